@@ -0,0 +1,75 @@
+#include "Game/AabbUtils.hpp"
+
+#include <algorithm>
+
+
+AABB2 UnionBounds(const AABB2& a, const AABB2& b)
+{
+	return AABB2(
+		Vec2(std::min(a.mins.x, b.mins.x), std::min(a.mins.y, b.mins.y)),
+		Vec2(std::max(a.maxs.x, b.maxs.x), std::max(a.maxs.y, b.maxs.y)));
+}
+
+
+// stands in for surface area when costing tree insertions in 2D
+float GetPerimeter(const AABB2& bounds)
+{
+	return 2.0f * ((bounds.maxs.x - bounds.mins.x) + (bounds.maxs.y - bounds.mins.y));
+}
+
+
+bool BoundsContain(const AABB2& outer, const AABB2& inner)
+{
+	return outer.mins.x <= inner.mins.x && outer.mins.y <= inner.mins.y
+		&& outer.maxs.x >= inner.maxs.x && outer.maxs.y >= inner.maxs.y;
+}
+
+
+bool BoundsOverlap(const AABB2& a, const AABB2& b)
+{
+	return a.mins.x <= b.maxs.x && b.mins.x <= a.maxs.x
+		&& a.mins.y <= b.maxs.y && b.mins.y <= a.maxs.y;
+}
+
+
+// slab test, out_t is where the ray enters the box (0 when it starts inside)
+bool RayHitsBounds(const Ray2& ray, const AABB2& bounds, const float max_t, float& out_t)
+{
+	float t_start = 0.0f;
+	float t_end = max_t;
+	const float origin[2] = { ray.m_pos.x, ray.m_pos.y };
+	const float dir[2] = { ray.m_dir.x, ray.m_dir.y };
+	const float mins[2] = { bounds.mins.x, bounds.mins.y };
+	const float maxs[2] = { bounds.maxs.x, bounds.maxs.y };
+	for(int axis = 0; axis < 2; ++axis)
+	{
+		if(dir[axis] == 0.0f)
+		{
+			if(origin[axis] < mins[axis] || origin[axis] > maxs[axis])
+			{
+				return false;
+			}
+
+			continue;
+		}
+
+		float t_near = (mins[axis] - origin[axis]) / dir[axis];
+		float t_far = (maxs[axis] - origin[axis]) / dir[axis];
+		if(t_near > t_far)
+		{
+			const float swap = t_near;
+			t_near = t_far;
+			t_far = swap;
+		}
+
+		t_start = t_near > t_start ? t_near : t_start;
+		t_end = t_far < t_end ? t_far : t_end;
+		if(t_start > t_end)
+		{
+			return false;
+		}
+	}
+
+	out_t = t_start;
+	return true;
+}
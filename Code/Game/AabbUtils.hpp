@@ -0,0 +1,11 @@
+#pragma once
+#include "Engine/Math/AABB2.hpp"
+#include "Engine/Math/Ray2.hpp"
+
+// Box helpers shared by the bounding volume hierarchies.
+
+AABB2	UnionBounds(const AABB2& a, const AABB2& b);
+float	GetPerimeter(const AABB2& bounds);
+bool	BoundsContain(const AABB2& outer, const AABB2& inner);
+bool	BoundsOverlap(const AABB2& a, const AABB2& b);
+bool	RayHitsBounds(const Ray2& ray, const AABB2& bounds, float max_t, float& out_t);
@@ -1,11 +1,16 @@
 #include "Game/App.hpp"
 #include "Game/GameCommon.hpp"
+#include "Game/MemoryTags.hpp"
+#include "Game/Profiler.hpp"
+#include "Game/QueryCounters.hpp"
+#include "Game/ScenarioRunner.hpp"
 #include "Engine/EngineCommon.hpp"
 #include "Engine/Renderer/RenderContext.hpp"
 #include "Engine/Renderer/DebugRender.hpp"
 #include "Engine/Audio/AudioSystem.hpp"
 #include "Engine/Core/Time.hpp"
 #include "Engine/Core/DevConsole.hpp"
+#include "Engine/Core/StringUtils.hpp"
 #include "Engine/Core/WindowContext.hpp"
 #include "Engine/Core/Clock.hpp"
 #include "Engine/Memory/Mem.hpp"
@@ -35,6 +40,152 @@ STATIC bool App::LogMemAlloc(EventArgs& args)
 }
 
 
+// per shape columns are for sizing budgets of bigger levels, reset=true restarts the high water marks
+STATIC bool App::PrintMemTags(EventArgs& args)
+{
+	const int num_shapes = g_theApp->GetGame()->GetShapeComponents().GetCount();
+	const double per_shape = num_shapes > 0 ? 1.0 / static_cast<double>(num_shapes) : 0.0;
+
+	g_theDevConsole->PrintString(Rgba::GREEN, Stringf("Memory tags for %i shapes:", num_shapes));
+	g_theDevConsole->PrintString(Rgba::GREEN, Stringf("  %-8s %12s %8s %12s %10s %10s", "tag", "live KiB", "count", "high KiB", "B/shape", "allocs"));
+
+	int64_t total_live = 0;
+	int64_t total_high = 0;
+	for(int tag_idx = 0; tag_idx < NUM_MEM_TAGS; ++tag_idx)
+	{
+		const MemTag tag = static_cast<MemTag>(tag_idx);
+		const MemTagStats& stats = MemTagGetStats(tag);
+		const int64_t live_bytes = stats.m_liveBytes.load(std::memory_order_relaxed);
+		const int64_t high_bytes = stats.m_highWaterBytes.load(std::memory_order_relaxed);
+		total_live += live_bytes;
+		total_high += high_bytes;
+
+		g_theDevConsole->PrintString(Rgba::GREEN, Stringf("  %-8s %12.1f %8lli %12.1f %10.1f %10lli",
+			GetMemTagName(tag),
+			static_cast<double>(live_bytes) / 1024.0,
+			static_cast<long long>(stats.m_liveCount.load(std::memory_order_relaxed)),
+			static_cast<double>(high_bytes) / 1024.0,
+			static_cast<double>(live_bytes) * per_shape,
+			static_cast<long long>(stats.m_totalCount.load(std::memory_order_relaxed))));
+	}
+
+	// high water marks peak at different times, so their sum is an upper bound
+	g_theDevConsole->PrintString(Rgba::GREEN, Stringf("  %-8s %12.1f %8s %12.1f %10.1f", "total",
+		static_cast<double>(total_live) / 1024.0, "", static_cast<double>(total_high) / 1024.0, static_cast<double>(total_live) * per_shape));
+
+	if(args.GetValue("reset", false))
+	{
+		MemTagResetHighWater();
+		g_theDevConsole->PrintString(Rgba::GREEN, "High water marks reset");
+	}
+	return true;
+}
+
+
+STATIC bool App::ExportProfile(EventArgs& args)
+{
+	const std::string file_path = args.GetValue("file", std::string("Data/Log/profile.json"));
+	const int num_events = ProfilerExportChromeTrace(file_path.c_str());
+
+	if(num_events < 0)
+	{
+		g_theDevConsole->PrintString(Rgba::RED, Stringf("Could not write profile to %s", file_path.c_str()));
+		return false;
+	}
+
+	g_theDevConsole->PrintString(Rgba::GREEN, Stringf("Wrote %i profile events to %s", num_events, file_path.c_str()));
+	return true;
+}
+
+
+STATIC bool App::SaveScene(EventArgs& args)
+{
+	const std::string file_path = args.GetValue("file", std::string("Data/scene.scn"));
+	if(!g_theApp->GetGame()->SaveScene(file_path.c_str()))
+	{
+		g_theDevConsole->PrintString(Rgba::RED, Stringf("Could not write scene to %s", file_path.c_str()));
+		return false;
+	}
+
+	g_theDevConsole->PrintString(Rgba::GREEN, Stringf("Wrote scene to %s", file_path.c_str()));
+	return true;
+}
+
+
+STATIC bool App::LoadScene(EventArgs& args)
+{
+	const std::string file_path = args.GetValue("file", std::string("Data/scene.scn"));
+	if(!g_theApp->GetGame()->LoadScene(file_path.c_str()))
+	{
+		g_theDevConsole->PrintString(Rgba::RED, Stringf("Could not load scene from %s", file_path.c_str()));
+		return false;
+	}
+
+	g_theDevConsole->PrintString(Rgba::GREEN, Stringf("Loaded scene from %s", file_path.c_str()));
+	return true;
+}
+
+
+STATIC bool App::RecordInput(EventArgs& args)
+{
+	UNUSED(args);
+	g_theApp->GetGame()->StartInputRecording();
+	g_theDevConsole->PrintString(Rgba::GREEN, "Recording input, InputSave to stop");
+	return true;
+}
+
+
+STATIC bool App::SaveInput(EventArgs& args)
+{
+	const std::string file_path = args.GetValue("file", std::string("Data/input.rec"));
+	if(!g_theApp->GetGame()->StopInputRecording(file_path.c_str()))
+	{
+		g_theDevConsole->PrintString(Rgba::RED, Stringf("Could not write input recording to %s", file_path.c_str()));
+		return false;
+	}
+
+	g_theDevConsole->PrintString(Rgba::GREEN, Stringf("Wrote input recording to %s", file_path.c_str()));
+	return true;
+}
+
+
+STATIC bool App::ReplayInput(EventArgs& args)
+{
+	const std::string file_path = args.GetValue("file", std::string("Data/input.rec"));
+	if(!g_theApp->GetGame()->StartInputReplay(file_path.c_str()))
+	{
+		g_theDevConsole->PrintString(Rgba::RED, Stringf("Could not replay input from %s", file_path.c_str()));
+		return false;
+	}
+
+	g_theDevConsole->PrintString(Rgba::GREEN, Stringf("Replaying input from %s", file_path.c_str()));
+	return true;
+}
+
+
+STATIC bool App::BenchmarkSnapshots(EventArgs& args)
+{
+	const int num_ticks = args.GetValue("ticks", 600);
+	const float changed_fraction = args.GetValue("changed", 0.05f);
+
+	const SnapshotBenchmarkResult result = RunSnapshotBenchmark(g_theApp->GetGame()->GetShapeComponents(), num_ticks, changed_fraction);
+	if(result.m_numTicks <= 0 || result.m_numShapes == 0)
+	{
+		g_theDevConsole->PrintString(Rgba::RED, "Snapshot benchmark needs shapes and at least one tick");
+		return false;
+	}
+
+	const double shapes_encoded = static_cast<double>(result.m_numShapes) * static_cast<double>(result.m_numTicks);
+	g_theDevConsole->PrintString(Rgba::GREEN, Stringf("Snapshots: %i shapes, %i ticks, %.0f bytes per tick, %i mismatches",
+		result.m_numShapes, result.m_numTicks, static_cast<double>(result.m_totalBytes) / result.m_numTicks, result.m_numMismatches));
+	g_theDevConsole->PrintString(Rgba::GREEN, Stringf("  encode %.3fms per tick, %.1fM shapes/s",
+		result.m_encodeMs / result.m_numTicks, shapes_encoded / (result.m_encodeMs * 1000.0)));
+	g_theDevConsole->PrintString(Rgba::GREEN, Stringf("  decode %.3fms per tick, %.1fMB/s",
+		result.m_decodeMs / result.m_numTicks, static_cast<double>(result.m_totalBytes) / (result.m_decodeMs * 1000.0)));
+	return true;
+}
+
+
 App::App() : m_theGame(nullptr)
 {
 	ParseXmlFileToNamedString(g_gameConfigBlackboard, "Data/GameConfig.xml");
@@ -67,19 +218,39 @@ void App::Startup()
 	g_theEventSystem->SubscribeEventCallbackFunction("quit", QuitRequest);
 	g_theEventSystem->SubscribeEventCallbackFunction("ShowMemAlloc", PrintMemAlloc);
 	g_theEventSystem->SubscribeEventCallbackFunction("LogMemAlloc", LogMemAlloc);
+	g_theEventSystem->SubscribeEventCallbackFunction("MemTags", PrintMemTags);
+	g_theEventSystem->SubscribeEventCallbackFunction("ProfileExport", ExportProfile);
+	g_theEventSystem->SubscribeEventCallbackFunction("SceneSave", SaveScene);
+	g_theEventSystem->SubscribeEventCallbackFunction("SceneLoad", LoadScene);
+	g_theEventSystem->SubscribeEventCallbackFunction("InputRecord", RecordInput);
+	g_theEventSystem->SubscribeEventCallbackFunction("InputSave", SaveInput);
+	g_theEventSystem->SubscribeEventCallbackFunction("InputReplay", ReplayInput);
+	g_theEventSystem->SubscribeEventCallbackFunction("SnapshotBench", BenchmarkSnapshots);
 	DevConPrintMemTrackType();
+
+	// a scenario file turns the run into a batch job that quits once the results are written
+	const std::string scenario_file = g_gameConfigBlackboard.GetValue("scenarioFile", std::string(""));
+	if(!scenario_file.empty())
+	{
+		RunScenarios(scenario_file);
+		m_isQuitting = true;
+	}
 }
 
 
 void App::Shutdown()
 {
 	m_theGame->Shutdown();
+	ProfilerShutdown();
+	QueryCountersShutdown();
 	EngineShutdown();
 }
 
 
 void App::RunFrame()
 {
+	PROFILE_SCOPE("App::RunFrame");
+
 	BeginFrame();
 	Update();
 	Render();
@@ -158,6 +329,38 @@ void App::HardRestart()
 }
 
 
+// every scenario gets a fresh game so nothing carries over from the one before
+bool App::RunScenarios(const std::string& file_path)
+{
+	ScenarioRunner runner;
+	if(!runner.LoadScenarios(file_path.c_str()))
+	{
+		DebuggerPrintf("Could not load any scenarios from %s\n", file_path.c_str());
+		return false;
+	}
+
+	const int num_scenarios = runner.GetNumScenarios();
+	for(int scenario_idx = 0; scenario_idx < num_scenarios; ++scenario_idx)
+	{
+		const ScenarioConfig& config = runner.GetScenario(scenario_idx);
+		DebuggerPrintf("Scenario %i / %i: %s\n", scenario_idx + 1, num_scenarios, config.m_name.c_str());
+
+		HardRestart();
+		runner.AddResult(ScenarioRunner::RunScenario(*m_theGame, config));
+	}
+
+	const std::string csv_path = runner.GetOutputPath() + ".csv";
+	const std::string json_path = runner.GetOutputPath() + ".json";
+	const bool wrote_csv = runner.WriteCsv(csv_path.c_str());
+	const bool wrote_json = runner.WriteJson(json_path.c_str());
+	DebuggerPrintf("Scenario results %s %s, %s %s\n",
+		wrote_csv ? "written to" : "could not be written to", csv_path.c_str(),
+		wrote_json ? "written to" : "could not be written to", json_path.c_str());
+
+	return wrote_csv && wrote_json;
+}
+
+
 bool App::HandleKeyPressed(const unsigned char key_code)
 {
 	switch (key_code)
@@ -16,10 +16,21 @@ public:
 	bool HandleKeyReleased(unsigned char key_code);
 	bool HandleQuitRequested();
 	void HardRestart();
+	bool RunScenarios(const std::string& file_path);
 
 	static bool QuitRequest(EventArgs& args);
 	static bool PrintMemAlloc(EventArgs& args);
 	static bool LogMemAlloc(EventArgs& args);
+	static bool PrintMemTags(EventArgs& args);
+	static bool ExportProfile(EventArgs& args);
+	static bool SaveScene(EventArgs& args);
+	static bool LoadScene(EventArgs& args);
+	static bool RecordInput(EventArgs& args);
+	static bool SaveInput(EventArgs& args);
+	static bool ReplayInput(EventArgs& args);
+	static bool BenchmarkSnapshots(EventArgs& args);
+
+	Game* GetGame() const { return m_theGame; }
 
 private:
 	void BeginFrame() const;
@@ -1,4 +1,6 @@
 #include "Game/BSPTree.hpp"
+#include "Game/Profiler.hpp"
+#include "Game/QueryCounters.hpp"
 
 #include "Engine/Math/MathUtils.hpp"
 #include "Engine/Math/Ray2.hpp"
@@ -12,11 +14,63 @@ BSPNode::~BSPNode()
 }
 
 
-BSPTree::BSPTree()
+BSPIterator::BSPIterator() = default;
+BSPIterator::~BSPIterator() = default;
+
+
+void BSPIterator::Reset(const BSPTree& tree, const Vec2& viewpoint, const BspTraversalOrder order)
+{
+	m_tree = &tree;
+	m_viewpoint = viewpoint;
+	m_order = order;
+
+	m_stack.clear();
+	if(tree.GetNumNodes() > 0)
+	{
+		m_stack.push_back({ 0, false });
+	}
+}
+
+
+bool BSPIterator::Next(int& out_node_idx)
 {
-	m_bspTree = std::vector<BSPNode>();
-	m_sceneSegments = std::vector<Segment2>();
+	while(!m_stack.empty())
+	{
+		const StackEntry entry = m_stack.back();
+		m_stack.pop_back();
+
+		const BSPNode& node = m_tree->GetNode(entry.m_nodeIdx);
+		if(node.m_isLeaf || entry.m_childrenPushed)
+		{
+			out_node_idx = entry.m_nodeIdx;
+			return true;
+		}
+
+		// on the plane counts as in front, same as ClassifyPoint's callers
+		const bool viewpoint_in_front = DotProduct(node.m_split.m_normal, m_viewpoint) >= node.m_split.m_signedDistance;
+		const bool front_first = viewpoint_in_front == (m_order == BSP_FRONT_TO_BACK);
+		const int first_idx = front_first ? node.m_frontChildIdx : node.m_backChildIdx;
+		const int second_idx = front_first ? node.m_backChildIdx : node.m_frontChildIdx;
 
+		// stack, so pushed in reverse
+		if(second_idx != -1)
+		{
+			m_stack.push_back({ second_idx, false });
+		}
+		m_stack.push_back({ entry.m_nodeIdx, true });
+		if(first_idx != -1)
+		{
+			m_stack.push_back({ first_idx, false });
+		}
+	}
+
+	return false;
+}
+
+//--------------------------------------------------------------------
+
+BSPTree::BSPTree()
+{
 	m_material = g_theRenderer->CreateOrGetMaterial("white.mat");
 }
 
@@ -29,6 +83,8 @@ BSPTree::~BSPTree()
 
 void BSPTree::BuildBspTree(BspHeuristic plane_selection, const std::vector<ConvexShape2D*>& geometry_list)
 {
+	PROFILE_SCOPE("BSPTree::BuildBspTree");
+
 	m_heuristicType = plane_selection;
 	Clear();
 
@@ -73,6 +129,7 @@ void BSPTree::BuildBspTree(BspHeuristic plane_selection, const std::vector<Conve
 
 bool BSPTree::CanSee(const Vec2& start, const Vec2& end, Vec2& out_end)
 {
+	QUERY_COUNT(QUERY_CAN_SEE);
 	const bool result = CanSee(start, end, out_end, 0);
 	return result;
 }
@@ -84,6 +141,24 @@ void BSPTree::Render() const
 }
 
 
+int BSPTree::GetNumNodes() const
+{
+	return static_cast<int>(m_bspTree.size());
+}
+
+
+BspHeuristic BSPTree::GetHeuristic() const
+{
+	return m_heuristicType;
+}
+
+
+const BSPNode& BSPTree::GetNode(const int node_idx) const
+{
+	return m_bspTree[node_idx];
+}
+
+
 void BSPTree::BuildBspSubTree(int current_node_idx, const std::vector<int>& seg_index_list, int parent_idx)
 {
 	std::vector<int> front_idx_list = std::vector<int>();
@@ -190,8 +265,7 @@ void BSPTree::Clear()
 	int num_nodes = static_cast<int>(m_bspTree.size());
 	for(int node_idx = 0; node_idx < num_nodes; ++node_idx)
 	{
-		delete m_bspTree[node_idx].m_mesh;
-		m_bspTree[node_idx].m_mesh = nullptr;
+		TaggedDelete(MEM_TAG_MESHES, m_bspTree[node_idx].m_mesh);
 	}
 
 	m_bspTree.clear();
@@ -491,7 +565,7 @@ void BSPTree::SetMesh(int current_node_idx)
 			Rgba color(static_cast<float>(hue_step * num_ancestors));
 
 			CpuMeshAddLine(&ray_mesh, false, start, end, line_thickness, color);
-			current_node.m_mesh = new GPUMesh(g_theRenderer);
+			current_node.m_mesh = TaggedNew<GPUMesh>(MEM_TAG_MESHES, g_theRenderer);
 			current_node.m_mesh->CreateFromCPUMesh<Vertex_PCU>(ray_mesh);
 		}
 	}
@@ -519,7 +593,7 @@ void BSPTree::SetMesh(int current_node_idx)
 			Rgba color(static_cast<float>(hue_step * num_ancestors));
 			
 			CpuMeshAddLine(&ray_mesh, false, start, end, line_thickness, color);
-			current_node.m_mesh = new GPUMesh(g_theRenderer);
+			current_node.m_mesh = TaggedNew<GPUMesh>(MEM_TAG_MESHES, g_theRenderer);
 			current_node.m_mesh->CreateFromCPUMesh<Vertex_PCU>(ray_mesh);
 		}
 	}
@@ -547,7 +621,7 @@ void BSPTree::SetMesh(int current_node_idx)
 			Rgba color(static_cast<float>(hue_step * num_ancestors));
 			
 			CpuMeshAddLine(&plane_mesh, start, end, line_thickness, color);
-			current_node.m_mesh = new GPUMesh(g_theRenderer);
+			current_node.m_mesh = TaggedNew<GPUMesh>(MEM_TAG_MESHES, g_theRenderer);
 			current_node.m_mesh->CreateFromCPUMesh<Vertex_PCU>(plane_mesh);
 		}
 	}
@@ -596,9 +670,10 @@ void BSPTree::RenderNode(int current_node_idx) const
 bool BSPTree::CanSee(const Vec2& start, const Vec2& end, Vec2& out_end, int current_node_idx)
 {
 	float t_val;
-	Vec2 intersection;
+	Vec2 intersection = start;
 	bool is_open_space;
 	BSPNode& current_node = m_bspTree[current_node_idx];
+	QUERY_COUNT(QUERY_BSP_NODES_VISITED);
 
 	//for either start or end
 	if(current_node.m_isLeaf)
@@ -660,7 +735,6 @@ bool BSPTree::CanSee(const Vec2& start, const Vec2& end, Vec2& out_end, int curr
 
 	// last check
 	is_open_space = CanSee(start, end, out_end, current_node.m_backChildIdx);
-	out_end = intersection;
 	return is_open_space;
 }
 
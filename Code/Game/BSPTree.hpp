@@ -3,6 +3,7 @@
 #include "Engine/Math/Segment2.hpp"
 
 #include "Game/ConvexShape.hpp"
+#include "Game/MemoryTags.hpp"
 
 #include <vector>
 
@@ -52,6 +53,42 @@ struct BSPNode
 	GPUMesh* m_mesh = nullptr;
 };
 
+enum BspTraversalOrder
+{
+	BSP_FRONT_TO_BACK,
+	BSP_BACK_TO_FRONT
+};
+
+class BSPTree;
+
+// Walks the tree relative to a viewpoint. Interior nodes come out between their two children, which is
+// when their m_segment should be used; leaves come out as the cells they are. Front to back, anything
+// yielded earlier is never behind anything yielded later along a ray from the viewpoint.
+// Reset and reuse one of these rather than making a new one per walk, the stack stays allocated.
+class BSPIterator
+{
+public:
+	BSPIterator();
+	~BSPIterator();
+
+	void Reset(const BSPTree& tree, const Vec2& viewpoint, BspTraversalOrder order);
+	bool Next(int& out_node_idx);
+
+private:
+	struct StackEntry
+	{
+		int		m_nodeIdx = -1;
+		bool	m_childrenPushed = false;
+	};
+
+	const BSPTree*			m_tree = nullptr;
+	Vec2					m_viewpoint;
+	BspTraversalOrder		m_order = BSP_FRONT_TO_BACK;
+	TaggedVector<StackEntry, MEM_TAG_SCRATCH>	m_stack;
+};
+
+//--------------------------------------------------------------------
+
 class BSPTree
 {
 public:
@@ -64,6 +101,10 @@ public:
 	void Render() const;
 	
 	void Clear();
+
+	int				GetNumNodes() const;
+	BspHeuristic	GetHeuristic() const;
+	const BSPNode&	GetNode(int node_idx) const;
 	
 private:
 	//accessors 
@@ -87,8 +128,8 @@ private:
 	bool	GetIntersection(const Vec2& start, const Vec2& end, const Plane2& plane, Vec2& intersection, float& t);
 	
 private:
-	std::vector<BSPNode> m_bspTree;
-	std::vector<Segment2> m_sceneSegments;
+	TaggedVector<BSPNode, MEM_TAG_BSP> m_bspTree;
+	TaggedVector<Segment2, MEM_TAG_BSP> m_sceneSegments;
 	BspHeuristic m_heuristicType = HEURISTIC_RANDOM;
 
 	Material* m_material = nullptr;
@@ -0,0 +1,302 @@
+#include "Game/BitStream.hpp"
+#include "Game/ByteBufferParser.hpp"
+#include "Game/ByteBufferWriter.hpp"
+
+#include "Engine/Core/ErrorWarningAssert.hpp"
+
+#include <vector>
+
+
+BitWriter::BitWriter(ByteBufferWriter& writer): m_writer(writer)
+{
+	m_sizeSlot = m_writer.ReserveSlot<uint>();
+}
+
+
+BitWriter::~BitWriter() = default;
+
+
+void BitWriter::WriteBits(const uint value, const int num_bits)
+{
+	ASSERT_OR_DIE(num_bits >= 0 && num_bits <= 32, "BitWriter writes at most 32 bits at once");
+	if(num_bits == 0)
+	{
+		return;
+	}
+
+	const uint64_t mask = (static_cast<uint64_t>(1) << num_bits) - 1;
+	m_scratch |= (static_cast<uint64_t>(value) & mask) << m_numScratchBits;
+	m_numScratchBits += num_bits;
+	m_numBitsWritten += num_bits;
+
+	if(m_numScratchBits >= 32)
+	{
+		m_writer.WriteUnsignedInt(static_cast<uint>(m_scratch));
+		m_scratch >>= 32;
+		m_numScratchBits -= 32;
+	}
+}
+
+
+void BitWriter::WriteBit(const bool value)
+{
+	WriteBits(value ? 1u : 0u, 1);
+}
+
+
+// order 0, one bit for zero and growing by two bits each time the value doubles
+void BitWriter::WriteExpGolomb(const uint value)
+{
+	ASSERT_OR_DIE(value < 0x7FFFFFFF, "Exp-Golomb codes are limited to 31 bit values");
+
+	const uint shifted = value + 1;
+	int num_low_bits = 0;
+	while((shifted >> (num_low_bits + 1)) != 0)
+	{
+		++num_low_bits;
+	}
+
+	// zeros then a one for the length, then the bits under the implied leading one
+	WriteBits(1u << num_low_bits, num_low_bits + 1);
+	WriteBits(shifted & ((1u << num_low_bits) - 1), num_low_bits);
+}
+
+
+// the tail goes out a byte at a time so the stream never carries more than seven bits of padding,
+// the prefix is the bit count so the reader can tell the last word from the tail bytes
+void BitWriter::Finish()
+{
+	while(m_numScratchBits > 0)
+	{
+		m_writer.WriteByte(static_cast<uchar>(m_scratch & 0xFF));
+		m_scratch >>= 8;
+		m_numScratchBits -= 8;
+	}
+
+	m_scratch = 0;
+	m_numScratchBits = 0;
+	m_writer.PatchValue<uint>(m_sizeSlot, static_cast<uint>(m_numBitsWritten));
+}
+
+//--------------------------------------------------------------------
+
+BitReader::BitReader(ByteBufferParser& parser): m_parser(parser)
+{
+	if(!m_parser.HasBytes(sizeof(uint)))
+	{
+		m_overflowed = true;
+		return;
+	}
+
+	const uint num_bits = m_parser.ParseUnsignedInt();
+	m_wordsLeft = num_bits / 32;
+	m_bytesLeft = m_wordsLeft * sizeof(uint) + (num_bits % 32 + 7) / 8;
+	if(!m_parser.HasBytes(m_bytesLeft))
+	{
+		m_wordsLeft = 0;
+		m_bytesLeft = 0;
+		m_overflowed = true;
+	}
+}
+
+
+BitReader::~BitReader() = default;
+
+
+uint BitReader::ReadBits(const int num_bits)
+{
+	ASSERT_OR_DIE(num_bits >= 0 && num_bits <= 32, "BitReader reads at most 32 bits at once");
+	if(num_bits == 0)
+	{
+		return 0;
+	}
+
+	Refill(num_bits);
+	if(m_numScratchBits < num_bits)
+	{
+		m_overflowed = true;
+		m_scratch = 0;
+		m_numScratchBits = 0;
+		return 0;
+	}
+
+	const uint64_t mask = (static_cast<uint64_t>(1) << num_bits) - 1;
+	const uint value = static_cast<uint>(m_scratch & mask);
+	m_scratch >>= num_bits;
+	m_numScratchBits -= num_bits;
+
+	return value;
+}
+
+
+bool BitReader::ReadBit()
+{
+	return ReadBits(1) != 0;
+}
+
+
+uint BitReader::ReadExpGolomb()
+{
+	int num_low_bits = 0;
+	while(!ReadBit())
+	{
+		if(m_overflowed || num_low_bits == 30)
+		{
+			m_overflowed = true;
+			return 0;
+		}
+		++num_low_bits;
+	}
+
+	const uint low_bits = ReadBits(num_low_bits);
+	return ((1u << num_low_bits) | low_bits) - 1;
+}
+
+
+// skips whatever of the stream was not read so the parser is past it
+void BitReader::Finish()
+{
+	m_parser.SetHead(m_parser.GetHead() + m_bytesLeft);
+	m_wordsLeft = 0;
+	m_bytesLeft = 0;
+	m_scratch = 0;
+	m_numScratchBits = 0;
+}
+
+
+// whole words in the writer's byte order, then the tail byte by byte the way Finish left it
+void BitReader::Refill(const int num_bits)
+{
+	while(m_numScratchBits < num_bits && m_bytesLeft > 0)
+	{
+		if(m_wordsLeft > 0)
+		{
+			m_scratch |= static_cast<uint64_t>(m_parser.ParseUnsignedInt()) << m_numScratchBits;
+			m_numScratchBits += 32;
+			m_bytesLeft -= sizeof(uint);
+			--m_wordsLeft;
+		}
+		else
+		{
+			m_scratch |= static_cast<uint64_t>(m_parser.ParseByte()) << m_numScratchBits;
+			m_numScratchBits += 8;
+			--m_bytesLeft;
+		}
+	}
+}
+
+//--------------------------------------------------------------------
+
+// a code is 2 * floor(log2(value + 1)) + 1 bits, so values either side of each 2^n - 1 change length
+UNITTEST("BitStream Exp-Golomb boundary values", "BitStream", 0)
+{
+	std::vector<uint> values;
+	std::vector<int> lengths;
+	values.push_back(0);
+	lengths.push_back(1);
+	for(int num_low_bits = 1; num_low_bits <= 30; ++num_low_bits)
+	{
+		const uint first_of_length = (1u << num_low_bits) - 1;
+		values.push_back(first_of_length - 1);
+		lengths.push_back(2 * num_low_bits - 1);
+		values.push_back(first_of_length);
+		lengths.push_back(2 * num_low_bits + 1);
+	}
+	values.push_back(0x7FFFFFFE);
+	lengths.push_back(61);
+
+	ByteBufferWriter writer;
+	BitWriter bit_writer(writer);
+	const int num_values = static_cast<int>(values.size());
+	for(int value_idx = 0; value_idx < num_values; ++value_idx)
+	{
+		const size_t bits_before = bit_writer.GetNumBits();
+		bit_writer.WriteExpGolomb(values[value_idx]);
+		if(bit_writer.GetNumBits() - bits_before != static_cast<size_t>(lengths[value_idx]))
+		{
+			return false;
+		}
+	}
+	bit_writer.WriteBits(0x5A, 8);
+	bit_writer.Finish();
+	writer.WriteInt(1234);
+
+	ByteBufferParser parser(writer.GetData(), writer.GetSize());
+	BitReader bit_reader(parser);
+	for(int value_idx = 0; value_idx < num_values; ++value_idx)
+	{
+		if(bit_reader.ReadExpGolomb() != values[value_idx])
+		{
+			return false;
+		}
+	}
+
+	const uint marker = bit_reader.ReadBits(8);
+	const bool overflowed = bit_reader.HasOverflowed();
+	bit_reader.Finish();
+	return marker == 0x5A && !overflowed && parser.ParseInt() == 1234 && parser.GetBytesLeft() == 0;
+}
+
+
+// every width lands on both sides of a word boundary somewhere in the stream
+UNITTEST("BitStream round trips mixed widths", "BitStream", 0)
+{
+	ByteBufferWriter writer;
+	BitWriter bit_writer(writer);
+	for(int num_bits = 0; num_bits <= 32; ++num_bits)
+	{
+		const uint value = num_bits == 32 ? 0xC3A5F00Fu : (0xC3A5F00Fu & ((1u << num_bits) - 1));
+		bit_writer.WriteBits(value, num_bits);
+		bit_writer.WriteBit(num_bits % 3 == 0);
+	}
+	bit_writer.Finish();
+
+	ByteBufferParser parser(writer.GetData(), writer.GetSize());
+	BitReader bit_reader(parser);
+	for(int num_bits = 0; num_bits <= 32; ++num_bits)
+	{
+		const uint value = num_bits == 32 ? 0xC3A5F00Fu : (0xC3A5F00Fu & ((1u << num_bits) - 1));
+		if(bit_reader.ReadBits(num_bits) != value || bit_reader.ReadBit() != (num_bits % 3 == 0))
+		{
+			return false;
+		}
+	}
+
+	// the stream is used up, more reads give zeros and flag it
+	if(bit_reader.HasOverflowed() || bit_reader.ReadBits(8) != 0 || !bit_reader.HasOverflowed())
+	{
+		return false;
+	}
+
+	bit_reader.Finish();
+	return parser.GetBytesLeft() == 0;
+}
+
+
+UNITTEST("BitStream flags truncated and unterminated streams", "BitStream", 0)
+{
+	ByteBufferWriter writer;
+	BitWriter bit_writer(writer);
+	bit_writer.WriteBits(0, 20);
+	bit_writer.Finish();
+
+	// twenty zeros is a code prefix that never ends
+	ByteBufferParser parser(writer.GetData(), writer.GetSize());
+	BitReader bit_reader(parser);
+	if(bit_reader.ReadExpGolomb() != 0 || !bit_reader.HasOverflowed())
+	{
+		return false;
+	}
+
+	// the bit count says more is coming than the buffer holds
+	ByteBufferParser short_parser(writer.GetData(), writer.GetSize() - 1);
+	BitReader short_reader(short_parser);
+	if(!short_reader.HasOverflowed() || short_reader.ReadBits(1) != 0)
+	{
+		return false;
+	}
+
+	ByteBufferParser empty_parser(writer.GetData(), 2);
+	BitReader empty_reader(empty_parser);
+	return empty_reader.HasOverflowed();
+}
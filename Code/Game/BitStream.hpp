@@ -0,0 +1,60 @@
+#pragma once
+#include "Game/GameCommon.hpp"
+
+#include <cstdint>
+
+class ByteBufferParser;
+class ByteBufferWriter;
+
+// Packs bit fields least significant bit first into 32 bit words of a ByteBufferWriter. The packed
+// stream is prefixed with its bit count so a BitReader knows where it ends, and Finish has to be
+// called before anything else goes into the writer.
+class BitWriter
+{
+public:
+	explicit BitWriter(ByteBufferWriter& writer);
+	~BitWriter();
+
+	void	WriteBits(uint value, int num_bits);
+	void	WriteBit(bool value);
+	void	WriteExpGolomb(uint value);
+	void	Finish();
+
+	size_t	GetNumBits() const		{ return m_numBitsWritten; }
+
+private:
+	ByteBufferWriter&	m_writer;
+	size_t				m_sizeSlot = 0;
+	uint64_t			m_scratch = 0;
+	int					m_numScratchBits = 0;
+	size_t				m_numBitsWritten = 0;
+};
+
+//--------------------------------------------------------------------
+
+// Reads what a BitWriter packed. Reading past the end of the stream gives zero bits and sets the
+// overflow flag instead of asserting, packets come from outside the process.
+class BitReader
+{
+public:
+	explicit BitReader(ByteBufferParser& parser);
+	~BitReader();
+
+	uint	ReadBits(int num_bits);
+	bool	ReadBit();
+	uint	ReadExpGolomb();
+	void	Finish();
+
+	bool	HasOverflowed() const	{ return m_overflowed; }
+
+private:
+	void	Refill(int num_bits);
+
+private:
+	ByteBufferParser&	m_parser;
+	size_t				m_wordsLeft = 0;
+	size_t				m_bytesLeft = 0;
+	uint64_t			m_scratch = 0;
+	int					m_numScratchBits = 0;
+	bool				m_overflowed = false;
+};
@@ -1,95 +1,193 @@
 #include "Game/ByteBufferParser.hpp"
 
-#include "Engine/Core/ErrorWarningAssert.hpp"
-#include "Engine/Core/StringUtils.hpp"
-
-ByteBufferParser::ByteBufferParser(std::vector<uchar>& buffer) : m_buffer(buffer)
-{
-	//TODO this is file agnostic, buffer parser only cares about parsing an STD vector given from construction 
-	
-	// 	m_buffer.clear();
-	// 	m_buffer.reserve(size);
-	// 
-	//  FILE* file;
-	// 	errno_t err;
-	// 	const char* dir;
-	// 	uint size = 65'535;
-	// 	
-	// 	err = fopen_s(&file, dir, "rb");
-	// 
-	// 	if(err != 0)
-	// 	{
-	// 		ERROR_AND_DIE("cannot open file '%s': %s\n", dir, strerror(err));
-	// 	}
-	// 		
-	// 	fread(&m_buffer[0], sizeof(uchar), size, file);
-	// 	fclose(file);
-	
+
+ByteBufferParser::ByteBufferParser(const std::vector<uchar>& buffer, const endian buffer_endian)
+	: ByteBufferParser(buffer.data(), buffer.size(), buffer_endian)
+{
+}
+
+
+ByteBufferParser::ByteBufferParser(const uchar* data, const size_t size, const endian buffer_endian)
+	: m_data(data), m_size(size)
+{
+	SetEndian(buffer_endian);
 }
 
 
 ByteBufferParser::~ByteBufferParser() = default;
 
 
-uchar ByteBufferParser::ParseByte()
+// any non zero byte is true
+bool ByteBufferParser::ParseBool()
 {
-	const uint byte_size = sizeof(uchar);
-	const uint new_head_idx = m_head + byte_size;
-	const uint buffer_size = GetBufferSize();
-	ASSERT_OR_DIE(buffer_size > new_head_idx, "Attempting to read outside buffer");
+	return ParseValue<uchar>() != 0;
+}
 
-	uchar result = m_buffer[m_head];
-	m_head = new_head_idx;
 
-	return result;
+uchar ByteBufferParser::ParseByte()
+{
+	return ParseValue<uchar>();
 }
 
 
 char ByteBufferParser::ParseChar()
 {
-	const uint byte_size = sizeof(char);
-	const uint new_head_idx = m_head + byte_size;
-	const uint buffer_size = GetBufferSize();
-	ASSERT_OR_DIE(buffer_size > new_head_idx, "Attempting to read outside buffer");
+	return ParseValue<char>();
+}
 
-	char result = static_cast<char>(m_buffer[m_head]);
-	m_head = new_head_idx;
 
-	return result;
+short ByteBufferParser::ParseShort()
+{
+	return ParseValue<short>();
+}
+
+
+unsigned short ByteBufferParser::ParseUnsignedShort()
+{
+	return ParseValue<unsigned short>();
 }
 
 
 int ByteBufferParser::ParseInt()
 {
-	return 0;
+	return ParseValue<int>();
 }
 
 
 uint ByteBufferParser::ParseUnsignedInt()
 {
-	return 0;
+	return ParseValue<uint>();
+}
+
+
+int64_t ByteBufferParser::ParseInt64()
+{
+	return ParseValue<int64_t>();
+}
+
+
+uint64_t ByteBufferParser::ParseUnsignedInt64()
+{
+	return ParseValue<uint64_t>();
 }
 
 
 float ByteBufferParser::ParseFloat()
 {
-	return 0.0f;
+	return ParseValue<float>();
 }
 
 
-char* ByteBufferParser::ParseByteArray(uint size)
+double ByteBufferParser::ParseDouble()
 {
-	return nullptr;
+	return ParseValue<double>();
 }
 
 
-void ByteBufferParser::SetHead(uint idx)
+// 32 bit length, then the characters without a terminator
+std::string ByteBufferParser::ParseString()
 {
+	const uint length = ParseUnsignedInt();
+	const uchar* chars = ParseByteArray(length);
+	return std::string(reinterpret_cast<const char*>(chars), length);
 }
 
 
-uint ByteBufferParser::GetBufferSize() const
+// points into the buffer, valid for as long as the buffer is
+const uchar* ByteBufferParser::ParseByteArray(const size_t size)
 {
-	return static_cast<uint>(m_buffer.size());
+	RequireBytes(size);
+
+	const uchar* result = m_data + m_head;
+	m_head += size;
+	return result;
 }
 
+
+bool ByteBufferParser::HasBytes(const size_t num_bytes) const
+{
+	return num_bytes <= m_size - m_head;
+}
+
+
+void ByteBufferParser::RequireBytes(const size_t num_bytes) const
+{
+	ASSERT_OR_DIE(HasBytes(num_bytes), "Attempting to read outside buffer");
+}
+
+
+// one past the end is allowed, nothing can be read from there
+void ByteBufferParser::SetHead(const size_t idx)
+{
+	ASSERT_OR_DIE(idx <= m_size, "Attempting to move head outside buffer");
+	m_head = idx;
+}
+
+
+// alignment is relative to the buffer start, writers pad against the same origin
+void ByteBufferParser::AlignHead(const size_t alignment)
+{
+	SetHead((m_head + alignment - 1) / alignment * alignment);
+}
+
+
+void ByteBufferParser::SetEndian(const endian buffer_endian)
+{
+	m_swapBytes = buffer_endian != endian::ENDIAN_NATIVE;
+}
+
+//--------------------------------------------------------------------
+
+// parsing past the end dies, so these only walk up to it and check what is reported left
+UNITTEST("ByteBufferParser reports the bytes left", "ByteBuffer", 0)
+{
+	const uchar bytes[7] = { 1, 0, 0, 0, 2, 0, 9 };
+	ByteBufferParser parser(bytes, sizeof(bytes));
+
+	if(!parser.HasBytes(sizeof(bytes)) || parser.HasBytes(sizeof(bytes) + 1) || parser.HasBytes(~static_cast<size_t>(0)))
+	{
+		return false;
+	}
+
+	const int first = parser.ParseInt();
+	if(first != 1 || parser.GetBytesLeft() != 3 || parser.HasBytes(sizeof(int)))
+	{
+		return false;
+	}
+
+	const short second = parser.ParseShort();
+	if(second != 2 || parser.GetBytesLeft() != 1 || parser.HasBytes(2))
+	{
+		return false;
+	}
+
+	parser.ParseByte();
+	return parser.GetBytesLeft() == 0
+		&& parser.HasBytes(0)
+		&& !parser.HasBytes(1)
+		&& parser.GetHead() == parser.GetBufferSize();
+}
+
+
+UNITTEST("ByteBufferParser aligns and seeks within the buffer", "ByteBuffer", 0)
+{
+	const uchar bytes[12] = { 0 };
+	ByteBufferParser parser(bytes, sizeof(bytes));
+
+	parser.ParseByte();
+	parser.AlignHead(8);
+	if(parser.GetHead() != 8 || parser.GetBytesLeft() != 4)
+	{
+		return false;
+	}
+
+	// one past the end is a valid head with nothing left to read
+	parser.SetHead(sizeof(bytes));
+	if(parser.GetBytesLeft() != 0 || parser.HasBytes(1))
+	{
+		return false;
+	}
+
+	parser.SetHead(2);
+	return parser.GetBytesLeft() == 10 && parser.HasBytes(10) && !parser.HasBytes(11);
+}
@@ -1,6 +1,12 @@
 #pragma once
-#include"Game/GameCommon.hpp"
+#include "Game/GameCommon.hpp"
 
+#include "Engine/Core/ErrorWarningAssert.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
 #include <vector>
 
 enum class endian
@@ -10,48 +16,160 @@ enum class endian
 	ENDIAN_NATIVE = ENDIAN_LITTLE
 };
 
+
+template<typename T>
+T SwapEndian(const T& value)
+{
+	static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be byte swapped");
+
+	uchar bytes[sizeof(T)];
+	memcpy(bytes, &value, sizeof(T));
+	for(size_t low = 0, high = sizeof(T) - 1; low < high; ++low, --high)
+	{
+		const uchar swap = bytes[low];
+		bytes[low] = bytes[high];
+		bytes[high] = swap;
+	}
+
+	T result;
+	memcpy(&result, bytes, sizeof(T));
+	return result;
+}
+
+
+// Array of T sitting inside someone else's buffer, nothing is copied or owned
+template<typename T>
+struct BufferView
+{
+public:
+	const T*	begin() const						{ return m_data; }
+	const T*	end() const							{ return m_data + m_count; }
+	size_t		size() const						{ return m_count; }
+	const T&	operator[](const size_t idx) const	{ return m_data[idx]; }
+
+public:
+	const T*	m_data = nullptr;
+	size_t		m_count = 0;
+};
+
+//--------------------------------------------------------------------
+
+// Reads values back out of a byte buffer it does not own, a vector or any mapped range of memory.
+// Every Parse call checks the bytes are there. When a block of known size follows, RequireBytes
+// checks it once and the Unchecked reads skip the test. Views point straight into the buffer, so
+// they only work when the data is in native order and aligned for T.
 class ByteBufferParser
 {
-	ByteBufferParser(std::vector<uchar>& buffer);
+public:
+	explicit ByteBufferParser(const std::vector<uchar>& buffer, endian buffer_endian = endian::ENDIAN_NATIVE);
+	ByteBufferParser(const uchar* data, size_t size, endian buffer_endian = endian::ENDIAN_NATIVE);
 	~ByteBufferParser();
 
-	
-	// functions left
-	//		Boolean types
-	//			bool
-	//		integer
-	//			short
-	//			unsigned short
-	//			long
-	//			unsigned long
-	//			long long
-	//			unsigned long long int
-	//			__int8
-	//			__int16
-	//			__int32
-	//			__int64
-	//		Character 
-	//			signed char
-	//			unsigned char
-	//			wchar_t
-	//			char8_t
-	//			char16_t
-	//			char32_t
-	//		floating point
-	//			double
-	//			long double
-
-	uchar	ParseByte();
-	char	ParseChar();	
-	int		ParseInt();
-	uint		ParseUnsignedInt();
-	float	ParseFloat();
-	char*	ParseByteArray(uint size);
-	
-	void SetHead(uint idx);
-	uint GetBufferSize() const;
-	
-	std::vector<uchar>&		m_buffer;
-	uint					m_head = 0;
+	bool			ParseBool();
+	uchar			ParseByte();
+	char			ParseChar();
+	short			ParseShort();
+	unsigned short	ParseUnsignedShort();
+	int				ParseInt();
+	uint			ParseUnsignedInt();
+	int64_t			ParseInt64();
+	uint64_t		ParseUnsignedInt64();
+	float			ParseFloat();
+	double			ParseDouble();
+	std::string		ParseString();
+	const uchar*	ParseByteArray(size_t size);
+
+	template<typename T> T				ParseValue();
+	template<typename T> T				ParseValueUnchecked();
+	template<typename T> void			ParseArray(T* out_values, size_t count);
+	template<typename T> BufferView<T>	ParseView(size_t count);
+
+	bool	HasBytes(size_t num_bytes) const;
+	void	RequireBytes(size_t num_bytes) const;
+
+	void	SetHead(size_t idx);
+	void	AlignHead(size_t alignment);
+	void	SetEndian(endian buffer_endian);
 
+	size_t			GetHead() const			{ return m_head; }
+	size_t			GetBufferSize() const	{ return m_size; }
+	size_t			GetBytesLeft() const	{ return m_size - m_head; }
+	const uchar*	GetData() const			{ return m_data; }
+	bool			IsNativeEndian() const	{ return !m_swapBytes; }
+
+private:
+	template<typename T> void	RequireValues(size_t count) const;
+
+	const uchar*	m_data = nullptr;
+	size_t			m_size = 0;
+	size_t			m_head = 0;
+	bool			m_swapBytes = false;
 };
+
+
+template<typename T>
+T ByteBufferParser::ParseValue()
+{
+	RequireBytes(sizeof(T));
+	return ParseValueUnchecked<T>();
+}
+
+
+// only after RequireBytes has covered it
+template<typename T>
+T ByteBufferParser::ParseValueUnchecked()
+{
+	static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be parsed");
+
+	T result;
+	memcpy(&result, m_data + m_head, sizeof(T));
+	m_head += sizeof(T);
+
+	return m_swapBytes ? SwapEndian(result) : result;
+}
+
+
+// a corrupt count could wrap count * sizeof(T) past RequireBytes, so it's the count that gets bounded
+template<typename T>
+void ByteBufferParser::RequireValues(const size_t count) const
+{
+	ASSERT_OR_DIE(count <= GetBytesLeft() / sizeof(T), "Attempting to read outside buffer");
+}
+
+
+template<typename T>
+void ByteBufferParser::ParseArray(T* out_values, const size_t count)
+{
+	static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be parsed");
+
+	RequireValues<T>(count);
+	const size_t num_bytes = count * sizeof(T);
+	memcpy(out_values, m_data + m_head, num_bytes);
+	m_head += num_bytes;
+
+	if(m_swapBytes)
+	{
+		for(size_t value_idx = 0; value_idx < count; ++value_idx)
+		{
+			out_values[value_idx] = SwapEndian(out_values[value_idx]);
+		}
+	}
+}
+
+
+template<typename T>
+BufferView<T> ByteBufferParser::ParseView(const size_t count)
+{
+	static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be viewed");
+	ASSERT_OR_DIE(!m_swapBytes, "Views need the buffer in native byte order");
+	ASSERT_OR_DIE(reinterpret_cast<uintptr_t>(m_data + m_head) % alignof(T) == 0, "Views need the data aligned for its type");
+
+	RequireValues<T>(count);
+	const size_t num_bytes = count * sizeof(T);
+
+	BufferView<T> view;
+	view.m_data = reinterpret_cast<const T*>(m_data + m_head);
+	view.m_count = count;
+	m_head += num_bytes;
+	return view;
+}
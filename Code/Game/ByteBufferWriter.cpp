@@ -1,10 +1,332 @@
 #include "Game/ByteBufferWriter.hpp"
 
+#include <cstdio>
+#include <utility>
 
 
-ByteBufferWriter::ByteBufferWriter()
+ByteBufferWriter::ByteBufferWriter(const endian buffer_endian)
 {
+	SetEndian(buffer_endian);
+}
+
 
+ByteBufferWriter::ByteBufferWriter(uchar* external_buffer, const size_t capacity, const endian buffer_endian)
+	: m_data(external_buffer), m_capacity(capacity), m_ownsBuffer(false)
+{
+	SetEndian(buffer_endian);
 }
 
+
 ByteBufferWriter::~ByteBufferWriter() = default;
+
+
+// moving the vector keeps its allocation, so m_data stays valid; the source is left empty
+ByteBufferWriter::ByteBufferWriter(ByteBufferWriter&& other) noexcept
+{
+	*this = std::move(other);
+}
+
+
+ByteBufferWriter& ByteBufferWriter::operator=(ByteBufferWriter&& other) noexcept
+{
+	if(this == &other)
+	{
+		return *this;
+	}
+
+	m_ownedBuffer = std::move(other.m_ownedBuffer);
+	m_data = other.m_data;
+	m_size = other.m_size;
+	m_capacity = other.m_capacity;
+	m_ownsBuffer = other.m_ownsBuffer;
+	m_swapBytes = other.m_swapBytes;
+
+	other.m_ownedBuffer.clear();
+	other.m_data = nullptr;
+	other.m_size = 0;
+	other.m_capacity = 0;
+	other.m_ownsBuffer = true;
+	return *this;
+}
+
+
+void ByteBufferWriter::WriteBool(const bool value)
+{
+	WriteValue<uchar>(value ? 1 : 0);
+}
+
+
+void ByteBufferWriter::WriteByte(const uchar value)
+{
+	WriteValue(value);
+}
+
+
+void ByteBufferWriter::WriteChar(const char value)
+{
+	WriteValue(value);
+}
+
+
+void ByteBufferWriter::WriteShort(const short value)
+{
+	WriteValue(value);
+}
+
+
+void ByteBufferWriter::WriteUnsignedShort(const unsigned short value)
+{
+	WriteValue(value);
+}
+
+
+void ByteBufferWriter::WriteInt(const int value)
+{
+	WriteValue(value);
+}
+
+
+void ByteBufferWriter::WriteUnsignedInt(const uint value)
+{
+	WriteValue(value);
+}
+
+
+void ByteBufferWriter::WriteInt64(const int64_t value)
+{
+	WriteValue(value);
+}
+
+
+void ByteBufferWriter::WriteUnsignedInt64(const uint64_t value)
+{
+	WriteValue(value);
+}
+
+
+void ByteBufferWriter::WriteFloat(const float value)
+{
+	WriteValue(value);
+}
+
+
+void ByteBufferWriter::WriteDouble(const double value)
+{
+	WriteValue(value);
+}
+
+
+// same layout ByteBufferParser::ParseString reads, 32 bit length then the characters
+void ByteBufferWriter::WriteString(const std::string& value)
+{
+	WriteUnsignedInt(static_cast<uint>(value.size()));
+	WriteByteArray(value.data(), value.size());
+}
+
+
+void ByteBufferWriter::WriteByteArray(const void* bytes, const size_t size)
+{
+	EnsureCapacity(size);
+	memcpy(m_data + m_size, bytes, size);
+	m_size += size;
+}
+
+
+// room to write into directly, only good until the next write grows the buffer
+uchar* ByteBufferWriter::ReserveBytes(const size_t size)
+{
+	EnsureCapacity(size);
+
+	uchar* result = m_data + m_size;
+	m_size += size;
+	return result;
+}
+
+
+// pads with zeros, relative to the buffer start like ByteBufferParser::AlignHead
+void ByteBufferWriter::AlignTo(const size_t alignment)
+{
+	const size_t aligned_size = (m_size + alignment - 1) / alignment * alignment;
+	const size_t padding = aligned_size - m_size;
+
+	EnsureCapacity(padding);
+	memset(m_data + m_size, 0, padding);
+	m_size = aligned_size;
+}
+
+
+void ByteBufferWriter::Reserve(const size_t capacity)
+{
+	if(capacity <= m_capacity)
+	{
+		return;
+	}
+
+	ASSERT_OR_DIE(m_ownsBuffer, "A caller's buffer cannot grow");
+	m_ownedBuffer.resize(capacity);
+	m_data = m_ownedBuffer.data();
+	m_capacity = capacity;
+}
+
+
+// keeps the memory for the next round of writes
+void ByteBufferWriter::Clear()
+{
+	m_size = 0;
+}
+
+
+void ByteBufferWriter::SetEndian(const endian buffer_endian)
+{
+	m_swapBytes = buffer_endian != endian::ENDIAN_NATIVE;
+}
+
+
+bool ByteBufferWriter::SaveToFile(const char* file_path) const
+{
+	FILE* file = nullptr;
+	fopen_s(&file, file_path, "wb");
+	if(file == nullptr)
+	{
+		return false;
+	}
+
+	const size_t num_written = fwrite(m_data, 1, m_size, file);
+	fclose(file);
+
+	return num_written == m_size;
+}
+
+
+// hands the written bytes over without copying, the writer starts again empty
+void ByteBufferWriter::TakeBuffer(std::vector<uchar>& out_buffer)
+{
+	ASSERT_OR_DIE(m_ownsBuffer, "The writer does not own the buffer it wrote");
+
+	m_ownedBuffer.resize(m_size);
+	out_buffer.swap(m_ownedBuffer);
+
+	m_ownedBuffer.clear();
+	m_data = nullptr;
+	m_size = 0;
+	m_capacity = 0;
+}
+
+
+// doubling keeps appends amortized constant
+void ByteBufferWriter::EnsureCapacity(const size_t num_bytes)
+{
+	const size_t needed = m_size + num_bytes;
+	if(needed <= m_capacity)
+	{
+		return;
+	}
+
+	ASSERT_OR_DIE(m_ownsBuffer, "Writing past the end of the caller's buffer");
+
+	size_t new_capacity = m_capacity < 64 ? 64 : m_capacity * 2;
+	while(new_capacity < needed)
+	{
+		new_capacity *= 2;
+	}
+
+	Reserve(new_capacity);
+}
+
+//--------------------------------------------------------------------
+
+UNITTEST("ByteBuffer round trips every value type", "ByteBuffer", 0)
+{
+	ByteBufferWriter writer;
+	writer.WriteBool(true);
+	writer.WriteByte(0xAB);
+	writer.WriteChar(-5);
+	writer.WriteShort(-1234);
+	writer.WriteUnsignedShort(54321);
+	writer.WriteInt(-123456789);
+	writer.WriteUnsignedInt(0xDEADBEEF);
+	writer.WriteInt64(-1234567890123ll);
+	writer.WriteUnsignedInt64(0xFEDCBA9876543210ull);
+	writer.WriteFloat(-3.25f);
+	writer.WriteDouble(1.0 / 3.0);
+	writer.WriteString("snapshot");
+	const size_t slot = writer.ReserveSlot<int>();
+	writer.AlignTo(8);
+	writer.PatchValue(slot, 77);
+
+	ByteBufferParser parser(writer.GetData(), writer.GetSize());
+	return parser.ParseBool()
+		&& parser.ParseByte() == 0xAB
+		&& parser.ParseChar() == -5
+		&& parser.ParseShort() == -1234
+		&& parser.ParseUnsignedShort() == 54321
+		&& parser.ParseInt() == -123456789
+		&& parser.ParseUnsignedInt() == 0xDEADBEEF
+		&& parser.ParseInt64() == -1234567890123ll
+		&& parser.ParseUnsignedInt64() == 0xFEDCBA9876543210ull
+		&& parser.ParseFloat() == -3.25f
+		&& parser.ParseDouble() == 1.0 / 3.0
+		&& parser.ParseString() == "snapshot"
+		&& parser.ParseInt() == 77
+		&& writer.GetSize() % 8 == 0;
+}
+
+
+// big endian lays the most significant byte first whatever the host is, and only a parser told so reads it back
+UNITTEST("ByteBuffer writes and reads big endian", "ByteBuffer", 0)
+{
+	ByteBufferWriter writer(endian::ENDIAN_BIG);
+	writer.WriteUnsignedInt(0x01020304u);
+	writer.WriteUnsignedShort(0x0A0B);
+	writer.WriteFloat(1.5f);
+
+	const uchar* bytes = writer.GetData();
+	if(writer.IsNativeEndian() || bytes[0] != 0x01 || bytes[1] != 0x02 || bytes[2] != 0x03 || bytes[3] != 0x04
+		|| bytes[4] != 0x0A || bytes[5] != 0x0B)
+	{
+		return false;
+	}
+
+	ByteBufferParser little_parser(writer.GetData(), writer.GetSize(), endian::ENDIAN_LITTLE);
+	ByteBufferParser big_parser(writer.GetData(), writer.GetSize(), endian::ENDIAN_BIG);
+	return little_parser.ParseUnsignedInt() == 0x04030201u
+		&& big_parser.ParseUnsignedInt() == 0x01020304u
+		&& big_parser.ParseUnsignedShort() == 0x0A0B
+		&& big_parser.ParseFloat() == 1.5f;
+}
+
+
+// a moved writer keeps writing into the memory it took, and the one moved from starts over empty
+UNITTEST("ByteBufferWriter moves its buffer", "ByteBuffer", 0)
+{
+	ByteBufferWriter source;
+	source.WriteInt(1);
+
+	ByteBufferWriter moved(std::move(source));
+	moved.WriteInt(2);
+	source.WriteInt(3);
+
+	ByteBufferParser moved_parser(moved.GetData(), moved.GetSize());
+	ByteBufferParser source_parser(source.GetData(), source.GetSize());
+	return moved.GetSize() == 2 * sizeof(int)
+		&& moved_parser.ParseInt() == 1
+		&& moved_parser.ParseInt() == 2
+		&& source.GetSize() == sizeof(int)
+		&& source_parser.ParseInt() == 3;
+}
+
+
+UNITTEST("ByteBufferWriter stays inside a caller's buffer", "ByteBuffer", 0)
+{
+	uchar memory[8] = { 0 };
+	ByteBufferWriter writer(memory, sizeof(memory));
+	writer.WriteInt(5);
+	writer.WriteShort(6);
+
+	int first = 0;
+	memcpy(&first, memory, sizeof(int));
+	return writer.GetData() == memory
+		&& writer.GetCapacity() == sizeof(memory)
+		&& writer.GetSize() == 6
+		&& first == 5;
+}
@@ -1,14 +1,127 @@
 #pragma once
+#include "Game/ByteBufferParser.hpp"
 #include "Game/GameCommon.hpp"
 
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
 #include <vector>
 
 
+// Appends values to a byte buffer. By default the writer owns a vector that doubles when it runs out;
+// given a caller's memory (a mapped file, a preallocated block) it writes there directly and never grows.
+// Slots can be reserved for length prefixes and offsets and patched once the real value is known.
 class ByteBufferWriter
 {
-	ByteBufferWriter();
+public:
+	explicit ByteBufferWriter(endian buffer_endian = endian::ENDIAN_NATIVE);
+	ByteBufferWriter(uchar* external_buffer, size_t capacity, endian buffer_endian = endian::ENDIAN_NATIVE);
 	~ByteBufferWriter();
 
-	
-	std::vector<uchar> m_buffer;
+	// m_data points into the owned vector, so a copy would write through to the original's memory
+	ByteBufferWriter(const ByteBufferWriter&) = delete;
+	ByteBufferWriter& operator=(const ByteBufferWriter&) = delete;
+	ByteBufferWriter(ByteBufferWriter&& other) noexcept;
+	ByteBufferWriter& operator=(ByteBufferWriter&& other) noexcept;
+
+	void	WriteBool(bool value);
+	void	WriteByte(uchar value);
+	void	WriteChar(char value);
+	void	WriteShort(short value);
+	void	WriteUnsignedShort(unsigned short value);
+	void	WriteInt(int value);
+	void	WriteUnsignedInt(uint value);
+	void	WriteInt64(int64_t value);
+	void	WriteUnsignedInt64(uint64_t value);
+	void	WriteFloat(float value);
+	void	WriteDouble(double value);
+	void	WriteString(const std::string& value);
+	void	WriteByteArray(const void* bytes, size_t size);
+
+	template<typename T> void	WriteValue(const T& value);
+	template<typename T> void	WriteArray(const T* values, size_t count);
+	template<typename T> size_t	ReserveSlot();
+	template<typename T> void	PatchValue(size_t offset, const T& value);
+
+	uchar*	ReserveBytes(size_t size);
+	void	AlignTo(size_t alignment);
+	void	Reserve(size_t capacity);
+	void	Clear();
+	void	SetEndian(endian buffer_endian);
+	bool	SaveToFile(const char* file_path) const;
+
+	const uchar*	GetData() const			{ return m_data; }
+	size_t			GetSize() const			{ return m_size; }
+	size_t			GetCapacity() const		{ return m_capacity; }
+	bool			IsNativeEndian() const	{ return !m_swapBytes; }
+	void			TakeBuffer(std::vector<uchar>& out_buffer);
+
+private:
+	void	EnsureCapacity(size_t num_bytes);
+
+private:
+	std::vector<uchar>	m_ownedBuffer;			// sized to the capacity, m_size is how much is written
+	uchar*				m_data = nullptr;
+	size_t				m_size = 0;
+	size_t				m_capacity = 0;
+	bool				m_ownsBuffer = true;
+	bool				m_swapBytes = false;
 };
+
+
+template<typename T>
+void ByteBufferWriter::WriteValue(const T& value)
+{
+	static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be written");
+
+	EnsureCapacity(sizeof(T));
+	const T ordered = m_swapBytes ? SwapEndian(value) : value;
+	memcpy(m_data + m_size, &ordered, sizeof(T));
+	m_size += sizeof(T);
+}
+
+
+template<typename T>
+void ByteBufferWriter::WriteArray(const T* values, const size_t count)
+{
+	static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be written");
+
+	const size_t num_bytes = count * sizeof(T);
+	EnsureCapacity(num_bytes);
+
+	if(!m_swapBytes)
+	{
+		memcpy(m_data + m_size, values, num_bytes);
+		m_size += num_bytes;
+		return;
+	}
+
+	for(size_t value_idx = 0; value_idx < count; ++value_idx)
+	{
+		const T ordered = SwapEndian(values[value_idx]);
+		memcpy(m_data + m_size, &ordered, sizeof(T));
+		m_size += sizeof(T);
+	}
+}
+
+
+// zero for now, returns where to PatchValue later
+template<typename T>
+size_t ByteBufferWriter::ReserveSlot()
+{
+	const size_t offset = m_size;
+	WriteValue(T());
+	return offset;
+}
+
+
+template<typename T>
+void ByteBufferWriter::PatchValue(const size_t offset, const T& value)
+{
+	static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be written");
+	ASSERT_OR_DIE(offset + sizeof(T) <= m_size, "Patching outside what has been written");
+
+	const T ordered = m_swapBytes ? SwapEndian(value) : value;
+	memcpy(m_data + offset, &ordered, sizeof(T));
+}
@@ -0,0 +1,490 @@
+#include "Game/CompressedBsp.hpp"
+#include "Game/Profiler.hpp"
+#include "Game/QueryCounters.hpp"
+
+#include "Engine/Core/ErrorWarningAssert.hpp"
+#include "Engine/Math/MathUtils.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+constexpr uint16_t COMPRESSED_BSP_SPACE_MASK			= 0x0003;	// the node's own SpaceType
+constexpr uint16_t COMPRESSED_BSP_FRONT_LEAF			= 0x0004;
+constexpr int      COMPRESSED_BSP_FRONT_SPACE_SHIFT		= 3;
+constexpr uint16_t COMPRESSED_BSP_BACK_LEAF				= 0x0020;
+constexpr int      COMPRESSED_BSP_BACK_SPACE_SHIFT		= 6;
+constexpr int      COMPRESSED_BSP_DELTA_HIGH_SHIFT		= 8;
+constexpr int      COMPRESSED_BSP_MAX_BACK_DELTA		= (1 << 24) - 1;
+
+constexpr float    COMPRESSED_BSP_ANCHOR_SCALE			= 1.0f / 65535.0f;
+constexpr float    COMPRESSED_BSP_CELL_SCALE			= 1.0f / 255.0f;
+constexpr int16_t  COMPRESSED_BSP_RESIDUAL_MISSING		= INT16_MIN;	// in m_distance, the plane is in the side table
+
+constexpr float    COMPRESSED_BSP_POINT_EPSILON			= 0.001f;	// BSPTree::ClassifyPoint's band
+constexpr float    COMPRESSED_BSP_FLOAT_SLACK			= 0.0005f;	// rounding in either tree's arithmetic
+
+
+// children are node indices when >= 0, a leaf is -1 - its SpaceType
+static int MakeLeafRef(const int space_type)
+{
+	return -1 - space_type;
+}
+
+
+static float DecodeFixed(const float min, const float extent, const int steps, const float scale)
+{
+	return min + extent * (static_cast<float>(steps) * scale);
+}
+
+
+static uint16_t QuantizeAnchor(const float value, const float min, const float extent)
+{
+	if(extent <= 0.0f)
+	{
+		return 0;
+	}
+
+	const float steps = floorf((value - min) / extent * 65535.0f + 0.5f);
+	return static_cast<uint16_t>(steps < 0.0f ? 0.0f : (steps > 65535.0f ? 65535.0f : steps));
+}
+
+
+// cell edges round outwards, checked against the decode so the cell really holds every anchor below it
+static uint8_t QuantizeCellMin(const float value, const float min, const float extent)
+{
+	if(extent <= 0.0f)
+	{
+		return 0;
+	}
+
+	int steps = static_cast<int>(floorf((value - min) / extent * 255.0f));
+	steps = steps < 0 ? 0 : (steps > 255 ? 255 : steps);
+	while(steps > 0 && DecodeFixed(min, extent, steps, COMPRESSED_BSP_CELL_SCALE) > value)
+	{
+		--steps;
+	}
+
+	return static_cast<uint8_t>(steps);
+}
+
+
+static uint8_t QuantizeCellMax(const float value, const float min, const float extent)
+{
+	if(extent <= 0.0f)
+	{
+		return 0;
+	}
+
+	int steps = static_cast<int>(ceilf((value - min) / extent * 255.0f));
+	steps = steps < 0 ? 0 : (steps > 255 ? 255 : steps);
+	while(steps < 255 && DecodeFixed(min, extent, steps, COMPRESSED_BSP_CELL_SCALE) < value)
+	{
+		++steps;
+	}
+
+	return static_cast<uint8_t>(steps);
+}
+
+
+static int16_t QuantizeNormal(const float value)
+{
+	const float clamped = value < -1.0f ? -1.0f : (value > 1.0f ? 1.0f : value);
+	return static_cast<int16_t>(floorf(clamped * 32767.0f + 0.5f));
+}
+
+
+// floats as integers that count representable values, so a residual is how many floats apart two
+// values are. Negative zero gets its own value so decoding is bit exact.
+static int32_t GetOrderedBits(const float value)
+{
+	uint32_t bits = 0;
+	memcpy(&bits, &value, sizeof(bits));
+	return (bits & 0x80000000u) ? -static_cast<int32_t>(bits & 0x7FFFFFFFu) - 1 : static_cast<int32_t>(bits);
+}
+
+
+static float FromOrderedBits(const int32_t ordered)
+{
+	const uint32_t bits = ordered >= 0 ? static_cast<uint32_t>(ordered) : (static_cast<uint32_t>(-(ordered + 1)) | 0x80000000u);
+	float value = 0.0f;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+
+static bool GetResidual(const float exact, const float decoded, int16_t& out_residual)
+{
+	const int64_t residual = static_cast<int64_t>(GetOrderedBits(exact)) - static_cast<int64_t>(GetOrderedBits(decoded));
+	if(residual <= COMPRESSED_BSP_RESIDUAL_MISSING || residual > INT16_MAX)
+	{
+		return false;
+	}
+
+	out_residual = static_cast<int16_t>(residual);
+	return true;
+}
+
+
+static bool IsSamePlane(const Plane2& first, const Plane2& second)
+{
+	return GetOrderedBits(first.m_normal.x) == GetOrderedBits(second.m_normal.x)
+		&& GetOrderedBits(first.m_normal.y) == GetOrderedBits(second.m_normal.y)
+		&& GetOrderedBits(first.m_signedDistance) == GetOrderedBits(second.m_signedDistance);
+}
+
+
+// the build and the traversal both decode through these, so a residual taken at build time still applies
+static void DecodePlane(const CompressedBspNode& node, const CompressedBspCell& parent_cell, Vec2& out_normal, Vec2& out_anchor)
+{
+	out_normal = Vec2(static_cast<float>(node.m_normalX) * (1.0f / 32767.0f), static_cast<float>(node.m_normalY) * (1.0f / 32767.0f));
+	out_anchor = Vec2(
+		DecodeFixed(parent_cell.m_mins.x, parent_cell.m_extents.x, node.m_anchorX, COMPRESSED_BSP_ANCHOR_SCALE),
+		DecodeFixed(parent_cell.m_mins.y, parent_cell.m_extents.y, node.m_anchorY, COMPRESSED_BSP_ANCHOR_SCALE));
+}
+
+
+static CompressedBspCell DecodeCell(const CompressedBspNode& node, const CompressedBspCell& parent_cell)
+{
+	CompressedBspCell cell;
+	cell.m_mins = Vec2(
+		DecodeFixed(parent_cell.m_mins.x, parent_cell.m_extents.x, node.m_cellMinX, COMPRESSED_BSP_CELL_SCALE),
+		DecodeFixed(parent_cell.m_mins.y, parent_cell.m_extents.y, node.m_cellMinY, COMPRESSED_BSP_CELL_SCALE));
+	cell.m_extents = Vec2(
+		DecodeFixed(parent_cell.m_mins.x, parent_cell.m_extents.x, node.m_cellMaxX, COMPRESSED_BSP_CELL_SCALE) - cell.m_mins.x,
+		DecodeFixed(parent_cell.m_mins.y, parent_cell.m_extents.y, node.m_cellMaxY, COMPRESSED_BSP_CELL_SCALE) - cell.m_mins.y);
+	return cell;
+}
+
+
+// anchors are segment midpoints, each internal node gets the box around its own and every one below it
+static bool GatherAnchorBounds(const BSPTree& tree, const int float_node_idx, TaggedVector<AABB2, MEM_TAG_SCRATCH>& anchor_bounds)
+{
+	const BSPNode& node = tree.GetNode(float_node_idx);
+	if(node.m_isLeaf)
+	{
+		return false;
+	}
+
+	const Vec2 anchor = node.m_segment.GetCenter();
+	AABB2 bounds(anchor, anchor);
+	const int child_indices[2] = { node.m_frontChildIdx, node.m_backChildIdx };
+	for(const int child_idx : child_indices)
+	{
+		if(GatherAnchorBounds(tree, child_idx, anchor_bounds))
+		{
+			const AABB2& child_bounds = anchor_bounds[child_idx];
+			bounds.mins = Vec2(std::min(bounds.mins.x, child_bounds.mins.x), std::min(bounds.mins.y, child_bounds.mins.y));
+			bounds.maxs = Vec2(std::max(bounds.maxs.x, child_bounds.maxs.x), std::max(bounds.maxs.y, child_bounds.maxs.y));
+		}
+	}
+
+	anchor_bounds[float_node_idx] = bounds;
+	return true;
+}
+
+
+// same arithmetic as BSPTree::ClassifyPoint, so the answers match it bit for bit
+static PointType ClassifyPointExact(const Vec2& point, const Plane2& plane)
+{
+	const Vec2 point_on_plane = plane.PointOnPlane();
+	const Vec2 dir = point_on_plane - point;
+	const float result = DotProduct(dir, plane.m_normal);
+
+	if(result < -COMPRESSED_BSP_POINT_EPSILON)
+	{
+		return POINT_INFRONT;
+	}
+	if(result > COMPRESSED_BSP_POINT_EPSILON)
+	{
+		return POINT_BEHIND;
+	}
+
+	return POINT_ONLINE;
+}
+
+
+// same arithmetic as BSPTree::GetIntersection
+static void GetIntersectionExact(const Vec2& start, const Vec2& end, const Plane2& plane, Vec2& out_intersection)
+{
+	const Vec2 dir = end - start;
+	const float line_length = DotProduct(dir, plane.m_normal);
+	if(IsZero(line_length))
+	{
+		return;
+	}
+
+	const Vec2 line = plane.PointOnPlane() - start;
+	const float t = DotProduct(line, plane.m_normal) / line_length;
+	if(t < 0.0f || t > 1.0f)
+	{
+		return;
+	}
+
+	out_intersection = start + dir * t;
+}
+
+//--------------------------------------------------------------------
+
+CompressedBspTree::CompressedBspTree() = default;
+CompressedBspTree::~CompressedBspTree() = default;
+
+
+void CompressedBspTree::Build(const BSPTree& tree)
+{
+	PROFILE_SCOPE("CompressedBspTree::Build");
+
+	Clear();
+	const int num_float_nodes = tree.GetNumNodes();
+	if(num_float_nodes == 0 || tree.GetNode(0).m_isLeaf)
+	{
+		return;
+	}
+
+	TaggedVector<AABB2, MEM_TAG_SCRATCH> anchor_bounds(num_float_nodes);
+	GatherAnchorBounds(tree, 0, anchor_bounds);
+
+	m_rootCell.m_mins = anchor_bounds[0].mins;
+	m_rootCell.m_extents = anchor_bounds[0].maxs - anchor_bounds[0].mins;
+	m_normalError = 0.5f / 32767.0f;
+
+	m_nodes.reserve(num_float_nodes / 2 + 1);
+	m_residuals.reserve(num_float_nodes / 2 + 1);
+	EmitNode(tree, 0, m_rootCell, anchor_bounds);
+}
+
+
+void CompressedBspTree::Clear()
+{
+	m_nodes.clear();
+	m_residuals.clear();
+	m_exactNodes.clear();
+	m_exactPlanes.clear();
+	m_numClassifies = 0;
+	m_numExactClassifies = 0;
+}
+
+
+size_t CompressedBspTree::GetColdBytes() const
+{
+	return m_residuals.size() * sizeof(CompressedBspResidual)
+		+ m_exactNodes.size() * sizeof(int)
+		+ m_exactPlanes.size() * sizeof(Plane2);
+}
+
+
+bool CompressedBspTree::CanSee(const Vec2& start, const Vec2& end, Vec2& out_end)
+{
+	QUERY_COUNT(QUERY_CAN_SEE);
+	if(m_nodes.empty())
+	{
+		return true;
+	}
+
+	return CanSee(start, end, out_end, 0, m_rootCell);
+}
+
+
+// depth first, front subtree straight after the node and the back subtree after that
+int CompressedBspTree::EmitNode(const BSPTree& tree, const int float_node_idx, const CompressedBspCell& parent_cell,
+	const TaggedVector<AABB2, MEM_TAG_SCRATCH>& anchor_bounds)
+{
+	const BSPNode& float_node = tree.GetNode(float_node_idx);
+	if(float_node.m_isLeaf)
+	{
+		return MakeLeafRef(float_node.m_spaceType);
+	}
+
+	const int node_idx = static_cast<int>(m_nodes.size());
+	m_nodes.emplace_back();
+	m_residuals.emplace_back();
+
+	const Vec2 anchor = float_node.m_segment.GetCenter();
+	const AABB2& cell_bounds = anchor_bounds[float_node_idx];
+	CompressedBspNode& node = m_nodes.back();
+	node.m_normalX = QuantizeNormal(float_node.m_split.m_normal.x);
+	node.m_normalY = QuantizeNormal(float_node.m_split.m_normal.y);
+	node.m_anchorX = QuantizeAnchor(anchor.x, parent_cell.m_mins.x, parent_cell.m_extents.x);
+	node.m_anchorY = QuantizeAnchor(anchor.y, parent_cell.m_mins.y, parent_cell.m_extents.y);
+	node.m_cellMinX = QuantizeCellMin(cell_bounds.mins.x, parent_cell.m_mins.x, parent_cell.m_extents.x);
+	node.m_cellMinY = QuantizeCellMin(cell_bounds.mins.y, parent_cell.m_mins.y, parent_cell.m_extents.y);
+	node.m_cellMaxX = QuantizeCellMax(cell_bounds.maxs.x, parent_cell.m_mins.x, parent_cell.m_extents.x);
+	node.m_cellMaxY = QuantizeCellMax(cell_bounds.maxs.y, parent_cell.m_mins.y, parent_cell.m_extents.y);
+	node.m_packed = static_cast<uint16_t>(float_node.m_spaceType) & COMPRESSED_BSP_SPACE_MASK;
+	const CompressedBspCell cell = DecodeCell(node, parent_cell);
+
+	// the residuals are checked by decoding them, anything that does not come back bit exact goes in the side table
+	Vec2 normal;
+	Vec2 decoded_anchor;
+	DecodePlane(node, parent_cell, normal, decoded_anchor);
+	const Plane2& exact_plane = float_node.m_split;
+	CompressedBspResidual& residual = m_residuals.back();
+	const bool fits = GetResidual(exact_plane.m_normal.x, normal.x, residual.m_normalX)
+		&& GetResidual(exact_plane.m_normal.y, normal.y, residual.m_normalY)
+		&& GetResidual(exact_plane.m_signedDistance, DotProduct(normal, decoded_anchor), residual.m_distance);
+	if(!fits || !IsSamePlane(GetExactPlane(node_idx, parent_cell), exact_plane))
+	{
+		m_residuals[node_idx].m_distance = COMPRESSED_BSP_RESIDUAL_MISSING;
+		m_exactNodes.push_back(node_idx);
+		m_exactPlanes.push_back(exact_plane);
+	}
+
+	// m_nodes may grow below, so the node is only looked up again by index
+	const int front_ref = EmitNode(tree, float_node.m_frontChildIdx, cell, anchor_bounds);
+	if(front_ref < 0)
+	{
+		m_nodes[node_idx].m_packed |= COMPRESSED_BSP_FRONT_LEAF | static_cast<uint16_t>((-1 - front_ref) << COMPRESSED_BSP_FRONT_SPACE_SHIFT);
+	}
+
+	const int back_ref = EmitNode(tree, float_node.m_backChildIdx, cell, anchor_bounds);
+	if(back_ref < 0)
+	{
+		m_nodes[node_idx].m_packed |= COMPRESSED_BSP_BACK_LEAF | static_cast<uint16_t>((-1 - back_ref) << COMPRESSED_BSP_BACK_SPACE_SHIFT);
+	}
+	else
+	{
+		const int delta = back_ref - node_idx;
+		ASSERT_OR_DIE(delta <= COMPRESSED_BSP_MAX_BACK_DELTA, "BSP subtree too large for a 24 bit child offset");
+		m_nodes[node_idx].m_packed |= static_cast<uint16_t>((delta >> 16) << COMPRESSED_BSP_DELTA_HIGH_SHIFT);
+		m_nodes[node_idx].m_backDeltaLow = static_cast<uint16_t>(delta & 0xFFFF);
+	}
+
+	return node_idx;
+}
+
+
+int CompressedBspTree::GetFrontChild(const int node_idx) const
+{
+	const uint16_t packed = m_nodes[node_idx].m_packed;
+	if(packed & COMPRESSED_BSP_FRONT_LEAF)
+	{
+		return MakeLeafRef((packed >> COMPRESSED_BSP_FRONT_SPACE_SHIFT) & COMPRESSED_BSP_SPACE_MASK);
+	}
+
+	return node_idx + 1;
+}
+
+
+int CompressedBspTree::GetBackChild(const int node_idx) const
+{
+	const CompressedBspNode& node = m_nodes[node_idx];
+	if(node.m_packed & COMPRESSED_BSP_BACK_LEAF)
+	{
+		return MakeLeafRef((node.m_packed >> COMPRESSED_BSP_BACK_SPACE_SHIFT) & COMPRESSED_BSP_SPACE_MASK);
+	}
+
+	return node_idx + ((node.m_packed >> COMPRESSED_BSP_DELTA_HIGH_SHIFT) << 16) + node.m_backDeltaLow;
+}
+
+
+Plane2 CompressedBspTree::GetExactPlane(const int node_idx, const CompressedBspCell& parent_cell) const
+{
+	const CompressedBspResidual& residual = m_residuals[node_idx];
+	if(residual.m_distance == COMPRESSED_BSP_RESIDUAL_MISSING)
+	{
+		const auto found = std::lower_bound(m_exactNodes.begin(), m_exactNodes.end(), node_idx);
+		return m_exactPlanes[found - m_exactNodes.begin()];
+	}
+
+	Vec2 normal;
+	Vec2 anchor;
+	DecodePlane(m_nodes[node_idx], parent_cell, normal, anchor);
+
+	Plane2 plane;
+	plane.m_normal = Vec2(
+		FromOrderedBits(GetOrderedBits(normal.x) + residual.m_normalX),
+		FromOrderedBits(GetOrderedBits(normal.y) + residual.m_normalY));
+	plane.m_signedDistance = FromOrderedBits(GetOrderedBits(DotProduct(normal, anchor)) + residual.m_distance);
+	return plane;
+}
+
+
+// decoded distance is off by at most the anchor error plus the normal error times how far the point is
+// from the anchor, only when that could cross the epsilon is the exact plane decoded
+PointType CompressedBspTree::ClassifyPoint(const Vec2& point, const int node_idx, const CompressedBspCell& parent_cell)
+{
+	++m_numClassifies;
+
+	Vec2 normal;
+	Vec2 anchor;
+	DecodePlane(m_nodes[node_idx], parent_cell, normal, anchor);
+	const float to_anchor_x = anchor.x - point.x;
+	const float to_anchor_y = anchor.y - point.y;
+	const float distance = normal.x * to_anchor_x + normal.y * to_anchor_y;
+
+	const float anchor_error = 0.5f * COMPRESSED_BSP_ANCHOR_SCALE * (parent_cell.m_extents.x + parent_cell.m_extents.y);
+	const float error = anchor_error + m_normalError * (fabsf(to_anchor_x) + fabsf(to_anchor_y)) + COMPRESSED_BSP_FLOAT_SLACK;
+	if(fabsf(distance - COMPRESSED_BSP_POINT_EPSILON) <= error || fabsf(distance + COMPRESSED_BSP_POINT_EPSILON) <= error)
+	{
+		++m_numExactClassifies;
+		return ClassifyPointExact(point, GetExactPlane(node_idx, parent_cell));
+	}
+
+	if(distance < -COMPRESSED_BSP_POINT_EPSILON)
+	{
+		return POINT_INFRONT;
+	}
+	if(distance > COMPRESSED_BSP_POINT_EPSILON)
+	{
+		return POINT_BEHIND;
+	}
+
+	return POINT_ONLINE;
+}
+
+
+// mirrors BSPTree::CanSee case for case
+bool CompressedBspTree::CanSee(const Vec2& start, const Vec2& end, Vec2& out_end, const int child_ref, const CompressedBspCell& parent_cell)
+{
+	QUERY_COUNT(QUERY_BSP_NODES_VISITED);
+	if(child_ref < 0)
+	{
+		return -1 - child_ref == SPACE_FREE;
+	}
+
+	const PointType start_type = ClassifyPoint(start, child_ref, parent_cell);
+	const PointType end_type = ClassifyPoint(end, child_ref, parent_cell);
+	const CompressedBspCell cell = DecodeCell(m_nodes[child_ref], parent_cell);
+
+	if(start_type == POINT_ONLINE && end_type == POINT_ONLINE)
+	{
+		return CanSee(start, end, out_end, GetFrontChild(child_ref), cell);
+	}
+
+	if(start_type == POINT_INFRONT && end_type == POINT_BEHIND)
+	{
+		Vec2 intersection = start;
+		GetIntersectionExact(start, end, GetExactPlane(child_ref, parent_cell), intersection);
+		const bool can_see_front = CanSee(start, intersection, out_end, GetFrontChild(child_ref), cell);
+		const bool can_see_behind = CanSee(intersection, end, out_end, GetBackChild(child_ref), cell);
+
+		if(!can_see_behind)
+		{
+			out_end = intersection;
+		}
+
+		return can_see_front && can_see_behind;
+	}
+
+	if(start_type == POINT_BEHIND && end_type == POINT_INFRONT)
+	{
+		Vec2 intersection = start;
+		GetIntersectionExact(start, end, GetExactPlane(child_ref, parent_cell), intersection);
+		const bool can_see_front = CanSee(intersection, end, out_end, GetFrontChild(child_ref), cell);
+		const bool can_see_back = CanSee(start, intersection, out_end, GetBackChild(child_ref), cell);
+
+		if(!can_see_front)
+		{
+			out_end = intersection;
+		}
+
+		return can_see_front && can_see_back;
+	}
+
+	if(start_type == POINT_INFRONT || end_type == POINT_INFRONT)
+	{
+		return CanSee(start, end, out_end, GetFrontChild(child_ref), cell);
+	}
+
+	return CanSee(start, end, out_end, GetBackChild(child_ref), cell);
+}
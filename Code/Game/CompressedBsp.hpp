@@ -0,0 +1,90 @@
+#pragma once
+#include "Engine/Math/AABB2.hpp"
+#include "Engine/Math/Plane2.hpp"
+
+#include "Game/BSPTree.hpp"
+#include "Game/MemoryTags.hpp"
+
+#include <cstdint>
+#include <vector>
+
+// 16 bytes against the float node's 60 odd. The plane is a 16 bit normal through a 16 bit anchor point
+// quantized inside the parent's cell, and the node's own cell (the box around every anchor below it)
+// is stored in 8 bits per edge of the parent's cell, so anchors get finer with depth. Nodes are laid
+// out depth first so the front child is always the next node, and the back child is stored as a 24
+// bit forward distance. Leaves are not stored at all, a child that is a leaf only keeps its SpaceType
+// in two bits of the parent.
+struct CompressedBspNode
+{
+	int16_t		m_normalX = 0;			// fixed point, 1.0 is 32767
+	int16_t		m_normalY = 0;
+	uint16_t	m_anchorX = 0;			// fixed point across the parent's cell
+	uint16_t	m_anchorY = 0;
+	uint16_t	m_packed = 0;			// see the COMPRESSED_BSP_ masks
+	uint16_t	m_backDeltaLow = 0;
+	uint8_t		m_cellMinX = 0;			// fixed point across the parent's cell, rounded outwards
+	uint8_t		m_cellMinY = 0;
+	uint8_t		m_cellMaxX = 0;
+	uint8_t		m_cellMaxY = 0;
+};
+
+// How far each exact plane float is, in representable floats, from the one decoded off the hot node.
+// Planes that are further off than 16 bits allow are kept whole in a side table.
+struct CompressedBspResidual
+{
+	int16_t		m_normalX = 0;
+	int16_t		m_normalY = 0;
+	int16_t		m_distance = 0;
+};
+
+// Frame a node's anchor and cell are decoded in, the root's is the tree bounds
+struct CompressedBspCell
+{
+	Vec2	m_mins;
+	Vec2	m_extents;
+};
+
+// Read only copy of a BSPTree for traversal, the float tree can be freed once this is built.
+// Classifying against a quantized plane can only be wrong within a known distance of the float
+// plane's epsilon, and only points inside that band decode the exact plane, so CanSee answers the
+// same as the float tree. Straddling segments are split with the exact plane for the same reason.
+// Exact planes are rebuilt bit for bit from the cold residuals, and only the few that do not fit
+// in them are stored whole.
+class CompressedBspTree
+{
+public:
+	CompressedBspTree();
+	~CompressedBspTree();
+
+	void	Build(const BSPTree& tree);
+	void	Clear();
+	bool	CanSee(const Vec2& start, const Vec2& end, Vec2& out_end);
+
+	int		GetNumNodes() const				{ return static_cast<int>(m_nodes.size()); }
+	int		GetNumExactPlanes() const		{ return static_cast<int>(m_exactPlanes.size()); }
+	size_t	GetHotBytes() const				{ return m_nodes.size() * sizeof(CompressedBspNode); }
+	size_t	GetColdBytes() const;
+	int		GetNumExactClassifies() const	{ return m_numExactClassifies; }
+	int		GetNumClassifies() const		{ return m_numClassifies; }
+
+private:
+	int			EmitNode(const BSPTree& tree, int float_node_idx, const CompressedBspCell& parent_cell,
+					const TaggedVector<AABB2, MEM_TAG_SCRATCH>& anchor_bounds);
+	int			GetFrontChild(int node_idx) const;
+	int			GetBackChild(int node_idx) const;
+	Plane2		GetExactPlane(int node_idx, const CompressedBspCell& parent_cell) const;
+	PointType	ClassifyPoint(const Vec2& point, int node_idx, const CompressedBspCell& parent_cell);
+	bool		CanSee(const Vec2& start, const Vec2& end, Vec2& out_end, int child_ref, const CompressedBspCell& parent_cell);
+
+private:
+	TaggedVector<CompressedBspNode, MEM_TAG_BSP>		m_nodes;
+	TaggedVector<CompressedBspResidual, MEM_TAG_BSP>	m_residuals;		// cold, same order as m_nodes
+	TaggedVector<int, MEM_TAG_BSP>						m_exactNodes;		// ascending, the nodes whose residuals did not fit
+	TaggedVector<Plane2, MEM_TAG_BSP>					m_exactPlanes;		// same order as m_exactNodes
+
+	CompressedBspCell	m_rootCell;
+	float	m_normalError = 0.0f;		// furthest a decoded normal component can sit from the real one
+
+	int		m_numClassifies = 0;
+	int		m_numExactClassifies = 0;
+};
@@ -0,0 +1,456 @@
+#include "Game/ConvexHullBuilder.hpp"
+#include "Game/ConvexShape.hpp"
+#include "Game/TestScene.hpp"
+
+#include "Engine/Math/MathUtils.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define HULL_BUILDER_SSE
+#include <emmintrin.h>
+#endif
+
+
+static float Cross(const Vec2& origin, const Vec2& a, const Vec2& b)
+{
+	return (a.x - origin.x) * (b.y - origin.y) - (a.y - origin.y) * (b.x - origin.x);
+}
+
+
+ConvexHullBuilder::ConvexHullBuilder() = default;
+ConvexHullBuilder::~ConvexHullBuilder() = default;
+
+
+void ConvexHullBuilder::Build(const Vec2* points, const int num_points, std::vector<Vec2>& out_ccw_hull)
+{
+	out_ccw_hull.clear();
+	if(num_points <= 0)
+	{
+		return;
+	}
+
+	FilterInteriorPoints(points, num_points);
+	MonotoneChain(out_ccw_hull);
+}
+
+
+STATIC int ConvexHullBuilder::BuildBatch(const std::vector<Vec2>* point_sets, const int num_sets, ConvexHull2D* out_hulls, int num_threads)
+{
+	if(num_threads <= 0)
+	{
+		num_threads = static_cast<int>(std::thread::hardware_concurrency());
+	}
+	num_threads = std::max(1, std::min(num_threads, num_sets));
+
+	// hulls are handed out one at a time, point sets vary too much in size to split evenly up front
+	std::atomic<int> next_set(0);
+	std::atomic<int> num_degenerate(0);
+	const auto worker = [&]()
+	{
+		ConvexHullBuilder builder;
+		std::vector<Vec2> hull_points;
+
+		for(int set_idx = next_set.fetch_add(1); set_idx < num_sets; set_idx = next_set.fetch_add(1))
+		{
+			const std::vector<Vec2>& point_set = point_sets[set_idx];
+			builder.Build(point_set.data(), static_cast<int>(point_set.size()), hull_points);
+
+			// a point or a segment would give planes with no outside, or NaN normals when they repeat
+			if(hull_points.size() < 3)
+			{
+				hull_points.clear();
+				num_degenerate.fetch_add(1);
+			}
+			out_hulls[set_idx].SetFromCcwPoints(hull_points);
+		}
+	};
+
+	std::vector<std::thread> threads;
+	threads.reserve(num_threads - 1);
+	for(int thread_idx = 1; thread_idx < num_threads; ++thread_idx)
+	{
+		threads.emplace_back(worker);
+	}
+
+	worker();
+
+	for(std::thread& thread : threads)
+	{
+		thread.join();
+	}
+
+	return num_degenerate.load();
+}
+
+
+// Akl-Toussaint, anything strictly left of every octagon edge cannot be on the hull
+void ConvexHullBuilder::FilterInteriorPoints(const Vec2* points, const int num_points)
+{
+	m_candidates.clear();
+
+	// bottom, bottom right, right, top right, top, top left, left, bottom left
+	int extreme_idx[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+	for(int point_idx = 1; point_idx < num_points; ++point_idx)
+	{
+		const Vec2& p = points[point_idx];
+		if(p.y < points[extreme_idx[0]].y)											{ extreme_idx[0] = point_idx; }
+		if(p.x - p.y > points[extreme_idx[1]].x - points[extreme_idx[1]].y)		{ extreme_idx[1] = point_idx; }
+		if(p.x > points[extreme_idx[2]].x)											{ extreme_idx[2] = point_idx; }
+		if(p.x + p.y > points[extreme_idx[3]].x + points[extreme_idx[3]].y)		{ extreme_idx[3] = point_idx; }
+		if(p.y > points[extreme_idx[4]].y)											{ extreme_idx[4] = point_idx; }
+		if(p.y - p.x > points[extreme_idx[5]].y - points[extreme_idx[5]].x)		{ extreme_idx[5] = point_idx; }
+		if(p.x < points[extreme_idx[6]].x)											{ extreme_idx[6] = point_idx; }
+		if(p.x + p.y < points[extreme_idx[7]].x + points[extreme_idx[7]].y)		{ extreme_idx[7] = point_idx; }
+	}
+
+	Vec2 octagon[8];
+	int num_corners = 0;
+	for(int extreme = 0; extreme < 8; ++extreme)
+	{
+		const Vec2& corner = points[extreme_idx[extreme]];
+		if(num_corners == 0 || (octagon[num_corners - 1] != corner && octagon[0] != corner))
+		{
+			octagon[num_corners++] = corner;
+		}
+	}
+
+	// a degenerate octagon has no inside to throw points away with
+	if(num_corners < 3)
+	{
+		m_candidates.assign(points, points + num_points);
+		return;
+	}
+
+	float edge_x[8];
+	float edge_y[8];
+	for(int corner_idx = 0; corner_idx < num_corners; ++corner_idx)
+	{
+		const Vec2& next = octagon[(corner_idx + 1) % num_corners];
+		edge_x[corner_idx] = next.x - octagon[corner_idx].x;
+		edge_y[corner_idx] = next.y - octagon[corner_idx].y;
+	}
+
+	m_candidates.reserve(num_points / 8 + 16);
+
+	int point_idx = 0;
+
+#if defined(HULL_BUILDER_SSE)
+	const __m128 zero = _mm_setzero_ps();
+	for(; point_idx + 4 <= num_points; point_idx += 4)
+	{
+		// x0 y0 x1 y1 | x2 y2 x3 y3 -> x0 x1 x2 x3 | y0 y1 y2 y3
+		const __m128 lo = _mm_loadu_ps(&points[point_idx].x);
+		const __m128 hi = _mm_loadu_ps(&points[point_idx + 2].x);
+		const __m128 xs = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+		const __m128 ys = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1));
+
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for(int corner_idx = 0; corner_idx < num_corners; ++corner_idx)
+		{
+			const __m128 rel_x = _mm_sub_ps(xs, _mm_set1_ps(octagon[corner_idx].x));
+			const __m128 rel_y = _mm_sub_ps(ys, _mm_set1_ps(octagon[corner_idx].y));
+			const __m128 cross = _mm_sub_ps(
+				_mm_mul_ps(_mm_set1_ps(edge_x[corner_idx]), rel_y),
+				_mm_mul_ps(_mm_set1_ps(edge_y[corner_idx]), rel_x));
+			inside = _mm_and_ps(inside, _mm_cmpgt_ps(cross, zero));
+		}
+
+		const int inside_mask = _mm_movemask_ps(inside);
+		if(inside_mask == 0xF)
+		{
+			continue;
+		}
+
+		for(int lane = 0; lane < 4; ++lane)
+		{
+			if((inside_mask & (1 << lane)) == 0)
+			{
+				m_candidates.push_back(points[point_idx + lane]);
+			}
+		}
+	}
+#endif
+
+	for(; point_idx < num_points; ++point_idx)
+	{
+		const Vec2& p = points[point_idx];
+
+		bool inside = true;
+		for(int corner_idx = 0; corner_idx < num_corners && inside; ++corner_idx)
+		{
+			const float cross = edge_x[corner_idx] * (p.y - octagon[corner_idx].y) - edge_y[corner_idx] * (p.x - octagon[corner_idx].x);
+			inside = cross > 0.0f;
+		}
+
+		if(!inside)
+		{
+			m_candidates.push_back(p);
+		}
+	}
+}
+
+
+// Andrew's monotone chain over the candidates, lower hull then upper hull
+void ConvexHullBuilder::MonotoneChain(std::vector<Vec2>& out_ccw_hull)
+{
+	std::sort(m_candidates.begin(), m_candidates.end(), [](const Vec2& a, const Vec2& b)
+	{
+		return a.x < b.x || (a.x == b.x && a.y < b.y);
+	});
+	m_candidates.erase(std::unique(m_candidates.begin(), m_candidates.end()), m_candidates.end());
+
+	const int num_candidates = static_cast<int>(m_candidates.size());
+	if(num_candidates < 3)
+	{
+		out_ccw_hull.assign(m_candidates.begin(), m_candidates.end());
+		return;
+	}
+
+	out_ccw_hull.resize(2 * num_candidates);
+	int hull_size = 0;
+
+	for(int point_idx = 0; point_idx < num_candidates; ++point_idx)
+	{
+		while(hull_size >= 2 && Cross(out_ccw_hull[hull_size - 2], out_ccw_hull[hull_size - 1], m_candidates[point_idx]) <= 0.0f)
+		{
+			--hull_size;
+		}
+		out_ccw_hull[hull_size++] = m_candidates[point_idx];
+	}
+
+	const int lower_size = hull_size + 1;
+	for(int point_idx = num_candidates - 2; point_idx >= 0; --point_idx)
+	{
+		while(hull_size >= lower_size && Cross(out_ccw_hull[hull_size - 2], out_ccw_hull[hull_size - 1], m_candidates[point_idx]) <= 0.0f)
+		{
+			--hull_size;
+		}
+		out_ccw_hull[hull_size++] = m_candidates[point_idx];
+	}
+
+	// the last point is the first one again
+	out_ccw_hull.resize(hull_size - 1);
+}
+
+//--------------------------------------------------------------------
+
+// monotone chain over every point with no octagon filter, what the filtered build has to match
+static void BuildReferenceHull(std::vector<Vec2> points, std::vector<Vec2>& out_ccw_hull)
+{
+	std::sort(points.begin(), points.end(), [](const Vec2& a, const Vec2& b)
+	{
+		return a.x < b.x || (a.x == b.x && a.y < b.y);
+	});
+	points.erase(std::unique(points.begin(), points.end()), points.end());
+
+	const int num_points = static_cast<int>(points.size());
+	out_ccw_hull.clear();
+	if(num_points < 3)
+	{
+		out_ccw_hull = points;
+		return;
+	}
+
+	for(int pass = 0; pass < 2; ++pass)
+	{
+		const size_t pass_start = out_ccw_hull.size();
+		for(int step = 0; step < num_points; ++step)
+		{
+			const Vec2& point = points[pass == 0 ? step : num_points - 1 - step];
+			while(out_ccw_hull.size() >= pass_start + 2
+				&& Cross(out_ccw_hull[out_ccw_hull.size() - 2], out_ccw_hull.back(), point) <= 0.0f)
+			{
+				out_ccw_hull.pop_back();
+			}
+			out_ccw_hull.push_back(point);
+		}
+
+		// each chain ends on the point the other one starts with
+		out_ccw_hull.pop_back();
+	}
+}
+
+
+static bool BuildsHull(const std::vector<Vec2>& points, const std::vector<Vec2>& expected_ccw_hull)
+{
+	ConvexHullBuilder builder;
+	std::vector<Vec2> hull;
+	builder.Build(points.data(), static_cast<int>(points.size()), hull);
+	return hull == expected_ccw_hull;
+}
+
+
+UNITTEST("ConvexHullBuilder handles fewer than three points", "ConvexHullBuilder", 0)
+{
+	const Vec2 a(1.0f, 2.0f);
+	const Vec2 b(-3.0f, 0.5f);
+	return BuildsHull({}, {})
+		&& BuildsHull({ a }, { a })
+		&& BuildsHull({ a, a, a }, { a })
+		&& BuildsHull({ a, b }, { b, a })
+		&& BuildsHull({ b, a, b, a, a }, { b, a });
+}
+
+
+UNITTEST("ConvexHullBuilder drops collinear points", "ConvexHullBuilder", 0)
+{
+	// a line keeps only its two ends, whichever way it runs
+	std::vector<Vec2> horizontal;
+	std::vector<Vec2> diagonal;
+	for(int point_idx = 9; point_idx >= 0; --point_idx)
+	{
+		horizontal.push_back(Vec2(static_cast<float>(point_idx), 3.0f));
+		diagonal.push_back(Vec2(static_cast<float>(point_idx), static_cast<float>(-point_idx)));
+	}
+
+	// edge midpoints of a square sit on the hull but are not corners of it
+	std::vector<Vec2> square_edges;
+	for(int step = 0; step <= 4; ++step)
+	{
+		const float t = static_cast<float>(step);
+		square_edges.push_back(Vec2(t, 0.0f));
+		square_edges.push_back(Vec2(4.0f, t));
+		square_edges.push_back(Vec2(t, 4.0f));
+		square_edges.push_back(Vec2(0.0f, t));
+	}
+
+	return BuildsHull(horizontal, { Vec2(0.0f, 3.0f), Vec2(9.0f, 3.0f) })
+		&& BuildsHull(diagonal, { Vec2(0.0f, 0.0f), Vec2(9.0f, -9.0f) })
+		&& BuildsHull(square_edges, { Vec2(0.0f, 0.0f), Vec2(4.0f, 0.0f), Vec2(4.0f, 4.0f), Vec2(0.0f, 4.0f) });
+}
+
+
+UNITTEST("ConvexHullBuilder ignores duplicate points", "ConvexHullBuilder", 0)
+{
+	const std::vector<Vec2> triangle = { Vec2(0.0f, 0.0f), Vec2(2.0f, 0.0f), Vec2(0.0f, 2.0f) };
+
+	// every corner and an interior point several times over, enough for the vector path to see them
+	std::vector<Vec2> points;
+	for(int copy_idx = 0; copy_idx < 7; ++copy_idx)
+	{
+		points.push_back(triangle[copy_idx % 3]);
+		points.push_back(Vec2(0.5f, 0.5f));
+		points.push_back(triangle[(copy_idx + 1) % 3]);
+	}
+
+	return BuildsHull(points, triangle);
+}
+
+
+// sizes either side of a multiple of four so the vector loop and the scalar tail both run, with
+// points spread over a square, on a circle where every lane survives, and packed near the centre
+UNITTEST("ConvexHullBuilder matches an unfiltered monotone chain", "ConvexHullBuilder", 0)
+{
+	uint random_state = 0x6A09E667u;
+
+	std::vector<Vec2> points;
+	std::vector<Vec2> expected_hull;
+	for(int trial = 0; trial < 120; ++trial)
+	{
+		const int num_points = 3 + (trial / 3) * 37 + trial % 4;
+		points.resize(num_points);
+		for(Vec2& point : points)
+		{
+			const float a = NextTestRandom(random_state) * 2.0f - 1.0f;
+			const float b = NextTestRandom(random_state) * 2.0f - 1.0f;
+			switch(trial % 3)
+			{
+				case 0:		point = Vec2(a * 10.0f, b * 10.0f);							break;
+				case 1:		point = Vec2(CosDegrees(a * 180.0f), SinDegrees(a * 180.0f));	break;
+				default:	point = Vec2(a * b * a, b * a * b);							break;
+			}
+		}
+
+		BuildReferenceHull(points, expected_hull);
+		if(!BuildsHull(points, expected_hull))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+// every fourth set spans an area, the rest are empty, a repeated point or a line, spread so each
+// thread gets both kinds
+UNITTEST("ConvexHullBuilder batch matches single builds and empties degenerate sets", "ConvexHullBuilder", 0)
+{
+	uint random_state = 0xBB67AE85u;
+
+	const int num_sets = 64;
+	std::vector<std::vector<Vec2>> point_sets(num_sets);
+	for(int set_idx = 0; set_idx < num_sets; ++set_idx)
+	{
+		std::vector<Vec2>& point_set = point_sets[set_idx];
+		const int num_points = 1 + set_idx * 13;
+		for(int point_idx = 0; point_idx < num_points; ++point_idx)
+		{
+			const float a = NextTestRandom(random_state) * 2.0f - 1.0f;
+			const float b = NextTestRandom(random_state) * 2.0f - 1.0f;
+			switch(set_idx % 4)
+			{
+				case 0:		break;
+				case 1:		point_set.push_back(Vec2(3.0f, -2.0f));						break;
+				case 2:		point_set.push_back(Vec2(floorf(a * 100.0f), floorf(a * 100.0f) * 3.0f + 2.0f));	break;
+				default:	point_set.push_back(Vec2(a * 10.0f, b * 10.0f));			break;
+			}
+		}
+	}
+
+	std::vector<ConvexHull2D> hulls(num_sets);
+	const int num_degenerate = ConvexHullBuilder::BuildBatch(point_sets.data(), num_sets, hulls.data(), 4);
+	if(num_degenerate != num_sets / 4 * 3)
+	{
+		return false;
+	}
+
+	ConvexHullBuilder builder;
+	std::vector<Vec2> expected_hull;
+	for(int set_idx = 0; set_idx < num_sets; ++set_idx)
+	{
+		const ConvexHull2D& hull = hulls[set_idx];
+		if(set_idx % 4 != 3)
+		{
+			if(hull.m_numPlanes != 0 || !hull.m_planes.empty())
+			{
+				return false;
+			}
+			continue;
+		}
+
+		const std::vector<Vec2>& point_set = point_sets[set_idx];
+		builder.Build(point_set.data(), static_cast<int>(point_set.size()), expected_hull);
+
+		ConvexHull2D expected;
+		expected.SetFromCcwPoints(expected_hull);
+		if(hull.m_numPlanes != expected.m_numPlanes)
+		{
+			return false;
+		}
+
+		// counter clockwise planes face out, so no point of the set is in front of any of them
+		for(int plane_idx = 0; plane_idx < hull.m_numPlanes; ++plane_idx)
+		{
+			const Plane2& plane = hull.m_planes[plane_idx];
+			if(plane.m_normal != expected.m_planes[plane_idx].m_normal || plane.m_signedDistance != expected.m_planes[plane_idx].m_signedDistance)
+			{
+				return false;
+			}
+
+			for(const Vec2& point : point_set)
+			{
+				if(DotProduct(plane.m_normal, point) - plane.m_signedDistance > 0.0001f)
+				{
+					return false;
+				}
+			}
+		}
+	}
+
+	return true;
+}
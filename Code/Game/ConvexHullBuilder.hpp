@@ -0,0 +1,30 @@
+#pragma once
+#include "Engine/Math/Vec2.hpp"
+
+#include <vector>
+
+struct ConvexHull2D;
+
+// Hull of an arbitrary point cloud. Points strictly inside the octagon spanned by the eight extreme
+// points (Akl-Toussaint) are thrown away four at a time with SSE, the survivors go through
+// Andrew's monotone chain. Output is counter clockwise with no repeated or collinear points.
+class ConvexHullBuilder
+{
+public:
+	ConvexHullBuilder();
+	~ConvexHullBuilder();
+
+	void	Build(const Vec2* points, int num_points, std::vector<Vec2>& out_ccw_hull);
+	int		GetNumCandidates() const	{ return static_cast<int>(m_candidates.size()); }
+
+	// one builder per worker, every out_hulls[i] is made from point_sets[i]. A set whose hull has fewer
+	// than three points spans no area and gets a hull with no planes, returns how many of those there were
+	static int BuildBatch(const std::vector<Vec2>* point_sets, int num_sets, ConvexHull2D* out_hulls, int num_threads = 0);
+
+private:
+	void	FilterInteriorPoints(const Vec2* points, int num_points);
+	void	MonotoneChain(std::vector<Vec2>& out_ccw_hull);
+
+private:
+	std::vector<Vec2>	m_candidates;
+};
@@ -1,10 +1,17 @@
 #include "Game/GameCommon.hpp"
 #include "Game/ConvexShape.hpp"
+#include "Game/ConvexHullBuilder.hpp"
 #include "Game/Game.hpp"
+#include "Game/MemoryTags.hpp"
+#include "Game/ShapePrototypes.hpp"
+#include "Game/ShapeSystems.hpp"
 
 #include "Engine/Renderer/DebugRender.hpp"
 #include "Engine/Core/ErrorWarningAssert.hpp"
 
+#include <algorithm>
+#include <cmath>
+
 
 ConvexHull2D::ConvexHull2D()
 {
@@ -12,46 +19,57 @@ ConvexHull2D::ConvexHull2D()
 	m_numPlanes = 0;
 	
 	m_debugLineMeshList = std::vector<GPUMesh*>();
-	m_debugPointMeshList = std::vector<GPUMesh*>();
 }
 
 
 ConvexHull2D::~ConvexHull2D()
 {
-	for (int plane_idx = 0; plane_idx < static_cast<int>(m_debugLineMeshList.size()); ++plane_idx)
-	{
-		if (m_debugLineMeshList[plane_idx])
-		{
-			delete m_debugLineMeshList[plane_idx];
-			m_debugLineMeshList[plane_idx] = nullptr;
-		}
-	}
-	
-	for (int plane_idx = 0; plane_idx < static_cast<int>(m_debugPointMeshList.size()); ++plane_idx)
-	{
-		if (m_debugPointMeshList[plane_idx])
-		{
-			delete m_debugPointMeshList[plane_idx];
-			m_debugPointMeshList[plane_idx] = nullptr;
-		}
-	}
+	ClearDebugMeshes();
 }
 
 
 ConvexHull2D::ConvexHull2D(const ConvexPolygon2D& poly)
 {
-	m_numPlanes = static_cast<int>(poly.m_points.size());
 	m_debugLineMeshList = std::vector<GPUMesh*>();
-	m_debugLineMeshList.resize(m_numPlanes);
-	m_debugPointMeshList = std::vector<GPUMesh*>();
-	m_debugPointMeshList.resize(m_numPlanes);
 
+	SetFromPolygon(poly);
+}
+
+
+// point clouds go through ConvexHullBuilder first, so any order and any interior points are fine
+ConvexHull2D::ConvexHull2D(const std::vector<Vec2>& points)
+{
+	m_debugLineMeshList = std::vector<GPUMesh*>();
+
+	std::vector<Vec2> ccw_points;
+	ConvexHullBuilder builder;
+	builder.Build(points.data(), static_cast<int>(points.size()), ccw_points);
+	ASSERT_OR_DIE(ccw_points.size() >= 3, "Points do not span an area, no hull to make")
+
+	SetFromCcwPoints(ccw_points);
+}
+
+
+void ConvexHull2D::SetFromPolygon(const ConvexPolygon2D& poly)
+{
+	SetFromCcwPoints(poly.m_points);
+}
+
+
+// one plane per edge, facing out
+void ConvexHull2D::SetFromCcwPoints(const std::vector<Vec2>& ccw_points)
+{
+	ClearDebugMeshes();
+
+	m_numPlanes = static_cast<int>(ccw_points.size());
+	m_planes.clear();
+	m_planes.reserve(m_numPlanes);
 	for(int point_idx = 0; point_idx < m_numPlanes; ++point_idx)
 	{
 		int point_ahead = (point_idx + 1) % m_numPlanes;
 		
-		Vec2 p1 = poly.m_points[point_idx];
-		Vec2 p2 = poly.m_points[point_ahead];
+		Vec2 p1 = ccw_points[point_idx];
+		Vec2 p2 = ccw_points[point_ahead];
 		Plane2 plane = Plane2(p1, p2);
 		
 		m_planes.push_back(plane);
@@ -59,72 +77,50 @@ ConvexHull2D::ConvexHull2D(const ConvexPolygon2D& poly)
 }
 
 
-void ConvexHull2D::Update(const Vec2& mouse_position, bool render_this_frame)
+// the lines only depend on the planes, so every shape sharing this hull draws the same meshes
+void ConvexHull2D::BuildDebugMeshes()
 {
-	m_renderFrame = render_this_frame;
+	ClearDebugMeshes();
+	m_debugLineMeshList.resize(m_numPlanes, nullptr);
 
-	if(m_renderFrame)
+	for (int plane_idx = 0; plane_idx < m_numPlanes; ++plane_idx)
 	{
-		for (int plane_idx = 0; plane_idx < m_numPlanes; ++plane_idx)
-		{
-			//first remove lines
-			if (m_debugLineMeshList[plane_idx])
-			{
-				delete m_debugLineMeshList[plane_idx];
-				m_debugLineMeshList[plane_idx] = nullptr;
-			}
-
-			//and remove discs
-			if (m_debugPointMeshList[plane_idx])
-			{
-				delete m_debugPointMeshList[plane_idx];
-				m_debugPointMeshList[plane_idx] = nullptr;
-			}
+		Vec2 plane_dir = m_planes[plane_idx].m_normal.GetRotated90Degrees();
+		Vec2 point_1_on_plane = m_planes[plane_idx].m_normal * m_planes[plane_idx].m_signedDistance;
 
+		Vec2 far_point_1 = plane_dir * 100.0f + point_1_on_plane;
+		Vec2 far_point_2 = plane_dir * -100.0f + point_1_on_plane;
 
-			//replace lines
-			Vec2 plane_dir = m_planes[plane_idx].m_normal.GetRotated90Degrees();
-			Vec2 point_1_on_plane = m_planes[plane_idx].m_normal * m_planes[plane_idx].m_signedDistance;
-
-			Vec2 far_point_1 = plane_dir * 100.0f + point_1_on_plane;
-			Vec2 far_point_2 = plane_dir * -100.0f + point_1_on_plane;
+		CPUMesh line_mesh;
+		CpuMeshAddLine(&line_mesh, far_point_1, far_point_2, 0.025f, Rgba::MAGENTA);
+		m_debugLineMeshList[plane_idx] = TaggedNew<GPUMesh>(MEM_TAG_MESHES, g_theRenderer);
+		m_debugLineMeshList[plane_idx]->CreateFromCPUMesh<Vertex_PCU>(line_mesh);
+	}
+}
 
-			CPUMesh line_mesh;
-			CpuMeshAddLine(&line_mesh, far_point_1, far_point_2, 0.025f, Rgba::MAGENTA);
-			m_debugLineMeshList[plane_idx] = new GPUMesh(g_theRenderer);
-			m_debugLineMeshList[plane_idx]->CreateFromCPUMesh<Vertex_PCU>(line_mesh);
 
-			//replace intersection point
-			Vec2 closest_point = m_planes[plane_idx].ClosestPoint(mouse_position);
+void ConvexHull2D::DebugRender(const Matrix44& model_matrix) const
+{
+	g_theRenderer->BindModelMatrix(model_matrix);
 
-			CPUMesh disc_mesh;
-			CpuMeshAddDisc(&disc_mesh, Rgba::YELLOW, closest_point, 0.05f);
-			m_debugPointMeshList[plane_idx] = new GPUMesh(g_theRenderer);
-			m_debugPointMeshList[plane_idx]->CreateFromCPUMesh<Vertex_PCU>(disc_mesh);
+	for (int plane_idx = 0; plane_idx < static_cast<int>(m_debugLineMeshList.size()); ++plane_idx)
+	{
+		if (m_debugLineMeshList[plane_idx])
+		{
+			g_theRenderer->DrawMesh(*m_debugLineMeshList[plane_idx]);
 		}
 	}
 }
 
 
-void ConvexHull2D::DebugRender(const Matrix44& model_matrix) const
+void ConvexHull2D::ClearDebugMeshes()
 {
-	if(m_renderFrame)
+	for (int plane_idx = 0; plane_idx < static_cast<int>(m_debugLineMeshList.size()); ++plane_idx)
 	{
-		g_theRenderer->BindModelMatrix(model_matrix);
-
-		for (int plane_idx = 0; plane_idx < m_numPlanes; ++plane_idx)
-		{
-			if (m_debugLineMeshList[plane_idx])
-			{
-				g_theRenderer->DrawMesh(*m_debugLineMeshList[plane_idx]);
-			}
-
-			if (m_debugPointMeshList[plane_idx])
-			{
-				g_theRenderer->DrawMesh(*m_debugPointMeshList[plane_idx]);
-			}
-		}
+		TaggedDelete(MEM_TAG_MESHES, m_debugLineMeshList[plane_idx]);
 	}
+
+	m_debugLineMeshList.clear();
 }
 
 //--------------------------------------------------------------------
@@ -137,76 +133,164 @@ ConvexPolygon2D::ConvexPolygon2D()
 }
 
 
+// taken as given, nothing is rolled
+ConvexPolygon2D::ConvexPolygon2D(const std::vector<Vec2>& ccw_points): m_points(ccw_points)
+{
+}
+
+
 ConvexPolygon2D::~ConvexPolygon2D() = default;
 
 
+void ConvexPolygon2D::Regenerate()
+{
+	RandomCcwPoints(m_points);
+}
+
+
+// hull planes are already in winding order, so each corner is where one plane meets the next
 ConvexPolygon2D::ConvexPolygon2D(const ConvexHull2D& hull)
 {
-	UNUSED(hull);
-	ERROR_AND_DIE("Have not made a convexpolygon from convexhull function yet")
+	const int num_planes = static_cast<int>(hull.m_planes.size());
+	m_points.reserve(num_planes);
+
+	for(int plane_idx = 0; plane_idx < num_planes; ++plane_idx)
+	{
+		const int prev_plane = (plane_idx + num_planes - 1) % num_planes;
+		Vec2 point = Vec2::ZERO;
+		const bool intersect = hull.m_planes[prev_plane].Intersection(point, hull.m_planes[plane_idx]);
+		ASSERT_OR_DIE(intersect, "Neighbouring hull planes are parallel")
+		m_points.push_back(point);
+	}
+}
+
+// a plane's boundary as a line with the inside on its left
+struct HalfPlaneLine
+{
+	Vec2	m_point;
+	Vec2	m_dir;
+	float	m_angle = 0.0f;
+};
+
+
+static float CrossLine(const HalfPlaneLine& line, const Vec2& point)
+{
+	const Vec2 rel = point - line.m_point;
+	return line.m_dir.x * rel.y - line.m_dir.y * rel.x;
+}
+
+
+static bool IsOutsideLine(const HalfPlaneLine& line, const Vec2& point)
+{
+	return CrossLine(line, point) < -0.0001f;
+}
+
+
+static Vec2 IntersectLines(const HalfPlaneLine& a, const HalfPlaneLine& b)
+{
+	const float denominator = a.m_dir.x * b.m_dir.y - a.m_dir.y * b.m_dir.x;
+	const Vec2 rel = b.m_point - a.m_point;
+	const float t = (rel.x * b.m_dir.y - rel.y * b.m_dir.x) / denominator;
+	return a.m_point + a.m_dir * t;
 }
 
-ConvexPolygon2D::ConvexPolygon2D(const std::vector<Plane2>& hull)
-{	
-	const int max_hulls = static_cast<int>(hull.size());
-	std::vector<int> planes_left = std::vector<int>();
-	planes_left.reserve(max_hulls);
-	for(int plane_idx = 1; plane_idx < max_hulls; ++plane_idx)
+
+// Sort by angle and sweep a deque (Zhu / Chazelle style), O(n log n). Redundant and parallel planes are
+// dropped along the way, and the clip box planes go in with the rest so unbounded sets still close.
+// An empty intersection leaves m_points empty.
+ConvexPolygon2D::ConvexPolygon2D(const std::vector<Plane2>& hull, const AABB2& clip_bounds)
+{
+	const int num_planes = static_cast<int>(hull.size());
+
+	std::vector<HalfPlaneLine> lines;
+	lines.reserve(num_planes + 4);
+	const auto add_line = [&lines](const Vec2& normal, const float signed_distance)
+	{
+		HalfPlaneLine line;
+		line.m_point = normal * signed_distance;
+		line.m_dir = normal.GetRotated90Degrees();
+		line.m_angle = atan2f(line.m_dir.y, line.m_dir.x);
+		lines.push_back(line);
+	};
+
+	for(int plane_idx = 0; plane_idx < num_planes; ++plane_idx)
 	{
-		planes_left.push_back(plane_idx);
+		add_line(hull[plane_idx].m_normal, hull[plane_idx].m_signedDistance);
 	}
+	add_line(Vec2(-1.0f, 0.0f), -clip_bounds.mins.x);
+	add_line(Vec2(1.0f, 0.0f), clip_bounds.maxs.x);
+	add_line(Vec2(0.0f, -1.0f), -clip_bounds.mins.y);
+	add_line(Vec2(0.0f, 1.0f), clip_bounds.maxs.y);
 
-	std::vector<int> hull_winding_order_idx = std::vector<int>();
-	hull_winding_order_idx.reserve(max_hulls);
-	hull_winding_order_idx.push_back(0);
+	std::sort(lines.begin(), lines.end(), [](const HalfPlaneLine& a, const HalfPlaneLine& b)
+	{
+		return a.m_angle < b.m_angle;
+	});
 
+	// deque over a flat array, head moves forward and tail moves both ways
+	const int num_lines = static_cast<int>(lines.size());
+	std::vector<HalfPlaneLine> deque(num_lines);
+	int head = 0;
+	int tail = 0;	// one past the last line
 
-	int num_checked = 1;
-	while(num_checked < max_hulls)
+	for(int line_idx = 0; line_idx < num_lines; ++line_idx)
 	{
-		const int plane_1_idx = hull_winding_order_idx[num_checked-1];
-		Plane2 plane_1 = hull[plane_1_idx];
-		float smallest_angle_change_degrees = 180.0f;
-		int smallest_angle_change_index = -1;
-		int plane_reference_idx = -1;
-
-		const int planes_left_to_test = static_cast<int>(planes_left.size());
-		for (int plane_2_idx = 0; plane_2_idx < planes_left_to_test; ++plane_2_idx)
+		const HalfPlaneLine& line = lines[line_idx];
+
+		while(tail - head >= 2 && IsOutsideLine(line, IntersectLines(deque[tail - 1], deque[tail - 2])))
 		{
-			if (plane_1_idx != planes_left[plane_2_idx])
-			{
-				const int p_2_idx = planes_left[plane_2_idx];
-				Plane2 plane_2 = hull[p_2_idx];
+			--tail;
+		}
+		while(tail - head >= 2 && IsOutsideLine(line, IntersectLines(deque[head], deque[head + 1])))
+		{
+			++head;
+		}
 
-				const float angle = AngleBetweenVectorsDegrees(plane_1.m_normal, plane_2.m_normal);
+		if(tail - head >= 1)
+		{
+			const HalfPlaneLine& back = deque[tail - 1];
+			const float parallel = back.m_dir.x * line.m_dir.y - back.m_dir.y * line.m_dir.x;
+			if(Abs(parallel) < 0.000001f)
+			{
+				// opposite directions, the box keeps anything non empty from getting here
+				if(DotProduct(back.m_dir, line.m_dir) < 0.0f)
+				{
+					return;
+				}
 
-				if (angle < smallest_angle_change_degrees)
+				// same direction, only the more restrictive of the two matters
+				if(!IsOutsideLine(line, back.m_point))
 				{
-					smallest_angle_change_degrees = angle;
-					plane_reference_idx = plane_2_idx;
-					smallest_angle_change_index = p_2_idx;
+					continue;
 				}
+				--tail;
 			}
 		}
 
-		hull_winding_order_idx.push_back(smallest_angle_change_index);
-		planes_left.erase(planes_left.begin() + plane_reference_idx);
-		++num_checked;
+		deque[tail] = line;
+		++tail;
 	}
 
+	while(tail - head >= 3 && IsOutsideLine(deque[head], IntersectLines(deque[tail - 1], deque[tail - 2])))
+	{
+		--tail;
+	}
+	while(tail - head >= 3 && IsOutsideLine(deque[tail - 1], IntersectLines(deque[head], deque[head + 1])))
+	{
+		++head;
+	}
 
-	// constructing points
-	m_points.clear();
-	m_points.reserve(max_hulls);
-	for (int plane_idx = 0; plane_idx < max_hulls; ++plane_idx)
+	if(tail - head < 3)
 	{
-		int next_plane = (plane_idx + 1) % max_hulls;
-		Vec2 point = Vec2::ZERO;
-		bool intersect = hull[plane_idx].Intersection(point, hull[next_plane]);
-		ASSERT_OR_DIE(intersect, "Planes do not intersect")
-			m_points.push_back(point);
+		return;
+	}
+
+	m_points.reserve(tail - head);
+	for(int line_idx = head; line_idx < tail; ++line_idx)
+	{
+		const int next_idx = line_idx + 1 < tail ? line_idx + 1 : head;
+		m_points.push_back(IntersectLines(deque[line_idx], deque[next_idx]));
 	}
-	
 }
 
 
@@ -231,112 +315,98 @@ void ConvexPolygon2D::RandomCcwPoints(std::vector<Vec2>& out) const
 
 //--------------------------------------------------------------------
 
+static_assert(sizeof(ConvexShape2D) <= 64, "ConvexShape2D is meant to fit in a single cache line");
+
 
+// shapes get their transform once the pool hands them a component slot
 ConvexShape2D::ConvexShape2D(Game* the_game): Entity(the_game)
 {
-	m_scale = g_randomNumberGenerator.GetRandomFloatInRange(MIN_SIZE, MAX_SIZE);
-	m_position = Vec2(
-		g_randomNumberGenerator.GetRandomFloatInRange(m_minX, m_maxX),
-		g_randomNumberGenerator.GetRandomFloatInRange(m_minY, m_maxY)
-	);
-	
-	m_hull = m_polygon;
-
-	int triangle_set = static_cast<int>(m_polygon.m_points.size()) - 2;
-
-	CPUMesh convex_mesh;
-	for(int convex_itr = 0; convex_itr < triangle_set; ++convex_itr)
-	{
-		CpuMeshAddTriangle(
-			&convex_mesh,
-			true,
-			m_polygon.m_points[0],
-			m_polygon.m_points[convex_itr + 1],
-			m_polygon.m_points[convex_itr + 2],
-			m_color,
-			convex_itr);
-	}
-
-	m_mesh = new GPUMesh(g_theRenderer);
-	m_mesh->CreateFromCPUMesh<Vertex_PCU>(convex_mesh); // we won't be updated this;
 }
 
 
 ConvexShape2D::~ConvexShape2D()
 {
-	delete m_mesh;
-	m_mesh = nullptr;
-
-	if(m_debugMesh)
-	{
-		delete m_debugMesh;
-		m_debugMesh = nullptr;
-	}
+	TaggedDelete(MEM_TAG_MESHES, m_hoverPointsMesh);
 }
 
 
+// only called for shapes in the game's dirty set
 void ConvexShape2D::Update(float delta_seconds)
 {
 	UNUSED(delta_seconds);
 
-	if (m_debugMesh)
+	if(!IsColliding() || IsOccluded())
 	{
-		delete m_debugMesh;
-		m_debugMesh = nullptr;
+		return;
 	}
 
-	Rgba color = m_debugColor;
+	// the mouse is inside, so show where it projects onto each plane
+	const Vec2 local_mouse_pos = GetFrame().ToLocalPosition(m_game->GetMousePosition());
+	const std::vector<Plane2>& planes = GetLocalConvexPlanes();
 
-	if(m_collideThisFrame && m_game->InDeveloperMode())
+	CPUMesh points_mesh;
+	for (int plane_idx = 0; plane_idx < static_cast<int>(planes.size()); ++plane_idx)
 	{
-		color = m_collideColor;
+		const Vec2 closest_point = planes[plane_idx].ClosestPoint(local_mouse_pos);
+		CpuMeshAddDisc(&points_mesh, Rgba::YELLOW, closest_point, 0.05f);
 	}
-	m_hull.Update(m_pointLocalPos, m_collideThisFrame);
-	m_collideThisFrame = false;
-	
-	CPUMesh disc_mesh;
-	CpuMeshAddDisc(&disc_mesh, color, 1.0f);
-	m_debugMesh = new GPUMesh(g_theRenderer);
-	m_debugMesh->CreateFromCPUMesh<Vertex_PCU>(disc_mesh);
-	
+
+	if(m_hoverPointsMesh == nullptr)
+	{
+		m_hoverPointsMesh = TaggedNew<GPUMesh>(MEM_TAG_MESHES, g_theRenderer);
+	}
+	m_hoverPointsMesh->CreateFromCPUMesh<Vertex_PCU>(points_mesh);
 }
 
 
+// the game draws every shape through RenderShapes, this is for drawing a single one
 void ConvexShape2D::Render() const
 {
 	if (!m_isDead)
 	{
-		const Matrix44 model_matrix = GetModelMatrix();
-		
-		g_theRenderer->BindModelMatrix(model_matrix);
 		g_theRenderer->BindMaterial(*m_material);
-		g_theRenderer->DrawMesh(*m_mesh);
-		
-		if(m_game->InDeveloperMode())
-		{
-			g_theRenderer->BindModelMatrix(model_matrix);
-			g_theRenderer->BindMaterial(*m_material);
-			g_theRenderer->DrawMesh(*m_debugMesh);
+		RenderShape(m_game->GetShapeComponents(), m_game->GetShapePrototypes(), m_componentIdx, m_game->InDeveloperMode());
+		RenderHoverPoints();
+	}
+}
 
-			m_hull.DebugRender(model_matrix);
-		}
+
+void ConvexShape2D::RenderHoverPoints() const
+{
+	if(m_hoverPointsMesh && IsColliding() && !IsOccluded() && m_game->InDeveloperMode())
+	{
+		g_theRenderer->BindModelMatrix(GetModelMatrix());
+		g_theRenderer->DrawMesh(*m_hoverPointsMesh);
 	}
 }
 
 
 void ConvexShape2D::Die()
 {
+	m_isDead = true;
+	m_componentIdx = -1;
 }
 
 
+// shapes coming back out of the pool get a fresh roll
 void ConvexShape2D::Revive()
 {
+	m_isDead = false;
+	Reroll();
+}
+
+
+// for shapes whose transform the caller has already written into their component slot
+void ConvexShape2D::ReviveInPlace()
+{
+	m_isDead = false;
+	m_game->GetShapeComponents().m_flags[m_componentIdx] &= ~SHAPE_FLAG_COLLIDING;
 }
 
 
 bool ConvexShape2D::InWorldBounds() const
 {
-	return IsPointInAABB2(m_position, WORLD_BOUNDS);
+	return IsPointInAABB2(GetPosition(), WORLD_BOUNDS);
 }
 
 
@@ -350,50 +420,138 @@ bool ConvexShape2D::DestroyEntity()
 	return false;
 }
 
+
+Vec2 ConvexShape2D::GetPosition() const
+{
+	return m_game->GetShapeComponents().m_positions[m_componentIdx];
+}
+
+
+float ConvexShape2D::GetOrientationDegrees() const
+{
+	return m_game->GetShapeComponents().m_orientationDegrees[m_componentIdx];
+}
+
+
+float ConvexShape2D::GetScale() const
+{
+	return m_game->GetShapeComponents().m_scales[m_componentIdx];
+}
+
+
 bool ConvexShape2D::CollisionFromPoint(const Vec2& pos)
 {
-	m_collideThisFrame = IsPointInDisc2D(pos, m_position, m_scale);
-	
-	Matrix44 model_matrix = GetModelMatrix();
-	model_matrix = model_matrix.GetInverseMatrix();
-	m_pointLocalPos = model_matrix.GetTransformPosition2D(pos);
+	ShapeComponents& shapes = m_game->GetShapeComponents();
+	const bool was_colliding = IsColliding();
 
-	if(m_collideThisFrame)
+	const bool colliding = IsPointInDisc2D(pos, GetPosition(), GetScale()) && IsPointInsideShape(pos);
+	if(colliding)
+	{
+		shapes.m_flags[m_componentIdx] |= SHAPE_FLAG_COLLIDING;
+	}
+	else
 	{
-		m_collideThisFrame = IsPointInsideShape(pos);
+		shapes.m_flags[m_componentIdx] &= ~SHAPE_FLAG_COLLIDING;
+	}
+
+	// the hover points follow the mouse, so they need rebuilding every frame it is inside
+	if(colliding || was_colliding)
+	{
+		MarkDirty();
 	}
 	
-	return 	m_collideThisFrame;
+	return colliding;
 }
 
+// picks another prototype and transform, nothing is allocated
+void ConvexShape2D::Reroll()
+{
+	RollTransform();
+	m_game->GetShapeComponents().m_flags[m_componentIdx] &= ~SHAPE_FLAG_COLLIDING;
+}
+
+
+void ConvexShape2D::RollTransform()
+{
+	ShapeComponents& shapes = m_game->GetShapeComponents();
+	shapes.m_prototypeIds[m_componentIdx] = m_game->GetShapePrototypes().GetRandomPrototypeId();
+
+	const float orientation_degrees = g_randomNumberGenerator.GetRandomFloatInRange(0.0f, 360.0f);
+	const float scale = g_randomNumberGenerator.GetRandomFloatInRange(MIN_SIZE, MAX_SIZE);
+	const Vec2 position = Vec2(
+		g_randomNumberGenerator.GetRandomFloatInRange(WORLD_BL_CORNER.x, WORLD_TR_CORNER.x),
+		g_randomNumberGenerator.GetRandomFloatInRange(WORLD_BL_CORNER.y, WORLD_TR_CORNER.y)
+	);
+
+	shapes.SetTransform(m_componentIdx, position, orientation_degrees, scale);
+}
+
+
 void ConvexShape2D::AddRotationDegrees(float degrees)
 {
-	m_orientationDegrees = ModFloatPositive(m_orientationDegrees + degrees, 360.0f);
+	ShapeComponents& shapes = m_game->GetShapeComponents();
+	shapes.m_orientationDegrees[m_componentIdx] = ModFloatPositive(shapes.m_orientationDegrees[m_componentIdx] + degrees, 360.0f);
+	shapes.RefreshFrame(m_componentIdx);
+	MarkDirty();
 }
 
 void ConvexShape2D::AddScalarValue(float scale)
 {
-	m_scale = ClampFloat(m_scale + scale, MIN_SIZE, MAX_SIZE);
+	ShapeComponents& shapes = m_game->GetShapeComponents();
+	shapes.m_scales[m_componentIdx] = ClampFloat(shapes.m_scales[m_componentIdx] + scale, MIN_SIZE, MAX_SIZE);
+	shapes.RefreshFrame(m_componentIdx);
+	MarkDirty();
 }
 
-std::vector<Plane2> ConvexShape2D::GetLocalConvexPlanes() const
+bool ConvexShape2D::IsColliding() const
 {
-	return m_hull.m_planes;
+	return (m_game->GetShapeComponents().m_flags[m_componentIdx] & SHAPE_FLAG_COLLIDING) != 0;
 }
 
-std::vector<Vec2> ConvexShape2D::GetLocalConvexPoints() const
+bool ConvexShape2D::IsOccluded() const
 {
-	return m_polygon.m_points;
+	return (m_game->GetShapeComponents().m_flags[m_componentIdx] & SHAPE_FLAG_OCCLUDED) != 0;
+}
+
+void ConvexShape2D::SetComponentIndex(const int component_idx)
+{
+	m_componentIdx = component_idx;
+}
+
+int ConvexShape2D::GetComponentIndex() const
+{
+	return m_componentIdx;
+}
+
+const ShapeFrame& ConvexShape2D::GetFrame() const
+{
+	return m_game->GetShapeComponents().m_frames[m_componentIdx];
+}
+
+int ConvexShape2D::GetPrototypeId() const
+{
+	return m_game->GetShapeComponents().m_prototypeIds[m_componentIdx];
+}
+
+const std::vector<Plane2>& ConvexShape2D::GetLocalConvexPlanes() const
+{
+	return m_game->GetShapePrototypes().GetPrototype(GetPrototypeId()).m_hull.m_planes;
+}
+
+const std::vector<Vec2>& ConvexShape2D::GetLocalConvexPoints() const
+{
+	return m_game->GetShapePrototypes().GetPrototype(GetPrototypeId()).m_polygon.m_points;
 }
 
 std::vector<Segment2> ConvexShape2D::GetLocalConvexSegments() const
 {
 	std::vector<Segment2> list;
-	const int num_points = static_cast<int>(m_polygon.m_points.size());
+	const std::vector<Vec2>& points = GetLocalConvexPoints();
+	const int num_points = static_cast<int>(points.size());
 
 	for(int point_idx = 0; point_idx < num_points; ++point_idx)
 	{
-		list.emplace_back(m_polygon.m_points[point_idx], m_polygon.m_points[(point_idx + 1)%num_points]);
+		list.emplace_back(points[point_idx], points[(point_idx + 1)%num_points]);
 	}
 
 	return list;
@@ -403,13 +561,14 @@ std::vector<Segment2> ConvexShape2D::GetLocalConvexSegments() const
 std::vector<Segment2> ConvexShape2D::GetWorldConvexSegments() const
 {
 	std::vector<Segment2> list;
-	const int num_points = static_cast<int>(m_polygon.m_points.size());
+	const std::vector<Vec2>& points = GetLocalConvexPoints();
+	const int num_points = static_cast<int>(points.size());
+	const ShapeFrame& frame = GetFrame();
 
 	for (int point_idx = 0; point_idx < num_points; ++point_idx)
 	{
-		Matrix44 model_matrix = GetModelMatrix();
-		Vec2 start = model_matrix.GetTransformPosition2D(m_polygon.m_points[point_idx]);
-		Vec2 end = model_matrix.GetTransformPosition2D(m_polygon.m_points[(point_idx + 1) % num_points]);
+		Vec2 start = frame.ToWorldPosition(points[point_idx]);
+		Vec2 end = frame.ToWorldPosition(points[(point_idx + 1) % num_points]);
 		
 		list.emplace_back(start, end);
 	}
@@ -419,49 +578,115 @@ std::vector<Segment2> ConvexShape2D::GetWorldConvexSegments() const
 
 bool ConvexShape2D::IsPointInsideShape(const Vec2& pos) const
 {
-	Matrix44 shape_local = GetModelMatrix().GetInverseMatrix();
-	Vec2 local_pos = shape_local.GetTransformPosition2D(pos);
-
-	std::vector<Plane2> plane = GetLocalConvexPlanes();
+	return ::IsPointInsideShape(m_game->GetShapeComponents(), m_game->GetShapePrototypes(), m_componentIdx, pos);
+}
 
-	for(int plane_idx = 0; plane_idx < static_cast<int>(plane.size()); ++plane_idx)
-	{
-		Vec2 closest_point = plane[plane_idx].ClosestPoint(local_pos);
-		Vec2 dir = closest_point - local_pos;
-		float compare = DotProduct(plane[plane_idx].m_normal, dir);
+bool ConvexShape2D::IsPointInsideShapeIgnorePlane(const Vec2& pos, int plane_idx) const
+{
+	return ::IsPointInsideShape(m_game->GetShapeComponents(), m_game->GetShapePrototypes(), m_componentIdx, pos, plane_idx);
+}
 
-		if (compare < 0.0f)
-		{
-			return false;
-		}
-	}
+//--------------------------------------------------------------------
 
-	return true;
+// inside is where DotProduct(normal, point) <= signed_distance
+static Plane2 MakeHalfPlane(const Vec2& normal, const float signed_distance)
+{
+	Plane2 plane;
+	plane.m_normal = normal.GetNormalized();
+	plane.m_signedDistance = signed_distance;
+	return plane;
 }
 
-bool ConvexShape2D::IsPointInsideShapeIgnorePlane(const Vec2& pos, int plane_idx) const
-{
-	Matrix44 shape_local = GetModelMatrix().GetInverseMatrix();
-	Vec2 local_pos = shape_local.GetTransformPosition2D(pos);
 
-	std::vector<Plane2> plane = GetLocalConvexPlanes();
+// same corners in counter clockwise order, starting anywhere
+static bool IsPolygonWithCorners(const ConvexPolygon2D& polygon, const std::vector<Vec2>& ccw_corners)
+{
+	const int num_corners = static_cast<int>(ccw_corners.size());
+	if(static_cast<int>(polygon.m_points.size()) != num_corners)
+	{
+		return false;
+	}
 
-	for (int idx = 0; idx < static_cast<int>(plane.size()); ++idx)
+	for(int start = 0; start < num_corners; ++start)
 	{
-		if(idx == plane_idx)
+		bool matches = true;
+		for(int corner_idx = 0; corner_idx < num_corners && matches; ++corner_idx)
 		{
-			continue;
+			const Vec2 offset = polygon.m_points[(start + corner_idx) % num_corners] - ccw_corners[corner_idx];
+			matches = Abs(offset.x) < 0.001f && Abs(offset.y) < 0.001f;
 		}
-		
-		Vec2 closest_point = plane[idx].ClosestPoint(local_pos);
-		Vec2 dir = closest_point - local_pos;
-		float compare = DotProduct(plane[idx].m_normal, dir);
 
-		if (compare < 0.0f)
+		if(matches)
 		{
-			return false;
+			return true;
 		}
 	}
 
-	return true;
+	return false;
+}
+
+
+UNITTEST("Half-plane intersection of disjoint planes is empty", "ConvexPolygon2D", 0)
+{
+	const AABB2 bounds(-10.0f, -5.0f, 10.0f, 5.0f);
+
+	// x >= 1 and x <= -1
+	const ConvexPolygon2D apart({ MakeHalfPlane(Vec2(-1.0f, 0.0f), -1.0f), MakeHalfPlane(Vec2(1.0f, 0.0f), -1.0f) }, bounds);
+
+	// a triangle's planes turned inside out
+	const ConvexPolygon2D inverted({
+		MakeHalfPlane(Vec2(0.0f, 1.0f), -1.0f),
+		MakeHalfPlane(Vec2(-1.0f, -1.0f), -1.0f),
+		MakeHalfPlane(Vec2(1.0f, -1.0f), -1.0f) }, bounds);
+
+	// a triangle entirely outside the clip bounds
+	const ConvexPolygon2D outside({
+		MakeHalfPlane(Vec2(0.0f, -1.0f), -20.0f),
+		MakeHalfPlane(Vec2(1.0f, 1.0f), 30.0f),
+		MakeHalfPlane(Vec2(-1.0f, 1.0f), 30.0f) }, bounds);
+
+	return apart.m_points.empty() && inverted.m_points.empty() && outside.m_points.empty();
+}
+
+
+// whatever the planes leave open is closed off by the clip bounds
+UNITTEST("Half-plane intersection closes unbounded sets with the clip bounds", "ConvexPolygon2D", 0)
+{
+	const AABB2 bounds(-10.0f, -5.0f, 10.0f, 5.0f);
+
+	const ConvexPolygon2D no_planes(std::vector<Plane2>(), bounds);
+	const ConvexPolygon2D left_half({ MakeHalfPlane(Vec2(1.0f, 0.0f), 0.0f) }, bounds);
+	const ConvexPolygon2D wedge({ MakeHalfPlane(Vec2(1.0f, -1.0f), 0.0f), MakeHalfPlane(Vec2(-1.0f, -1.0f), 0.0f) }, bounds);
+
+	return IsPolygonWithCorners(no_planes, { Vec2(-10.0f, -5.0f), Vec2(10.0f, -5.0f), Vec2(10.0f, 5.0f), Vec2(-10.0f, 5.0f) })
+		&& IsPolygonWithCorners(left_half, { Vec2(-10.0f, -5.0f), Vec2(0.0f, -5.0f), Vec2(0.0f, 5.0f), Vec2(-10.0f, 5.0f) })
+		&& IsPolygonWithCorners(wedge, { Vec2(0.0f, 0.0f), Vec2(5.0f, 5.0f), Vec2(-5.0f, 5.0f) });
+}
+
+
+UNITTEST("Half-plane intersection handles parallel planes", "ConvexPolygon2D", 0)
+{
+	const AABB2 bounds(-10.0f, -5.0f, 10.0f, 5.0f);
+
+	// same direction, only the tightest counts whatever order they come in
+	const ConvexPolygon2D stacked({
+		MakeHalfPlane(Vec2(1.0f, 0.0f), 3.0f),
+		MakeHalfPlane(Vec2(1.0f, 0.0f), 1.0f),
+		MakeHalfPlane(Vec2(1.0f, 0.0f), 2.0f) }, bounds);
+
+	// opposite directions with room between them
+	const ConvexPolygon2D strip({ MakeHalfPlane(Vec2(1.0f, 0.0f), 1.0f), MakeHalfPlane(Vec2(-1.0f, 0.0f), 1.0f) }, bounds);
+
+	// a square whose sides are repeated, plus a parallel plane that cuts nothing
+	const ConvexPolygon2D square({
+		MakeHalfPlane(Vec2(1.0f, 0.0f), 2.0f),
+		MakeHalfPlane(Vec2(0.0f, 1.0f), 2.0f),
+		MakeHalfPlane(Vec2(-1.0f, 0.0f), 2.0f),
+		MakeHalfPlane(Vec2(0.0f, -1.0f), 2.0f),
+		MakeHalfPlane(Vec2(1.0f, 0.0f), 2.0f),
+		MakeHalfPlane(Vec2(0.0f, 1.0f), 4.0f) }, bounds);
+
+	return IsPolygonWithCorners(stacked, { Vec2(-10.0f, -5.0f), Vec2(1.0f, -5.0f), Vec2(1.0f, 5.0f), Vec2(-10.0f, 5.0f) })
+		&& IsPolygonWithCorners(strip, { Vec2(-1.0f, -5.0f), Vec2(1.0f, -5.0f), Vec2(1.0f, 5.0f), Vec2(-1.0f, 5.0f) })
+		&& IsPolygonWithCorners(square, { Vec2(-2.0f, -2.0f), Vec2(2.0f, -2.0f), Vec2(2.0f, 2.0f), Vec2(-2.0f, 2.0f) });
 }
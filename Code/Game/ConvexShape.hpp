@@ -3,6 +3,7 @@
 
 #include "Game/Entity.hpp"
 #include "Game/GameCommon.hpp"
+#include "Game/ShapeComponents.hpp"
 
 #include <vector>
 
@@ -22,14 +23,16 @@ public:
 	ConvexHull2D(const ConvexPolygon2D& poly);
 	explicit ConvexHull2D(const std::vector<Vec2>& points); 
 	
-	void Update(const Vec2& mouse_position, bool render_this_frame);
+	void SetFromPolygon(const ConvexPolygon2D& poly);
+	void SetFromCcwPoints(const std::vector<Vec2>& ccw_points);
+	void BuildDebugMeshes();
 	void DebugRender(const Matrix44& model_matrix) const;
 	
 private:
-	bool m_renderFrame = false;
-	
+	void ClearDebugMeshes();
+
+private:
 	std::vector<GPUMesh*> m_debugLineMeshList;
-	std::vector<GPUMesh*> m_debugPointMeshList;
 };
 
 
@@ -45,7 +48,10 @@ public:
 	~ConvexPolygon2D();
 
 	ConvexPolygon2D(const ConvexHull2D& hull);
-	explicit ConvexPolygon2D(const std::vector<Plane2>& hull);
+	explicit ConvexPolygon2D(const std::vector<Vec2>& ccw_points);
+	explicit ConvexPolygon2D(const std::vector<Plane2>& hull, const AABB2& clip_bounds = WORLD_BOUNDS);
+
+	void Regenerate();
 
 private:
 	void RandomCcwPoints(std::vector<Vec2>& out) const;
@@ -57,7 +63,9 @@ private:
 
 //--------------------------------------------------------------------
 
-class ConvexShape2D: public Entity
+// Facade over one slot of the game's ShapeComponents. Transform, prototype id and flags live in the
+// component arrays so the batched systems can walk them, the object keeps the gameplay interface.
+class alignas(64) ConvexShape2D: public Entity
 {
 public:
 	explicit ConvexShape2D(Game* the_game);
@@ -67,58 +75,46 @@ public:
 	void Render() const override;
 	void Die() override;
 	void Revive() override;
+	void ReviveInPlace();
 	bool InWorldBounds() const override;
 	void DrawEntity() const override;
 	bool DestroyEntity() override;
 
+	Vec2	GetPosition() const override;
+	float	GetOrientationDegrees() const override;
+	float	GetScale() const override;
+
+	void RenderHoverPoints() const;
 	bool CollisionFromPoint(const Vec2& pos);
 
+	void Reroll();
 	void AddRotationDegrees(float degrees);
 	void AddScalarValue(float scale);
 
 	bool IsPointInsideShape(const Vec2& pos) const;
 	bool IsPointInsideShapeIgnorePlane(const Vec2& pos, int plane_idx) const;
+	bool IsColliding() const;
+	bool IsOccluded() const;
+
+	void SetComponentIndex(int component_idx);
+	int GetComponentIndex() const;
+	const ShapeFrame& GetFrame() const;
 
-	std::vector<Plane2> GetLocalConvexPlanes() const;
-	std::vector<Vec2> GetLocalConvexPoints() const;
+	int GetPrototypeId() const;
+	const std::vector<Plane2>& GetLocalConvexPlanes() const;
+	const std::vector<Vec2>& GetLocalConvexPoints() const;
 	std::vector<Segment2> GetLocalConvexSegments() const;
 
 	std::vector<Segment2> GetWorldConvexSegments() const;
 
+public:
+	static constexpr float MIN_SIZE = 5.0f;
+	static constexpr float MAX_SIZE = 15.0f;
 
 private:
-	ConvexHull2D		m_hull;
-	ConvexPolygon2D		m_polygon;
-
-	Rgba m_color = Rgba(0.0980392156862745f,
-		1.0000000000000000f,
-		0.0980392156862745f,
-		0.3200000000000000f);
-	
-	Rgba m_debugColor = Rgba(
-		0.0784313725490196f,
-		0.7098039215686275f,
-		0.8000000000000000f, 
-		0.2f
-	);
-	
-	Rgba m_collideColor = Rgba(
-		1.0000000000000000f, 
-		0.8980392156862745f,
-		0.0980392156862745f,
-		0.2f
-	);
-	
-	bool m_collideThisFrame = false;
-	
-	const float MIN_SIZE = 5.0f;
-	const float MAX_SIZE = 15.0f;
-	
-	float m_minX = WORLD_BL_CORNER.x;
-	float m_maxX = WORLD_TR_CORNER.x;
-	float m_minY = WORLD_BL_CORNER.y;
-	float m_maxY = WORLD_TR_CORNER.y;
-
-	Vec2 m_pointLocalPos = Vec2::ZERO;
+	void RollTransform();
 
-};
\ No newline at end of file
+private:
+	int			m_componentIdx = -1;			// slot in ShapeComponents, -1 while sitting in the pool
+	GPUMesh*	m_hoverPointsMesh = nullptr;	// closest point on each plane, only made once the mouse has been inside
+};
@@ -0,0 +1,619 @@
+#include "Game/DynamicAabbTree.hpp"
+#include "Game/AabbUtils.hpp"
+#include "Game/ShapeComponents.hpp"
+#include "Game/ShapeGrid.hpp"
+#include "Game/ShapePrototypes.hpp"
+#include "Game/ShapeSystems.hpp"
+#include "Game/TestScene.hpp"
+
+#include "Engine/Core/ErrorWarningAssert.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+
+DynamicAabbTree::DynamicAabbTree() = default;
+DynamicAabbTree::~DynamicAabbTree() = default;
+
+
+int DynamicAabbTree::CreateProxy(const AABB2& bounds, const int shape_idx)
+{
+	const int proxy_id = AllocateNode();
+	AabbTreeNode& leaf = m_nodes[proxy_id];
+	const Vec2 margin(m_fatMargin, m_fatMargin);
+	leaf.m_bounds = AABB2(bounds.mins - margin, bounds.maxs + margin);
+	leaf.m_shapeIdx = shape_idx;
+	leaf.m_height = 0;
+
+	InsertLeaf(proxy_id);
+	++m_numProxies;
+	return proxy_id;
+}
+
+
+void DynamicAabbTree::DestroyProxy(const int proxy_id)
+{
+	ASSERT_OR_DIE(m_nodes[proxy_id].IsLeaf(), "Only leaves are proxies");
+
+	RemoveLeaf(proxy_id);
+	FreeNode(proxy_id);
+	--m_numProxies;
+}
+
+
+// returns true only when the leaf had to be reinserted
+bool DynamicAabbTree::MoveProxy(const int proxy_id, const AABB2& bounds)
+{
+	if(BoundsContain(m_nodes[proxy_id].m_bounds, bounds))
+	{
+		return false;
+	}
+
+	RemoveLeaf(proxy_id);
+
+	const Vec2 margin(m_fatMargin, m_fatMargin);
+	m_nodes[proxy_id].m_bounds = AABB2(bounds.mins - margin, bounds.maxs + margin);
+	InsertLeaf(proxy_id);
+	return true;
+}
+
+
+void DynamicAabbTree::Clear()
+{
+	m_nodes.clear();
+	m_root = -1;
+	m_freeList = -1;
+	m_numProxies = 0;
+}
+
+
+// candidates only, the point is inside their fat box
+void DynamicAabbTree::QueryPoint(const Vec2& point, std::vector<int>& out_shapes) const
+{
+	out_shapes.clear();
+	if(m_root == -1)
+	{
+		return;
+	}
+
+	m_stack.clear();
+	m_stack.push_back(m_root);
+	while(!m_stack.empty())
+	{
+		const AabbTreeNode& node = m_nodes[m_stack.back()];
+		m_stack.pop_back();
+
+		if(point.x < node.m_bounds.mins.x || point.x > node.m_bounds.maxs.x
+			|| point.y < node.m_bounds.mins.y || point.y > node.m_bounds.maxs.y)
+		{
+			continue;
+		}
+
+		if(node.IsLeaf())
+		{
+			out_shapes.push_back(node.m_shapeIdx);
+		}
+		else
+		{
+			m_stack.push_back(node.m_child1);
+			m_stack.push_back(node.m_child2);
+		}
+	}
+}
+
+
+void DynamicAabbTree::QueryRegion(const AABB2& region, TaggedVector<int, MEM_TAG_SCRATCH>& out_shapes) const
+{
+	out_shapes.clear();
+	if(m_root == -1)
+	{
+		return;
+	}
+
+	m_stack.clear();
+	m_stack.push_back(m_root);
+	while(!m_stack.empty())
+	{
+		const AabbTreeNode& node = m_nodes[m_stack.back()];
+		m_stack.pop_back();
+
+		if(!BoundsOverlap(node.m_bounds, region))
+		{
+			continue;
+		}
+
+		if(node.IsLeaf())
+		{
+			out_shapes.push_back(node.m_shapeIdx);
+		}
+		else
+		{
+			m_stack.push_back(node.m_child1);
+			m_stack.push_back(node.m_child2);
+		}
+	}
+}
+
+
+// nearer child is visited first, so the best hit shrinks the ray before the far side is looked at
+bool DynamicAabbTree::RaycastClosest(const ShapeComponents& shapes, const ShapePrototypeLibrary& prototypes,
+	const Ray2& ray, const float max_t, ShapeRayHit& out_hit) const
+{
+	out_hit = ShapeRayHit();
+	float root_t = 0.0f;
+	if(m_root == -1 || !RayHitsBounds(ray, m_nodes[m_root].m_bounds, max_t, root_t))
+	{
+		return false;
+	}
+
+	m_stack.clear();
+	m_stack.push_back(m_root);
+	while(!m_stack.empty())
+	{
+		const AabbTreeNode& node = m_nodes[m_stack.back()];
+		m_stack.pop_back();
+
+		const float best_t = out_hit.m_t < max_t ? out_hit.m_t : max_t;
+		float enter_t = 0.0f;
+		if(!RayHitsBounds(ray, node.m_bounds, best_t, enter_t))
+		{
+			continue;
+		}
+
+		if(node.IsLeaf())
+		{
+			float t = 0.0f;
+			int plane_idx = -1;
+			if(RaycastShape(shapes, prototypes, node.m_shapeIdx, ray, t, plane_idx) && t <= best_t)
+			{
+				out_hit.m_t = t;
+				out_hit.m_shapeIdx = node.m_shapeIdx;
+				out_hit.m_planeIdx = plane_idx;
+			}
+
+			continue;
+		}
+
+		float t1 = 0.0f;
+		float t2 = 0.0f;
+		const bool hit1 = RayHitsBounds(ray, m_nodes[node.m_child1].m_bounds, best_t, t1);
+		const bool hit2 = RayHitsBounds(ray, m_nodes[node.m_child2].m_bounds, best_t, t2);
+		if(hit1 && hit2)
+		{
+			// pushed far first so the near one pops next
+			m_stack.push_back(t1 <= t2 ? node.m_child2 : node.m_child1);
+			m_stack.push_back(t1 <= t2 ? node.m_child1 : node.m_child2);
+		}
+		else if(hit1)
+		{
+			m_stack.push_back(node.m_child1);
+		}
+		else if(hit2)
+		{
+			m_stack.push_back(node.m_child2);
+		}
+	}
+
+	if(out_hit.m_shapeIdx == -1)
+	{
+		return false;
+	}
+
+	if(out_hit.m_planeIdx != -1)
+	{
+		const std::vector<Plane2>& planes = prototypes.GetPrototype(shapes.m_prototypeIds[out_hit.m_shapeIdx]).m_hull.m_planes;
+		out_hit.m_normal = shapes.m_frames[out_hit.m_shapeIdx].ToWorldVector(planes[out_hit.m_planeIdx].m_normal).GetNormalized();
+	}
+
+	return true;
+}
+
+
+int DynamicAabbTree::GetHeight() const
+{
+	return m_root == -1 ? 0 : m_nodes[m_root].m_height;
+}
+
+
+const AABB2& DynamicAabbTree::GetFatBounds(const int proxy_id) const
+{
+	return m_nodes[proxy_id].m_bounds;
+}
+
+
+// walks every node checking links, heights and bounds, slow so only for debugging
+void DynamicAabbTree::Validate() const
+{
+	if(m_root != -1)
+	{
+		ASSERT_OR_DIE(m_nodes[m_root].m_parent == -1, "Tree root has a parent");
+		ValidateNode(m_root);
+	}
+}
+
+
+int DynamicAabbTree::AllocateNode()
+{
+	if(m_freeList == -1)
+	{
+		m_nodes.emplace_back();
+		return static_cast<int>(m_nodes.size()) - 1;
+	}
+
+	const int node_idx = m_freeList;
+	m_freeList = m_nodes[node_idx].m_parent;
+	m_nodes[node_idx] = AabbTreeNode();
+	return node_idx;
+}
+
+
+void DynamicAabbTree::FreeNode(const int node_idx)
+{
+	AabbTreeNode& node = m_nodes[node_idx];
+	node.m_parent = m_freeList;
+	node.m_child1 = -1;
+	node.m_child2 = -1;
+	node.m_height = -1;
+	node.m_shapeIdx = -1;
+	m_freeList = node_idx;
+}
+
+
+// walks down towards the sibling that grows the tree's total perimeter the least
+void DynamicAabbTree::InsertLeaf(const int leaf_idx)
+{
+	if(m_root == -1)
+	{
+		m_root = leaf_idx;
+		m_nodes[leaf_idx].m_parent = -1;
+		return;
+	}
+
+	const AABB2 leaf_bounds = m_nodes[leaf_idx].m_bounds;
+	int sibling_idx = m_root;
+	while(!m_nodes[sibling_idx].IsLeaf())
+	{
+		const AabbTreeNode& node = m_nodes[sibling_idx];
+		const float combined_perimeter = GetPerimeter(UnionBounds(node.m_bounds, leaf_bounds));
+
+		// pairing with this node makes a new parent, going deeper grows this node's box for free-ish
+		const float cost_here = 2.0f * combined_perimeter;
+		const float inherited_cost = 2.0f * (combined_perimeter - GetPerimeter(node.m_bounds));
+
+		float child_costs[2];
+		const int children[2] = { node.m_child1, node.m_child2 };
+		for(int child = 0; child < 2; ++child)
+		{
+			const AabbTreeNode& child_node = m_nodes[children[child]];
+			const float grown = GetPerimeter(UnionBounds(child_node.m_bounds, leaf_bounds));
+			child_costs[child] = inherited_cost + (child_node.IsLeaf() ? grown : grown - GetPerimeter(child_node.m_bounds));
+		}
+
+		if(cost_here < child_costs[0] && cost_here < child_costs[1])
+		{
+			break;
+		}
+
+		sibling_idx = child_costs[0] < child_costs[1] ? children[0] : children[1];
+	}
+
+	const int old_parent_idx = m_nodes[sibling_idx].m_parent;
+	const int new_parent_idx = AllocateNode();
+
+	AabbTreeNode& new_parent = m_nodes[new_parent_idx];
+	new_parent.m_parent = old_parent_idx;
+	new_parent.m_bounds = UnionBounds(leaf_bounds, m_nodes[sibling_idx].m_bounds);
+	new_parent.m_height = m_nodes[sibling_idx].m_height + 1;
+	new_parent.m_child1 = sibling_idx;
+	new_parent.m_child2 = leaf_idx;
+
+	if(old_parent_idx != -1)
+	{
+		AabbTreeNode& old_parent = m_nodes[old_parent_idx];
+		if(old_parent.m_child1 == sibling_idx)
+		{
+			old_parent.m_child1 = new_parent_idx;
+		}
+		else
+		{
+			old_parent.m_child2 = new_parent_idx;
+		}
+	}
+	else
+	{
+		m_root = new_parent_idx;
+	}
+
+	m_nodes[sibling_idx].m_parent = new_parent_idx;
+	m_nodes[leaf_idx].m_parent = new_parent_idx;
+
+	RefitAncestors(new_parent_idx);
+}
+
+
+// the leaf's parent goes away and the sibling takes its place
+void DynamicAabbTree::RemoveLeaf(const int leaf_idx)
+{
+	if(leaf_idx == m_root)
+	{
+		m_root = -1;
+		return;
+	}
+
+	const int parent_idx = m_nodes[leaf_idx].m_parent;
+	const int grandparent_idx = m_nodes[parent_idx].m_parent;
+	const int sibling_idx = m_nodes[parent_idx].m_child1 == leaf_idx ? m_nodes[parent_idx].m_child2 : m_nodes[parent_idx].m_child1;
+
+	m_nodes[sibling_idx].m_parent = grandparent_idx;
+	FreeNode(parent_idx);
+
+	if(grandparent_idx == -1)
+	{
+		m_root = sibling_idx;
+		return;
+	}
+
+	AabbTreeNode& grandparent = m_nodes[grandparent_idx];
+	if(grandparent.m_child1 == parent_idx)
+	{
+		grandparent.m_child1 = sibling_idx;
+	}
+	else
+	{
+		grandparent.m_child2 = sibling_idx;
+	}
+
+	RefitAncestors(grandparent_idx);
+}
+
+
+// promotes the taller grandchild when the children differ in height by more than one,
+// returns whichever node now sits where node_idx was
+int DynamicAabbTree::Balance(const int node_idx)
+{
+	AabbTreeNode& a = m_nodes[node_idx];
+	if(a.IsLeaf() || a.m_height < 2)
+	{
+		return node_idx;
+	}
+
+	const int b_idx = a.m_child1;
+	const int c_idx = a.m_child2;
+	const int balance = m_nodes[c_idx].m_height - m_nodes[b_idx].m_height;
+	if(balance >= -1 && balance <= 1)
+	{
+		return node_idx;
+	}
+
+	// rotate the taller child (up) into a's place, a takes one of its children
+	const bool promote_c = balance > 1;
+	const int up_idx = promote_c ? c_idx : b_idx;
+	const int stay_idx = promote_c ? b_idx : c_idx;
+	AabbTreeNode& up = m_nodes[up_idx];
+	const int f_idx = up.m_child1;
+	const int g_idx = up.m_child2;
+
+	up.m_child1 = node_idx;
+	up.m_parent = a.m_parent;
+	a.m_parent = up_idx;
+
+	if(up.m_parent != -1)
+	{
+		AabbTreeNode& parent = m_nodes[up.m_parent];
+		if(parent.m_child1 == node_idx)
+		{
+			parent.m_child1 = up_idx;
+		}
+		else
+		{
+			parent.m_child2 = up_idx;
+		}
+	}
+	else
+	{
+		m_root = up_idx;
+	}
+
+	// the taller grandchild stays with up, the shorter one moves under a
+	const bool f_taller = m_nodes[f_idx].m_height > m_nodes[g_idx].m_height;
+	const int kept_idx = f_taller ? f_idx : g_idx;
+	const int moved_idx = f_taller ? g_idx : f_idx;
+
+	up.m_child2 = kept_idx;
+	if(promote_c)
+	{
+		a.m_child2 = moved_idx;
+	}
+	else
+	{
+		a.m_child1 = moved_idx;
+	}
+	m_nodes[moved_idx].m_parent = node_idx;
+
+	const AabbTreeNode& stay = m_nodes[stay_idx];
+	const AabbTreeNode& moved = m_nodes[moved_idx];
+	const AabbTreeNode& kept = m_nodes[kept_idx];
+	a.m_bounds = UnionBounds(stay.m_bounds, moved.m_bounds);
+	a.m_height = 1 + std::max(stay.m_height, moved.m_height);
+	up.m_bounds = UnionBounds(a.m_bounds, kept.m_bounds);
+	up.m_height = 1 + std::max(a.m_height, kept.m_height);
+
+	return up_idx;
+}
+
+
+void DynamicAabbTree::RefitAncestors(int node_idx)
+{
+	while(node_idx != -1)
+	{
+		node_idx = Balance(node_idx);
+
+		AabbTreeNode& node = m_nodes[node_idx];
+		const AabbTreeNode& child1 = m_nodes[node.m_child1];
+		const AabbTreeNode& child2 = m_nodes[node.m_child2];
+		node.m_height = 1 + std::max(child1.m_height, child2.m_height);
+		node.m_bounds = UnionBounds(child1.m_bounds, child2.m_bounds);
+
+		node_idx = node.m_parent;
+	}
+}
+
+
+int DynamicAabbTree::ValidateNode(const int node_idx) const
+{
+	const AabbTreeNode& node = m_nodes[node_idx];
+	if(node.IsLeaf())
+	{
+		ASSERT_OR_DIE(node.m_height == 0, "Leaf height is not zero");
+		return 0;
+	}
+
+	const AabbTreeNode& child1 = m_nodes[node.m_child1];
+	const AabbTreeNode& child2 = m_nodes[node.m_child2];
+	ASSERT_OR_DIE(child1.m_parent == node_idx && child2.m_parent == node_idx, "Child does not point back at its parent");
+	ASSERT_OR_DIE(BoundsContain(node.m_bounds, child1.m_bounds) && BoundsContain(node.m_bounds, child2.m_bounds), "Node bounds miss a child");
+
+	const int height = 1 + std::max(ValidateNode(node.m_child1), ValidateNode(node.m_child2));
+	ASSERT_OR_DIE(height == node.m_height, "Node height is stale");
+	return height;
+}
+
+//--------------------------------------------------------------------
+
+static AABB2 GetTestShapeBounds(const ShapeComponents& shapes, const int shape_idx)
+{
+	const Vec2 extents(shapes.m_scales[shape_idx], shapes.m_scales[shape_idx]);
+	return AABB2(shapes.m_positions[shape_idx] - extents, shapes.m_positions[shape_idx] + extents);
+}
+
+
+// every live proxy whose fat box overlaps the region, in shape order, and each shape's exact box has to be among them
+static bool RegionMatchesBruteForce(const DynamicAabbTree& tree, const ShapeComponents& shapes, const std::vector<int>& proxies,
+	const AABB2& region, TaggedVector<int, MEM_TAG_SCRATCH>& found)
+{
+	tree.QueryRegion(region, found);
+	std::sort(found.begin(), found.end());
+
+	std::vector<int> expected;
+	for(int shape_idx = 0; shape_idx < static_cast<int>(proxies.size()); ++shape_idx)
+	{
+		if(proxies[shape_idx] == -1)
+		{
+			continue;
+		}
+
+		if(BoundsOverlap(tree.GetFatBounds(proxies[shape_idx]), region))
+		{
+			expected.push_back(shape_idx);
+		}
+		else if(BoundsOverlap(GetTestShapeBounds(shapes, shape_idx), region))
+		{
+			return false;
+		}
+	}
+
+	return found.size() == expected.size() && std::equal(found.begin(), found.end(), expected.begin());
+}
+
+
+// closest hit over every live shape, ties on t only have to agree with the hit shape's own cast
+static bool RayMatchesBruteForce(const DynamicAabbTree& tree, const ShapeComponents& shapes, const ShapePrototypeLibrary& prototypes,
+	const std::vector<int>& proxies, const Ray2& ray, const float max_t)
+{
+	float expected_t = max_t;
+	bool expected_hit = false;
+	for(int shape_idx = 0; shape_idx < static_cast<int>(proxies.size()); ++shape_idx)
+	{
+		float t = 0.0f;
+		int plane_idx = -1;
+		if(proxies[shape_idx] != -1 && RaycastShape(shapes, prototypes, shape_idx, ray, t, plane_idx) && t <= expected_t)
+		{
+			expected_t = t;
+			expected_hit = true;
+		}
+	}
+
+	ShapeRayHit hit;
+	if(tree.RaycastClosest(shapes, prototypes, ray, max_t, hit) != expected_hit)
+	{
+		return false;
+	}
+
+	float shape_t = 0.0f;
+	int plane_idx = -1;
+	return !expected_hit || (hit.m_t == expected_t && proxies[hit.m_shapeIdx] != -1
+		&& RaycastShape(shapes, prototypes, hit.m_shapeIdx, ray, shape_t, plane_idx)
+		&& shape_t == hit.m_t && plane_idx == hit.m_planeIdx);
+}
+
+
+// shapes drift inside their margin, now and then jump out of it or leave and come back, and the tree
+// is validated and queried after every frame of that
+UNITTEST("DynamicAabbTree region and ray queries match brute force", "DynamicAabbTree", 0)
+{
+	constexpr int num_shapes = 400;
+	uint random_state = 0x9B05688Cu;
+	ShapePrototypeLibrary prototypes;
+	ShapeComponents shapes;
+	BuildTestScene(prototypes, shapes, random_state, 8, num_shapes, 0.2f, 2.2f);
+
+	DynamicAabbTree tree;
+	std::vector<int> proxies(num_shapes);
+	for(int shape_idx = 0; shape_idx < num_shapes; ++shape_idx)
+	{
+		proxies[shape_idx] = tree.CreateProxy(GetTestShapeBounds(shapes, shape_idx), shape_idx);
+	}
+
+	TaggedVector<int, MEM_TAG_SCRATCH> found;
+	for(int frame_idx = 0; frame_idx < 20; ++frame_idx)
+	{
+		for(int shape_idx = 0; shape_idx < num_shapes; ++shape_idx)
+		{
+			const float roll = NextTestRandom(random_state);
+			if(roll < 0.02f)
+			{
+				// gone, or back in a new leaf
+				if(proxies[shape_idx] != -1)
+				{
+					tree.DestroyProxy(proxies[shape_idx]);
+					proxies[shape_idx] = -1;
+				}
+				else
+				{
+					proxies[shape_idx] = tree.CreateProxy(GetTestShapeBounds(shapes, shape_idx), shape_idx);
+				}
+				continue;
+			}
+
+			const float reach = roll < 0.1f ? 20.0f : 0.5f;
+			const Vec2 move(NextTestRandom(random_state) * 2.0f - 1.0f, NextTestRandom(random_state) * 2.0f - 1.0f);
+			shapes.SetTransform(shape_idx, shapes.m_positions[shape_idx] + move * reach, shapes.m_orientationDegrees[shape_idx], shapes.m_scales[shape_idx]);
+			if(proxies[shape_idx] != -1)
+			{
+				tree.MoveProxy(proxies[shape_idx], GetTestShapeBounds(shapes, shape_idx));
+			}
+		}
+
+		tree.Validate();
+
+		for(int query_idx = 0; query_idx < 20; ++query_idx)
+		{
+			const Vec2 mins = GetTestWorldPosition(random_state);
+			const AABB2 region(mins, mins + Vec2(1.0f + NextTestRandom(random_state) * 30.0f, 1.0f + NextTestRandom(random_state) * 30.0f));
+			if(!RegionMatchesBruteForce(tree, shapes, proxies, region, found))
+			{
+				return false;
+			}
+
+			const float degrees = NextTestRandom(random_state) * 360.0f;
+			const Ray2 ray(GetTestWorldPosition(random_state), Vec2(CosDegrees(degrees), SinDegrees(degrees)));
+			const float max_t = query_idx % 2 == 0 ? INFINITY : 1.0f + NextTestRandom(random_state) * 20.0f;
+			if(!RayMatchesBruteForce(tree, shapes, prototypes, proxies, ray, max_t))
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include "Engine/Math/AABB2.hpp"
+#include "Engine/Math/Ray2.hpp"
+#include "Engine/Math/Vec2.hpp"
+
+#include "Game/MemoryTags.hpp"
+
+#include <vector>
+
+struct ShapeComponents;
+struct ShapeRayHit;
+class ShapePrototypeLibrary;
+
+struct AabbTreeNode
+{
+	AABB2	m_bounds;				// fattened for leaves, the union of the children otherwise
+	int		m_parent = -1;			// next free node while on the free list
+	int		m_child1 = -1;
+	int		m_child2 = -1;
+	int		m_height = -1;			// 0 for leaves, -1 while free
+	int		m_shapeIdx = -1;		// leaves only
+
+	bool	IsLeaf() const { return m_child1 == -1; }
+};
+
+// Bounding volume hierarchy that is kept up to date instead of rebuilt. Leaves hold a box grown by
+// a margin, so a shape that turns or scales a little stays inside it and moving it costs nothing,
+// otherwise the leaf is pulled out and reinserted along the cheapest path, rotating on the way up
+// to keep the tree balanced.
+class DynamicAabbTree
+{
+public:
+	DynamicAabbTree();
+	~DynamicAabbTree();
+
+	int		CreateProxy(const AABB2& bounds, int shape_idx);
+	void	DestroyProxy(int proxy_id);
+	bool	MoveProxy(int proxy_id, const AABB2& bounds);
+	void	SetProxyShape(int proxy_id, int shape_idx)	{ m_nodes[proxy_id].m_shapeIdx = shape_idx; }
+	void	Clear();
+
+	void	QueryPoint(const Vec2& point, std::vector<int>& out_shapes) const;
+	void	QueryRegion(const AABB2& region, TaggedVector<int, MEM_TAG_SCRATCH>& out_shapes) const;
+	bool	RaycastClosest(const ShapeComponents& shapes, const ShapePrototypeLibrary& prototypes,
+				const Ray2& ray, float max_t, ShapeRayHit& out_hit) const;
+
+	void	SetFatMargin(float margin)		{ m_fatMargin = margin; }
+	int		GetNumProxies() const			{ return m_numProxies; }
+	int		GetHeight() const;
+	const AABB2&	GetFatBounds(int proxy_id) const;
+	void	Validate() const;
+
+private:
+	int		AllocateNode();
+	void	FreeNode(int node_idx);
+	void	InsertLeaf(int leaf_idx);
+	void	RemoveLeaf(int leaf_idx);
+	int		Balance(int node_idx);
+	void	RefitAncestors(int node_idx);
+	int		ValidateNode(int node_idx) const;
+
+private:
+	TaggedVector<AabbTreeNode, MEM_TAG_SHAPES>	m_nodes;
+	int							m_root = -1;
+	int							m_freeList = -1;
+	int							m_numProxies = 0;
+	float						m_fatMargin = 2.0f;
+
+	mutable TaggedVector<int, MEM_TAG_SCRATCH>	m_stack;		// scratch for the queries
+};
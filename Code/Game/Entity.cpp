@@ -15,36 +15,40 @@ Entity::Entity(Game* the_game): m_game(the_game)
 
 Entity::~Entity() = default;
 
-Vec2 Entity::GetPosition() const
+float Entity::GetOrientationRadians() const
 {
-	return m_position;
+	return GetOrientationDegrees() * DEGREES_TO_RADIANS_SCALE;
 }
 
-float Entity::GetOrientationDegrees() const
+Matrix44 Entity::GetModelMatrix() const
 {
-	return m_orientationDegrees;
+	Matrix44 translation = Matrix44::MakeTranslation2D(GetPosition());
+	Matrix44 rotation = Matrix44::MakeZRotationDegrees(GetOrientationDegrees());
+	Matrix44 scale = Matrix44::MakeUniformScale2D(GetScale());
+
+	return scale * rotation * translation;
 }
 
-float Entity::GetOrientationRadians() const
+bool Entity::IsDead() const
 {
-	return m_orientationDegrees * DEGREES_TO_RADIANS_SCALE;
+	return m_isDead;
 }
 
-float Entity::GetScale() const
+void Entity::MarkDirty()
 {
-	return m_scale;
+	if(!m_isDirty)
+	{
+		m_isDirty = true;
+		m_game->AddDirtyEntity(this);
+	}
 }
 
-Matrix44 Entity::GetModelMatrix() const
+void Entity::ClearDirty()
 {
-	Matrix44 translation = Matrix44::MakeTranslation2D(m_position);
-	Matrix44 rotation = Matrix44::MakeZRotationDegrees(m_orientationDegrees);
-	Matrix44 scale = Matrix44::MakeUniformScale2D(m_scale);
-
-	return scale * rotation * translation;
+	m_isDirty = false;
 }
 
-bool Entity::IsDead() const
+bool Entity::IsDirty() const
 {
-	return m_isDead;
+	return m_isDirty;
 }
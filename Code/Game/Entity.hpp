@@ -22,25 +22,25 @@ public:
 	virtual void DrawEntity() const = 0;
 	virtual bool DestroyEntity() = 0;
 
-	Vec2		GetPosition() const;
-	float		GetOrientationDegrees() const;
+	// each entity keeps its transform where it already lives, shapes in ShapeComponents
+	virtual Vec2	GetPosition() const = 0;
+	virtual float	GetOrientationDegrees() const = 0;
+	virtual float	GetScale() const = 0;
+
 	float		GetOrientationRadians() const;
-	float		GetScale() const;
 	Matrix44	GetModelMatrix() const;
 	bool		IsDead() const;
 
+	void		MarkDirty();
+	void		ClearDirty();
+	bool		IsDirty() const;
+
 protected:
 	Game* m_game = nullptr;
 	
-	Vec2 m_position = Vec2::ZERO;			// the Entity's 2D (x,y) Cartesian origin/center location, in world space 
-	float m_orientationDegrees = 0.0f;	// the Entity's forward-facing direction, as an angle in degrees
-	float m_scale = 0.0f;
-	
 	bool m_isDead = false;				// whether the Entity should [not] participate in game logic
 	bool m_isGarbage = false;			// whether the Entity should be deleted at the end of Game::Update()
+	bool m_isDirty = false;				// whether the Entity still has to rebuild its meshes, cleared entities may stay queued
 
-	GPUMesh* m_mesh = nullptr;
 	Material* m_material = nullptr;
-
-	GPUMesh* m_debugMesh = nullptr;
 };
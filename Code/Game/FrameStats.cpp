@@ -0,0 +1,309 @@
+#include "Game/FrameStats.hpp"
+#include "Game/Profiler.hpp"
+
+#include "Engine/Core/ErrorWarningAssert.hpp"
+#include "Engine/Math/MathUtils.hpp"
+#include "Engine/Renderer/ImGUISystem.hpp"
+
+#include <cmath>
+#include <cstdio>
+
+
+FrameStats::FrameStats() = default;
+FrameStats::~FrameStats() = default;
+
+
+void FrameStats::RecordFrame(const double delta_seconds)
+{
+	const float frame_ms = static_cast<float>(delta_seconds * 1000.0);
+
+	int bin_idx = static_cast<int>(frame_ms / FRAME_STATS_BIN_WIDTH_MS);
+	bin_idx = ClampInt(bin_idx, 0, FRAME_STATS_NUM_BINS);
+	++m_bins[bin_idx];
+	++m_numFrames;
+	++m_markerBins[bin_idx];
+	++m_numMarkerFrames;
+
+	if(frame_ms > m_maxMs)
+	{
+		m_maxMs = frame_ms;
+	}
+	if(frame_ms > m_markerMaxMs)
+	{
+		m_markerMaxMs = frame_ms;
+	}
+
+	GatherProfiledSections();
+
+	if(frame_ms > m_budgetMs)
+	{
+		++m_numOverBudget;
+		AttributeHitch(frame_ms);
+	}
+
+	for(int section_idx = 0; section_idx < m_numSections; ++section_idx)
+	{
+		FrameSectionStat& section = m_sections[section_idx];
+		if(section.m_hasAverage)
+		{
+			section.m_averageMs += (section.m_frameMs - section.m_averageMs) * SECTION_AVERAGE_WEIGHT;
+		}
+		else
+		{
+			section.m_averageMs = section.m_frameMs;
+			section.m_hasAverage = true;
+		}
+		if(section.m_frameMs > section.m_maxMs)
+		{
+			section.m_maxMs = section.m_frameMs;
+		}
+		section.m_frameMs = 0.0f;
+	}
+}
+
+
+// label has to outlive the stats, a string literal. Section averages are reseeded, what was normal
+// before a scene change says nothing about after it, but the histogram and hitches are kept
+void FrameStats::AddMarker(const char* label)
+{
+	FrameMarker& marker = m_markers[m_numMarkers % FRAME_STATS_MAX_MARKERS];
+	marker.m_frame = m_numFrames;
+	marker.m_label = label;
+	++m_numMarkers;
+
+	for(int bin_idx = 0; bin_idx <= FRAME_STATS_NUM_BINS; ++bin_idx)
+	{
+		m_markerBins[bin_idx] = 0;
+	}
+	m_numMarkerFrames = 0;
+	m_markerMaxMs = 0.0f;
+
+	for(int section_idx = 0; section_idx < m_numSections; ++section_idx)
+	{
+		m_sections[section_idx].m_hasAverage = false;
+	}
+}
+
+
+float FrameStats::GetPercentileMs(const float percentile) const
+{
+	return GetBinsPercentileMs(m_bins, m_numFrames, m_maxMs, percentile);
+}
+
+
+float FrameStats::GetPercentileSinceMarkerMs(const float percentile) const
+{
+	return GetBinsPercentileMs(m_markerBins, m_numMarkerFrames, m_markerMaxMs, percentile);
+}
+
+
+void FrameStats::ImGuiDisplay() const
+{
+	const float p50 = GetPercentileMs(0.50f);
+
+	ImGui::Text("FPS (p50): %f", p50 > 0.0f ? 1000.0f / p50 : 0.0f);
+	ImGui::Text("Frame ms p50: %.2f p95: %.2f p99: %.2f max: %.2f", p50, GetPercentileMs(0.95f), GetPercentileMs(0.99f), m_maxMs);
+	ImGui::Text("Over %.2fms budget: %i / %i", m_budgetMs, m_numOverBudget, m_numFrames);
+
+	if(m_numMarkers > 0)
+	{
+		const FrameMarker& marker = m_markers[(m_numMarkers - 1) % FRAME_STATS_MAX_MARKERS];
+		ImGui::Text("Since %s (frame %i) p50: %.2f p95: %.2f p99: %.2f max: %.2f",
+			marker.m_label,
+			marker.m_frame,
+			GetPercentileSinceMarkerMs(0.50f),
+			GetPercentileSinceMarkerMs(0.95f),
+			GetPercentileSinceMarkerMs(0.99f),
+			m_markerMaxMs);
+	}
+
+	const int num_shown = m_numHitches < FRAME_STATS_MAX_HITCHES ? m_numHitches : FRAME_STATS_MAX_HITCHES;
+	for(int shown_idx = 0; shown_idx < num_shown; ++shown_idx)
+	{
+		const FrameHitch& hitch = m_hitches[(m_numHitches - 1 - shown_idx) % FRAME_STATS_MAX_HITCHES];
+		ImGui::Text("  hitch frame %i: %.2fms, %s %.2fms (avg %.2fms) after %s",
+			hitch.m_frame,
+			hitch.m_frameMs,
+			hitch.m_sectionName != nullptr ? hitch.m_sectionName : "unprofiled",
+			hitch.m_sectionMs,
+			hitch.m_sectionAverageMs,
+			hitch.m_markerLabel != nullptr ? hitch.m_markerLabel : "startup");
+	}
+}
+
+
+void FrameStats::LogSummary(const char* file_path) const
+{
+	FILE* file = nullptr;
+	fopen_s(&file, file_path, "wb");
+
+	char line[256];
+	const auto write_line = [&](const char* text)
+	{
+		DebuggerPrintf("%s\n", text);
+		if(file != nullptr)
+		{
+			fprintf(file, "%s\n", text);
+		}
+	};
+
+	snprintf(line, sizeof(line), "Frame stats: %i frames, %i over %.2fms budget", m_numFrames, m_numOverBudget, m_budgetMs);
+	write_line(line);
+	snprintf(line, sizeof(line), "  p50 %.2fms  p95 %.2fms  p99 %.2fms  max %.2fms",
+		GetPercentileMs(0.50f), GetPercentileMs(0.95f), GetPercentileMs(0.99f), m_maxMs);
+	write_line(line);
+
+	const int first_marker = m_numMarkers > FRAME_STATS_MAX_MARKERS ? m_numMarkers - FRAME_STATS_MAX_MARKERS : 0;
+	for(int marker_idx = first_marker; marker_idx < m_numMarkers; ++marker_idx)
+	{
+		const FrameMarker& marker = m_markers[marker_idx % FRAME_STATS_MAX_MARKERS];
+		snprintf(line, sizeof(line), "  marker at frame %i: %s", marker.m_frame, marker.m_label);
+		write_line(line);
+	}
+	if(m_numMarkers > 0)
+	{
+		snprintf(line, sizeof(line), "  since last marker: %i frames, p50 %.2fms  p95 %.2fms  p99 %.2fms  max %.2fms",
+			m_numMarkerFrames, GetPercentileSinceMarkerMs(0.50f), GetPercentileSinceMarkerMs(0.95f), GetPercentileSinceMarkerMs(0.99f), m_markerMaxMs);
+		write_line(line);
+	}
+
+	for(int section_idx = 0; section_idx < m_numSections; ++section_idx)
+	{
+		const FrameSectionStat& section = m_sections[section_idx];
+		snprintf(line, sizeof(line), "  %-28s avg %8.3fms  max %8.3fms  hitches %i",
+			section.m_name, section.m_averageMs, section.m_maxMs, section.m_hitchCount);
+		write_line(line);
+	}
+
+	if(file != nullptr)
+	{
+		fclose(file);
+	}
+}
+
+
+// the calling thread owns its profiler buffer, so it can read it back without synchronizing
+void FrameStats::GatherProfiledSections()
+{
+	const ProfilerThreadBuffer* buffer = ProfilerGetThreadBuffer();
+	const uint64_t write_count = buffer->m_writeCount.load(std::memory_order_relaxed);
+
+	if(write_count - m_profileCursor > PROFILER_RING_SIZE)
+	{
+		m_profileCursor = write_count - PROFILER_RING_SIZE;
+	}
+
+	for(; m_profileCursor < write_count; ++m_profileCursor)
+	{
+		const ProfileEvent& profile_event = buffer->m_events[m_profileCursor & PROFILER_RING_MASK];
+		const int section_idx = FindOrAddSection(profile_event.m_name, static_cast<int>(profile_event.m_depth));
+		if(section_idx >= 0)
+		{
+			const uint64_t duration = profile_event.m_endTicks - profile_event.m_startTicks;
+			m_sections[section_idx].m_frameMs += static_cast<float>(ProfilerTicksToMicroseconds(duration) * 0.001);
+		}
+	}
+}
+
+
+void FrameStats::AttributeHitch(const float frame_ms)
+{
+	// a section without an average yet has nothing to overrun
+	float largest_excess = 0.0f;
+	for(int section_idx = 0; section_idx < m_numSections; ++section_idx)
+	{
+		if(!m_sections[section_idx].m_hasAverage)
+		{
+			continue;
+		}
+
+		const float excess = m_sections[section_idx].m_frameMs - m_sections[section_idx].m_averageMs;
+		if(excess > largest_excess)
+		{
+			largest_excess = excess;
+		}
+	}
+
+	// parents always overrun at least as much as their children, so take the deepest real offender
+	int blamed_idx = -1;
+	for(int section_idx = 0; section_idx < m_numSections; ++section_idx)
+	{
+		const FrameSectionStat& section = m_sections[section_idx];
+		const float excess = section.m_frameMs - section.m_averageMs;
+		if(!section.m_hasAverage || excess <= 0.0f || excess < largest_excess * 0.5f)
+		{
+			continue;
+		}
+
+		if(blamed_idx == -1 || section.m_depth > m_sections[blamed_idx].m_depth)
+		{
+			blamed_idx = section_idx;
+		}
+	}
+
+	FrameHitch& hitch = m_hitches[m_numHitches % FRAME_STATS_MAX_HITCHES];
+	hitch.m_frame = m_numFrames;
+	hitch.m_frameMs = frame_ms;
+	hitch.m_sectionName = nullptr;
+	hitch.m_sectionMs = 0.0f;
+	hitch.m_sectionAverageMs = 0.0f;
+	hitch.m_markerLabel = m_numMarkers > 0 ? m_markers[(m_numMarkers - 1) % FRAME_STATS_MAX_MARKERS].m_label : nullptr;
+
+	if(blamed_idx != -1)
+	{
+		FrameSectionStat& section = m_sections[blamed_idx];
+		++section.m_hitchCount;
+		hitch.m_sectionName = section.m_name;
+		hitch.m_sectionMs = section.m_frameMs;
+		hitch.m_sectionAverageMs = section.m_averageMs;
+	}
+
+	++m_numHitches;
+}
+
+
+// scope names are string literals, so the pointer is the identity
+int FrameStats::FindOrAddSection(const char* name, const int depth)
+{
+	for(int section_idx = 0; section_idx < m_numSections; ++section_idx)
+	{
+		if(m_sections[section_idx].m_name == name)
+		{
+			return section_idx;
+		}
+	}
+
+	if(m_numSections == FRAME_STATS_MAX_SECTIONS)
+	{
+		return -1;
+	}
+
+	FrameSectionStat& section = m_sections[m_numSections];
+	section.m_name = name;
+	section.m_depth = depth;
+	return m_numSections++;
+}
+
+
+// percentile in [0, 1], reported as the upper edge of the bin that holds it
+STATIC float FrameStats::GetBinsPercentileMs(const int* bins, const int num_frames, const float max_ms, const float percentile)
+{
+	if(num_frames == 0)
+	{
+		return 0.0f;
+	}
+
+	const int rank = static_cast<int>(ceilf(percentile * static_cast<float>(num_frames)));
+	int seen = 0;
+	for(int bin_idx = 0; bin_idx < FRAME_STATS_NUM_BINS; ++bin_idx)
+	{
+		seen += bins[bin_idx];
+		if(seen >= rank)
+		{
+			const float upper_edge = static_cast<float>(bin_idx + 1) * FRAME_STATS_BIN_WIDTH_MS;
+			return upper_edge < max_ms ? upper_edge : max_ms;
+		}
+	}
+
+	return max_ms;
+}
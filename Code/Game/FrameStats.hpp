@@ -0,0 +1,91 @@
+#pragma once
+#include "Game/GameCommon.hpp"
+
+#include <cstdint>
+
+constexpr int	FRAME_STATS_NUM_BINS = 1'000;		// 0.1ms per bin, everything past 100ms lands in the overflow bin
+constexpr float	FRAME_STATS_BIN_WIDTH_MS = 0.1f;
+constexpr int	FRAME_STATS_MAX_SECTIONS = 32;
+constexpr int	FRAME_STATS_MAX_HITCHES = 8;
+constexpr int	FRAME_STATS_MAX_MARKERS = 8;
+
+struct FrameSectionStat
+{
+	const char*	m_name = nullptr;
+	int			m_depth = 0;
+	float		m_frameMs = 0.0f;		// accumulated over the frame being recorded
+	float		m_averageMs = 0.0f;		// exponential moving average, what "normal" looks like
+	bool		m_hasAverage = false;	// seeded from the first frame recorded after it was added or marked
+	float		m_maxMs = 0.0f;
+	int			m_hitchCount = 0;
+};
+
+struct FrameHitch
+{
+	int			m_frame = 0;
+	float		m_frameMs = 0.0f;
+	const char*	m_sectionName = nullptr;
+	float		m_sectionMs = 0.0f;
+	float		m_sectionAverageMs = 0.0f;
+	const char*	m_markerLabel = nullptr;	// the last marker before it
+};
+
+struct FrameMarker
+{
+	int			m_frame = 0;		// the first frame recorded after it
+	const char*	m_label = nullptr;
+};
+
+// Allocation free frame time histogram. Overrunning frames are blamed on the profiled scope
+// that went furthest over its own running average, preferring the deepest one. A marker splits
+// the run where the scene changed: the whole run is kept, and a second histogram restarts there.
+class FrameStats
+{
+public:
+	FrameStats();
+	~FrameStats();
+
+	void	RecordFrame(double delta_seconds);
+	void	AddMarker(const char* label);
+
+	float	GetPercentileMs(float percentile) const;
+	float	GetPercentileSinceMarkerMs(float percentile) const;
+	float	GetMaxMs() const				{ return m_maxMs; }
+	float	GetBudgetMs() const				{ return m_budgetMs; }
+	int		GetNumFrames() const			{ return m_numFrames; }
+	int		GetNumOverBudget() const		{ return m_numOverBudget; }
+
+	void	SetBudgetMs(float budget_ms)	{ m_budgetMs = budget_ms; }
+
+	void	ImGuiDisplay() const;
+	void	LogSummary(const char* file_path) const;
+
+private:
+	void	GatherProfiledSections();
+	void	AttributeHitch(float frame_ms);
+	int		FindOrAddSection(const char* name, int depth);
+
+	static float GetBinsPercentileMs(const int* bins, int num_frames, float max_ms, float percentile);
+
+private:
+	int			m_bins[FRAME_STATS_NUM_BINS + 1] = { 0 };
+	int			m_numFrames = 0;
+	int			m_numOverBudget = 0;
+	float		m_maxMs = 0.0f;
+	float		m_budgetMs = 1000.0f / 60.0f;
+
+	int			m_markerBins[FRAME_STATS_NUM_BINS + 1] = { 0 };
+	int			m_numMarkerFrames = 0;
+	float		m_markerMaxMs = 0.0f;
+	FrameMarker	m_markers[FRAME_STATS_MAX_MARKERS];
+	int			m_numMarkers = 0;		// total added, m_markers is a ring over the latest
+
+	FrameSectionStat	m_sections[FRAME_STATS_MAX_SECTIONS];
+	int					m_numSections = 0;
+	uint64_t			m_profileCursor = 0;
+
+	FrameHitch	m_hitches[FRAME_STATS_MAX_HITCHES];
+	int			m_numHitches = 0;		// total recorded, m_hitches is a ring over the latest
+
+	const float SECTION_AVERAGE_WEIGHT = 0.05f;
+};
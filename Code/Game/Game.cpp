@@ -1,6 +1,7 @@
 #include "Engine/Core/Vertex_PCU.hpp"
 #include "Engine/Core/WindowContext.hpp"
 #include "Engine/Math/Matrix44.hpp"
+#include "Engine/Math/MathUtils.hpp"
 #include "Engine/Core/CPUMesh.hpp"
 #include "Engine/Renderer/GPUMesh.hpp"
 #include "Engine/Renderer/Material.hpp"
@@ -8,6 +9,7 @@
 #include "Engine/Renderer/DebugRender.hpp"
 #include "Engine/Core/Vertex_Lit.hpp"
 #include "Engine/Core/Callstack.hpp"
+#include "Engine/Core/RandomNumberGenerator.hpp"
 #include "Engine/EngineCommon.hpp"
 #include "Engine/Renderer/ImGUISystem.hpp"
 
@@ -16,7 +18,12 @@
 #include "Game/Point.hpp"
 #include "Game/ConvexShape.hpp"
 #include "Game/BSPTree.hpp"
+#include "Game/Profiler.hpp"
+#include "Game/ByteBufferWriter.hpp"
+#include "Game/SceneSnapshot.hpp"
+#include "Game/ShapeSystems.hpp"
 
+#include <algorithm>
 #include <vector>
 
 UNITTEST("Is Test", nullptr, 0)
@@ -41,18 +48,28 @@ UNITTEST("Is false", nullptr, 2)
 }
 
 
-Game::Game(): m_mouseEntity(this), m_movableRay(this)
+Game::Game(): m_mouseEntity(this), m_movableRay(this), m_shapePool(this)
 {
 	m_convexShapes = std::vector<ConvexShape2D*>();
 	m_convexShapes.reserve(MAX_SHAPES);
+	m_dirtyEntities = std::vector<Entity*>();
+	m_dirtyEntities.reserve(MAX_SHAPES);
+	m_shapeComponents.Reserve(MAX_SHAPES);
+	m_collidingShapeIdx.reserve(MAX_SHAPES);
+	m_changedShapeIdx.reserve(MAX_SHAPES);
+	m_shapeProxies.reserve(MAX_SHAPES);
+	m_treeCandidates.reserve(MAX_SHAPES);
+
+	m_shapeTree.SetFatMargin(g_gameConfigBlackboard.GetValue("shapeTreeMargin", 2.0f));
+	m_numShapePrototypes = g_gameConfigBlackboard.GetValue("shapePrototypes", m_numShapePrototypes);
+	m_shapePrototypes.Generate(m_numShapePrototypes);
 	for(int shape_idx = 0; shape_idx < m_currentNumConvexShapes; ++shape_idx)
 	{
-		m_convexShapes.push_back(new ConvexShape2D(this));
+		AddShape();
 	}
 	
 
 	
-	m_invisibleRays = std::vector <Ray2>();
 	m_invisibleRays.reserve(MAX_RAYS);
 	for(int ray_idx = 0; ray_idx < m_currentNumRays; ++ray_idx)
 	{
@@ -77,22 +94,34 @@ void Game::Startup()
 {
 	InitCamera();
 	InitGameObjs();
+
+	m_frameStats.SetBudgetMs(g_gameConfigBlackboard.GetValue("frameBudgetMs", m_frameStats.GetBudgetMs()));
+	m_shapeGridCellSize = g_gameConfigBlackboard.GetValue("shapeGridCellSize", m_shapeGridCellSize);
+	m_regionSelectSize = g_gameConfigBlackboard.GetValue("regionSelectSize", m_regionSelectSize);
+	m_reflectionBounces = g_gameConfigBlackboard.GetValue("rayBounces", m_reflectionBounces);
+	m_reflectInvisibleRays = g_gameConfigBlackboard.GetValue("reflectInvisibleRays", m_reflectInvisibleRays);
 }
 
 
 void Game::Shutdown()
 {
-	for (int ent_idx = 0; ent_idx < static_cast<int>(m_convexShapes.size()); ++ent_idx)
-	{
-		delete m_convexShapes[ent_idx];
-		m_convexShapes[ent_idx] = nullptr;
-	}
+	m_frameStats.LogSummary("Data/Log/frame_stats.txt");
+
+	m_convexShapes.clear();
+	m_selectedShapes.clear();
+	m_dirtyEntities.clear();
+	m_shapeComponents.Clear();
+	m_shapeTree.Clear();
+	m_shapeProxies.clear();
+	m_shapePool.Clear();
+	m_shapePrototypes.Clear();
 	
 	delete m_gameCamera;
 	m_gameCamera = nullptr;
 
-	delete m_quad;
-	m_quad = nullptr;
+	TaggedDelete(MEM_TAG_MESHES, m_quad);
+
+	TaggedDelete(MEM_TAG_MESHES, m_visibilityMesh);
 }
 
 
@@ -104,36 +133,46 @@ void Game::BeginFrame() const
 }
 
 
-void Game::Update(const double delta_seconds)
+void Game::Update(double delta_seconds)
 {
+	PROFILE_SCOPE("Game::Update");
+	const uint64_t update_start = ProfilerGetTicks();
+
+	if(m_isReplayingInput)
+	{
+		delta_seconds = BeginReplayFrame();
+	}
+
 	m_time += static_cast<float>(delta_seconds);
 	m_currentFrame++;
 
-	const float fps = 1.0f / static_cast<float>(delta_seconds);
+	m_frameStats.RecordFrame(delta_seconds);
 
 	ImGui::Text("CurrentFrame: %i", m_currentFrame);
-	ImGui::Text("FPS: %f", CalcAverageTick(fps));
+	m_frameStats.ImGuiDisplay();
 	ImGui::Text("Num Shapes: %i", m_currentNumConvexShapes);
 	ImGui::Text("Num Rays: %i", m_currentNumRays);
 
-	m_mousePos = g_theWindow->GetMousePosition(WORLD_BOUNDS);
+	m_mousePos = m_isReplayingInput ? m_inputRecording.GetFrame(m_replayFrame).m_mousePos : g_theWindow->GetMousePosition(WORLD_BOUNDS);
 
 	UpdateEntities(delta_seconds);
 	
-	m_numHits = 0;
-	for(int ray_idx = 0; ray_idx < m_currentNumRays; ++ray_idx)
 	{
-		for(int convex_idx = 0; convex_idx < m_currentNumConvexShapes; ++convex_idx)
-		{
-			float t_val[] = { 0.0f };
-			const bool hit = RayToConvexShape(m_invisibleRays[ray_idx], *m_convexShapes[convex_idx]);
+		PROFILE_SCOPE("Game::RayLoop");
 
-			if (hit)
+		if(m_useLinearBvh)
+		{
+			m_numHits = 0;
+			ShapeRayHit hit;
+			for(int ray_idx = 0; ray_idx < m_currentNumRays; ++ray_idx)
 			{
-				++m_numHits;
-				break;
+				m_numHits += m_linearBvh.RaycastClosest(m_shapeComponents, m_shapePrototypes, m_invisibleRays[ray_idx], INFINITY, hit) ? 1 : 0;
 			}
 		}
+		else
+		{
+			m_numHits = CountRaysHittingShapes(m_shapeComponents, m_shapePrototypes, m_invisibleRays.data(), m_currentNumRays);
+		}
 	}
 
 	if(m_sceneUpdated)
@@ -141,50 +180,71 @@ void Game::Update(const double delta_seconds)
 		m_bspSet = false;
 	}
 
+	UpdateVisibilityPolygon();
+	UpdateCompressedBsp();
+	UpdateSnapshotMirror();
+	UpdateQueryCounters();
+
+	EndInputFrame(delta_seconds, ProfilerGetTicks() - update_start);
 }
 
 void Game::UpdateEntities(double delta_seconds)
 {
+	PROFILE_SCOPE("Game::UpdateEntities");
+
 	m_mouseEntity.Update(static_cast<float>(delta_seconds));
 	m_movableRay.PreUpdate();
 	
+	UpdateLinearBvh();
+	UpdateOcclusionCulling();
+	UpdateShapeTree();
 	MouseCollisionTest(m_selectedShapes);
+	UpdateRegionSelection();
 
 
-	float smallest_contact_point = INFINITY;
-	int closest_convx_idx = -1;
-	int closest_plain_idx = -1;
-	for (int ent_idx = 0; ent_idx < static_cast<int>(m_convexShapes.size()); ++ent_idx)
 	{
-		m_convexShapes[ent_idx]->Update(static_cast<float>(delta_seconds));
+		PROFILE_SCOPE("ShapeGrid::Build");
+
+		// shapes hang over the world edge by up to their scale, the grid has to cover that too
+		const Vec2 padding(ConvexShape2D::MAX_SIZE, ConvexShape2D::MAX_SIZE);
+		m_shapeGrid.Build(m_shapeComponents, AABB2(WORLD_BL_CORNER - padding, WORLD_TR_CORNER + padding), m_shapeGridCellSize);
+	}
+
+	m_movableRay.CollideWithShapes(m_shapeGrid, m_shapeComponents, m_shapePrototypes);
+	TraceReflections();
+	UpdateSweepAndPrune();
+	UpdateShapeOverlaps();
+	
+	m_movableRay.Update(static_cast<float>(delta_seconds));
+
+	UpdateDirtyEntities(delta_seconds);
+}
 
-		float t_val[] = { 0.0f };
-		int plain_idx = -1;
-		const bool hit = m_movableRay.CollideWithConvexShape(t_val, &plain_idx, *m_convexShapes[ent_idx]);
 
-		if (hit)
+// entities only rebuild their meshes when their selection, collision or transform changed. Removed
+// shapes are left in the list with their flag cleared, and one that came back out of the pool and was
+// marked again is in it twice, so only the first entry still flagged gets updated.
+void Game::UpdateDirtyEntities(double delta_seconds)
+{
+	const int num_dirty = static_cast<int>(m_dirtyEntities.size());
+	for (int dirty_idx = 0; dirty_idx < num_dirty; ++dirty_idx)
+	{
+		Entity* entity = m_dirtyEntities[dirty_idx];
+		if(entity->IsDirty())
 		{
-			if (smallest_contact_point > t_val[0])
-			{
-				smallest_contact_point = t_val[0];
-				closest_convx_idx = ent_idx;
-				closest_plain_idx = plain_idx;
-			}
+			entity->Update(static_cast<float>(delta_seconds));
+			entity->ClearDirty();
 		}
 	}
 
-	if (smallest_contact_point != INFINITY)
-	{
-		m_movableRay.SetEnd(smallest_contact_point, m_convexShapes[closest_convx_idx], closest_plain_idx);
-	}
-	
-	
-	m_movableRay.Update(static_cast<float>(delta_seconds));
+	m_dirtyEntities.clear();
 }
 
 
 void Game::Render() const
 {
+	PROFILE_SCOPE("Game::Render");
+
 	ColorTargetView* rtv = g_theRenderer->GetFrameColorTarget();
 	m_gameCamera->SetColorTarget(rtv);
 
@@ -202,6 +262,13 @@ void Game::Render() const
 	if(m_bspSet)
 	{
 		m_bspTree.Render();
+
+		if(m_showVisibility && m_visibilityPolygon.size() > 1)
+		{
+			g_theRenderer->BindModelMatrix(Matrix44::IDENTITY);
+			g_theRenderer->BindMaterial(*m_shapeMaterial);
+			g_theRenderer->DrawMesh(*m_visibilityMesh);
+		}
 	}
 	
 	g_imGUI->Render();
@@ -214,9 +281,10 @@ void Game::Render() const
 void Game::RenderEntities() const
 {
 	//would like to populate a buffer and do one single draw call, but till then
-	for (int ent_idx = 0; ent_idx < static_cast<int>(m_convexShapes.size()); ++ent_idx)
+	RenderShapes(m_shapeComponents, m_shapePrototypes, *m_shapeMaterial, m_inDevMode);
+	for (int hover_id = 0; hover_id < static_cast<int>(m_selectedShapes.size()); ++hover_id)
 	{
-		m_convexShapes[ent_idx]->Render();
+		m_selectedShapes[hover_id]->RenderHoverPoints();
 	}
 
 	m_movableRay.Render();
@@ -228,7 +296,40 @@ void Game::EndFrame() const
 	g_imGUI->EndFrame();
 }
 
+// live keys are ignored while a replay feeds the recorded ones
 bool Game::HandleKeyPressed(const unsigned char key_code)
+{
+	if(m_isReplayingInput)
+	{
+		return false;
+	}
+
+	if(m_isRecordingInput)
+	{
+		m_inputRecording.RecordKey(key_code, true);
+	}
+
+	return ApplyKeyPressed(key_code);
+}
+
+
+bool Game::HandleKeyReleased(const unsigned char key_code)
+{
+	if(m_isReplayingInput)
+	{
+		return false;
+	}
+
+	if(m_isRecordingInput)
+	{
+		m_inputRecording.RecordKey(key_code, false);
+	}
+
+	return ApplyKeyReleased(key_code);
+}
+
+
+bool Game::ApplyKeyPressed(const unsigned char key_code)
 {
 	switch (key_code)
 	{
@@ -293,7 +394,7 @@ bool Game::HandleKeyPressed(const unsigned char key_code)
 }
 
 
-bool Game::HandleKeyReleased(const unsigned char key_code)
+bool Game::ApplyKeyReleased(const unsigned char key_code)
 {
 	switch (key_code)
 	{
@@ -351,22 +452,59 @@ bool Game::HandleKeyReleased(const unsigned char key_code)
 			m_currentNumRays = cur_rays;
 			UpdateNumberOfRays();
 				
-			const int cur_shapes = m_currentNumConvexShapes;
-			m_currentNumConvexShapes = 1;
-			UpdateNumberOfShapes();
-			m_currentNumConvexShapes = cur_shapes;
-			UpdateNumberOfShapes();
+			RerollShapes();
 
-			m_bspTree.BuildBspTree(HEURISTIC_RANDOM, m_convexShapes);
-			m_sceneUpdated = false;
-			m_bspSet = true;
+			BuildBsp(HEURISTIC_RANDOM);
+			m_frameStats.AddMarker("scene reroll");
+			break;
+		}
+		case V_KEY: // show what the mouse can see, needs the BSP tree
+		{
+			m_showVisibility = !m_showVisibility;
+			break;
+		}
+		case O_KEY: // cull shapes hidden from the ray start, needs the BSP tree
+		{
+			m_occlusionCulling = !m_occlusionCulling;
+			break;
+		}
+		case P_KEY: // find every overlapping pair of shapes each frame
+		{
+			m_findOverlaps = !m_findOverlaps;
+			m_shapeContacts.clear();
+			break;
+		}
+		case B_KEY: // swap the overlap broadphase between the grid and sweep and prune
+		{
+			m_useSweepAndPrune = !m_useSweepAndPrune;
+			m_sweepAndPruneStale = true;
+			break;
+		}
+		case C_KEY: // compare line of sight through the compressed BSP against the float one
+		{
+			m_checkCompressedBsp = !m_checkCompressedBsp;
+			m_numCompressedMismatches = 0;
+			break;
+		}
+		case M_KEY: // mirror the shape transforms through the snapshot loopback every frame
+		{
+			m_mirrorSnapshots = !m_mirrorSnapshots;
+			m_snapshotLoopback.Reset();
+			break;
+		}
+		case L_KEY: // rebuild a Morton ordered BVH every frame and cast the invisible rays through it
+		{
+			m_useLinearBvh = !m_useLinearBvh;
+			break;
+		}
+		case G_KEY: // cycle selecting by box, disc or hexagon around the mouse, so the edit keys work on many shapes
+		{
+			m_regionSelectMode = static_cast<RegionSelectMode>((m_regionSelectMode + 1) % NUM_REGION_SELECT_MODES);
 			break;
 		}
 		case F2_KEY:
 		{
-			m_bspTree.BuildBspTree(HEURISTIC_RANDOM, m_convexShapes);
-			m_sceneUpdated = false;
-			m_bspSet = true;
+			BuildBsp(HEURISTIC_RANDOM);
 			break;
 		}
 		
@@ -385,11 +523,333 @@ void Game::SetDeveloperMode(const bool on_or_off)
 	m_inDevMode = on_or_off;
 }
 
+void Game::AddDirtyEntity(Entity* entity)
+{
+	m_dirtyEntities.push_back(entity);
+}
+
 Vec2 Game::GetMousePosition() const
 {
 	return m_mousePos;
 }
 
+const ShapePrototypeLibrary& Game::GetShapePrototypes() const
+{
+	return m_shapePrototypes;
+}
+
+bool Game::SaveScene(const char* file_path) const
+{
+	ByteBufferWriter writer;
+	WriteScene(writer);
+	return writer.SaveToFile(file_path);
+}
+
+
+void Game::WriteScene(ByteBufferWriter& writer) const
+{
+	SceneSnapshot::Write(writer, m_shapeComponents, m_shapePrototypes, m_invisibleRays.data(), m_currentNumRays);
+}
+
+
+// the file's arrays are copied straight into the component arrays, shapes only come out of the pool
+// to own the slots, nothing in the file is parsed per shape
+bool Game::LoadScene(const char* file_path)
+{
+	PROFILE_SCOPE("Game::LoadScene");
+
+	std::vector<uchar> buffer;
+	return SceneSnapshot::LoadFile(file_path, buffer) && LoadSceneFromMemory(buffer.data(), buffer.size());
+}
+
+
+bool Game::LoadSceneFromMemory(const uchar* data, const size_t size)
+{
+	SceneSnapshot snapshot;
+	if(!snapshot.Read(data, size))
+	{
+		return false;
+	}
+
+	if(snapshot.m_numShapes < MIN_SHAPES || snapshot.m_numShapes > MAX_SHAPES
+		|| snapshot.m_numRays < MIN_RAYS || snapshot.m_numRays > MAX_RAYS)
+	{
+		return false;
+	}
+
+	m_selectedShapes.clear();
+	m_shapeContacts.clear();
+	while(!m_convexShapes.empty())
+	{
+		RemoveLastShape();
+	}
+
+	m_numShapePrototypes = snapshot.m_numPrototypes;
+	m_shapePrototypes.SetFromPolygons(snapshot.m_pointsX.m_data, snapshot.m_pointsY.m_data, snapshot.m_pointStarts.m_data, snapshot.m_numPrototypes);
+
+	m_currentNumConvexShapes = snapshot.m_numShapes;
+	for(int shape_idx = 0; shape_idx < snapshot.m_numShapes; ++shape_idx)
+	{
+		AddShape(Vec2(snapshot.m_positionsX[shape_idx], snapshot.m_positionsY[shape_idx]),
+			snapshot.m_orientations[shape_idx], snapshot.m_scales[shape_idx], snapshot.m_prototypeIds[shape_idx]);
+	}
+
+	m_invisibleRays.clear();
+	for(int ray_idx = 0; ray_idx < snapshot.m_numRays; ++ray_idx)
+	{
+		m_invisibleRays.emplace_back(
+			Vec2(snapshot.m_rayPositionsX[ray_idx], snapshot.m_rayPositionsY[ray_idx]),
+			Vec2(snapshot.m_rayDirectionsX[ray_idx], snapshot.m_rayDirectionsY[ray_idx]));
+	}
+	m_currentNumRays = snapshot.m_numRays;
+
+	m_bspSet = false;
+	m_sceneUpdated = true;
+	m_sweepAndPruneStale = true;
+	m_frameStats.AddMarker("scene load");
+	return true;
+}
+
+
+// the scene and toggles are snapshotted before seeding, and loading them back draws no random numbers, so the seed alone sets what follows
+void Game::StartInputRecording()
+{
+	ByteBufferWriter writer;
+	WriteScene(writer);
+
+	std::vector<uchar> scene;
+	writer.TakeBuffer(scene);
+
+	const uint seed = static_cast<uint>(ProfilerGetTicks());
+	m_inputRecording.Begin(seed, scene, m_movableRay.GetStart(), m_movableRay.GetEnd(), GetInputToggles());
+	g_randomNumberGenerator = RandomNumberGenerator(seed);
+
+	m_isReplayingInput = false;
+	m_isRecordingInput = true;
+}
+
+
+bool Game::StopInputRecording(const char* file_path)
+{
+	if(!m_isRecordingInput)
+	{
+		return false;
+	}
+
+	m_isRecordingInput = false;
+	return m_inputRecording.SaveToFile(file_path);
+}
+
+
+bool Game::StartInputReplay(const char* file_path)
+{
+	m_isRecordingInput = false;
+	m_isReplayingInput = false;
+
+	if(!m_inputRecording.LoadFromFile(file_path) || m_inputRecording.GetNumFrames() == 0)
+	{
+		return false;
+	}
+
+	const std::vector<uchar>& scene = m_inputRecording.GetScene();
+	if(!LoadSceneFromMemory(scene.data(), scene.size()))
+	{
+		return false;
+	}
+
+	// a random heuristic rebuild draws numbers, so it happens before seeding
+	ApplyInputToggles(m_inputRecording.GetToggles());
+	g_randomNumberGenerator = RandomNumberGenerator(m_inputRecording.GetSeed());
+	m_movableRay.SetStart(m_inputRecording.GetRayStart());
+	m_movableRay.SetEnd(m_inputRecording.GetRayEnd());
+
+	m_isReplayingInput = true;
+	m_replayFrame = 0;
+	m_numReplayMismatches = 0;
+	m_replayUpdateMs = 0.0;
+	m_recordedUpdateMs = 0.0;
+	return true;
+}
+
+
+InputToggleState Game::GetInputToggles() const
+{
+	InputToggleState toggles;
+	toggles.m_regionSelectMode = m_regionSelectMode;
+	toggles.m_regionSelectSize = m_regionSelectSize;
+	toggles.m_bspHeuristic = m_bspTree.GetHeuristic();
+	toggles.m_bspBuilt = m_bspSet;
+	toggles.m_useLinearBvh = m_useLinearBvh;
+	toggles.m_occlusionCulling = m_occlusionCulling;
+	toggles.m_showVisibility = m_showVisibility;
+	toggles.m_checkCompressedBsp = m_checkCompressedBsp;
+	toggles.m_mirrorSnapshots = m_mirrorSnapshots;
+	toggles.m_findOverlaps = m_findOverlaps;
+	toggles.m_useSweepAndPrune = m_useSweepAndPrune;
+	return toggles;
+}
+
+
+// resets the same state the matching keys do when toggled
+void Game::ApplyInputToggles(const InputToggleState& toggles)
+{
+	m_regionSelectMode = static_cast<RegionSelectMode>(ClampInt(toggles.m_regionSelectMode, 0, NUM_REGION_SELECT_MODES - 1));
+	m_regionSelectSize = toggles.m_regionSelectSize;
+	m_useLinearBvh = toggles.m_useLinearBvh;
+	m_occlusionCulling = toggles.m_occlusionCulling;
+	m_showVisibility = toggles.m_showVisibility;
+	m_checkCompressedBsp = toggles.m_checkCompressedBsp;
+	m_numCompressedMismatches = 0;
+	m_mirrorSnapshots = toggles.m_mirrorSnapshots;
+	m_snapshotLoopback.Reset();
+	m_findOverlaps = toggles.m_findOverlaps;
+	m_shapeContacts.clear();
+	m_useSweepAndPrune = toggles.m_useSweepAndPrune;
+	m_sweepAndPruneStale = true;
+
+	if(toggles.m_bspBuilt)
+	{
+		BuildBsp(static_cast<BspHeuristic>(ClampInt(toggles.m_bspHeuristic, HEURISTIC_RANDOM, HEURISTIC_SCORE)));
+	}
+}
+
+
+bool Game::IsRecordingInput() const
+{
+	return m_isRecordingInput;
+}
+
+
+// the recorded keys go in before the update they arrived ahead of, the recorded delta replaces the
+// clock's so the frame runs as fast as it can instead of waiting out real time
+double Game::BeginReplayFrame()
+{
+	const InputFrame& frame = m_inputRecording.GetFrame(m_replayFrame);
+	for(int key_idx = frame.m_firstKey; key_idx < frame.m_firstKey + frame.m_numKeys; ++key_idx)
+	{
+		const InputKeyEvent& key = m_inputRecording.GetKey(key_idx);
+		if(key.m_pressed)
+		{
+			ApplyKeyPressed(key.m_keyCode);
+		}
+		else
+		{
+			ApplyKeyReleased(key.m_keyCode);
+		}
+	}
+
+	return frame.m_deltaSeconds;
+}
+
+
+void Game::EndInputFrame(const double delta_seconds, const uint64_t update_ticks)
+{
+	const float update_ms = static_cast<float>(ProfilerTicksToMicroseconds(update_ticks) * 0.001);
+
+	if(m_isRecordingInput)
+	{
+		m_inputRecording.RecordFrame(delta_seconds, m_mousePos, m_numHits, update_ms);
+		ImGui::Text("Recording input: %i frames", m_inputRecording.GetNumFrames());
+		return;
+	}
+
+	if(!m_isReplayingInput)
+	{
+		return;
+	}
+
+	const InputFrame& frame = m_inputRecording.GetFrame(m_replayFrame);
+	if(frame.m_numHits != m_numHits)
+	{
+		++m_numReplayMismatches;
+	}
+	m_replayUpdateMs += update_ms;
+	m_recordedUpdateMs += frame.m_updateMs;
+	++m_replayFrame;
+
+	ImGui::Text("Replaying input: frame %i / %i, %i hit mismatches, update %.2fms vs %.2fms recorded",
+		m_replayFrame,
+		m_inputRecording.GetNumFrames(),
+		m_numReplayMismatches,
+		m_replayUpdateMs,
+		m_recordedUpdateMs);
+
+	if(m_replayFrame == m_inputRecording.GetNumFrames())
+	{
+		m_isReplayingInput = false;
+		DebuggerPrintf("Input replay: %i frames, %i hit mismatches, update %.2fms vs %.2fms recorded\n",
+			m_replayFrame, m_numReplayMismatches, m_replayUpdateMs, m_recordedUpdateMs);
+	}
+}
+
+
+// a scenario depends on its seed alone. Growing from the current shapes would draw a number of rolls
+// that depends on how many there were, so the scene is emptied before seeding and rebuilt from nothing
+void Game::SetupScenario(const int num_shapes, const int num_rays, const uint seed, const int num_threads, const bool use_linear_bvh)
+{
+	m_selectedShapes.clear();
+	m_shapeContacts.clear();
+	while(!m_convexShapes.empty())
+	{
+		RemoveLastShape();
+	}
+
+	g_randomNumberGenerator = RandomNumberGenerator(seed);
+	m_shapePrototypes.Generate(m_numShapePrototypes);
+
+	// every shape is rolled as it comes out of the pool, rerolling them again would only draw more numbers
+	m_currentNumConvexShapes = ClampInt(num_shapes, MIN_SHAPES, MAX_SHAPES);
+	UpdateNumberOfShapes();
+	m_sweepAndPruneStale = true;
+
+	m_currentNumRays = ClampInt(num_rays, MIN_RAYS, MAX_RAYS);
+	m_invisibleRays.clear();
+	UpdateNumberOfRays();
+
+	m_numWorkerThreads = num_threads;
+	m_useLinearBvh = use_linear_bvh;
+	m_bspSet = false;
+	m_sceneUpdated = false;
+}
+
+
+void Game::BuildBsp(const BspHeuristic heuristic)
+{
+	m_bspTree.BuildBspTree(heuristic, m_convexShapes);
+	m_compressedBsp.Build(m_bspTree);
+	m_sceneUpdated = false;
+	m_bspSet = true;
+}
+
+
+int Game::GetNumHits() const
+{
+	return m_numHits;
+}
+
+
+int Game::GetNumRays() const
+{
+	return m_currentNumRays;
+}
+
+
+int Game::GetNumBspNodes() const
+{
+	return m_bspSet ? m_bspTree.GetNumNodes() : 0;
+}
+
+
+ShapeComponents& Game::GetShapeComponents()
+{
+	return m_shapeComponents;
+}
+
+const ShapeComponents& Game::GetShapeComponents() const
+{
+	return m_shapeComponents;
+}
+
 bool Game::InDeveloperMode() const
 {
 	return m_inDevMode;
@@ -417,18 +877,18 @@ void Game::InitGameObjs()
 	m_woodMaterial = g_theRenderer->CreateOrGetMaterial("wood.mat");
 	m_woodMaterial->m_shader->SetDepth(COMPARE_LESS_EQUAL, true);
 	m_defaultShader = g_theRenderer->CreateOrGetShader("default_lit.hlsl");
+	m_shapeMaterial = g_theRenderer->CreateOrGetMaterial("white.mat");
 
 	//Get the mesh for all the game objs
 	CPUMesh quad_mesh;
 	CpuMeshAddQuad(&quad_mesh, AABB2(-10.0f, -10.0f, 10.0f, 10.0f));
-	m_quad = new GPUMesh(g_theRenderer);
+	m_quad = TaggedNew<GPUMesh>(MEM_TAG_MESHES, g_theRenderer);
 	m_quad->CreateFromCPUMesh<Vertex_Lit>(quad_mesh); // we won't be updated this;
 }
 
 void Game::UpdateNumberOfShapes()
 {
 	const int num_shapes_in_vec = static_cast<int>(m_convexShapes.size());
-	const int current_index = num_shapes_in_vec - 1;
 
 	if(num_shapes_in_vec == m_currentNumConvexShapes)
 	{
@@ -441,127 +901,496 @@ void Game::UpdateNumberOfShapes()
 		
 		for(int shape_adding = 0; shape_adding < difference; ++shape_adding)
 		{
-			m_convexShapes.emplace_back(new ConvexShape2D(this));
+			AddShape();
 		}
 	}
 	else // we need to "remove" some
 	{
 		const int difference = num_shapes_in_vec - m_currentNumConvexShapes;
+		m_selectedShapes.clear();
 
 		for (int shape_removing = 0; shape_removing < difference; ++shape_removing)
 		{
-			ConvexShape2D* current_shape = m_convexShapes[current_index - shape_removing];
-			delete current_shape;
-			current_shape = nullptr;
-			m_convexShapes.pop_back();
+			RemoveLastShape();
 		}
 	}
 
 }
 
 
-void Game::UpdateNumberOfRays()
+// the component slot has to exist before the pool rolls the shape into it
+void Game::AddShape()
 {
-	const int num_rays_in_vec = static_cast<int>(m_invisibleRays.size());
-	const int current_index = num_rays_in_vec - 1;
+	const int component_idx = m_shapeComponents.Add(nullptr);
+	TrackShape(component_idx, m_shapePool.Acquire(component_idx));
+}
 
-	if (num_rays_in_vec == m_currentNumRays)
+
+// loaded shapes go straight in with their transform, no random numbers are drawn
+void Game::AddShape(const Vec2& position, const float orientation_degrees, const float scale, const int prototype_id)
+{
+	const int component_idx = m_shapeComponents.Add(nullptr);
+	m_shapeComponents.m_prototypeIds[component_idx] = prototype_id;
+	m_shapeComponents.SetTransform(component_idx, position, orientation_degrees, scale);
+	TrackShape(component_idx, m_shapePool.Acquire(component_idx, false));
+}
+
+
+void Game::TrackShape(const int component_idx, ConvexShape2D* shape)
+{
+	m_shapeComponents.m_owners[component_idx] = shape;
+	m_convexShapes.push_back(shape);
+
+	const Vec2 extents(m_shapeComponents.m_scales[component_idx], m_shapeComponents.m_scales[component_idx]);
+	const Vec2& position = m_shapeComponents.m_positions[component_idx];
+	m_shapeProxies.push_back(m_shapeTree.CreateProxy(AABB2(position - extents, position + extents), component_idx));
+}
+
+
+// shapes only ever leave from the back, so every other shape keeps its component slot
+void Game::RemoveLastShape()
+{
+	// stays queued, the flush skips entities that are no longer dirty
+	ConvexShape2D* current_shape = m_convexShapes.back();
+	current_shape->ClearDirty();
+
+	m_shapePool.Release(current_shape);
+	m_convexShapes.pop_back();
+
+	const int component_idx = m_shapeComponents.GetCount() - 1;
+	m_shapeTree.DestroyProxy(m_shapeProxies.back());
+	m_shapeProxies.pop_back();
+	m_collidingShapeIdx.erase(std::remove(m_collidingShapeIdx.begin(), m_collidingShapeIdx.end(), component_idx), m_collidingShapeIdx.end());
+	m_shapeComponents.RemoveLast();
+}
+
+
+// runs first in the frame so nothing is holding on to a shape index when the arrays move
+void Game::UpdateLinearBvh()
+{
+	if(!m_useLinearBvh)
 	{
 		return;
 	}
 
-	if (num_rays_in_vec < m_currentNumRays) // we need to add more
+	m_linearBvh.Build(m_shapeComponents, m_numWorkerThreads);
+
+	const std::vector<int>& new_to_old = m_linearBvh.GetSortedShapes();
+	const int num_shapes = static_cast<int>(new_to_old.size());
+	int num_moved = 0;
+	for(int shape_idx = 0; shape_idx < num_shapes; ++shape_idx)
 	{
-		const int difference = m_currentNumRays - num_rays_in_vec;
+		num_moved += new_to_old[shape_idx] != shape_idx ? 1 : 0;
+	}
 
-		for (int shape_adding = 0; shape_adding < difference; ++shape_adding)
-		{
-			float x = g_randomNumberGenerator.GetRandomFloatInRange(0.0, WORLD_HEIGHT * WORLD_ASPECT);
-			float y = g_randomNumberGenerator.GetRandomFloatInRange(0.0, WORLD_HEIGHT);
+	if(num_moved > 0)
+	{
+		ReorderShapes(new_to_old);
+		m_linearBvh.MarkShapesSorted();
+	}
 
-			Vec2 dir = g_randomNumberGenerator.GetRandomVec2InsideUnitCircle();
+	ImGui::Text("Linear BVH: %i leaves in %.3fms, %i shapes moved", m_linearBvh.GetNumLeaves(), m_linearBvh.GetLastBuildMs(), num_moved);
+}
 
 
-			m_invisibleRays.push_back(Ray2(Vec2(x, y), dir));
-		}
+// every structure keyed by component slot follows the shapes to their new slots
+void Game::ReorderShapes(const std::vector<int>& new_to_old)
+{
+	PROFILE_SCOPE("Game::ReorderShapes");
+
+	const int num_shapes = static_cast<int>(new_to_old.size());
+	m_shapeComponents.Permute(new_to_old);
+
+	std::vector<int> old_to_new(num_shapes);
+	std::vector<ConvexShape2D*> reordered_shapes;
+	std::vector<int> reordered_proxies;
+	reordered_shapes.reserve(MAX_SHAPES);
+	reordered_proxies.reserve(MAX_SHAPES);
+	for(int new_idx = 0; new_idx < num_shapes; ++new_idx)
+	{
+		const int old_idx = new_to_old[new_idx];
+		old_to_new[old_idx] = new_idx;
+
+		reordered_shapes.push_back(m_convexShapes[old_idx]);
+		reordered_shapes.back()->SetComponentIndex(new_idx);
+
+		reordered_proxies.push_back(m_shapeProxies[old_idx]);
+		m_shapeTree.SetProxyShape(reordered_proxies.back(), new_idx);
 	}
-	else // we need to "remove" some
+
+	m_convexShapes.swap(reordered_shapes);
+	m_shapeProxies.swap(reordered_proxies);
+
+	for(int& colliding_idx : m_collidingShapeIdx)
 	{
-		const int difference = num_rays_in_vec - m_currentNumRays;
+		colliding_idx = old_to_new[colliding_idx];
+	}
+	std::sort(m_collidingShapeIdx.begin(), m_collidingShapeIdx.end());
 
-		for (int shape_removing = 0; shape_removing < difference; ++shape_removing)
+	m_sweepAndPruneStale = true;
+}
+
+
+// a shape that only turned or scaled a little is still inside its fat box, and costs one containment test
+void Game::UpdateShapeTree()
+{
+	PROFILE_SCOPE("DynamicAabbTree::Update");
+
+	m_numTreeReinserts = 0;
+	const int num_shapes = m_shapeComponents.GetCount();
+	for(int shape_idx = 0; shape_idx < num_shapes; ++shape_idx)
+	{
+		const Vec2 extents(m_shapeComponents.m_scales[shape_idx], m_shapeComponents.m_scales[shape_idx]);
+		const Vec2& position = m_shapeComponents.m_positions[shape_idx];
+		if(m_shapeTree.MoveProxy(m_shapeProxies[shape_idx], AABB2(position - extents, position + extents)))
 		{
-			m_invisibleRays.pop_back();
+			++m_numTreeReinserts;
 		}
 	}
+
+	ImGui::Text("Shape tree: height %i, %i reinserted", m_shapeTree.GetHeight(), m_numTreeReinserts);
 }
 
-void Game::MouseCollisionTest(std::vector<ConvexShape2D*>& out)
+
+// every live shape gets a new roll in place, nothing is freed or allocated
+void Game::RerollShapes()
 {
-	out.clear();
-	
-	//TODO: from naive attempt to Space partitioning
-	for(int shape_idx = 0; shape_idx < static_cast<int>(m_convexShapes.size()); ++shape_idx)
+	const int num_shapes = static_cast<int>(m_convexShapes.size());
+	for (int shape_idx = 0; shape_idx < num_shapes; ++shape_idx)
+	{
+		m_convexShapes[shape_idx]->Reroll();
+	}
+
+	m_selectedShapes.clear();
+	m_sweepAndPruneStale = true;
+}
+
+
+// shapes that only turned or grew a little cost a handful of swaps here
+void Game::UpdateSweepAndPrune()
+{
+	if(!m_useSweepAndPrune)
+	{
+		return;
+	}
+
+	if(m_sweepAndPruneStale)
+	{
+		m_sweepAndPrune.Rebuild(m_shapeComponents);
+		m_sweepAndPruneStale = false;
+	}
+	else
+	{
+		m_sweepAndPrune.Update(m_shapeComponents);
+	}
+
+	int num_added = 0;
+	for(const ShapePairEvent& pair_event : m_sweepAndPrune.GetEvents())
+	{
+		num_added += pair_event.m_added ? 1 : 0;
+	}
+
+	ImGui::Text("Sweep and prune: %i box pairs, +%i -%i this frame, %i swaps",
+		m_sweepAndPrune.GetNumPairs(),
+		num_added,
+		static_cast<int>(m_sweepAndPrune.GetEvents().size()) - num_added,
+		m_sweepAndPrune.GetNumSwaps());
+}
+
+
+void Game::UpdateShapeOverlaps()
+{
+	if(!m_findOverlaps)
 	{
-		if(m_convexShapes[shape_idx]->CollisionFromPoint(m_mousePos))
+		return;
+	}
+
+	const uint64_t start_ticks = ProfilerGetTicks();
+	if(m_useSweepAndPrune)
+	{
+		m_overlapQuery.FindAllOverlaps(m_sweepAndPrune, m_shapeComponents, m_shapePrototypes, m_shapeContacts);
+	}
+	else
+	{
+		m_overlapQuery.FindAllOverlaps(m_shapeGrid, m_shapeComponents, m_shapePrototypes, m_shapeContacts);
+	}
+	const double elapsed_ms = ProfilerTicksToMicroseconds(ProfilerGetTicks() - start_ticks) * 0.001;
+
+	ImGui::Text("Overlapping pairs: %i (%i tested, %i cached axes) %.3fms",
+		static_cast<int>(m_shapeContacts.size()),
+		m_overlapQuery.GetNumPairsTested(),
+		m_overlapQuery.GetNumCacheHits(),
+		elapsed_ms);
+}
+
+
+// every emitter goes through one trace so the bounces are spread over the worker threads together
+void Game::TraceReflections()
+{
+	m_reflectionEmitters.clear();
+
+	Ray2 movable_emitter;
+	const bool ray_reflects = m_movableRay.GetReflectionEmitter(movable_emitter);
+	if(ray_reflects)
+	{
+		m_reflectionEmitters.push_back(movable_emitter);
+	}
+
+	if(m_reflectInvisibleRays)
+	{
+		const int num_rays = std::min(m_currentNumRays, static_cast<int>(m_invisibleRays.size()));
+		m_reflectionEmitters.insert(m_reflectionEmitters.end(), m_invisibleRays.begin(), m_invisibleRays.begin() + num_rays);
+	}
+
+	m_reflectionTracer.Trace(m_shapeGrid, m_shapeComponents, m_shapePrototypes,
+		m_reflectionEmitters.data(), static_cast<int>(m_reflectionEmitters.size()),
+		m_reflectionBounces, m_reflectionLength, m_reflectionPaths, m_numWorkerThreads);
+
+	m_movableRay.SetReflectionPath(ray_reflects ? &m_reflectionPaths : nullptr, 0, m_shapeComponents.GetVersion());
+
+	ImGui::Text("Reflection paths: %i (%i points) %.3fms",
+		m_reflectionPaths.GetNumPaths(),
+		static_cast<int>(m_reflectionPaths.m_points.size()),
+		m_reflectionTracer.GetLastTraceMs());
+}
+
+
+// runs before the shapes update so hidden ones skip their hover meshes as well as rendering
+void Game::UpdateOcclusionCulling()
+{
+	if(!m_occlusionCulling || !m_bspSet)
+	{
+		if(m_shapesCulled)
 		{
-			out.push_back(m_convexShapes[shape_idx]);
+			m_occlusionBuffer.ClearCulling(m_shapeComponents);
+			m_shapesCulled = false;
+			m_numCulledShapes = 0;
 		}
+		return;
 	}
-	
-	
+
+	m_occlusionBuffer.Build(m_bspTree, m_movableRay.GetStart());
+	m_numCulledShapes = m_occlusionBuffer.CullShapes(m_shapeComponents);
+	m_shapesCulled = true;
+
+	ImGui::Text("Occlusion culled: %i / %i shapes", m_numCulledShapes, m_currentNumConvexShapes);
 }
 
-bool Game::RayToConvexShape(const Ray2& ray, const ConvexShape2D& shape)
+
+// outline of the region visible from the mouse, rebuilt every frame since the mouse moves
+void Game::UpdateVisibilityPolygon()
 {
-	std::vector<Plane2> planes = shape.GetLocalConvexPlanes();
-	float t_vals[2];
+	if(!m_showVisibility || !m_bspSet)
+	{
+		return;
+	}
 
-	// check if inside
-	if (shape.IsPointInsideShape(ray.m_pos))
+	m_visibilityQuery.Compute(m_bspTree, m_mousePos, WORLD_BOUNDS, m_visibilityPolygon);
+	ImGui::Text("Visibility: %i points, %i segments tested", static_cast<int>(m_visibilityPolygon.size()), m_visibilityQuery.GetNumSegmentsTested());
+
+	const int num_points = static_cast<int>(m_visibilityPolygon.size());
+	if(num_points < 2)
 	{
-		return true;
+		return;
 	}
 
-	// mid check
-	bool mid_test = false;
-	const uint num_hits = Raycast(t_vals, ray, shape.GetPosition(), shape.GetScale());
-	mid_test = num_hits > 0;
-	
+	CPUMesh outline_mesh;
+	for(int point_idx = 0; point_idx < num_points; ++point_idx)
+	{
+		CpuMeshAddLine(&outline_mesh, m_visibilityPolygon[point_idx], m_visibilityPolygon[(point_idx + 1) % num_points], 0.15f, Rgba::YELLOW);
+	}
+
+	if(m_visibilityMesh == nullptr)
+	{
+		m_visibilityMesh = TaggedNew<GPUMesh>(MEM_TAG_MESHES, g_theRenderer);
+	}
+	m_visibilityMesh->CreateFromCPUMesh<Vertex_PCU>(outline_mesh);
+}
 
-	if (mid_test)
+
+// both trees should agree exactly, the compressed one keeps no reference to the float tree
+void Game::UpdateCompressedBsp()
+{
+	if(!m_checkCompressedBsp || !m_bspSet)
 	{
-		float smallest_t_val = INFINITY;
-		int plane_intersection_idx = -1;
+		return;
+	}
 
-		//check all planes if they intersect.
-		for (int plane_idx = 0; plane_idx < static_cast<int>(planes.size()); ++plane_idx)
-		{
-			float t_vals[2];
+	const Vec2 ray_start = m_movableRay.GetStart();
+	Vec2 float_end = ray_start;
+	Vec2 compressed_end = ray_start;
+	const bool float_sees = m_bspTree.CanSee(m_mousePos, ray_start, float_end);
+	const bool compressed_sees = m_compressedBsp.CanSee(m_mousePos, ray_start, compressed_end);
 
-			//world ray cast, to local ray cast
-			Vec2 local_pos = PointToLocalSpace(ray.m_pos, planes[plane_idx].m_normal, planes[plane_idx].GetDirection(), planes[plane_idx].PointOnPlane());
-			Vec2 local_dir = VectorToLocalSpace(ray.m_pos, planes[plane_idx].m_normal, planes[plane_idx].GetDirection());
+	if(float_sees != compressed_sees || (!float_sees && (float_end.x != compressed_end.x || float_end.y != compressed_end.y)))
+	{
+		++m_numCompressedMismatches;
+	}
 
-			Ray2 local_ray_cast(local_pos, local_dir);
+	ImGui::Text("Compressed BSP: %i nodes, %i hot + %i cold bytes (%i whole planes) vs %i float",
+		m_compressedBsp.GetNumNodes(),
+		static_cast<int>(m_compressedBsp.GetHotBytes()),
+		static_cast<int>(m_compressedBsp.GetColdBytes()),
+		m_compressedBsp.GetNumExactPlanes(),
+		m_bspTree.GetNumNodes() * static_cast<int>(sizeof(BSPNode)));
+	ImGui::Text("  mouse sees ray start: %s, %i / %i exact classifies, %i mismatches",
+		compressed_sees ? "yes" : "no",
+		m_compressedBsp.GetNumExactClassifies(),
+		m_compressedBsp.GetNumClassifies(),
+		m_numCompressedMismatches);
+}
 
-			uint num_hits = Raycast(t_vals, local_ray_cast, planes[plane_idx]);
 
-			if (num_hits > 0)
+void Game::UpdateSnapshotMirror()
+{
+	if(!m_mirrorSnapshots)
+	{
+		return;
+	}
+
+	m_snapshotLoopback.Tick(m_shapeComponents);
+
+	const int num_ticks = m_snapshotLoopback.GetNumTicks();
+	ImGui::Text("Snapshot mirror: %i bytes this tick, %.0f average, %.3fms encode %.3fms decode average, %i mismatches",
+		m_snapshotLoopback.GetLastPacketBytes(),
+		static_cast<double>(m_snapshotLoopback.GetTotalBytes()) / static_cast<double>(num_ticks),
+		m_snapshotLoopback.GetEncodeMs() / static_cast<double>(num_ticks),
+		m_snapshotLoopback.GetDecodeMs() / static_cast<double>(num_ticks),
+		m_snapshotLoopback.GetNumMismatches());
+}
+
+
+// runs after the mouse test, so the region replaces whatever was under the mouse
+void Game::UpdateRegionSelection()
+{
+	if(m_regionSelectMode == REGION_SELECT_OFF)
+	{
+		return;
+	}
+
+	const int num_shapes = m_shapeComponents.GetCount();
+	if(static_cast<int>(m_regionShapes.size()) < num_shapes)
+	{
+		m_regionShapes.resize(num_shapes);
+	}
+
+	const uint64_t start_ticks = ProfilerGetTicks();
+	int num_found = 0;
+	const char* region_name = "";
+	switch(m_regionSelectMode)
+	{
+		case REGION_SELECT_BOX:
+		{
+			const Vec2 extents(m_regionSelectSize, m_regionSelectSize);
+			num_found = m_regionQuery.QueryAabb(m_shapeTree, m_shapeComponents, m_shapePrototypes,
+				AABB2(m_mousePos - extents, m_mousePos + extents), m_regionShapes.data(), num_shapes);
+			region_name = "box";
+			break;
+		}
+		case REGION_SELECT_DISC:
+		{
+			num_found = m_regionQuery.QueryDisc(m_shapeTree, m_shapeComponents, m_shapePrototypes,
+				m_mousePos, m_regionSelectSize, m_regionShapes.data(), num_shapes);
+			region_name = "disc";
+			break;
+		}
+		case REGION_SELECT_POLYGON:
+		{
+			Vec2 hexagon[6];
+			for(int corner_idx = 0; corner_idx < 6; ++corner_idx)
 			{
-				if (t_vals[0] < smallest_t_val)
-				{
-					smallest_t_val = t_vals[0];
-					plane_intersection_idx = plane_idx;
-				}
+				const float degrees = 60.0f * static_cast<float>(corner_idx);
+				hexagon[corner_idx] = m_mousePos + Vec2(CosDegrees(degrees), SinDegrees(degrees)) * m_regionSelectSize;
 			}
+			num_found = m_regionQuery.QueryPolygon(m_shapeTree, m_shapeComponents, m_shapePrototypes,
+				hexagon, 6, m_regionShapes.data(), num_shapes);
+			region_name = "hexagon";
+			break;
+		}
+		default:
+		{
+			break;
+		}
+	}
+	const double query_us = ProfilerTicksToMicroseconds(ProfilerGetTicks() - start_ticks);
+
+	m_selectedShapes.clear();
+	for(int found_idx = 0; found_idx < num_found; ++found_idx)
+	{
+		m_selectedShapes.push_back(m_convexShapes[m_regionShapes[found_idx]]);
+	}
+
+	ImGui::Text("Region select (%s, size %.1f): %i shapes, %i candidates, %i exact tests, %.1fus",
+		region_name, m_regionSelectSize, num_found, m_regionQuery.GetNumCandidates(), m_regionQuery.GetNumExactTests(), query_us);
+}
+
+
+// per frame work next to the hit count, so a faster structure shows up as less work and not only less time
+void Game::UpdateQueryCounters()
+{
+	ImGui::Text("Rays hitting shapes: %i / %i", m_numHits, m_currentNumRays);
+
+#if defined(QUERY_COUNTERS_ENABLED)
+	QueryCountersGatherFrame(m_queryCounters);
+	for(int counter_idx = 0; counter_idx < NUM_QUERY_COUNTERS; ++counter_idx)
+	{
+		ImGui::Text("  %s: %llu", GetQueryCounterName(static_cast<QueryCounter>(counter_idx)), static_cast<unsigned long long>(m_queryCounters.m_counts[counter_idx]));
+	}
+#endif
+}
+
+
+void Game::UpdateNumberOfRays()
+{
+	const int num_rays_in_vec = static_cast<int>(m_invisibleRays.size());
+	const int current_index = num_rays_in_vec - 1;
+
+	if (num_rays_in_vec == m_currentNumRays)
+	{
+		return;
+	}
+
+	if (num_rays_in_vec < m_currentNumRays) // we need to add more
+	{
+		const int difference = m_currentNumRays - num_rays_in_vec;
+
+		for (int shape_adding = 0; shape_adding < difference; ++shape_adding)
+		{
+			float x = g_randomNumberGenerator.GetRandomFloatInRange(0.0, WORLD_HEIGHT * WORLD_ASPECT);
+			float y = g_randomNumberGenerator.GetRandomFloatInRange(0.0, WORLD_HEIGHT);
+
+			Vec2 dir = g_randomNumberGenerator.GetRandomVec2InsideUnitCircle();
+
+
+			m_invisibleRays.push_back(Ray2(Vec2(x, y), dir));
 		}
+	}
+	else // we need to "remove" some
+	{
+		const int difference = num_rays_in_vec - m_currentNumRays;
 
-		if(smallest_t_val != INFINITY)
+		for (int shape_removing = 0; shape_removing < difference; ++shape_removing)
 		{
-			return true;
+			m_invisibleRays.pop_back();
 		}
 	}
+}
 
-	return false;
+void Game::MouseCollisionTest(std::vector<ConvexShape2D*>& out)
+{
+	out.clear();
+	
+	m_shapeTree.QueryPoint(m_mousePos, m_treeCandidates);
+	CollideShapeCandidatesWithPoint(m_shapeComponents, m_shapePrototypes, m_mousePos, m_treeCandidates, m_collidingShapeIdx, m_changedShapeIdx);
+
+	for(int colliding_idx = 0; colliding_idx < static_cast<int>(m_collidingShapeIdx.size()); ++colliding_idx)
+	{
+		out.push_back(m_convexShapes[m_collidingShapeIdx[colliding_idx]]);
+	}
+
+	// the hover points follow the mouse, so they need rebuilding every frame it is inside
+	for(int changed_idx = 0; changed_idx < static_cast<int>(m_changedShapeIdx.size()); ++changed_idx)
+	{
+		m_convexShapes[m_changedShapeIdx[changed_idx]]->MarkDirty();
+	}
 }
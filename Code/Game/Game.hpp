@@ -8,12 +8,40 @@
 #include "Game/Point.hpp"
 #include "Game/MovableRay.hpp"
 #include "Game/BSPTree.hpp"
+#include "Game/CompressedBsp.hpp"
+#include "Game/DynamicAabbTree.hpp"
+#include "Game/FrameStats.hpp"
+#include "Game/InputRecording.hpp"
+#include "Game/LinearBvh.hpp"
+#include "Game/MemoryTags.hpp"
+#include "Game/OcclusionBuffer.hpp"
+#include "Game/QueryCounters.hpp"
+#include "Game/ReflectionPaths.hpp"
+#include "Game/ShapeComponents.hpp"
+#include "Game/ShapeGrid.hpp"
+#include "Game/ShapeOverlap.hpp"
+#include "Game/ShapePool.hpp"
+#include "Game/ShapePrototypes.hpp"
+#include "Game/ShapeRegionQuery.hpp"
+#include "Game/ShapeSnapshotCodec.hpp"
+#include "Game/SweepAndPrune.hpp"
+#include "Game/VisibilityPolygon.hpp"
 
 class Camera;
 class Shader;
 class GPUMesh;
 class Material;
 class ConvexShape2D;
+class ByteBufferWriter;
+
+enum RegionSelectMode
+{
+	REGION_SELECT_OFF,
+	REGION_SELECT_BOX,
+	REGION_SELECT_DISC,
+	REGION_SELECT_POLYGON,
+	NUM_REGION_SELECT_MODES
+};
 
 class Game
 {
@@ -37,19 +65,62 @@ public:
 	bool HandleKeyPressed(unsigned char key_code);
 	bool HandleKeyReleased(unsigned char key_code);
 	void SetDeveloperMode(bool on_or_off);
+	void AddDirtyEntity(Entity* entity);
 
 	Vec2 GetMousePosition() const;
+	const ShapePrototypeLibrary& GetShapePrototypes() const;
+	ShapeComponents& GetShapeComponents();
+	const ShapeComponents& GetShapeComponents() const;
 	bool InDeveloperMode() const;
 
+	bool SaveScene(const char* file_path) const;
+	bool LoadScene(const char* file_path);
+
+	void StartInputRecording();
+	bool StopInputRecording(const char* file_path);
+	bool StartInputReplay(const char* file_path);
+	bool IsRecordingInput() const;
+
+	void SetupScenario(int num_shapes, int num_rays, uint seed, int num_threads, bool use_linear_bvh);
+	void BuildBsp(BspHeuristic heuristic);
+	int GetNumHits() const;
+	int GetNumRays() const;
+	int GetNumBspNodes() const;
+
 private:
 	void GarbageCollection() const;
+	bool ApplyKeyPressed(unsigned char key_code);
+	bool ApplyKeyReleased(unsigned char key_code);
+	void WriteScene(ByteBufferWriter& writer) const;
+	bool LoadSceneFromMemory(const uchar* data, size_t size);
+	InputToggleState GetInputToggles() const;
+	void ApplyInputToggles(const InputToggleState& toggles);
+	double BeginReplayFrame();
+	void EndInputFrame(double delta_seconds, uint64_t update_ticks);
 	void InitCamera();
 	void InitGameObjs();
 	void UpdateNumberOfShapes();
+	void AddShape();
+	void AddShape(const Vec2& position, float orientation_degrees, float scale, int prototype_id);
+	void TrackShape(int component_idx, ConvexShape2D* shape);
+	void RemoveLastShape();
 	void UpdateNumberOfRays();
+	void RerollShapes();
+	void UpdateDirtyEntities(double delta_seconds);
+	void UpdateVisibilityPolygon();
+	void UpdateCompressedBsp();
+	void UpdateSnapshotMirror();
+	void UpdateQueryCounters();
+	void UpdateOcclusionCulling();
+	void UpdateLinearBvh();
+	void ReorderShapes(const std::vector<int>& new_to_old);
+	void UpdateShapeTree();
+	void UpdateSweepAndPrune();
+	void UpdateShapeOverlaps();
+	void UpdateRegionSelection();
+	void TraceReflections();
 
 	void MouseCollisionTest(std::vector<ConvexShape2D*>& out);
-	bool RayToConvexShape(const Ray2& ray, const ConvexShape2D& shape);
 	
 private:
 
@@ -62,6 +133,7 @@ private:
 	Vec3 m_camEuler = Vec3(0.0f, 0.0f, 0.0f);
 
 	Material* m_woodMaterial = nullptr;
+	Material* m_shapeMaterial = nullptr;
 	Shader* m_defaultShader = nullptr;
 	GPUMesh* m_quad{};
 	Matrix44 m_quadTransform = Matrix44::IDENTITY; // quad's model matrix
@@ -70,10 +142,44 @@ private:
 	Point m_mouseEntity;
 	MovableRay m_movableRay;
 	
-	std::vector<ConvexShape2D*> m_convexShapes;
+	ShapePrototypeLibrary m_shapePrototypes;
+	ShapeComponents m_shapeComponents;
+	ShapePool m_shapePool;
+	std::vector<ConvexShape2D*> m_convexShapes;		// m_convexShapes[i] owns m_shapeComponents slot i
+	std::vector<int> m_collidingShapeIdx;
+	std::vector<int> m_changedShapeIdx;
+	ShapeGrid m_shapeGrid;
+	float m_shapeGridCellSize = 10.0f;
+	DynamicAabbTree m_shapeTree;
+	std::vector<int> m_shapeProxies;		// tree leaf of each component slot
+	std::vector<int> m_treeCandidates;
+	int m_numTreeReinserts = 0;
+	LinearBvh m_linearBvh;
+	bool m_useLinearBvh = false;			// rebuilt every frame, keeps the shapes in Morton order and casts the invisible rays
+	int m_numWorkerThreads = 0;				// for the linear BVH build and the reflection trace, 0 is one per hardware thread
+
+	ShapeOverlapQuery m_overlapQuery;
+	std::vector<ShapeContact> m_shapeContacts;
+	bool m_findOverlaps = false;
+	SweepAndPrune m_sweepAndPrune;
+	bool m_useSweepAndPrune = false;	// overlaps take their candidates from the persistent endpoint lists instead of the grid
+	bool m_sweepAndPruneStale = true;	// a reroll moves everything, a full sort beats the insertion sort then
 	std::vector<ConvexShape2D*> m_selectedShapes;
-	std::vector<Ray2> m_invisibleRays;
+	ShapeRegionQuery m_regionQuery;
+	RegionSelectMode m_regionSelectMode = REGION_SELECT_OFF;	// selects every shape in a region around the mouse instead of those under it
+	float m_regionSelectSize = 10.0f;
+	std::vector<int> m_regionShapes;
+	std::vector<Entity*> m_dirtyEntities;
+	TaggedVector<Ray2, MEM_TAG_RAYS> m_invisibleRays;
+
+	ReflectionTracer m_reflectionTracer;
+	ReflectionPathBuffer m_reflectionPaths;		// the movable ray's path first when it hit something, then one per invisible ray
+	TaggedVector<Ray2, MEM_TAG_RAYS> m_reflectionEmitters;
+	int m_reflectionBounces = 8;
+	float m_reflectionLength = 100.0f;
+	bool m_reflectInvisibleRays = true;
 	
+	int m_numShapePrototypes = 64;
 	int m_currentNumConvexShapes = 1;
 	const int MIN_SHAPES = 1;
 	const int MAX_SHAPES = 8'192;
@@ -83,9 +189,37 @@ private:
 	const int MAX_RAYS = 16'384;
 
 	int m_numHits = 0;
+	QueryCounterFrame m_queryCounters;		// work the queries did last frame, zero in release builds
 	
 	BSPTree m_bspTree;
 	bool	m_bspSet = false;
 	bool	m_sceneUpdated = false;
 
+	CompressedBspTree	m_compressedBsp;
+	bool				m_checkCompressedBsp = false;	// mouse to ray start line of sight through both trees
+	int					m_numCompressedMismatches = 0;
+
+	VisibilityPolygonQuery	m_visibilityQuery;
+	std::vector<Vec2>		m_visibilityPolygon;
+	GPUMesh*				m_visibilityMesh = nullptr;
+	bool					m_showVisibility = false;
+
+	OcclusionBuffer	m_occlusionBuffer;
+	bool			m_occlusionCulling = false;
+	bool			m_shapesCulled = false;
+	int				m_numCulledShapes = 0;
+
+	FrameStats m_frameStats;
+
+	ShapeSnapshotLoopback	m_snapshotLoopback;
+	bool					m_mirrorSnapshots = false;	// encode the shapes every frame as if for a remote viewer
+
+	InputRecording	m_inputRecording;
+	bool			m_isRecordingInput = false;
+	bool			m_isReplayingInput = false;
+	int				m_replayFrame = 0;
+	int				m_numReplayMismatches = 0;
+	double			m_replayUpdateMs = 0.0;		// this run's Game::Update time over the frames replayed so far
+	double			m_recordedUpdateMs = 0.0;	// the recording's time over the same frames
+
 };
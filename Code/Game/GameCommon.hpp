@@ -83,11 +83,4 @@ constexpr float WORLD_CENTER_Y = 0.0f;
 
 const Vec2 WORLD_BL_CORNER(-0.5f * WORLD_WIDTH, -0.5f * WORLD_HEIGHT);
 const Vec2 WORLD_TR_CORNER(0.5f * WORLD_WIDTH, 0.5f * WORLD_HEIGHT);
-const AABB2 WORLD_BOUNDS(WORLD_BL_CORNER, WORLD_TR_CORNER);
-
-constexpr int g_maxTickSample = 128;
-inline int g_tickIndex = 0;
-inline float g_tickSum = 0;
-inline float g_tickList[g_maxTickSample] = { 0 };
-
-float CalcAverageTick(float new_tick);
\ No newline at end of file
+const AABB2 WORLD_BOUNDS(WORLD_BL_CORNER, WORLD_TR_CORNER);
\ No newline at end of file
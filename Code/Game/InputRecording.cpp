@@ -0,0 +1,196 @@
+#include "Game/InputRecording.hpp"
+#include "Game/ByteBufferParser.hpp"
+#include "Game/ByteBufferWriter.hpp"
+#include "Game/SceneSnapshot.hpp"
+
+
+InputRecording::InputRecording() = default;
+InputRecording::~InputRecording() = default;
+
+
+// takes the scene bytes, leaving the caller an empty vector
+void InputRecording::Begin(const uint seed, std::vector<uchar>& scene, const Vec2& ray_start, const Vec2& ray_end, const InputToggleState& toggles)
+{
+	Clear();
+	m_seed = seed;
+	m_scene.swap(scene);
+	m_rayStart = ray_start;
+	m_rayEnd = ray_end;
+	m_toggles = toggles;
+}
+
+
+void InputRecording::RecordKey(const uchar key_code, const bool pressed)
+{
+	InputKeyEvent key;
+	key.m_keyCode = key_code;
+	key.m_pressed = pressed;
+	m_keys.push_back(key);
+	++m_numPendingKeys;
+}
+
+
+void InputRecording::RecordFrame(const double delta_seconds, const Vec2& mouse_pos, const int num_hits, const float update_ms)
+{
+	InputFrame frame;
+	frame.m_deltaSeconds = delta_seconds;
+	frame.m_mousePos = mouse_pos;
+	frame.m_firstKey = static_cast<int>(m_keys.size()) - m_numPendingKeys;
+	frame.m_numKeys = m_numPendingKeys;
+	frame.m_numHits = num_hits;
+	frame.m_updateMs = update_ms;
+	m_frames.push_back(frame);
+
+	m_numPendingKeys = 0;
+}
+
+
+void InputRecording::Clear()
+{
+	m_seed = 0;
+	m_toggles = InputToggleState();
+	m_scene.clear();
+	m_frames.clear();
+	m_keys.clear();
+	m_numPendingKeys = 0;
+}
+
+
+// header, scene bytes, then the frames and keys as flat records
+bool InputRecording::SaveToFile(const char* file_path) const
+{
+	const int num_frames = static_cast<int>(m_frames.size());
+	const int num_keys = static_cast<int>(m_keys.size()) - m_numPendingKeys;
+
+	ByteBufferWriter writer;
+	writer.Reserve(96 + m_scene.size() + num_frames * 28 + num_keys * 2);
+
+	writer.WriteUnsignedInt(INPUT_RECORDING_MAGIC);
+	writer.WriteUnsignedInt(INPUT_RECORDING_VERSION);
+	writer.WriteUnsignedInt(m_seed);
+	writer.WriteInt(num_frames);
+	writer.WriteInt(num_keys);
+	writer.WriteFloat(m_rayStart.x);
+	writer.WriteFloat(m_rayStart.y);
+	writer.WriteFloat(m_rayEnd.x);
+	writer.WriteFloat(m_rayEnd.y);
+	writer.WriteInt(m_toggles.m_regionSelectMode);
+	writer.WriteFloat(m_toggles.m_regionSelectSize);
+	writer.WriteInt(m_toggles.m_bspHeuristic);
+	writer.WriteBool(m_toggles.m_bspBuilt);
+	writer.WriteBool(m_toggles.m_useLinearBvh);
+	writer.WriteBool(m_toggles.m_occlusionCulling);
+	writer.WriteBool(m_toggles.m_showVisibility);
+	writer.WriteBool(m_toggles.m_checkCompressedBsp);
+	writer.WriteBool(m_toggles.m_mirrorSnapshots);
+	writer.WriteBool(m_toggles.m_findOverlaps);
+	writer.WriteBool(m_toggles.m_useSweepAndPrune);
+	writer.WriteUnsignedInt64(m_scene.size());
+	writer.WriteByteArray(m_scene.data(), m_scene.size());
+
+	for(int frame_idx = 0; frame_idx < num_frames; ++frame_idx)
+	{
+		const InputFrame& frame = m_frames[frame_idx];
+		writer.WriteDouble(frame.m_deltaSeconds);
+		writer.WriteFloat(frame.m_mousePos.x);
+		writer.WriteFloat(frame.m_mousePos.y);
+		writer.WriteInt(frame.m_numHits);
+		writer.WriteFloat(frame.m_updateMs);
+		writer.WriteInt(frame.m_numKeys);
+	}
+
+	// frames own consecutive runs of keys, so the closed ones are everything before the pending keys
+	for(int key_idx = 0; key_idx < num_keys; ++key_idx)
+	{
+		writer.WriteByte(m_keys[key_idx].m_keyCode);
+		writer.WriteBool(m_keys[key_idx].m_pressed);
+	}
+
+	return writer.SaveToFile(file_path);
+}
+
+
+bool InputRecording::LoadFromFile(const char* file_path)
+{
+	Clear();
+
+	std::vector<uchar> buffer;
+	if(!SceneSnapshot::LoadFile(file_path, buffer))
+	{
+		return false;
+	}
+
+	constexpr size_t header_size = 12 * sizeof(uint) + 8 * sizeof(bool) + sizeof(uint64_t);
+	ByteBufferParser parser(buffer);
+	if(!parser.HasBytes(header_size)
+		|| parser.ParseUnsignedInt() != INPUT_RECORDING_MAGIC
+		|| parser.ParseUnsignedInt() != INPUT_RECORDING_VERSION)
+	{
+		return false;
+	}
+
+	m_seed = parser.ParseUnsignedInt();
+	const int num_frames = parser.ParseInt();
+	const int num_keys = parser.ParseInt();
+	m_rayStart.x = parser.ParseFloat();
+	m_rayStart.y = parser.ParseFloat();
+	m_rayEnd.x = parser.ParseFloat();
+	m_rayEnd.y = parser.ParseFloat();
+	m_toggles.m_regionSelectMode = parser.ParseInt();
+	m_toggles.m_regionSelectSize = parser.ParseFloat();
+	m_toggles.m_bspHeuristic = parser.ParseInt();
+	m_toggles.m_bspBuilt = parser.ParseBool();
+	m_toggles.m_useLinearBvh = parser.ParseBool();
+	m_toggles.m_occlusionCulling = parser.ParseBool();
+	m_toggles.m_showVisibility = parser.ParseBool();
+	m_toggles.m_checkCompressedBsp = parser.ParseBool();
+	m_toggles.m_mirrorSnapshots = parser.ParseBool();
+	m_toggles.m_findOverlaps = parser.ParseBool();
+	m_toggles.m_useSweepAndPrune = parser.ParseBool();
+	const uint64_t scene_size = parser.ParseUnsignedInt64();
+
+	constexpr size_t frame_size = sizeof(double) + 5 * sizeof(float);
+	if(num_frames < 0 || num_keys < 0 || scene_size > parser.GetBytesLeft()
+		|| parser.GetBytesLeft() - scene_size != num_frames * frame_size + num_keys * 2)
+	{
+		return false;
+	}
+
+	const uchar* scene = parser.ParseByteArray(static_cast<size_t>(scene_size));
+	m_scene.assign(scene, scene + scene_size);
+
+	m_frames.resize(num_frames);
+	int num_frame_keys = 0;
+	for(int frame_idx = 0; frame_idx < num_frames; ++frame_idx)
+	{
+		InputFrame& frame = m_frames[frame_idx];
+		frame.m_deltaSeconds = parser.ParseDouble();
+		frame.m_mousePos.x = parser.ParseFloat();
+		frame.m_mousePos.y = parser.ParseFloat();
+		frame.m_numHits = parser.ParseInt();
+		frame.m_updateMs = parser.ParseFloat();
+		frame.m_numKeys = parser.ParseInt();
+		if(frame.m_numKeys < 0 || frame.m_numKeys > num_keys - num_frame_keys)
+		{
+			Clear();
+			return false;
+		}
+		frame.m_firstKey = num_frame_keys;
+		num_frame_keys += frame.m_numKeys;
+	}
+
+	if(num_frame_keys != num_keys)
+	{
+		Clear();
+		return false;
+	}
+
+	m_keys.resize(num_keys);
+	for(int key_idx = 0; key_idx < num_keys; ++key_idx)
+	{
+		m_keys[key_idx].m_keyCode = parser.ParseByte();
+		m_keys[key_idx].m_pressed = parser.ParseBool();
+	}
+
+	return true;
+}
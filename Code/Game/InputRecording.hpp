@@ -0,0 +1,82 @@
+#pragma once
+#include "Engine/Math/Vec2.hpp"
+
+#include "Game/GameCommon.hpp"
+
+#include <vector>
+
+constexpr uint INPUT_RECORDING_MAGIC = 0x52504E49;	// "INPR" read as little endian
+constexpr uint INPUT_RECORDING_VERSION = 2;
+
+struct InputKeyEvent
+{
+	uchar	m_keyCode = 0;
+	bool	m_pressed = false;
+};
+
+// Game toggles that change what the recorded keys do, restored before the first replayed frame.
+// A built BSP is rebuilt with the same heuristic before the seed is applied.
+struct InputToggleState
+{
+	int		m_regionSelectMode = 0;
+	float	m_regionSelectSize = 0.0f;
+	int		m_bspHeuristic = 0;
+	bool	m_bspBuilt = false;
+	bool	m_useLinearBvh = false;
+	bool	m_occlusionCulling = false;
+	bool	m_showVisibility = false;
+	bool	m_checkCompressedBsp = false;
+	bool	m_mirrorSnapshots = false;
+	bool	m_findOverlaps = false;
+	bool	m_useSweepAndPrune = false;
+};
+
+// keys are applied before the update they were recorded in, the hit count and update time are what
+// the recorded update produced, replay compares against them
+struct InputFrame
+{
+	double	m_deltaSeconds = 0.0;
+	Vec2	m_mousePos = Vec2::ZERO;
+	int		m_firstKey = 0;
+	int		m_numKeys = 0;
+	int		m_numHits = 0;
+	float	m_updateMs = 0.0f;
+};
+
+// Everything needed to drive Game::Update again without a window: the scene snapshot, toggles and
+// random seed it started from, then per frame the game keys, mouse position and delta time. Saved through
+// ByteBufferWriter so the files follow the snapshot format's endian and alignment rules.
+class InputRecording
+{
+public:
+	InputRecording();
+	~InputRecording();
+
+	void	Begin(uint seed, std::vector<uchar>& scene, const Vec2& ray_start, const Vec2& ray_end, const InputToggleState& toggles);
+	void	RecordKey(uchar key_code, bool pressed);
+	void	RecordFrame(double delta_seconds, const Vec2& mouse_pos, int num_hits, float update_ms);
+	void	Clear();
+
+	bool	SaveToFile(const char* file_path) const;
+	bool	LoadFromFile(const char* file_path);
+
+	uint						GetSeed() const				{ return m_seed; }
+	const std::vector<uchar>&	GetScene() const			{ return m_scene; }
+	const Vec2&					GetRayStart() const			{ return m_rayStart; }
+	const Vec2&					GetRayEnd() const			{ return m_rayEnd; }
+	const InputToggleState&		GetToggles() const			{ return m_toggles; }
+	int							GetNumFrames() const		{ return static_cast<int>(m_frames.size()); }
+	const InputFrame&			GetFrame(int frame_idx) const	{ return m_frames[frame_idx]; }
+	const InputKeyEvent&		GetKey(int key_idx) const	{ return m_keys[key_idx]; }
+
+private:
+	uint	m_seed = 0;
+	Vec2	m_rayStart = Vec2::ZERO;
+	Vec2	m_rayEnd = Vec2::ZERO;
+	InputToggleState	m_toggles;
+
+	std::vector<uchar>			m_scene;		// SceneSnapshot bytes, kept in their own allocation for its views
+	std::vector<InputFrame>		m_frames;
+	std::vector<InputKeyEvent>	m_keys;
+	int							m_numPendingKeys = 0;	// recorded since the last frame closed
+};
@@ -0,0 +1,549 @@
+#include "Game/LinearBvh.hpp"
+#include "Game/AabbUtils.hpp"
+#include "Game/Profiler.hpp"
+#include "Game/ShapeComponents.hpp"
+#include "Game/ShapeGrid.hpp"
+#include "Game/ShapePrototypes.hpp"
+#include "Game/ShapeSystems.hpp"
+#include "Game/TestScene.hpp"
+#include "Game/WorkerThreads.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+constexpr int LBVH_RADIX_BITS = 8;
+constexpr int LBVH_RADIX_SIZE = 1 << LBVH_RADIX_BITS;
+constexpr int LBVH_RADIX_PASSES = 4;					// 30 bit codes, the last pass only sees 6 bits
+constexpr int LBVH_ROOT_NODE = 0;						// internal node 0 spans every leaf, or is the only leaf
+constexpr int LBVH_MIN_SHAPES_PER_THREAD = 4096;		// below this the threads cost more than they save
+
+
+static int CountLeadingZeros(const uint32_t value)
+{
+	if(value == 0)
+	{
+		return 32;
+	}
+
+#if defined(_MSC_VER)
+	unsigned long bit_idx = 0;
+	_BitScanReverse(&bit_idx, value);
+	return 31 - static_cast<int>(bit_idx);
+#else
+	return __builtin_clz(value);
+#endif
+}
+
+
+// spreads the low 15 bits out to the even bits
+static uint32_t SpreadBits(uint32_t value)
+{
+	value &= 0x00007FFFu;
+	value = (value | (value << 8)) & 0x00FF00FFu;
+	value = (value | (value << 4)) & 0x0F0F0F0Fu;
+	value = (value | (value << 2)) & 0x33333333u;
+	value = (value | (value << 1)) & 0x55555555u;
+	return value;
+}
+
+
+// every worker has to arrive before any of them leaves, the passes of the radix sort need it
+class SpinBarrier
+{
+public:
+	explicit SpinBarrier(const int num_threads): m_numThreads(num_threads) {}
+
+	void Wait()
+	{
+		const int generation = m_generation.load(std::memory_order_acquire);
+		if(m_numArrived.fetch_add(1, std::memory_order_acq_rel) + 1 == m_numThreads)
+		{
+			m_numArrived.store(0, std::memory_order_relaxed);
+			m_generation.fetch_add(1, std::memory_order_release);
+			return;
+		}
+
+		while(m_generation.load(std::memory_order_acquire) == generation)
+		{
+			std::this_thread::yield();
+		}
+	}
+
+private:
+	int					m_numThreads = 1;
+	std::atomic<int>	m_numArrived { 0 };
+	std::atomic<int>	m_generation { 0 };
+};
+
+
+template<typename Worker>
+static void RunOnThreads(WorkerThreads* workers, const Worker& worker)
+{
+	if(workers == nullptr)
+	{
+		worker(0);
+		return;
+	}
+
+	workers->Run(worker);
+}
+
+//--------------------------------------------------------------------
+
+LinearBvh::LinearBvh() = default;
+
+
+LinearBvh::~LinearBvh()
+{
+	TaggedDelete(MEM_TAG_SCRATCH, m_workers);
+}
+
+
+void LinearBvh::Build(const ShapeComponents& shapes, int num_threads)
+{
+	PROFILE_SCOPE("LinearBvh::Build");
+	const uint64_t start_ticks = ProfilerGetTicks();
+
+	m_numLeaves = shapes.GetCount();
+	m_nodes.clear();
+	if(m_numLeaves == 0)
+	{
+		m_sortedShapes.clear();
+		return;
+	}
+
+	if(num_threads <= 0)
+	{
+		num_threads = static_cast<int>(std::thread::hardware_concurrency());
+	}
+	num_threads = std::max(1, std::min(num_threads, m_numLeaves / LBVH_MIN_SHAPES_PER_THREAD));
+
+	// restarted only when the thread count changes, a single threaded build leaves them asleep
+	if(num_threads > 1 && (m_workers == nullptr || m_workers->GetNumThreads() != num_threads))
+	{
+		TaggedDelete(MEM_TAG_SCRATCH, m_workers);
+		m_workers = TaggedNew<WorkerThreads>(MEM_TAG_SCRATCH, num_threads);
+	}
+
+	ComputeMortonCodes(shapes);
+	SortMortonCodes(num_threads);
+
+	m_nodes.resize(2 * m_numLeaves - 1);
+	EmitHierarchy(num_threads);
+	ComputeBounds(shapes);
+
+	m_lastBuildMs = ProfilerTicksToMicroseconds(ProfilerGetTicks() - start_ticks) * 0.001;
+}
+
+
+// call once the shapes have been permuted by GetSortedShapes, leaf i is then shape i
+void LinearBvh::MarkShapesSorted()
+{
+	for(int leaf_idx = 0; leaf_idx < m_numLeaves; ++leaf_idx)
+	{
+		m_sortedShapes[leaf_idx] = leaf_idx;
+	}
+}
+
+
+void LinearBvh::QueryRegion(const AABB2& region, std::vector<int>& out_shapes) const
+{
+	out_shapes.clear();
+	if(m_numLeaves == 0)
+	{
+		return;
+	}
+
+	const int first_leaf = m_numLeaves - 1;
+	m_stack.clear();
+	m_stack.push_back(LBVH_ROOT_NODE);
+	while(!m_stack.empty())
+	{
+		const int node_idx = m_stack.back();
+		m_stack.pop_back();
+
+		const LinearBvhNode& node = m_nodes[node_idx];
+		if(!BoundsOverlap(node.m_bounds, region))
+		{
+			continue;
+		}
+
+		if(node_idx >= first_leaf)
+		{
+			out_shapes.push_back(m_sortedShapes[node_idx - first_leaf]);
+		}
+		else
+		{
+			m_stack.push_back(node.m_left);
+			m_stack.push_back(node.m_right);
+		}
+	}
+}
+
+
+bool LinearBvh::RaycastClosest(const ShapeComponents& shapes, const ShapePrototypeLibrary& prototypes,
+	const Ray2& ray, const float max_t, ShapeRayHit& out_hit) const
+{
+	out_hit = ShapeRayHit();
+	if(m_numLeaves == 0)
+	{
+		return false;
+	}
+
+	const int first_leaf = m_numLeaves - 1;
+	m_stack.clear();
+	m_stack.push_back(LBVH_ROOT_NODE);
+	while(!m_stack.empty())
+	{
+		const int node_idx = m_stack.back();
+		m_stack.pop_back();
+
+		const float best_t = out_hit.m_t < max_t ? out_hit.m_t : max_t;
+		float enter_t = 0.0f;
+		if(!RayHitsBounds(ray, m_nodes[node_idx].m_bounds, best_t, enter_t))
+		{
+			continue;
+		}
+
+		if(node_idx >= first_leaf)
+		{
+			const int shape_idx = m_sortedShapes[node_idx - first_leaf];
+			float t = 0.0f;
+			int plane_idx = -1;
+			if(RaycastShape(shapes, prototypes, shape_idx, ray, t, plane_idx) && t <= best_t)
+			{
+				out_hit.m_t = t;
+				out_hit.m_shapeIdx = shape_idx;
+				out_hit.m_planeIdx = plane_idx;
+			}
+
+			continue;
+		}
+
+		const LinearBvhNode& node = m_nodes[node_idx];
+		float left_t = 0.0f;
+		float right_t = 0.0f;
+		const bool hit_left = RayHitsBounds(ray, m_nodes[node.m_left].m_bounds, best_t, left_t);
+		const bool hit_right = RayHitsBounds(ray, m_nodes[node.m_right].m_bounds, best_t, right_t);
+		if(hit_left && hit_right)
+		{
+			// pushed far first so the near one pops next
+			m_stack.push_back(left_t <= right_t ? node.m_right : node.m_left);
+			m_stack.push_back(left_t <= right_t ? node.m_left : node.m_right);
+		}
+		else if(hit_left)
+		{
+			m_stack.push_back(node.m_left);
+		}
+		else if(hit_right)
+		{
+			m_stack.push_back(node.m_right);
+		}
+	}
+
+	if(out_hit.m_shapeIdx == -1)
+	{
+		return false;
+	}
+
+	if(out_hit.m_planeIdx != -1)
+	{
+		const std::vector<Plane2>& planes = prototypes.GetPrototype(shapes.m_prototypeIds[out_hit.m_shapeIdx]).m_hull.m_planes;
+		out_hit.m_normal = shapes.m_frames[out_hit.m_shapeIdx].ToWorldVector(planes[out_hit.m_planeIdx].m_normal).GetNormalized();
+	}
+
+	return true;
+}
+
+
+// unit_x and unit_y in [0, 1], 15 bits each interleaved with x in the low bit
+STATIC uint32_t LinearBvh::GetMortonCode(const float unit_x, const float unit_y)
+{
+	const float clamped_x = unit_x < 0.0f ? 0.0f : (unit_x > 1.0f ? 1.0f : unit_x);
+	const float clamped_y = unit_y < 0.0f ? 0.0f : (unit_y > 1.0f ? 1.0f : unit_y);
+	const uint32_t x = static_cast<uint32_t>(clamped_x * 32767.0f);
+	const uint32_t y = static_cast<uint32_t>(clamped_y * 32767.0f);
+	return SpreadBits(x) | (SpreadBits(y) << 1);
+}
+
+
+// codes are relative to the box around the centers, so the full 15 bits are spent on the scene
+void LinearBvh::ComputeMortonCodes(const ShapeComponents& shapes)
+{
+	Vec2 mins = shapes.m_positions[0];
+	Vec2 maxs = shapes.m_positions[0];
+	for(int shape_idx = 1; shape_idx < m_numLeaves; ++shape_idx)
+	{
+		const Vec2& position = shapes.m_positions[shape_idx];
+		mins = Vec2(std::min(mins.x, position.x), std::min(mins.y, position.y));
+		maxs = Vec2(std::max(maxs.x, position.x), std::max(maxs.y, position.y));
+	}
+
+	const float inv_width = maxs.x > mins.x ? 1.0f / (maxs.x - mins.x) : 0.0f;
+	const float inv_height = maxs.y > mins.y ? 1.0f / (maxs.y - mins.y) : 0.0f;
+
+	m_codes.resize(m_numLeaves);
+	m_sortedShapes.resize(m_numLeaves);
+	for(int shape_idx = 0; shape_idx < m_numLeaves; ++shape_idx)
+	{
+		const Vec2& position = shapes.m_positions[shape_idx];
+		m_codes[shape_idx] = GetMortonCode((position.x - mins.x) * inv_width, (position.y - mins.y) * inv_height);
+		m_sortedShapes[shape_idx] = shape_idx;
+	}
+}
+
+
+// least significant digit first, each thread owns one slice of the input for all four passes,
+// so the scatter of a pass only needs the histograms of the slices before it
+void LinearBvh::SortMortonCodes(const int num_threads)
+{
+	PROFILE_SCOPE("LinearBvh::SortMortonCodes");
+
+	m_scratchCodes.resize(m_numLeaves);
+	m_scratchShapes.resize(m_numLeaves);
+
+	std::vector<int> histograms(num_threads * LBVH_RADIX_SIZE);
+	SpinBarrier barrier(num_threads);
+
+	const auto worker = [&](const int thread_idx)
+	{
+		const int slice_start = static_cast<int>(static_cast<int64_t>(m_numLeaves) * thread_idx / num_threads);
+		const int slice_end = static_cast<int>(static_cast<int64_t>(m_numLeaves) * (thread_idx + 1) / num_threads);
+		int* histogram = &histograms[thread_idx * LBVH_RADIX_SIZE];
+
+		uint32_t* codes_in = m_codes.data();
+		int* shapes_in = m_sortedShapes.data();
+		uint32_t* codes_out = m_scratchCodes.data();
+		int* shapes_out = m_scratchShapes.data();
+
+		for(int pass = 0; pass < LBVH_RADIX_PASSES; ++pass)
+		{
+			const int shift = pass * LBVH_RADIX_BITS;
+
+			std::fill(histogram, histogram + LBVH_RADIX_SIZE, 0);
+			for(int item_idx = slice_start; item_idx < slice_end; ++item_idx)
+			{
+				++histogram[(codes_in[item_idx] >> shift) & (LBVH_RADIX_SIZE - 1)];
+			}
+
+			barrier.Wait();
+
+			// where this slice writes each digit: every smaller digit, then this digit in earlier slices
+			int offsets[LBVH_RADIX_SIZE];
+			int running = 0;
+			for(int digit = 0; digit < LBVH_RADIX_SIZE; ++digit)
+			{
+				for(int other_idx = 0; other_idx < num_threads; ++other_idx)
+				{
+					if(other_idx == thread_idx)
+					{
+						offsets[digit] = running;
+					}
+					running += histograms[other_idx * LBVH_RADIX_SIZE + digit];
+				}
+			}
+
+			for(int item_idx = slice_start; item_idx < slice_end; ++item_idx)
+			{
+				const int out_idx = offsets[(codes_in[item_idx] >> shift) & (LBVH_RADIX_SIZE - 1)]++;
+				codes_out[out_idx] = codes_in[item_idx];
+				shapes_out[out_idx] = shapes_in[item_idx];
+			}
+
+			// histograms are rewritten next pass, nobody may still be reading them
+			barrier.Wait();
+
+			std::swap(codes_in, codes_out);
+			std::swap(shapes_in, shapes_out);
+		}
+	};
+
+	RunOnThreads(num_threads > 1 ? m_workers : nullptr, worker);
+
+	// an even number of passes lands the result back in m_codes
+	static_assert(LBVH_RADIX_PASSES % 2 == 0, "Sorted codes are expected back in m_codes");
+}
+
+
+void LinearBvh::EmitHierarchy(const int num_threads)
+{
+	PROFILE_SCOPE("LinearBvh::EmitHierarchy");
+
+	const int num_internal = m_numLeaves - 1;
+	const auto worker = [&](const int thread_idx)
+	{
+		const int start = static_cast<int>(static_cast<int64_t>(num_internal) * thread_idx / num_threads);
+		const int end = static_cast<int>(static_cast<int64_t>(num_internal) * (thread_idx + 1) / num_threads);
+		for(int node_idx = start; node_idx < end; ++node_idx)
+		{
+			EmitInternalNode(node_idx);
+		}
+	};
+
+	RunOnThreads(num_threads > 1 ? m_workers : nullptr, worker);
+}
+
+
+// the range of leaves under node i starts or ends at leaf i, it extends towards the neighbour
+// sharing the longer prefix, and splits where the prefix of the whole range first changes
+void LinearBvh::EmitInternalNode(const int node_idx)
+{
+	const int direction = GetCommonPrefix(node_idx, node_idx + 1) - GetCommonPrefix(node_idx, node_idx - 1) > 0 ? 1 : -1;
+
+	const int min_prefix = GetCommonPrefix(node_idx, node_idx - direction);
+	int max_length = 2;
+	while(GetCommonPrefix(node_idx, node_idx + max_length * direction) > min_prefix)
+	{
+		max_length *= 2;
+	}
+
+	int length = 0;
+	for(int step = max_length / 2; step > 0; step /= 2)
+	{
+		if(GetCommonPrefix(node_idx, node_idx + (length + step) * direction) > min_prefix)
+		{
+			length += step;
+		}
+	}
+
+	const int other_end = node_idx + length * direction;
+	const int node_prefix = GetCommonPrefix(node_idx, other_end);
+
+	int split = 0;
+	int step = length;
+	do
+	{
+		step = (step + 1) / 2;
+		if(GetCommonPrefix(node_idx, node_idx + (split + step) * direction) > node_prefix)
+		{
+			split += step;
+		}
+	}
+	while(step > 1);
+
+	const int gamma = node_idx + split * direction + std::min(direction, 0);
+	const int first_leaf = m_numLeaves - 1;
+	const int range_min = std::min(node_idx, other_end);
+	const int range_max = std::max(node_idx, other_end);
+
+	LinearBvhNode& node = m_nodes[node_idx];
+	node.m_left = range_min == gamma ? first_leaf + gamma : gamma;
+	node.m_right = range_max == gamma + 1 ? first_leaf + gamma + 1 : gamma + 1;
+	m_nodes[node.m_left].m_parent = node_idx;
+	m_nodes[node.m_right].m_parent = node_idx;
+}
+
+
+// climbs from every leaf, the second child to arrive at a node is the one that fills it in
+void LinearBvh::ComputeBounds(const ShapeComponents& shapes)
+{
+	const int first_leaf = m_numLeaves - 1;
+	m_visitCounts.assign(m_numLeaves, 0);
+
+	for(int leaf_idx = 0; leaf_idx < m_numLeaves; ++leaf_idx)
+	{
+		const int shape_idx = m_sortedShapes[leaf_idx];
+		const Vec2& position = shapes.m_positions[shape_idx];
+		const Vec2 extents(shapes.m_scales[shape_idx], shapes.m_scales[shape_idx]);
+		m_nodes[first_leaf + leaf_idx].m_bounds = AABB2(position - extents, position + extents);
+
+		int node_idx = m_nodes[first_leaf + leaf_idx].m_parent;
+		while(node_idx != -1 && ++m_visitCounts[node_idx] == 2)
+		{
+			LinearBvhNode& node = m_nodes[node_idx];
+			node.m_bounds = UnionBounds(m_nodes[node.m_left].m_bounds, m_nodes[node.m_right].m_bounds);
+			node_idx = node.m_parent;
+		}
+	}
+}
+
+
+// length of the shared leading bits, equal codes fall back on the leaf index so every key is unique
+int LinearBvh::GetCommonPrefix(const int first, const int second) const
+{
+	if(second < 0 || second >= m_numLeaves)
+	{
+		return -1;
+	}
+
+	const uint32_t first_code = m_codes[first];
+	const uint32_t second_code = m_codes[second];
+	if(first_code == second_code)
+	{
+		return 32 + CountLeadingZeros(static_cast<uint32_t>(first ^ second));
+	}
+
+	return CountLeadingZeros(first_code ^ second_code);
+}
+
+//--------------------------------------------------------------------
+
+// the closest hit of every shape, with no hierarchy to cull by
+static bool RaycastBruteForce(const ShapeComponents& shapes, const ShapePrototypeLibrary& prototypes, const Ray2& ray, const float max_t, float& out_t)
+{
+	out_t = max_t;
+	bool hit = false;
+	for(int shape_idx = 0; shape_idx < shapes.GetCount(); ++shape_idx)
+	{
+		float t = 0.0f;
+		int plane_idx = -1;
+		if(RaycastShape(shapes, prototypes, shape_idx, ray, t, plane_idx) && t <= out_t)
+		{
+			out_t = t;
+			hit = true;
+		}
+	}
+
+	return hit;
+}
+
+
+// the threaded build only kicks in past LBVH_MIN_SHAPES_PER_THREAD shapes a thread, so the big scene covers it
+UNITTEST("LinearBvh closest ray hits match brute force", "LinearBvh", 0)
+{
+	const int scene_sizes[2] = { 300, 2 * LBVH_MIN_SHAPES_PER_THREAD + 100 };
+	uint random_state = 0x1B873593u;
+	for(int scene_idx = 0; scene_idx < 2; ++scene_idx)
+	{
+		ShapePrototypeLibrary prototypes;
+		ShapeComponents shapes;
+		BuildTestScene(prototypes, shapes, random_state, 8, scene_sizes[scene_idx], 0.2f, 2.2f);
+
+		LinearBvh bvh;
+		bvh.Build(shapes, scene_idx + 1);
+
+		for(int ray_idx = 0; ray_idx < 200; ++ray_idx)
+		{
+			const Vec2 start = GetTestWorldPosition(random_state);
+			const float degrees = NextTestRandom(random_state) * 360.0f;
+			const Ray2 ray(start, Vec2(CosDegrees(degrees), SinDegrees(degrees)));
+			const float max_t = ray_idx % 2 == 0 ? INFINITY : 1.0f + NextTestRandom(random_state) * 20.0f;
+
+			float expected_t = 0.0f;
+			const bool expected_hit = RaycastBruteForce(shapes, prototypes, ray, max_t, expected_t);
+
+			// shapes can tie on t, so the hit shape only has to agree with its own cast
+			ShapeRayHit hit;
+			if(bvh.RaycastClosest(shapes, prototypes, ray, max_t, hit) != expected_hit)
+			{
+				return false;
+			}
+
+			float shape_t = 0.0f;
+			int plane_idx = -1;
+			if(expected_hit && (hit.m_t != expected_t
+				|| !RaycastShape(shapes, prototypes, hit.m_shapeIdx, ray, shape_t, plane_idx)
+				|| shape_t != hit.m_t || plane_idx != hit.m_planeIdx))
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include "Engine/Math/AABB2.hpp"
+#include "Engine/Math/Ray2.hpp"
+
+#include "Game/MemoryTags.hpp"
+
+#include <cstdint>
+#include <vector>
+
+struct ShapeComponents;
+struct ShapeRayHit;
+class WorkerThreads;
+class ShapePrototypeLibrary;
+
+struct LinearBvhNode
+{
+	AABB2	m_bounds;
+	int		m_left = -1;		// node indices, leaves come after the n - 1 internal nodes
+	int		m_right = -1;
+	int		m_parent = -1;
+};
+
+// Bounding volume hierarchy rebuilt from scratch each time rather than refit. Shape centers are
+// turned into 30 bit Morton codes, radix sorted across threads, and every internal node is then
+// placed independently from the sorted codes (Karras 2012), so the whole build is linear. The worker
+// threads are started by the first threaded build and sleep between builds.
+class LinearBvh
+{
+public:
+	LinearBvh();
+	~LinearBvh();
+
+	LinearBvh(const LinearBvh&) = delete;		// owns its worker threads
+	LinearBvh& operator=(const LinearBvh&) = delete;
+
+	void	Build(const ShapeComponents& shapes, int num_threads = 0);
+	void	MarkShapesSorted();
+
+	void	QueryRegion(const AABB2& region, std::vector<int>& out_shapes) const;
+	bool	RaycastClosest(const ShapeComponents& shapes, const ShapePrototypeLibrary& prototypes,
+				const Ray2& ray, float max_t, ShapeRayHit& out_hit) const;
+
+	const std::vector<int>&	GetSortedShapes() const		{ return m_sortedShapes; }
+	int						GetNumLeaves() const		{ return m_numLeaves; }
+	double					GetLastBuildMs() const		{ return m_lastBuildMs; }
+
+	static uint32_t	GetMortonCode(float unit_x, float unit_y);
+
+private:
+	void	ComputeMortonCodes(const ShapeComponents& shapes);
+	void	SortMortonCodes(int num_threads);
+	void	EmitHierarchy(int num_threads);
+	void	EmitInternalNode(int node_idx);
+	void	ComputeBounds(const ShapeComponents& shapes);
+	int		GetCommonPrefix(int first, int second) const;
+
+private:
+	int							m_numLeaves = 0;
+	TaggedVector<LinearBvhNode, MEM_TAG_SHAPES>	m_nodes;
+	TaggedVector<uint32_t, MEM_TAG_SHAPES>		m_codes;
+	std::vector<int>							m_sortedShapes;		// shape index of each leaf, in Morton order
+	TaggedVector<uint32_t, MEM_TAG_SCRATCH>		m_scratchCodes;
+	TaggedVector<int, MEM_TAG_SCRATCH>			m_scratchShapes;
+	TaggedVector<int, MEM_TAG_SCRATCH>			m_visitCounts;
+	double						m_lastBuildMs = 0.0;
+	WorkerThreads*				m_workers = nullptr;
+
+	mutable TaggedVector<int, MEM_TAG_SCRATCH>	m_stack;
+};
@@ -168,12 +168,23 @@ void RunFrame()
 }
 
 //-----------------------------------------------------------------------------------------------
-void Startup()
+void Startup(const char* command_line)
 {
 	tinyxml2::XMLDocument config;
 	config.LoadFile("Data/GameConfig.xml");
 	XmlElement* root = config.RootElement();
 	g_gameConfigBlackboard.PopulateFromXmlElementAttributes(*root);
+
+	// -scenarios=<file> on the command line overrides the config's scenarioFile
+	const std::string command_line_args = command_line != nullptr ? command_line : "";
+	const size_t scenarios_arg = command_line_args.find("-scenarios=");
+	if(scenarios_arg != std::string::npos)
+	{
+		const size_t value_start = scenarios_arg + strlen("-scenarios=");
+		const size_t value_end = command_line_args.find(' ', value_start);
+		g_gameConfigBlackboard.SetValue("scenarioFile", command_line_args.substr(value_start, value_end == std::string::npos ? std::string::npos : value_end - value_start));
+	}
+
 	const float world_aspect = g_gameConfigBlackboard.GetValue("windowAspect", WORLD_ASPECT);
 	CreateWindowAndRenderContext(world_aspect);
 	g_theApp = new App();
@@ -197,11 +208,10 @@ void Shutdown()
 int WINAPI WinMain(HINSTANCE application_instance_handle, HINSTANCE prev_instance, LPSTR command_line_string, int show_cmd)
 {
 	UNUSED(application_instance_handle);
-	UNUSED(command_line_string);
 	UNUSED(prev_instance);
 	UNUSED(show_cmd);
 
-	Startup();
+	Startup(command_line_string);
 
 	// This bit benefits the most from making it a class - knowing when a processing messages 
 	// results int he window itself being closed so we can stop processing.
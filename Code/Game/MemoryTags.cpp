@@ -0,0 +1,57 @@
+#include "Game/MemoryTags.hpp"
+
+static MemTagStats s_memTagStats[NUM_MEM_TAGS];
+
+
+void MemTagAllocated(const MemTag tag, const size_t num_bytes)
+{
+	MemTagStats& stats = s_memTagStats[tag];
+	const int64_t live_bytes = stats.m_liveBytes.fetch_add(static_cast<int64_t>(num_bytes), std::memory_order_relaxed) + static_cast<int64_t>(num_bytes);
+	stats.m_liveCount.fetch_add(1, std::memory_order_relaxed);
+	stats.m_totalCount.fetch_add(1, std::memory_order_relaxed);
+
+	int64_t high_water = stats.m_highWaterBytes.load(std::memory_order_relaxed);
+	while(live_bytes > high_water && !stats.m_highWaterBytes.compare_exchange_weak(high_water, live_bytes, std::memory_order_relaxed))
+	{
+	}
+}
+
+
+void MemTagFreed(const MemTag tag, const size_t num_bytes)
+{
+	MemTagStats& stats = s_memTagStats[tag];
+	stats.m_liveBytes.fetch_sub(static_cast<int64_t>(num_bytes), std::memory_order_relaxed);
+	stats.m_liveCount.fetch_sub(1, std::memory_order_relaxed);
+}
+
+
+const MemTagStats& MemTagGetStats(const MemTag tag)
+{
+	return s_memTagStats[tag];
+}
+
+
+// high water starts again from what is live now
+void MemTagResetHighWater()
+{
+	for(int tag_idx = 0; tag_idx < NUM_MEM_TAGS; ++tag_idx)
+	{
+		MemTagStats& stats = s_memTagStats[tag_idx];
+		stats.m_highWaterBytes.store(stats.m_liveBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	}
+}
+
+
+const char* GetMemTagName(const MemTag tag)
+{
+	switch(tag)
+	{
+		case MEM_TAG_BSP:		return "BSP";
+		case MEM_TAG_SHAPES:	return "Shapes";
+		case MEM_TAG_HULLS:		return "Hulls";
+		case MEM_TAG_RAYS:		return "Rays";
+		case MEM_TAG_MESHES:	return "Meshes";
+		case MEM_TAG_SCRATCH:	return "Scratch";
+		default:				return "Unknown";
+	}
+}
@@ -0,0 +1,111 @@
+#pragma once
+#include "Game/GameCommon.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Where the game's own memory goes, on top of the engine's global tracker which cannot tell
+// subsystems apart. Containers opt in through TaggedVector, single objects through TaggedNew.
+enum MemTag
+{
+	MEM_TAG_BSP,
+	MEM_TAG_SHAPES,		// components, pooled shapes and the spatial indices over them
+	MEM_TAG_HULLS,		// prototype hulls and outlines
+	MEM_TAG_RAYS,
+	MEM_TAG_MESHES,		// GPUMesh objects, their vertex buffers live with the renderer
+	MEM_TAG_SCRATCH,	// per frame and per query working space
+	NUM_MEM_TAGS
+};
+
+struct MemTagStats
+{
+	std::atomic<int64_t>	m_liveBytes{ 0 };
+	std::atomic<int64_t>	m_liveCount{ 0 };
+	std::atomic<int64_t>	m_highWaterBytes{ 0 };
+	std::atomic<int64_t>	m_totalCount{ 0 };
+};
+
+void				MemTagAllocated(MemTag tag, size_t num_bytes);
+void				MemTagFreed(MemTag tag, size_t num_bytes);
+const MemTagStats&	MemTagGetStats(MemTag tag);
+void				MemTagResetHighWater();
+const char*			GetMemTagName(MemTag tag);
+
+//--------------------------------------------------------------------
+
+template<typename T, MemTag TAG>
+class TaggedAllocator
+{
+public:
+	using value_type = T;
+
+	template<typename U>
+	struct rebind
+	{
+		using other = TaggedAllocator<U, TAG>;
+	};
+
+	TaggedAllocator() = default;
+
+	template<typename U>
+	TaggedAllocator(const TaggedAllocator<U, TAG>&) {}
+
+	T* allocate(const size_t count)
+	{
+		MemTagAllocated(TAG, count * sizeof(T));
+		if constexpr(alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+		{
+			return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t(alignof(T))));
+		}
+		else
+		{
+			return static_cast<T*>(::operator new(count * sizeof(T)));
+		}
+	}
+
+	void deallocate(T* pointer, const size_t count)
+	{
+		MemTagFreed(TAG, count * sizeof(T));
+		if constexpr(alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+		{
+			::operator delete(pointer, std::align_val_t(alignof(T)));
+		}
+		else
+		{
+			::operator delete(pointer);
+		}
+	}
+
+	template<typename U>
+	bool operator==(const TaggedAllocator<U, TAG>&) const	{ return true; }
+
+	template<typename U>
+	bool operator!=(const TaggedAllocator<U, TAG>&) const	{ return false; }
+};
+
+template<typename T, MemTag TAG>
+using TaggedVector = std::vector<T, TaggedAllocator<T, TAG>>;
+
+
+template<typename T, typename... Args>
+T* TaggedNew(const MemTag tag, Args&&... args)
+{
+	MemTagAllocated(tag, sizeof(T));
+	return new T(std::forward<Args>(args)...);
+}
+
+
+// takes null the same way delete does, and leaves the pointer null
+template<typename T>
+void TaggedDelete(const MemTag tag, T*& object)
+{
+	if(object != nullptr)
+	{
+		MemTagFreed(tag, sizeof(T));
+		delete object;
+		object = nullptr;
+	}
+}
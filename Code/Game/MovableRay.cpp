@@ -1,5 +1,6 @@
 #include "Game/MovableRay.hpp"
-#include "Game/ConvexShape.hpp"
+#include "Game/MemoryTags.hpp"
+#include "Game/ShapeGrid.hpp"
 
 #include "Engine/Math/MathUtils.hpp"
 
@@ -10,12 +11,12 @@ MovableRay::MovableRay(Game* the_game): Entity(the_game)
 	m_debugSegment.SetStart(Vec2(25.0f, 25.0f));
 	m_debugSegment.SetEnd(Vec2(26.0f, 25.0f));
 	m_ray = Ray2::FromPoints(Vec2(25.0f, 25.0f), Vec2(26.0f, 25.0f));
-	
-	m_position = m_raySegment.GetCenter();
-	m_orientationDegrees = m_raySegment.GetRotation();
-	m_scale = 0.50f;
 
 	m_material = g_theRenderer->CreateOrGetMaterial("white.mat");
+
+	m_mesh = TaggedNew<GPUMesh>(MEM_TAG_MESHES, g_theRenderer);
+	m_debugMesh = TaggedNew<GPUMesh>(MEM_TAG_MESHES, g_theRenderer);
+	m_reflectingMesh = TaggedNew<GPUMesh>(MEM_TAG_MESHES, g_theRenderer);
 }
 
 
@@ -23,57 +24,32 @@ MovableRay::~MovableRay()
 {
 	if (m_mesh)
 	{
-		delete m_mesh;
-		m_mesh = nullptr;
+		TaggedDelete(MEM_TAG_MESHES, m_mesh);
 	}
 
 	if(m_debugMesh)
 	{
-		delete m_debugMesh;
-		m_debugMesh = nullptr;
+		TaggedDelete(MEM_TAG_MESHES, m_debugMesh);
 	}
 
 	if (m_reflectingMesh)
 	{
-		delete m_reflectingMesh;
-		m_reflectingMesh = nullptr;
+		TaggedDelete(MEM_TAG_MESHES, m_reflectingMesh);
 	}
 }
 
 
 void MovableRay::Update(float delta_seconds)
 {
-	if(m_mesh)
-	{
-		delete m_mesh;
-		m_mesh = nullptr;
-	}
-
-	if (m_debugMesh)
-	{
-		delete m_debugMesh;
-		m_debugMesh = nullptr;
-	}
-
-	if (m_reflectingMesh)
-	{
-		delete m_reflectingMesh;
-		m_reflectingMesh = nullptr;
-	}
+	UNUSED(delta_seconds);
 
 	//hand drawing the line in world space
-	m_position = m_raySegment.GetCenter();
-	m_orientationDegrees = m_raySegment.GetRotation();
 	m_ray = Ray2::FromPoints(m_raySegment.m_start, m_raySegment.m_end);
 
-	if(m_hitThisFrame)
+	if(ArrowsChanged())
 	{
-		m_reflectingRaySegment = Segment2(m_reflectingRay.m_pos, m_reflectingRay.PointAtTime(10.0f));
-		m_reflectingPos = m_reflectingRaySegment.GetCenter();
-		m_reflectingOrientationDeg = m_reflectingRaySegment.GetRotation();
+		ConstructArrow();
 	}
-
-	ConstructArrow();
 }
 
 
@@ -90,7 +66,11 @@ void MovableRay::Render() const
 		if (m_hitThisFrame)
 		{
  			g_theRenderer->DrawMesh(*m_debugMesh);
- 			g_theRenderer->DrawMesh(*m_reflectingMesh);
+
+			if(m_builtNumReflectionPoints > 1)
+			{
+				g_theRenderer->DrawMesh(*m_reflectingMesh);
+			}
 		}
 		
 		g_theRenderer->DrawMesh(*m_mesh);
@@ -125,6 +105,25 @@ bool MovableRay::DestroyEntity()
 }
 
 
+Vec2 MovableRay::GetPosition() const
+{
+	return m_raySegment.GetCenter();
+}
+
+
+float MovableRay::GetOrientationDegrees() const
+{
+	return m_raySegment.GetRotation();
+}
+
+
+// the arrow is built in world space, this is only the scale it has always reported
+float MovableRay::GetScale() const
+{
+	return 0.5f;
+}
+
+
 void MovableRay::SetStart(const Vec2& pos)
 {
 	m_raySegment.m_start = pos;
@@ -139,22 +138,6 @@ void MovableRay::SetEnd(const Vec2& pos)
 }
 
 
-void MovableRay::SetEnd(const float ray_t_val, ConvexShape2D* convx, int plane_idx)
-{
-	m_raySegment.m_end = m_ray.PointAtTime(ray_t_val);
-	
-	float diff_time = Abs(m_debugSegment.GetLength() - ray_t_val);
-	m_debugSegment.m_end = m_ray.PointAtTime(m_raySegment.GetLength() + diff_time);
-
-	if(convx != nullptr && plane_idx != -1)
-	{
-		std::vector<Plane2> planes = convx->GetLocalConvexPlanes();
-		Vec2 ref_dir = ReflectVectorOffSurfaceNormal(m_ray.m_dir, planes[plane_idx].m_normal);
-		m_reflectingRay = Ray2(m_raySegment.m_end, ref_dir);
-	}
-}
-
-
 Vec2 MovableRay::GetStart() const
 {
 	return m_debugSegment.m_start;
@@ -167,122 +150,125 @@ Vec2 MovableRay::GetEnd() const
 }
 
 
+// the segment is re-clipped every frame, so it grows back once a shape moves out of the way
 void MovableRay::PreUpdate()
 {
-	m_position = m_raySegment.GetCenter();
-	m_orientationDegrees = m_raySegment.GetRotation();
+	m_raySegment.m_end = m_debugSegment.m_end;
 	m_ray = Ray2::FromPoints(m_raySegment.m_start, m_raySegment.m_end);
 	m_hitThisFrame = false;
 }
 
 
-
-bool MovableRay::CollideWithConvexShape(float* out_t, int* out_plane_idx, const ConvexShape2D& shape)
+void MovableRay::CollideWithShapes(const ShapeGrid& grid, const ShapeComponents& shapes, const ShapePrototypeLibrary& prototypes)
 {
-	std::vector<Plane2> planes = shape.GetLocalConvexPlanes();
+	m_reflects = false;
 
-	//early out inside
-	if(shape.IsPointInsideShape(m_ray.m_pos))
+	ShapeRayHit hit;
+	if(!grid.RaycastClosest(shapes, prototypes, m_ray, m_debugSegment.GetLength(), hit))
 	{
-		out_t[0] = 0.01f;
-		*out_plane_idx = -1;
-
-		m_reflectingRay = m_ray;
-
-		m_hitThisFrame = true;
-		return true;
+		return;
 	}
 
-	const bool mid_check = CollideWithDisk(shape);
-	
-	if(mid_check)
+	m_hitThisFrame = true;
+
+	//early out inside
+	if(hit.m_planeIdx == -1)
 	{
- 		float largest_t_val = 0.0f;
- 		int plane_intersection_idx = -1;
- 
- 		//check all planes if they intersect.
-  		for(int plane_idx = 0; plane_idx < static_cast<int>(planes.size()); ++plane_idx)
-  		{
-  			float t_vals[2];
-  			 
-  			//world ray cast, to local ray cast
-  			Matrix44 shape_local_space = shape.GetModelMatrix().GetInverseMatrix();
-  			Vec2 local_pos = shape_local_space.GetTransformPosition2D(m_ray.m_pos);
-  			Vec2 local_dir = shape_local_space.GetTransformVector2D(m_ray.m_dir);
-  			
-  			Ray2 local_ray_cast(local_pos, local_dir);
-  
-  			uint num_hits = Raycast(t_vals, local_ray_cast, planes[plane_idx]);
-  
-  			if(num_hits > 0)
-  			{
-  				if(t_vals[0] > largest_t_val)
-  				{
-  					largest_t_val = t_vals[0];
-  					plane_intersection_idx = plane_idx;
-  				}
-  			}
-  		}
- 
- 		//check if the point is in the hull, without the plan that it intersected.
- 		if(plane_intersection_idx >= 0)
- 		{
- 			const Vec2 contact_point = m_ray.PointAtTime(largest_t_val);
-
-			const Vec2 dir = contact_point - m_ray.m_pos;
-			const float segment_length = m_debugSegment.GetLengthSqr();
-			const float ray_length = dir.GetLengthSquared();
- 			
-			if (ray_length < segment_length && shape.IsPointInsideShapeIgnorePlane(contact_point, plane_intersection_idx))
-			{
-				const float segment_end_t_value = m_raySegment.GetLength();
+		m_raySegment.m_end = m_ray.PointAtTime(0.01f);
+		return;
+	}
 
-				out_t[0] = ClampFloat(largest_t_val, 0.0f, segment_end_t_value);
+	m_raySegment.m_end = m_ray.PointAtTime(hit.m_t);
 
-				m_hitThisFrame = true;
-				*out_plane_idx = plane_intersection_idx;
-				return true;
-			}
- 		}
+	// the path starts on the surface, nudge it off so the first bounce does not find it again
+	const Vec2 reflected_dir = ReflectVectorOffSurfaceNormal(m_ray.m_dir, hit.m_normal);
+	m_reflectionEmitter = Ray2(m_raySegment.m_end + hit.m_normal * 0.001f, reflected_dir);
+	m_reflects = true;
+}
 
-	}
 
-	return false;
+// false when the ray missed or started inside a shape
+bool MovableRay::GetReflectionEmitter(Ray2& out_emitter) const
+{
+	out_emitter = m_reflectionEmitter;
+	return m_reflects;
 }
 
 
-bool MovableRay::CollideWithDisk(const ConvexShape2D& shape)
+// paths has to outlive the next Update, the points are only read when the arrows are rebuilt
+void MovableRay::SetReflectionPath(const ReflectionPathBuffer* paths, const int path_idx, const uint64_t shapes_version)
 {
-	float t_vals[2];
+	m_reflectionPaths = paths;
+	m_reflectionPathIdx = path_idx;
+	m_shapesVersion = shapes_version;
+}
+
 
-	uint num_hits = Raycast(t_vals, m_ray, shape.GetPosition(), shape.GetScale());
+bool MovableRay::ArrowsChanged() const
+{
+	if(!m_arrowsBuilt || m_builtHit != m_hitThisFrame)
+	{
+		return true;
+	}
 
-	if(num_hits > 0)
+	if(m_builtRaySegment.m_start != m_raySegment.m_start || m_builtRaySegment.m_end != m_raySegment.m_end)
 	{
 		return true;
 	}
 
+	if(m_hitThisFrame)
+	{
+		if(m_builtDebugSegment.m_start != m_debugSegment.m_start || m_builtDebugSegment.m_end != m_debugSegment.m_end)
+		{
+			return true;
+		}
+
+		if(m_builtReflects != m_reflects || (m_reflects && m_builtShapesVersion != m_shapesVersion))
+		{
+			return true;
+		}
+	}
+
 	return false;
 }
 
 
+// re-fills the meshes made in the constructor rather than creating new ones
 void MovableRay::ConstructArrow()
 {
 	CPUMesh arrow_mesh;
 	CpuMeshAddArrow(&arrow_mesh, m_rayCastColor, m_raySegment.m_start, m_raySegment.m_end, 0.25f);
-	m_mesh = new GPUMesh(g_theRenderer);
 	m_mesh->CreateFromCPUMesh<Vertex_PCU>(arrow_mesh);
 
+	int num_points = 0;
 	if(m_hitThisFrame)
 	{
-		CpuMeshAddArrow(&arrow_mesh, m_segmentColor, m_debugSegment.m_start, m_debugSegment.m_end, 0.25f);
-		m_debugMesh = new GPUMesh(g_theRenderer);
-		m_debugMesh->CreateFromCPUMesh<Vertex_PCU>(arrow_mesh);
+		CPUMesh debug_mesh;
+		CpuMeshAddArrow(&debug_mesh, m_segmentColor, m_debugSegment.m_start, m_debugSegment.m_end, 0.25f);
+		m_debugMesh->CreateFromCPUMesh<Vertex_PCU>(debug_mesh);
+
+		const bool has_path = m_reflects && m_reflectionPaths != nullptr;
+		num_points = has_path ? m_reflectionPaths->GetPathNumPoints(m_reflectionPathIdx) : 0;
+		if(num_points > 1)
+		{
+			const Vec2* points = &m_reflectionPaths->m_points[m_reflectionPaths->GetPathStart(m_reflectionPathIdx)];
 
-		CpuMeshAddArrow(&arrow_mesh, m_reflectColor, m_reflectingRaySegment.m_start, m_reflectingRaySegment.m_end, 0.25f);
-		m_reflectingMesh = new GPUMesh(g_theRenderer);
-		m_reflectingMesh->CreateFromCPUMesh<Vertex_PCU>(arrow_mesh);
+			CPUMesh reflecting_mesh;
+			for(int point_idx = 1; point_idx < num_points; ++point_idx)
+			{
+				CpuMeshAddArrow(&reflecting_mesh, m_reflectColor, points[point_idx - 1], points[point_idx], 0.25f);
+			}
+			m_reflectingMesh->CreateFromCPUMesh<Vertex_PCU>(reflecting_mesh);
+		}
 	}
+
+	m_arrowsBuilt = true;
+	m_builtHit = m_hitThisFrame;
+	m_builtRaySegment = m_raySegment;
+	m_builtDebugSegment = m_debugSegment;
+	m_builtShapesVersion = m_shapesVersion;
+	m_builtReflects = m_reflects;
+	m_builtNumReflectionPoints = num_points;
 }
 
 
@@ -1,10 +1,15 @@
 #pragma once
 #include "Game/Entity.hpp"
+#include "Game/ReflectionPaths.hpp"
 
 #include "Engine/Math/Segment2.hpp"
 #include "Engine/Math/Ray2.hpp"
 
-class ConvexShape2D;
+#include <cstdint>
+
+struct ShapeComponents;
+class ShapeGrid;
+class ShapePrototypeLibrary;
 
 class MovableRay: public Entity
 {
@@ -20,19 +25,24 @@ public:
 	void DrawEntity() const override;
 	bool DestroyEntity() override;
 
+	Vec2	GetPosition() const override;
+	float	GetOrientationDegrees() const override;
+	float	GetScale() const override;
+
 	void SetStart(const Vec2& pos);
 	void SetEnd(const Vec2& pos);
-	void SetEnd(float ray_t_val, ConvexShape2D* convx = nullptr, int plane_idx = -1);
 
 	Vec2 GetStart() const;
 	Vec2 GetEnd() const;
 
 	void PreUpdate();
-	bool CollideWithConvexShape(float* out_t, int* out_plane_idx, const ConvexShape2D& shape);
+	void CollideWithShapes(const ShapeGrid& grid, const ShapeComponents& shapes, const ShapePrototypeLibrary& prototypes);
+	bool GetReflectionEmitter(Ray2& out_emitter) const;
+	void SetReflectionPath(const ReflectionPathBuffer* paths, int path_idx, uint64_t shapes_version);
 
 private:
 	void ConstructArrow();
-	bool CollideWithDisk(const ConvexShape2D& shape);
+	bool ArrowsChanged() const;
 	
 private:
 	Segment2 m_raySegment;
@@ -40,8 +50,13 @@ private:
 	
 	Segment2 m_debugSegment;
 	
-	Segment2 m_reflectingRaySegment;
-	Ray2 m_reflectingRay;
+	Ray2 m_reflectionEmitter;
+	bool m_reflects = false;
+
+	// the game traces every emitter in one batch, this is where the bounces after the first hit landed
+	const ReflectionPathBuffer* m_reflectionPaths = nullptr;
+	int m_reflectionPathIdx = 0;
+	uint64_t m_shapesVersion = 0;
 
 	Rgba m_rayCastColor = Rgba::MAGENTA;
 	Rgba m_segmentColor = Rgba::GRAY;
@@ -49,7 +64,16 @@ private:
 
 	bool m_hitThisFrame = false;
 
+	GPUMesh* m_mesh = nullptr;
+	GPUMesh* m_debugMesh = nullptr;
 	GPUMesh* m_reflectingMesh = nullptr;
-	Vec2 m_reflectingPos;
-	float m_reflectingOrientationDeg;
+
+	// what the arrow meshes currently hold
+	bool m_arrowsBuilt = false;
+	bool m_builtHit = false;
+	Segment2 m_builtRaySegment;
+	Segment2 m_builtDebugSegment;
+	uint64_t m_builtShapesVersion = 0;	// the path only depends on the segments and where the shapes are
+	bool m_builtReflects = false;
+	int m_builtNumReflectionPoints = 0;
 };
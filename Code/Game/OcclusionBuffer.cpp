@@ -0,0 +1,171 @@
+#include "Game/OcclusionBuffer.hpp"
+#include "Game/Profiler.hpp"
+#include "Game/ShapeComponents.hpp"
+
+#include "Engine/Math/MathUtils.hpp"
+
+#include <cmath>
+
+constexpr float OCCLUSION_PI = 3.14159265358979f;
+constexpr float OCCLUSION_BIN_ANGLE = 2.0f * OCCLUSION_PI / static_cast<float>(OCCLUSION_BUFFER_NUM_BINS);
+
+
+OcclusionBuffer::OcclusionBuffer()
+{
+	for(int bin_idx = 0; bin_idx < OCCLUSION_BUFFER_NUM_BINS; ++bin_idx)
+	{
+		m_binDepths[bin_idx] = INFINITY;
+	}
+}
+
+
+OcclusionBuffer::~OcclusionBuffer() = default;
+
+
+void OcclusionBuffer::Build(const BSPTree& tree, const Vec2& viewpoint)
+{
+	PROFILE_SCOPE("OcclusionBuffer::Build");
+
+	m_viewpoint = viewpoint;
+	m_numBinsFilled = 0;
+	for(int bin_idx = 0; bin_idx < OCCLUSION_BUFFER_NUM_BINS; ++bin_idx)
+	{
+		m_binDepths[bin_idx] = INFINITY;
+	}
+
+	m_iterator.Reset(tree, viewpoint, BSP_FRONT_TO_BACK);
+	int node_idx = -1;
+	while(m_numBinsFilled < OCCLUSION_BUFFER_NUM_BINS && m_iterator.Next(node_idx))
+	{
+		const BSPNode& node = tree.GetNode(node_idx);
+		if(!node.m_isLeaf)
+		{
+			AddOccluder(node.m_segment);
+		}
+	}
+}
+
+
+// returns how many shapes are hidden, the rest get their flag cleared
+int OcclusionBuffer::CullShapes(ShapeComponents& shapes) const
+{
+	PROFILE_SCOPE("OcclusionBuffer::CullShapes");
+
+	int num_culled = 0;
+	const int num_shapes = shapes.GetCount();
+	for(int shape_idx = 0; shape_idx < num_shapes; ++shape_idx)
+	{
+		if(IsDiscHidden(shapes.m_positions[shape_idx], shapes.m_scales[shape_idx]))
+		{
+			shapes.m_flags[shape_idx] |= SHAPE_FLAG_OCCLUDED;
+			++num_culled;
+		}
+		else
+		{
+			shapes.m_flags[shape_idx] &= ~SHAPE_FLAG_OCCLUDED;
+		}
+	}
+
+	return num_culled;
+}
+
+
+void OcclusionBuffer::ClearCulling(ShapeComponents& shapes) const
+{
+	const int num_shapes = shapes.GetCount();
+	for(int shape_idx = 0; shape_idx < num_shapes; ++shape_idx)
+	{
+		shapes.m_flags[shape_idx] &= ~SHAPE_FLAG_OCCLUDED;
+	}
+}
+
+
+// only bins the segment covers completely take its depth, and only if nothing nearer got there first
+void OcclusionBuffer::AddOccluder(const Segment2& segment)
+{
+	Vec2 to_start = segment.m_start - m_viewpoint;
+	Vec2 to_end = segment.m_end - m_viewpoint;
+
+	const float winding = to_start.x * to_end.y - to_start.y * to_end.x;
+	if(winding == 0.0f)
+	{
+		return;
+	}
+
+	if(winding < 0.0f)
+	{
+		const Vec2 swap = to_start;
+		to_start = to_end;
+		to_end = swap;
+	}
+
+	const float start_distance_sqr = to_start.GetLengthSquared();
+	const float end_distance_sqr = to_end.GetLengthSquared();
+	const float far_depth = sqrtf(start_distance_sqr > end_distance_sqr ? start_distance_sqr : end_distance_sqr);
+
+	// first and last bins the segment spans edge to edge, counter clockwise from start
+	const float start_angle = atan2f(to_start.y, to_start.x) + OCCLUSION_PI;
+	float end_angle = atan2f(to_end.y, to_end.x) + OCCLUSION_PI;
+	if(end_angle < start_angle)
+	{
+		end_angle += 2.0f * OCCLUSION_PI;
+	}
+
+	const int first_bin = static_cast<int>(ceilf(start_angle / OCCLUSION_BIN_ANGLE));
+	const int end_bin = static_cast<int>(floorf(end_angle / OCCLUSION_BIN_ANGLE));
+
+	for(int bin = first_bin; bin < end_bin; ++bin)
+	{
+		const int bin_idx = bin % OCCLUSION_BUFFER_NUM_BINS;
+		if(m_binDepths[bin_idx] == INFINITY)
+		{
+			m_binDepths[bin_idx] = far_depth;
+			++m_numBinsFilled;
+		}
+	}
+}
+
+
+bool OcclusionBuffer::IsDiscHidden(const Vec2& center, const float radius) const
+{
+	const Vec2 to_center = center - m_viewpoint;
+	const float distance = to_center.GetLength();
+	if(distance <= radius)
+	{
+		return false;
+	}
+
+	const float near_depth = distance - radius;
+	const float center_angle = atan2f(to_center.y, to_center.x);
+	const float half_width = asinf(radius / distance);
+
+	const int first_bin = GetBin(center_angle - half_width);
+	int last_bin = GetBin(center_angle + half_width);
+	if(last_bin < first_bin)
+	{
+		last_bin += OCCLUSION_BUFFER_NUM_BINS;
+	}
+
+	for(int bin = first_bin; bin <= last_bin; ++bin)
+	{
+		if(m_binDepths[bin % OCCLUSION_BUFFER_NUM_BINS] >= near_depth)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+int OcclusionBuffer::GetBin(float angle) const
+{
+	angle += OCCLUSION_PI;
+	if(angle < 0.0f)
+	{
+		angle += 2.0f * OCCLUSION_PI;
+	}
+
+	const int bin = static_cast<int>(angle / OCCLUSION_BIN_ANGLE);
+	return ClampInt(bin % OCCLUSION_BUFFER_NUM_BINS, 0, OCCLUSION_BUFFER_NUM_BINS - 1);
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include "Engine/Math/Vec2.hpp"
+
+#include "Game/BSPTree.hpp"
+
+#include <vector>
+
+struct ShapeComponents;
+
+constexpr int OCCLUSION_BUFFER_NUM_BINS = 1'024;
+
+// Coarse 1D depth buffer around a viewpoint. Each angular bin keeps the far distance of the first wall
+// that spans all of it, walls arrive front to back so that is the nearest one. A shape whose bounding
+// disc is further away than that in every bin it touches cannot be seen.
+class OcclusionBuffer
+{
+public:
+	OcclusionBuffer();
+	~OcclusionBuffer();
+
+	void	Build(const BSPTree& tree, const Vec2& viewpoint);
+	int		CullShapes(ShapeComponents& shapes) const;
+	void	ClearCulling(ShapeComponents& shapes) const;
+
+	int		GetNumBinsFilled() const	{ return m_numBinsFilled; }
+
+private:
+	void	AddOccluder(const Segment2& segment);
+	bool	IsDiscHidden(const Vec2& center, float radius) const;
+	int		GetBin(float angle) const;
+
+private:
+	Vec2		m_viewpoint;
+	float		m_binDepths[OCCLUSION_BUFFER_NUM_BINS];
+	int			m_numBinsFilled = 0;
+	BSPIterator	m_iterator;
+};
@@ -3,23 +3,21 @@
 #include "Game/Point.hpp"
 #include "Game/GameCommon.hpp"
 #include "Game/Game.hpp"
+#include "Game/MemoryTags.hpp"
 
 
 Point::Point(Game* the_game): Entity(the_game)
 {
-	m_scale = 0.4f;
-
 	CPUMesh disc_mesh;
 	CpuMeshAddDisc(&disc_mesh, Rgba(1.0f,0.0f, 0.5f, 1.0f), 1.0f);
-	m_mesh = new GPUMesh(g_theRenderer);
+	m_mesh = TaggedNew<GPUMesh>(MEM_TAG_MESHES, g_theRenderer);
 	m_mesh->CreateFromCPUMesh<Vertex_PCU>(disc_mesh); // we won't be updated this;
 }
 
 
 Point::~Point()
 {
-	delete m_mesh;
-	m_mesh = nullptr;
+	TaggedDelete(MEM_TAG_MESHES, m_mesh);
 }
 
 
@@ -71,3 +69,21 @@ bool Point::DestroyEntity()
 {
 	return false;
 }
+
+
+Vec2 Point::GetPosition() const
+{
+	return m_position;
+}
+
+
+float Point::GetOrientationDegrees() const
+{
+	return 0.0f;
+}
+
+
+float Point::GetScale() const
+{
+	return m_scale;
+}
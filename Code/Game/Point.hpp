@@ -16,4 +16,13 @@ public:
 	void DrawEntity() const override;
 	
 	bool DestroyEntity() override;
+
+	Vec2	GetPosition() const override;
+	float	GetOrientationDegrees() const override;
+	float	GetScale() const override;
+
+private:
+	GPUMesh* m_mesh = nullptr;
+	Vec2 m_position = Vec2::ZERO;	// follows the mouse
+	float m_scale = 0.4f;
 };
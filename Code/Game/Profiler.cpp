@@ -0,0 +1,163 @@
+#include "Game/Profiler.hpp"
+
+#include <chrono>
+#include <vector>
+
+static std::atomic<ProfilerThreadBuffer*>	s_profilerBufferList{ nullptr };
+static std::atomic<uint>					s_profilerNextThreadId{ 0 };
+thread_local ProfilerThreadBuffer*			t_profilerBuffer = nullptr;
+
+
+ProfileScope::ProfileScope(const char* name): m_name(name)
+{
+	ProfilerThreadBuffer* buffer = ProfilerGetThreadBuffer();
+	++buffer->m_depth;
+	m_startTicks = ProfilerGetTicks();
+}
+
+
+ProfileScope::~ProfileScope()
+{
+	const uint64_t end_ticks = ProfilerGetTicks();
+	ProfilerThreadBuffer* buffer = t_profilerBuffer;
+
+	// only this thread writes here, the release store is what makes the slot visible to the exporter
+	const uint64_t write_count = buffer->m_writeCount.load(std::memory_order_relaxed);
+	ProfileEvent& slot = buffer->m_events[write_count & PROFILER_RING_MASK];
+	slot.m_name = m_name;
+	slot.m_startTicks = m_startTicks;
+	slot.m_endTicks = end_ticks;
+	slot.m_depth = --buffer->m_depth;
+	buffer->m_writeCount.store(write_count + 1, std::memory_order_release);
+}
+
+
+uint64_t ProfilerGetTicks()
+{
+	return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+}
+
+
+double ProfilerTicksToMicroseconds(const uint64_t ticks)
+{
+	constexpr double TICKS_TO_MICROSECONDS = 1'000'000.0
+		* static_cast<double>(std::chrono::steady_clock::period::num)
+		/ static_cast<double>(std::chrono::steady_clock::period::den);
+
+	return static_cast<double>(ticks) * TICKS_TO_MICROSECONDS;
+}
+
+
+ProfilerThreadBuffer* ProfilerGetThreadBuffer()
+{
+	if(t_profilerBuffer == nullptr)
+	{
+		ProfilerThreadBuffer* buffer = new ProfilerThreadBuffer();
+		buffer->m_threadId = s_profilerNextThreadId.fetch_add(1, std::memory_order_relaxed);
+
+		// lock free push onto the global list, the exporter only ever walks it
+		ProfilerThreadBuffer* head = s_profilerBufferList.load(std::memory_order_relaxed);
+		do
+		{
+			buffer->m_next = head;
+		}
+		while(!s_profilerBufferList.compare_exchange_weak(head, buffer, std::memory_order_release, std::memory_order_relaxed));
+
+		t_profilerBuffer = buffer;
+	}
+
+	return t_profilerBuffer;
+}
+
+
+// every thread that recorded events must be finished before this is called
+void ProfilerShutdown()
+{
+	ProfilerThreadBuffer* buffer = s_profilerBufferList.exchange(nullptr, std::memory_order_acquire);
+	while(buffer != nullptr)
+	{
+		ProfilerThreadBuffer* next = buffer->m_next;
+		delete buffer;
+		buffer = next;
+	}
+
+	t_profilerBuffer = nullptr;
+}
+
+
+// returns the number of events written, or -1 if the file could not be opened
+int ProfilerExportChromeTrace(const char* file_path)
+{
+	struct ExportEvent
+	{
+		ProfileEvent m_event;
+		uint m_threadId = 0;
+	};
+
+	std::vector<ExportEvent> events;
+	uint64_t base_ticks = UINT64_MAX;
+
+	ProfilerThreadBuffer* buffer = s_profilerBufferList.load(std::memory_order_acquire);
+	while(buffer != nullptr)
+	{
+		const uint64_t count_before = buffer->m_writeCount.load(std::memory_order_acquire);
+		const uint64_t first = count_before > PROFILER_RING_SIZE ? count_before - PROFILER_RING_SIZE : 0;
+		const size_t thread_start = events.size();
+
+		for(uint64_t event_idx = first; event_idx < count_before; ++event_idx)
+		{
+			ExportEvent export_event;
+			export_event.m_event = buffer->m_events[event_idx & PROFILER_RING_MASK];
+			export_event.m_threadId = buffer->m_threadId;
+			events.push_back(export_event);
+		}
+
+		// anything the writer may have lapped while we were copying is discarded
+		const uint64_t count_after = buffer->m_writeCount.load(std::memory_order_acquire);
+		const uint64_t safe_first = count_after + 1 > PROFILER_RING_SIZE ? count_after + 1 - PROFILER_RING_SIZE : 0;
+		if(safe_first > first)
+		{
+			const size_t num_stale = static_cast<size_t>(safe_first - first);
+			const size_t num_copied = events.size() - thread_start;
+			events.erase(events.begin() + thread_start, events.begin() + thread_start + (num_stale < num_copied ? num_stale : num_copied));
+		}
+
+		for(size_t event_idx = thread_start; event_idx < events.size(); ++event_idx)
+		{
+			if(events[event_idx].m_event.m_startTicks < base_ticks)
+			{
+				base_ticks = events[event_idx].m_event.m_startTicks;
+			}
+		}
+
+		buffer = buffer->m_next;
+	}
+
+	FILE* file = nullptr;
+	const errno_t err = fopen_s(&file, file_path, "wb");
+	if(err != 0 || file == nullptr)
+	{
+		return -1;
+	}
+
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	const int num_events = static_cast<int>(events.size());
+	for(int event_idx = 0; event_idx < num_events; ++event_idx)
+	{
+		const ExportEvent& export_event = events[event_idx];
+		const double start_us = ProfilerTicksToMicroseconds(export_event.m_event.m_startTicks - base_ticks);
+		const double duration_us = ProfilerTicksToMicroseconds(export_event.m_event.m_endTicks - export_event.m_event.m_startTicks);
+
+		fprintf(file, "{\"name\":\"%s\",\"cat\":\"game\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"depth\":%u}}%s\n",
+			export_event.m_event.m_name,
+			export_event.m_threadId,
+			start_us,
+			duration_us,
+			export_event.m_event.m_depth,
+			event_idx + 1 < num_events ? "," : "");
+	}
+	fprintf(file, "]}\n");
+	fclose(file);
+
+	return num_events;
+}
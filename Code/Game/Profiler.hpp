@@ -0,0 +1,60 @@
+#pragma once
+#include "Game/GameCommon.hpp"
+
+#include <atomic>
+#include <cstdint>
+
+// Uncomment to compile every PROFILE_SCOPE down to nothing
+//#define PROFILER_DISABLED
+
+constexpr uint PROFILER_RING_SIZE = 16'384; // events kept per thread, must be a power of two
+constexpr uint PROFILER_RING_MASK = PROFILER_RING_SIZE - 1;
+static_assert((PROFILER_RING_SIZE & PROFILER_RING_MASK) == 0, "PROFILER_RING_SIZE must be a power of two");
+
+struct ProfileEvent
+{
+	const char*	m_name = nullptr;	// must be a string literal, we only keep the pointer
+	uint64_t	m_startTicks = 0;
+	uint64_t	m_endTicks = 0;
+	uint		m_depth = 0;
+};
+
+// One per thread. Only the owning thread writes, so publishing an event is a plain store followed
+// by a release of the write count. Readers copy a window and drop anything the writer lapped.
+struct ProfilerThreadBuffer
+{
+	ProfileEvent				m_events[PROFILER_RING_SIZE];
+	std::atomic<uint64_t>		m_writeCount{ 0 };
+	uint						m_threadId = 0;
+	uint						m_depth = 0;
+	ProfilerThreadBuffer*		m_next = nullptr;
+};
+
+class ProfileScope
+{
+public:
+	explicit ProfileScope(const char* name);
+	~ProfileScope();
+
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+	const char*	m_name = nullptr;
+	uint64_t	m_startTicks = 0;
+};
+
+uint64_t	ProfilerGetTicks();
+double		ProfilerTicksToMicroseconds(uint64_t ticks);
+
+ProfilerThreadBuffer*	ProfilerGetThreadBuffer();
+void					ProfilerShutdown();
+int						ProfilerExportChromeTrace(const char* file_path);
+
+#if defined(PROFILER_DISABLED)
+	#define PROFILE_SCOPE(name)
+#else
+	#define PROFILE_SCOPE_CONCAT_INNER(a, b) a##b
+	#define PROFILE_SCOPE_CONCAT(a, b) PROFILE_SCOPE_CONCAT_INNER(a, b)
+	#define PROFILE_SCOPE(name) ProfileScope PROFILE_SCOPE_CONCAT(profile_scope_, __LINE__)(name)
+#endif
@@ -0,0 +1,80 @@
+#include "Game/QueryCounters.hpp"
+
+static std::atomic<QueryCounterBlock*>	s_queryCounterBlockList{ nullptr };
+static uint64_t							s_queryCounterLastTotals[NUM_QUERY_COUNTERS] = {};
+thread_local QueryCounterBlock*			t_queryCounterBlock = nullptr;
+
+
+QueryCounterBlock* QueryCountersGetThreadBlock()
+{
+	if(t_queryCounterBlock == nullptr)
+	{
+		QueryCounterBlock* block = new QueryCounterBlock();
+
+		// same lock free push as the profiler's buffers, the gather only ever walks the list
+		QueryCounterBlock* head = s_queryCounterBlockList.load(std::memory_order_relaxed);
+		do
+		{
+			block->m_next = head;
+		}
+		while(!s_queryCounterBlockList.compare_exchange_weak(head, block, std::memory_order_release, std::memory_order_relaxed));
+
+		t_queryCounterBlock = block;
+	}
+
+	return t_queryCounterBlock;
+}
+
+
+// blocks only ever grow, so the frame's count is this gather's total less the last one's
+void QueryCountersGatherFrame(QueryCounterFrame& out_frame)
+{
+	uint64_t totals[NUM_QUERY_COUNTERS] = {};
+	for(const QueryCounterBlock* block = s_queryCounterBlockList.load(std::memory_order_acquire); block != nullptr; block = block->m_next)
+	{
+		for(int counter_idx = 0; counter_idx < NUM_QUERY_COUNTERS; ++counter_idx)
+		{
+			totals[counter_idx] += block->m_counts[counter_idx].load(std::memory_order_relaxed);
+		}
+	}
+
+	for(int counter_idx = 0; counter_idx < NUM_QUERY_COUNTERS; ++counter_idx)
+	{
+		out_frame.m_counts[counter_idx] = totals[counter_idx] - s_queryCounterLastTotals[counter_idx];
+		s_queryCounterLastTotals[counter_idx] = totals[counter_idx];
+	}
+}
+
+
+// every thread that counted must be finished before this is called
+void QueryCountersShutdown()
+{
+	QueryCounterBlock* block = s_queryCounterBlockList.exchange(nullptr, std::memory_order_acquire);
+	while(block != nullptr)
+	{
+		QueryCounterBlock* next = block->m_next;
+		delete block;
+		block = next;
+	}
+
+	for(int counter_idx = 0; counter_idx < NUM_QUERY_COUNTERS; ++counter_idx)
+	{
+		s_queryCounterLastTotals[counter_idx] = 0;
+	}
+	t_queryCounterBlock = nullptr;
+}
+
+
+const char* GetQueryCounterName(const QueryCounter counter)
+{
+	switch(counter)
+	{
+		case QUERY_CAN_SEE:					return "CanSee queries";
+		case QUERY_BSP_NODES_VISITED:		return "BSP nodes visited";
+		case QUERY_RAY_SHAPE_TESTS:			return "Ray shape tests";
+		case QUERY_RAY_PLANES_TESTED:		return "Ray planes tested";
+		case QUERY_DISC_REJECTIONS:			return "Disc rejections";
+		case QUERY_POINT_IN_SHAPE_TESTS:	return "Point in shape tests";
+		default:							return "Unknown";
+	}
+}
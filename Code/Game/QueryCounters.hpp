@@ -0,0 +1,57 @@
+#pragma once
+#include "Game/GameCommon.hpp"
+
+#include <atomic>
+#include <cstdint>
+
+// Counts of the work queries do, compiled in for debug builds only. Define QUERY_COUNTERS_DISABLED
+// to drop them from a debug build as well.
+#if defined(_DEBUG) && !defined(QUERY_COUNTERS_DISABLED)
+	#define QUERY_COUNTERS_ENABLED
+#endif
+
+enum QueryCounter
+{
+	QUERY_CAN_SEE,				// BSP line of sight queries
+	QUERY_BSP_NODES_VISITED,
+	QUERY_RAY_SHAPE_TESTS,		// RaycastShape calls, which took over from Game::RayToConvexShape
+	QUERY_RAY_PLANES_TESTED,
+	QUERY_DISC_REJECTIONS,		// shapes thrown out by their bounding disc before any plane
+	QUERY_POINT_IN_SHAPE_TESTS,
+	NUM_QUERY_COUNTERS
+};
+
+// One per thread. Only the owning thread writes, with relaxed load and store rather than a locked
+// add, and the frame gather reads every thread's running totals.
+struct QueryCounterBlock
+{
+	std::atomic<uint64_t>	m_counts[NUM_QUERY_COUNTERS] = {};
+	QueryCounterBlock*		m_next = nullptr;
+};
+
+// totals across every thread since the last gather
+struct QueryCounterFrame
+{
+	uint64_t	m_counts[NUM_QUERY_COUNTERS] = {};
+};
+
+QueryCounterBlock*	QueryCountersGetThreadBlock();
+void				QueryCountersGatherFrame(QueryCounterFrame& out_frame);
+void				QueryCountersShutdown();
+const char*			GetQueryCounterName(QueryCounter counter);
+
+
+inline void QueryCountersAdd(const QueryCounter counter, const uint64_t amount)
+{
+	std::atomic<uint64_t>& count = QueryCountersGetThreadBlock()->m_counts[counter];
+	count.store(count.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+
+#if defined(QUERY_COUNTERS_ENABLED)
+	#define QUERY_COUNT(counter) QueryCountersAdd(counter, 1)
+	#define QUERY_COUNT_N(counter, amount) QueryCountersAdd(counter, static_cast<uint64_t>(amount))
+#else
+	#define QUERY_COUNT(counter)
+	#define QUERY_COUNT_N(counter, amount)
+#endif
@@ -0,0 +1,162 @@
+#include "Game/ReflectionPaths.hpp"
+#include "Game/MemoryTags.hpp"
+#include "Game/Profiler.hpp"
+#include "Game/ShapeGrid.hpp"
+#include "Game/WorkerThreads.hpp"
+
+#include "Engine/Math/MathUtils.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+constexpr float REFLECTION_SURFACE_OFFSET = 0.001f;				// keeps the next leg from finding the surface it just left
+constexpr int REFLECTION_BLOCK_SIZE = 64;						// emitters a thread takes at a time
+constexpr int REFLECTION_MIN_EMITTERS_PER_THREAD = 256;			// below this the threads cost more than they save
+
+
+void ReflectionPathBuffer::Clear()
+{
+	m_points.clear();
+	m_pathStarts.clear();
+	m_pathStarts.push_back(0);
+}
+
+
+int ReflectionPathBuffer::GetNumPaths() const
+{
+	return static_cast<int>(m_pathStarts.size()) - 1;
+}
+
+
+int ReflectionPathBuffer::GetPathStart(const int path_idx) const
+{
+	return m_pathStarts[path_idx];
+}
+
+
+int ReflectionPathBuffer::GetPathNumPoints(const int path_idx) const
+{
+	return m_pathStarts[path_idx + 1] - m_pathStarts[path_idx];
+}
+
+//--------------------------------------------------------------------
+
+static void TracePath(const ShapeGrid& grid, const ShapeComponents& shapes, const ShapePrototypeLibrary& prototypes,
+	const Ray2& emitter, const int max_bounces, const float max_length, ReflectionPathBuffer& out_paths)
+{
+	Vec2 pos = emitter.m_pos;
+	Vec2 dir = emitter.m_dir.GetNormalized();
+	float length_left = max_length;
+
+	out_paths.m_points.push_back(pos);
+
+	for(int bounce_idx = 0; bounce_idx <= max_bounces; ++bounce_idx)
+	{
+		ShapeRayHit hit;
+		if(!grid.RaycastClosest(shapes, prototypes, Ray2(pos, dir), length_left, hit))
+		{
+			out_paths.m_points.push_back(pos + dir * length_left);
+			break;
+		}
+
+		pos = pos + dir * hit.m_t;
+		length_left -= hit.m_t;
+		out_paths.m_points.push_back(pos);
+
+		if(hit.m_planeIdx == -1 || bounce_idx == max_bounces)
+		{
+			break;
+		}
+
+		dir = ReflectVectorOffSurfaceNormal(dir, hit.m_normal);
+		pos = pos + hit.m_normal * REFLECTION_SURFACE_OFFSET;
+	}
+
+	out_paths.m_pathStarts.push_back(static_cast<int>(out_paths.m_points.size()));
+}
+
+//--------------------------------------------------------------------
+
+ReflectionTracer::ReflectionTracer() = default;
+
+
+ReflectionTracer::~ReflectionTracer()
+{
+	TaggedDelete(MEM_TAG_SCRATCH, m_workers);
+}
+
+
+void ReflectionTracer::Trace(const ShapeGrid& grid, const ShapeComponents& shapes, const ShapePrototypeLibrary& prototypes,
+	const Ray2* emitters, const int num_emitters, const int max_bounces, const float max_length, ReflectionPathBuffer& out_paths, int num_threads)
+{
+	PROFILE_SCOPE("ReflectionTracer::Trace");
+	const uint64_t start_ticks = ProfilerGetTicks();
+
+	if(num_threads <= 0)
+	{
+		num_threads = static_cast<int>(std::thread::hardware_concurrency());
+	}
+	num_threads = std::max(1, std::min(num_threads, num_emitters / REFLECTION_MIN_EMITTERS_PER_THREAD));
+
+	if(num_threads > 1 && (m_workers == nullptr || m_workers->GetNumThreads() != num_threads))
+	{
+		TaggedDelete(MEM_TAG_SCRATCH, m_workers);
+		m_workers = TaggedNew<WorkerThreads>(MEM_TAG_SCRATCH, num_threads);
+	}
+
+	// the buffers are kept across traces, so a steady frame reuses their capacity
+	const int num_blocks = (num_emitters + REFLECTION_BLOCK_SIZE - 1) / REFLECTION_BLOCK_SIZE;
+	if(static_cast<int>(m_blockPaths.size()) < num_blocks)
+	{
+		m_blockPaths.resize(num_blocks);
+	}
+
+	std::atomic<int> next_block { 0 };
+	const auto worker = [&](const int thread_idx)
+	{
+		UNUSED(thread_idx);
+		for(int block_idx = next_block.fetch_add(1, std::memory_order_relaxed); block_idx < num_blocks;
+			block_idx = next_block.fetch_add(1, std::memory_order_relaxed))
+		{
+			ReflectionPathBuffer& block_paths = m_blockPaths[block_idx];
+			block_paths.Clear();
+
+			const int end_idx = std::min(num_emitters, (block_idx + 1) * REFLECTION_BLOCK_SIZE);
+			for(int emitter_idx = block_idx * REFLECTION_BLOCK_SIZE; emitter_idx < end_idx; ++emitter_idx)
+			{
+				TracePath(grid, shapes, prototypes, emitters[emitter_idx], max_bounces, max_length, block_paths);
+			}
+		}
+	};
+
+	if(num_threads > 1)
+	{
+		m_workers->Run(worker);
+	}
+	else
+	{
+		worker(0);
+	}
+
+	size_t num_points = 0;
+	for(int block_idx = 0; block_idx < num_blocks; ++block_idx)
+	{
+		num_points += m_blockPaths[block_idx].m_points.size();
+	}
+
+	out_paths.Clear();
+	out_paths.m_points.reserve(num_points);
+	out_paths.m_pathStarts.reserve(num_emitters + 1);
+	for(int block_idx = 0; block_idx < num_blocks; ++block_idx)
+	{
+		const ReflectionPathBuffer& block_paths = m_blockPaths[block_idx];
+		const int point_offset = static_cast<int>(out_paths.m_points.size());
+		out_paths.m_points.insert(out_paths.m_points.end(), block_paths.m_points.begin(), block_paths.m_points.end());
+		for(int path_idx = 1; path_idx < static_cast<int>(block_paths.m_pathStarts.size()); ++path_idx)
+		{
+			out_paths.m_pathStarts.push_back(point_offset + block_paths.m_pathStarts[path_idx]);
+		}
+	}
+
+	m_lastTraceMs = ProfilerTicksToMicroseconds(ProfilerGetTicks() - start_ticks) * 0.001;
+}
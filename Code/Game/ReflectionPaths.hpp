@@ -0,0 +1,49 @@
+#pragma once
+#include "Engine/Math/Ray2.hpp"
+#include "Engine/Math/Vec2.hpp"
+
+#include <vector>
+
+struct ShapeComponents;
+class ShapeGrid;
+class ShapePrototypeLibrary;
+class WorkerThreads;
+
+// Every traced path as one polyline, stored back to back. Path i is
+// m_points[m_pathStarts[i]] up to m_points[m_pathStarts[i + 1]].
+struct ReflectionPathBuffer
+{
+public:
+	void		Clear();
+	int			GetNumPaths() const;
+	int			GetPathStart(int path_idx) const;
+	int			GetPathNumPoints(int path_idx) const;
+
+public:
+	std::vector<Vec2>	m_points;
+	std::vector<int>	m_pathStarts = { 0 };
+};
+
+// Bounces each emitter off the shapes up to max_bounces times, using the grid for every closest hit.
+// A path ends when it misses, starts inside a shape, or has travelled max_length. Emitters are taken
+// a block at a time by every thread, each block fills its own buffer, and the blocks are joined in
+// emitter order afterwards. The threads are started by the first threaded trace and sleep between.
+class ReflectionTracer
+{
+public:
+	ReflectionTracer();
+	~ReflectionTracer();
+
+	ReflectionTracer(const ReflectionTracer&) = delete;		// owns its worker threads
+	ReflectionTracer& operator=(const ReflectionTracer&) = delete;
+
+	void	Trace(const ShapeGrid& grid, const ShapeComponents& shapes, const ShapePrototypeLibrary& prototypes,
+				const Ray2* emitters, int num_emitters, int max_bounces, float max_length, ReflectionPathBuffer& out_paths, int num_threads = 0);
+
+	double	GetLastTraceMs() const		{ return m_lastTraceMs; }
+
+private:
+	std::vector<ReflectionPathBuffer>	m_blockPaths;
+	WorkerThreads*						m_workers = nullptr;
+	double								m_lastTraceMs = 0.0;
+};
@@ -0,0 +1,243 @@
+#include "Game/ScenarioRunner.hpp"
+#include "Game/Game.hpp"
+#include "Game/Profiler.hpp"
+
+#include "Engine/Core/XmlUtils.hpp"
+#include "Engine/Renderer/ImGUISystem.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+constexpr double SCENARIO_FRAME_SECONDS = 1.0 / 60.0;
+
+
+static double TicksToMs(const uint64_t ticks)
+{
+	return ProfilerTicksToMicroseconds(ticks) * 0.001;
+}
+
+
+static BspHeuristic ParseHeuristic(const char* name)
+{
+	if(name != nullptr && strcmp(name, "score") == 0)
+	{
+		return HEURISTIC_SCORE;
+	}
+
+	return HEURISTIC_RANDOM;
+}
+
+
+static const char* GetHeuristicName(const BspHeuristic heuristic)
+{
+	return heuristic == HEURISTIC_SCORE ? "score" : "random";
+}
+
+
+// sorted must be ascending, percentile in [0, 1]
+static double GetPercentile(const std::vector<double>& sorted, const double percentile)
+{
+	if(sorted.empty())
+	{
+		return 0.0;
+	}
+
+	const size_t rank = static_cast<size_t>(percentile * static_cast<double>(sorted.size() - 1) + 0.5);
+	return sorted[rank];
+}
+
+//--------------------------------------------------------------------
+
+ScenarioRunner::ScenarioRunner() = default;
+ScenarioRunner::~ScenarioRunner() = default;
+
+
+// missing attributes keep ScenarioConfig's defaults, a scenario without a name is named by position
+bool ScenarioRunner::LoadScenarios(const char* file_path)
+{
+	m_scenarios.clear();
+	m_results.clear();
+
+	tinyxml2::XMLDocument document;
+	if(document.LoadFile(file_path) != tinyxml2::XML_SUCCESS || document.RootElement() == nullptr)
+	{
+		return false;
+	}
+
+	const XmlElement* root = document.RootElement();
+	const char* output_path = root->Attribute("output");
+	if(output_path != nullptr)
+	{
+		m_outputPath = output_path;
+	}
+
+	const ScenarioConfig defaults;
+	for(const XmlElement* element = root->FirstChildElement("Scenario"); element != nullptr; element = element->NextSiblingElement("Scenario"))
+	{
+		ScenarioConfig config;
+		const char* name = element->Attribute("name");
+		config.m_name = name != nullptr ? name : "scenario_" + std::to_string(m_scenarios.size());
+		config.m_numShapes = element->IntAttribute("shapes", defaults.m_numShapes);
+		config.m_numRays = element->IntAttribute("rays", defaults.m_numRays);
+		config.m_heuristic = ParseHeuristic(element->Attribute("heuristic"));
+		config.m_numThreads = element->IntAttribute("threads", defaults.m_numThreads);
+		config.m_useLinearBvh = element->BoolAttribute("linearBvh", defaults.m_useLinearBvh);
+		config.m_seed = element->UnsignedAttribute("seed", defaults.m_seed);
+		config.m_numFrames = element->IntAttribute("frames", defaults.m_numFrames);
+		m_scenarios.push_back(config);
+	}
+
+	return !m_scenarios.empty();
+}
+
+
+void ScenarioRunner::AddResult(const ScenarioResult& result)
+{
+	m_results.push_back(result);
+}
+
+
+bool ScenarioRunner::WriteCsv(const char* file_path) const
+{
+	FILE* file = nullptr;
+	fopen_s(&file, file_path, "wb");
+	if(file == nullptr)
+	{
+		return false;
+	}
+
+	fprintf(file, "name,shapes,rays,heuristic,threads,linear_bvh,seed,frames,setup_ms,bsp_build_ms,bsp_nodes,"
+		"update_avg_ms,update_p50_ms,update_p95_ms,update_max_ms,first_hits,last_hits,total_hits\n");
+
+	for(const ScenarioResult& result : m_results)
+	{
+		const ScenarioConfig& config = result.m_config;
+		fprintf(file, "%s,%i,%i,%s,%i,%i,%u,%i,%.3f,%.3f,%i,%.4f,%.4f,%.4f,%.4f,%i,%i,%lld\n",
+			config.m_name.c_str(),
+			result.m_numShapes,
+			result.m_numRays,
+			GetHeuristicName(config.m_heuristic),
+			config.m_numThreads,
+			config.m_useLinearBvh ? 1 : 0,
+			config.m_seed,
+			config.m_numFrames,
+			result.m_setupMs,
+			result.m_bspBuildMs,
+			result.m_numBspNodes,
+			result.m_updateAverageMs,
+			result.m_updateP50Ms,
+			result.m_updateP95Ms,
+			result.m_updateMaxMs,
+			result.m_firstHits,
+			result.m_lastHits,
+			static_cast<long long>(result.m_totalHits));
+	}
+
+	fclose(file);
+	return true;
+}
+
+
+// names are written as given, they come from our own scenario files
+bool ScenarioRunner::WriteJson(const char* file_path) const
+{
+	FILE* file = nullptr;
+	fopen_s(&file, file_path, "wb");
+	if(file == nullptr)
+	{
+		return false;
+	}
+
+	fprintf(file, "{\n\t\"scenarios\": [\n");
+
+	const int num_results = static_cast<int>(m_results.size());
+	for(int result_idx = 0; result_idx < num_results; ++result_idx)
+	{
+		const ScenarioResult& result = m_results[result_idx];
+		const ScenarioConfig& config = result.m_config;
+		fprintf(file, "\t\t{\"name\": \"%s\", \"shapes\": %i, \"rays\": %i, \"heuristic\": \"%s\", \"threads\": %i, \"linearBvh\": %s, \"seed\": %u, \"frames\": %i,\n",
+			config.m_name.c_str(),
+			result.m_numShapes,
+			result.m_numRays,
+			GetHeuristicName(config.m_heuristic),
+			config.m_numThreads,
+			config.m_useLinearBvh ? "true" : "false",
+			config.m_seed,
+			config.m_numFrames);
+		fprintf(file, "\t\t\"setupMs\": %.3f, \"bspBuildMs\": %.3f, \"bspNodes\": %i,\n",
+			result.m_setupMs,
+			result.m_bspBuildMs,
+			result.m_numBspNodes);
+		fprintf(file, "\t\t\"updateAvgMs\": %.4f, \"updateP50Ms\": %.4f, \"updateP95Ms\": %.4f, \"updateMaxMs\": %.4f,\n",
+			result.m_updateAverageMs,
+			result.m_updateP50Ms,
+			result.m_updateP95Ms,
+			result.m_updateMaxMs);
+		fprintf(file, "\t\t\"firstHits\": %i, \"lastHits\": %i, \"totalHits\": %lld}%s\n",
+			result.m_firstHits,
+			result.m_lastHits,
+			static_cast<long long>(result.m_totalHits),
+			result_idx + 1 < num_results ? "," : "");
+	}
+
+	fprintf(file, "\t]\n}\n");
+	fclose(file);
+	return true;
+}
+
+
+// each frame opens and throws away an ImGui frame, Game::Update writes its stats into one
+STATIC ScenarioResult ScenarioRunner::RunScenario(Game& game, const ScenarioConfig& config)
+{
+	PROFILE_SCOPE("ScenarioRunner::RunScenario");
+
+	ScenarioResult result;
+	result.m_config = config;
+
+	const uint64_t setup_start = ProfilerGetTicks();
+	game.SetupScenario(config.m_numShapes, config.m_numRays, config.m_seed, config.m_numThreads, config.m_useLinearBvh);
+	result.m_setupMs = TicksToMs(ProfilerGetTicks() - setup_start);
+	result.m_numShapes = game.GetShapeComponents().GetCount();
+	result.m_numRays = game.GetNumRays();
+
+	const uint64_t bsp_start = ProfilerGetTicks();
+	game.BuildBsp(config.m_heuristic);
+	result.m_bspBuildMs = TicksToMs(ProfilerGetTicks() - bsp_start);
+	result.m_numBspNodes = game.GetNumBspNodes();
+
+	std::vector<double> frame_ms;
+	frame_ms.reserve(config.m_numFrames);
+	for(int frame_idx = 0; frame_idx < config.m_numFrames; ++frame_idx)
+	{
+		game.BeginFrame();
+
+		const uint64_t update_start = ProfilerGetTicks();
+		game.Update(SCENARIO_FRAME_SECONDS);
+		frame_ms.push_back(TicksToMs(ProfilerGetTicks() - update_start));
+
+		ImGui::EndFrame();
+
+		const int num_hits = game.GetNumHits();
+		result.m_firstHits = frame_idx == 0 ? num_hits : result.m_firstHits;
+		result.m_lastHits = num_hits;
+		result.m_totalHits += num_hits;
+	}
+
+	if(!frame_ms.empty())
+	{
+		double total_ms = 0.0;
+		for(const double ms : frame_ms)
+		{
+			total_ms += ms;
+		}
+		result.m_updateAverageMs = total_ms / static_cast<double>(frame_ms.size());
+
+		std::sort(frame_ms.begin(), frame_ms.end());
+		result.m_updateP50Ms = GetPercentile(frame_ms, 0.50);
+		result.m_updateP95Ms = GetPercentile(frame_ms, 0.95);
+		result.m_updateMaxMs = frame_ms.back();
+	}
+
+	return result;
+}
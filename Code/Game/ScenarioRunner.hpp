@@ -0,0 +1,70 @@
+#pragma once
+#include "Game/BSPTree.hpp"
+#include "Game/GameCommon.hpp"
+
+#include <string>
+#include <vector>
+
+class Game;
+
+struct ScenarioConfig
+{
+	std::string		m_name;
+	int				m_numShapes = 64;
+	int				m_numRays = 256;
+	BspHeuristic	m_heuristic = HEURISTIC_RANDOM;
+	int				m_numThreads = 0;		// for the linear BVH build, 0 is one per hardware thread
+	bool			m_useLinearBvh = true;
+	uint			m_seed = 1;
+	int				m_numFrames = 120;
+};
+
+struct ScenarioResult
+{
+	ScenarioConfig	m_config;
+	int				m_numShapes = 0;		// after clamping to what the game allows
+	int				m_numRays = 0;
+	double			m_setupMs = 0.0;
+	double			m_bspBuildMs = 0.0;
+	int				m_numBspNodes = 0;
+	double			m_updateAverageMs = 0.0;
+	double			m_updateP50Ms = 0.0;
+	double			m_updateP95Ms = 0.0;
+	double			m_updateMaxMs = 0.0;
+	int				m_firstHits = 0;
+	int				m_lastHits = 0;
+	int64_t			m_totalHits = 0;
+};
+
+// Reads a list of scenarios from XML and runs each one through Game::Update without rendering or
+// input, at a fixed step. It is not headless: the game still needs the window, renderer and ImGui
+// context App made, shapes build their meshes and Update writes its stats into an ImGui frame, so
+// the timings include that work too. The file looks like
+//
+// <Scenarios output="Data/Log/scenarios">
+//   <Scenario name="dense" shapes="4096" rays="8192" heuristic="score" threads="4" seed="7" frames="300"/>
+// </Scenarios>
+//
+// and the results go to output.csv and output.json for capacity planning.
+class ScenarioRunner
+{
+public:
+	ScenarioRunner();
+	~ScenarioRunner();
+
+	bool	LoadScenarios(const char* file_path);
+	void	AddResult(const ScenarioResult& result);
+	bool	WriteCsv(const char* file_path) const;
+	bool	WriteJson(const char* file_path) const;
+
+	int						GetNumScenarios() const		{ return static_cast<int>(m_scenarios.size()); }
+	const ScenarioConfig&	GetScenario(int scenario_idx) const	{ return m_scenarios[scenario_idx]; }
+	const std::string&		GetOutputPath() const		{ return m_outputPath; }
+
+	static ScenarioResult	RunScenario(Game& game, const ScenarioConfig& config);
+
+private:
+	std::vector<ScenarioConfig>	m_scenarios;
+	std::vector<ScenarioResult>	m_results;
+	std::string					m_outputPath = "Data/Log/scenarios";
+};
@@ -0,0 +1,359 @@
+#include "Game/SceneSnapshot.hpp"
+#include "Game/ByteBufferWriter.hpp"
+#include "Game/ConvexShape.hpp"
+#include "Game/Profiler.hpp"
+#include "Game/ShapeComponents.hpp"
+#include "Game/ShapePrototypes.hpp"
+
+#include <cstdio>
+#include <limits>
+
+
+template<typename T>
+static void WriteSection(ByteBufferWriter& writer, const size_t table_offset, const SceneSectionId section_id, const T* values, const size_t count)
+{
+	writer.AlignTo(SCENE_SECTION_ALIGNMENT);
+	const size_t section_offset = writer.GetSize();
+	writer.WriteArray(values, count);
+
+	const size_t entry_offset = table_offset + section_id * 2 * sizeof(uint64_t);
+	writer.PatchValue<uint64_t>(entry_offset, section_offset);
+	writer.PatchValue<uint64_t>(entry_offset + sizeof(uint64_t), count * sizeof(T));
+}
+
+
+// the table has to promise exactly count values of T, anything else and the file is rejected
+template<typename T>
+static bool ViewSection(ByteBufferParser& parser, const uint64_t* table, const SceneSectionId section_id, const size_t count, BufferView<T>& out_view)
+{
+	const uint64_t offset = table[section_id * 2];
+	const uint64_t size = table[section_id * 2 + 1];
+	if(size != count * sizeof(T) || offset % SCENE_SECTION_ALIGNMENT != 0 || offset > parser.GetBufferSize() || size > parser.GetBufferSize() - offset)
+	{
+		return false;
+	}
+
+	parser.SetHead(static_cast<size_t>(offset));
+	out_view = parser.ParseView<T>(count);
+	return true;
+}
+
+//--------------------------------------------------------------------
+
+// only the header and the section table are parsed, everything else is checked for size and viewed
+bool SceneSnapshot::Read(const uchar* data, const size_t size)
+{
+	PROFILE_SCOPE("SceneSnapshot::Read");
+
+	ByteBufferParser parser(data, size);
+	constexpr size_t counts_size = 4 * sizeof(uint) + 3 * sizeof(int);
+	if(!parser.HasBytes(counts_size) || reinterpret_cast<uintptr_t>(data) % alignof(uint64_t) != 0)
+	{
+		return false;
+	}
+
+	parser.RequireBytes(counts_size);
+	const uint magic = parser.ParseValueUnchecked<uint>();
+	const uint version = parser.ParseValueUnchecked<uint>();
+	const uint file_endian = parser.ParseValueUnchecked<uint>();
+	const uint num_sections = parser.ParseValueUnchecked<uint>();
+	if(magic != SCENE_FILE_MAGIC || version != SCENE_FILE_VERSION
+		|| file_endian != static_cast<uint>(endian::ENDIAN_NATIVE) || num_sections != NUM_SCENE_SECTIONS)
+	{
+		return false;
+	}
+
+	m_numShapes = parser.ParseValueUnchecked<int>();
+	m_numPrototypes = parser.ParseValueUnchecked<int>();
+	m_numRays = parser.ParseValueUnchecked<int>();
+	if(m_numShapes < 0 || m_numPrototypes <= 0 || m_numPrototypes == std::numeric_limits<int>::max() || m_numRays < 0)
+	{
+		return false;
+	}
+
+	// the table starts on the next 8 byte boundary, a short file can end before or inside it
+	constexpr size_t table_size = NUM_SCENE_SECTIONS * 2 * sizeof(uint64_t);
+	const size_t table_offset = (parser.GetHead() + alignof(uint64_t) - 1) / alignof(uint64_t) * alignof(uint64_t);
+	if(table_offset > size)
+	{
+		return false;
+	}
+
+	parser.AlignHead(alignof(uint64_t));
+	if(!parser.HasBytes(table_size))
+	{
+		return false;
+	}
+	const uint64_t* table = parser.ParseView<uint64_t>(NUM_SCENE_SECTIONS * 2).m_data;
+
+	bool valid = ViewSection(parser, table, SCENE_SECTION_POINT_STARTS, static_cast<size_t>(m_numPrototypes) + 1, m_pointStarts);
+	if(!valid)
+	{
+		return false;
+	}
+
+	const int num_points = m_pointStarts[m_numPrototypes];
+	valid = valid && num_points >= 0;
+	valid = valid && ViewSection(parser, table, SCENE_SECTION_POSITIONS_X, m_numShapes, m_positionsX);
+	valid = valid && ViewSection(parser, table, SCENE_SECTION_POSITIONS_Y, m_numShapes, m_positionsY);
+	valid = valid && ViewSection(parser, table, SCENE_SECTION_ORIENTATIONS, m_numShapes, m_orientations);
+	valid = valid && ViewSection(parser, table, SCENE_SECTION_SCALES, m_numShapes, m_scales);
+	valid = valid && ViewSection(parser, table, SCENE_SECTION_PROTOTYPE_IDS, m_numShapes, m_prototypeIds);
+	valid = valid && ViewSection(parser, table, SCENE_SECTION_POINTS_X, num_points, m_pointsX);
+	valid = valid && ViewSection(parser, table, SCENE_SECTION_POINTS_Y, num_points, m_pointsY);
+	valid = valid && ViewSection(parser, table, SCENE_SECTION_RAY_POSITIONS_X, m_numRays, m_rayPositionsX);
+	valid = valid && ViewSection(parser, table, SCENE_SECTION_RAY_POSITIONS_Y, m_numRays, m_rayPositionsY);
+	valid = valid && ViewSection(parser, table, SCENE_SECTION_RAY_DIRECTIONS_X, m_numRays, m_rayDirectionsX);
+	valid = valid && ViewSection(parser, table, SCENE_SECTION_RAY_DIRECTIONS_Y, m_numRays, m_rayDirectionsY);
+	if(!valid)
+	{
+		return false;
+	}
+
+	// every polygon needs an area, and ids have to land inside the library
+	for(int prototype_idx = 0; prototype_idx < m_numPrototypes; ++prototype_idx)
+	{
+		const int64_t num_prototype_points = static_cast<int64_t>(m_pointStarts[prototype_idx + 1]) - m_pointStarts[prototype_idx];
+		if(m_pointStarts[prototype_idx] < 0 || num_prototype_points < 3)
+		{
+			return false;
+		}
+	}
+
+	// written as "not inside" so NaNs are thrown out as well
+	for(int shape_idx = 0; shape_idx < m_numShapes; ++shape_idx)
+	{
+		const float scale = m_scales[shape_idx];
+		if(m_prototypeIds[shape_idx] < 0 || m_prototypeIds[shape_idx] >= m_numPrototypes
+			|| !(scale >= ConvexShape2D::MIN_SIZE && scale <= ConvexShape2D::MAX_SIZE))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+STATIC void SceneSnapshot::Write(ByteBufferWriter& writer, const ShapeComponents& shapes, const ShapePrototypeLibrary& prototypes,
+	const Ray2* rays, const int num_rays)
+{
+	PROFILE_SCOPE("SceneSnapshot::Write");
+
+	const int num_shapes = shapes.GetCount();
+	const int num_prototypes = prototypes.GetNumPrototypes();
+
+	// Vec2 goes out as two float arrays, the file never depends on the engine's struct layout
+	std::vector<float> xs(num_shapes);
+	std::vector<float> ys(num_shapes);
+	std::vector<int> point_starts(num_prototypes + 1, 0);
+	for(int prototype_idx = 0; prototype_idx < num_prototypes; ++prototype_idx)
+	{
+		const int num_points = static_cast<int>(prototypes.GetPrototype(prototype_idx).m_polygon.m_points.size());
+		point_starts[prototype_idx + 1] = point_starts[prototype_idx] + num_points;
+	}
+
+	writer.Reserve(writer.GetSize() + SCENE_SECTION_ALIGNMENT * NUM_SCENE_SECTIONS
+		+ num_shapes * (4 * sizeof(float) + sizeof(int))
+		+ point_starts[num_prototypes] * 2 * sizeof(float)
+		+ num_rays * 4 * sizeof(float) + 256);
+
+	writer.WriteUnsignedInt(SCENE_FILE_MAGIC);
+	writer.WriteUnsignedInt(SCENE_FILE_VERSION);
+	writer.WriteUnsignedInt(static_cast<uint>(endian::ENDIAN_NATIVE));
+	writer.WriteUnsignedInt(NUM_SCENE_SECTIONS);
+	writer.WriteInt(num_shapes);
+	writer.WriteInt(num_prototypes);
+	writer.WriteInt(num_rays);
+
+	writer.AlignTo(alignof(uint64_t));
+	const size_t table_offset = writer.GetSize();
+	for(int entry_idx = 0; entry_idx < NUM_SCENE_SECTIONS * 2; ++entry_idx)
+	{
+		writer.ReserveSlot<uint64_t>();
+	}
+
+	for(int shape_idx = 0; shape_idx < num_shapes; ++shape_idx)
+	{
+		xs[shape_idx] = shapes.m_positions[shape_idx].x;
+		ys[shape_idx] = shapes.m_positions[shape_idx].y;
+	}
+	WriteSection(writer, table_offset, SCENE_SECTION_POSITIONS_X, xs.data(), num_shapes);
+	WriteSection(writer, table_offset, SCENE_SECTION_POSITIONS_Y, ys.data(), num_shapes);
+	WriteSection(writer, table_offset, SCENE_SECTION_ORIENTATIONS, shapes.m_orientationDegrees.data(), num_shapes);
+	WriteSection(writer, table_offset, SCENE_SECTION_SCALES, shapes.m_scales.data(), num_shapes);
+	WriteSection(writer, table_offset, SCENE_SECTION_PROTOTYPE_IDS, shapes.m_prototypeIds.data(), num_shapes);
+	WriteSection(writer, table_offset, SCENE_SECTION_POINT_STARTS, point_starts.data(), num_prototypes + 1);
+
+	xs.resize(point_starts[num_prototypes]);
+	ys.resize(point_starts[num_prototypes]);
+	for(int prototype_idx = 0; prototype_idx < num_prototypes; ++prototype_idx)
+	{
+		const std::vector<Vec2>& points = prototypes.GetPrototype(prototype_idx).m_polygon.m_points;
+		for(int point_idx = 0; point_idx < static_cast<int>(points.size()); ++point_idx)
+		{
+			xs[point_starts[prototype_idx] + point_idx] = points[point_idx].x;
+			ys[point_starts[prototype_idx] + point_idx] = points[point_idx].y;
+		}
+	}
+	WriteSection(writer, table_offset, SCENE_SECTION_POINTS_X, xs.data(), xs.size());
+	WriteSection(writer, table_offset, SCENE_SECTION_POINTS_Y, ys.data(), ys.size());
+
+	std::vector<float> ray_values[4];
+	for(std::vector<float>& values : ray_values)
+	{
+		values.resize(num_rays);
+	}
+	for(int ray_idx = 0; ray_idx < num_rays; ++ray_idx)
+	{
+		ray_values[0][ray_idx] = rays[ray_idx].m_pos.x;
+		ray_values[1][ray_idx] = rays[ray_idx].m_pos.y;
+		ray_values[2][ray_idx] = rays[ray_idx].m_dir.x;
+		ray_values[3][ray_idx] = rays[ray_idx].m_dir.y;
+	}
+	WriteSection(writer, table_offset, SCENE_SECTION_RAY_POSITIONS_X, ray_values[0].data(), num_rays);
+	WriteSection(writer, table_offset, SCENE_SECTION_RAY_POSITIONS_Y, ray_values[1].data(), num_rays);
+	WriteSection(writer, table_offset, SCENE_SECTION_RAY_DIRECTIONS_X, ray_values[2].data(), num_rays);
+	WriteSection(writer, table_offset, SCENE_SECTION_RAY_DIRECTIONS_Y, ray_values[3].data(), num_rays);
+}
+
+
+// one read of the whole file, vector storage is aligned well enough for every section type
+STATIC bool SceneSnapshot::LoadFile(const char* file_path, std::vector<uchar>& out_buffer)
+{
+	FILE* file = nullptr;
+	fopen_s(&file, file_path, "rb");
+	if(file == nullptr)
+	{
+		return false;
+	}
+
+	fseek(file, 0, SEEK_END);
+	const long file_size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	out_buffer.resize(file_size > 0 ? static_cast<size_t>(file_size) : 0);
+	const size_t num_read = fread(out_buffer.data(), 1, out_buffer.size(), file);
+	fclose(file);
+
+	return num_read == out_buffer.size();
+}
+
+//--------------------------------------------------------------------
+
+// one triangle prototype under num_shapes shapes, laid out the way Write lays out a real scene
+static void WriteTestScene(ByteBufferWriter& writer, const int num_shapes, const float scale)
+{
+	writer.WriteUnsignedInt(SCENE_FILE_MAGIC);
+	writer.WriteUnsignedInt(SCENE_FILE_VERSION);
+	writer.WriteUnsignedInt(static_cast<uint>(endian::ENDIAN_NATIVE));
+	writer.WriteUnsignedInt(NUM_SCENE_SECTIONS);
+	writer.WriteInt(num_shapes);
+	writer.WriteInt(1);
+	writer.WriteInt(0);
+
+	writer.AlignTo(alignof(uint64_t));
+	const size_t table_offset = writer.GetSize();
+	for(int entry_idx = 0; entry_idx < NUM_SCENE_SECTIONS * 2; ++entry_idx)
+	{
+		writer.ReserveSlot<uint64_t>();
+	}
+
+	const std::vector<float> ones(num_shapes, 1.0f);
+	const std::vector<float> scales(num_shapes, scale);
+	const std::vector<int> prototype_ids(num_shapes, 0);
+	const int point_starts[2] = { 0, 3 };
+	const float points_x[3] = { 1.0f, -0.5f, -0.5f };
+	const float points_y[3] = { 0.0f, 0.866f, -0.866f };
+
+	WriteSection(writer, table_offset, SCENE_SECTION_POSITIONS_X, ones.data(), num_shapes);
+	WriteSection(writer, table_offset, SCENE_SECTION_POSITIONS_Y, ones.data(), num_shapes);
+	WriteSection(writer, table_offset, SCENE_SECTION_ORIENTATIONS, ones.data(), num_shapes);
+	WriteSection(writer, table_offset, SCENE_SECTION_SCALES, scales.data(), num_shapes);
+	WriteSection(writer, table_offset, SCENE_SECTION_PROTOTYPE_IDS, prototype_ids.data(), num_shapes);
+	WriteSection(writer, table_offset, SCENE_SECTION_POINT_STARTS, point_starts, 2);
+	WriteSection(writer, table_offset, SCENE_SECTION_POINTS_X, points_x, 3);
+	WriteSection(writer, table_offset, SCENE_SECTION_POINTS_Y, points_y, 3);
+	WriteSection(writer, table_offset, SCENE_SECTION_RAY_POSITIONS_X, points_x, 0);
+	WriteSection(writer, table_offset, SCENE_SECTION_RAY_POSITIONS_Y, points_x, 0);
+	WriteSection(writer, table_offset, SCENE_SECTION_RAY_DIRECTIONS_X, points_x, 0);
+	WriteSection(writer, table_offset, SCENE_SECTION_RAY_DIRECTIONS_Y, points_x, 0);
+}
+
+
+static bool ReadsTestScene(const int num_shapes, const float scale, const size_t patch_offset = 0, const uint64_t patch_value = 0, const size_t patch_size = 0)
+{
+	ByteBufferWriter writer;
+	WriteTestScene(writer, num_shapes, scale);
+	if(patch_size == sizeof(int))
+	{
+		writer.PatchValue<int>(patch_offset, static_cast<int>(patch_value));
+	}
+	else if(patch_size == sizeof(uint64_t))
+	{
+		writer.PatchValue<uint64_t>(patch_offset, patch_value);
+	}
+
+	std::vector<uchar> buffer;
+	writer.TakeBuffer(buffer);
+
+	SceneSnapshot snapshot;
+	return snapshot.Read(buffer.data(), buffer.size());
+}
+
+
+UNITTEST("SceneSnapshot reads back a valid scene", "SceneSnapshot", 0)
+{
+	ByteBufferWriter writer;
+	WriteTestScene(writer, 5, ConvexShape2D::MIN_SIZE);
+	std::vector<uchar> buffer;
+	writer.TakeBuffer(buffer);
+
+	SceneSnapshot snapshot;
+	return snapshot.Read(buffer.data(), buffer.size())
+		&& snapshot.m_numShapes == 5
+		&& snapshot.m_numPrototypes == 1
+		&& snapshot.m_pointStarts[1] == 3
+		&& snapshot.m_scales[4] == ConvexShape2D::MIN_SIZE;
+}
+
+
+// every length short of the whole file, including the ones that end in the table padding
+UNITTEST("SceneSnapshot rejects truncated files", "SceneSnapshot", 0)
+{
+	ByteBufferWriter writer;
+	WriteTestScene(writer, 3, ConvexShape2D::MIN_SIZE);
+	std::vector<uchar> buffer;
+	writer.TakeBuffer(buffer);
+
+	for(size_t length = 0; length < buffer.size(); ++length)
+	{
+		SceneSnapshot snapshot;
+		if(snapshot.Read(buffer.data(), length))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+UNITTEST("SceneSnapshot rejects corrupt files", "SceneSnapshot", 0)
+{
+	const float mid_size = (ConvexShape2D::MIN_SIZE + ConvexShape2D::MAX_SIZE) * 0.5f;
+	const size_t num_prototypes_offset = 5 * sizeof(uint);
+	const size_t table_offset = 8 * sizeof(uint);
+	const size_t scales_entry = table_offset + SCENE_SECTION_SCALES * 2 * sizeof(uint64_t);
+
+	return ReadsTestScene(2, mid_size)
+		&& !ReadsTestScene(2, 0.0f)
+		&& !ReadsTestScene(2, -1.0f)
+		&& !ReadsTestScene(2, NAN)
+		&& !ReadsTestScene(2, ConvexShape2D::MAX_SIZE * 2.0f)
+		&& !ReadsTestScene(2, mid_size, num_prototypes_offset, std::numeric_limits<int>::max(), sizeof(int))
+		&& !ReadsTestScene(2, mid_size, num_prototypes_offset, 0, sizeof(int))
+		&& !ReadsTestScene(2, mid_size, scales_entry, ~0ull - 63, sizeof(uint64_t))
+		&& !ReadsTestScene(2, mid_size, scales_entry, SCENE_SECTION_ALIGNMENT + 4, sizeof(uint64_t))
+		&& !ReadsTestScene(2, mid_size, scales_entry + sizeof(uint64_t), 4 * sizeof(float), sizeof(uint64_t));
+}
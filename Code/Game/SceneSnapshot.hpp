@@ -0,0 +1,67 @@
+#pragma once
+#include "Game/ByteBufferParser.hpp"
+#include "Game/GameCommon.hpp"
+
+#include "Engine/Math/Ray2.hpp"
+
+#include <cstdint>
+#include <vector>
+
+struct ShapeComponents;
+class ByteBufferWriter;
+class ShapePrototypeLibrary;
+
+constexpr uint		SCENE_FILE_MAGIC = 0x4E435353;		// "SSCN" read as little endian
+constexpr uint		SCENE_FILE_VERSION = 1;
+constexpr size_t	SCENE_SECTION_ALIGNMENT = 64;
+
+enum SceneSectionId : uint
+{
+	SCENE_SECTION_POSITIONS_X,
+	SCENE_SECTION_POSITIONS_Y,
+	SCENE_SECTION_ORIENTATIONS,
+	SCENE_SECTION_SCALES,
+	SCENE_SECTION_PROTOTYPE_IDS,
+	SCENE_SECTION_POINT_STARTS,			// one per prototype, plus one past the last
+	SCENE_SECTION_POINTS_X,
+	SCENE_SECTION_POINTS_Y,
+	SCENE_SECTION_RAY_POSITIONS_X,
+	SCENE_SECTION_RAY_POSITIONS_Y,
+	SCENE_SECTION_RAY_DIRECTIONS_X,
+	SCENE_SECTION_RAY_DIRECTIONS_Y,
+	NUM_SCENE_SECTIONS
+};
+
+// A loaded scene file. Every array is a view straight into the file's bytes, so the buffer it was
+// read from has to outlive it.
+//
+// Layout: magic, version, endian byte and padding, shape / prototype / ray counts, then a table of
+// (offset, size) for each section. Sections are plain arrays starting on a 64 byte boundary, so a
+// mapped file can be used as is.
+struct SceneSnapshot
+{
+public:
+	bool	Read(const uchar* data, size_t size);
+
+	static void	Write(ByteBufferWriter& writer, const ShapeComponents& shapes, const ShapePrototypeLibrary& prototypes,
+					const Ray2* rays, int num_rays);
+	static bool	LoadFile(const char* file_path, std::vector<uchar>& out_buffer);
+
+public:
+	int m_numShapes = 0;
+	int m_numPrototypes = 0;
+	int m_numRays = 0;
+
+	BufferView<float>	m_positionsX;
+	BufferView<float>	m_positionsY;
+	BufferView<float>	m_orientations;
+	BufferView<float>	m_scales;
+	BufferView<int>		m_prototypeIds;
+	BufferView<int>		m_pointStarts;
+	BufferView<float>	m_pointsX;
+	BufferView<float>	m_pointsY;
+	BufferView<float>	m_rayPositionsX;
+	BufferView<float>	m_rayPositionsY;
+	BufferView<float>	m_rayDirectionsX;
+	BufferView<float>	m_rayDirectionsY;
+};
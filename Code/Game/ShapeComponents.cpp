@@ -0,0 +1,163 @@
+#include "Game/ShapeComponents.hpp"
+
+#include "Engine/Math/MathUtils.hpp"
+
+
+Vec2 ShapeFrame::ToLocalPosition(const Vec2& world_pos) const
+{
+	return ToLocalVector(world_pos - m_position);
+}
+
+
+Vec2 ShapeFrame::ToLocalVector(const Vec2& world_vec) const
+{
+	return Vec2(
+		(m_cos * world_vec.x + m_sin * world_vec.y) * m_invScale,
+		(m_cos * world_vec.y - m_sin * world_vec.x) * m_invScale
+	);
+}
+
+
+Vec2 ShapeFrame::ToWorldPosition(const Vec2& local_pos) const
+{
+	return m_position + ToWorldVector(local_pos);
+}
+
+
+Vec2 ShapeFrame::ToWorldVector(const Vec2& local_vec) const
+{
+	return Vec2(
+		(m_cos * local_vec.x - m_sin * local_vec.y) * m_scale,
+		(m_sin * local_vec.x + m_cos * local_vec.y) * m_scale
+	);
+}
+
+//--------------------------------------------------------------------
+
+template<typename Array>
+static void PermuteArray(Array& values, const std::vector<int>& new_to_old)
+{
+	Array permuted;
+	permuted.reserve(values.capacity());
+	for(const int old_idx : new_to_old)
+	{
+		permuted.push_back(values[old_idx]);
+	}
+
+	values.swap(permuted);
+}
+
+//--------------------------------------------------------------------
+
+ShapeComponents::ShapeComponents() = default;
+ShapeComponents::~ShapeComponents() = default;
+
+
+int ShapeComponents::Add(ConvexShape2D* owner)
+{
+	m_positions.push_back(Vec2::ZERO);
+	m_orientationDegrees.push_back(0.0f);
+	m_scales.push_back(1.0f);
+	m_prototypeIds.push_back(0);
+	m_flags.push_back(SHAPE_FLAG_NONE);
+	m_frames.emplace_back();
+	m_owners.push_back(owner);
+	++m_version;
+
+	return static_cast<int>(m_owners.size()) - 1;
+}
+
+
+void ShapeComponents::RemoveLast()
+{
+	m_positions.pop_back();
+	m_orientationDegrees.pop_back();
+	m_scales.pop_back();
+	m_prototypeIds.pop_back();
+	m_flags.pop_back();
+	m_frames.pop_back();
+	m_owners.pop_back();
+	++m_version;
+}
+
+
+void ShapeComponents::Clear()
+{
+	m_positions.clear();
+	m_orientationDegrees.clear();
+	m_scales.clear();
+	m_prototypeIds.clear();
+	m_flags.clear();
+	m_frames.clear();
+	m_owners.clear();
+	++m_version;
+}
+
+
+void ShapeComponents::Reserve(const int num_shapes)
+{
+	m_positions.reserve(num_shapes);
+	m_orientationDegrees.reserve(num_shapes);
+	m_scales.reserve(num_shapes);
+	m_prototypeIds.reserve(num_shapes);
+	m_flags.reserve(num_shapes);
+	m_frames.reserve(num_shapes);
+	m_owners.reserve(num_shapes);
+}
+
+
+int ShapeComponents::GetCount() const
+{
+	return static_cast<int>(m_owners.size());
+}
+
+
+uint64_t ShapeComponents::GetVersion() const
+{
+	return m_version;
+}
+
+
+// slot i takes whatever was in slot new_to_old[i]
+void ShapeComponents::Permute(const std::vector<int>& new_to_old)
+{
+	PermuteArray(m_positions, new_to_old);
+	PermuteArray(m_orientationDegrees, new_to_old);
+	PermuteArray(m_scales, new_to_old);
+	PermuteArray(m_prototypeIds, new_to_old);
+	PermuteArray(m_flags, new_to_old);
+	PermuteArray(m_frames, new_to_old);
+	PermuteArray(m_owners, new_to_old);
+	++m_version;
+}
+
+
+void ShapeComponents::SetTransform(const int shape_idx, const Vec2& position, const float orientation_degrees, const float scale)
+{
+	m_positions[shape_idx] = position;
+	m_orientationDegrees[shape_idx] = orientation_degrees;
+	m_scales[shape_idx] = scale;
+	RefreshFrame(shape_idx);
+}
+
+
+void ShapeComponents::RefreshFrame(const int shape_idx)
+{
+	ShapeFrame& frame = m_frames[shape_idx];
+	frame.m_position = m_positions[shape_idx];
+	frame.m_cos = CosDegrees(m_orientationDegrees[shape_idx]);
+	frame.m_sin = SinDegrees(m_orientationDegrees[shape_idx]);
+	frame.m_scale = m_scales[shape_idx];
+	frame.m_invScale = 1.0f / m_scales[shape_idx];
+	++m_version;
+}
+
+
+Matrix44 ShapeComponents::GetModelMatrix(const int shape_idx) const
+{
+	Matrix44 translation = Matrix44::MakeTranslation2D(m_positions[shape_idx]);
+	Matrix44 rotation = Matrix44::MakeZRotationDegrees(m_orientationDegrees[shape_idx]);
+	Matrix44 scale = Matrix44::MakeUniformScale2D(m_scales[shape_idx]);
+
+	return scale * rotation * translation;
+}
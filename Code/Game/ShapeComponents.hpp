@@ -0,0 +1,70 @@
+#pragma once
+#include "Engine/Math/Vec2.hpp"
+#include "Engine/Math/Matrix44.hpp"
+
+#include "Game/GameCommon.hpp"
+#include "Game/MemoryTags.hpp"
+
+#include <cstdint>
+#include <vector>
+
+class ConvexShape2D;
+
+enum ShapeFlag : uchar
+{
+	SHAPE_FLAG_NONE			= 0,
+	SHAPE_FLAG_COLLIDING	= 1 << 0,	// the mouse is inside the shape this frame
+	SHAPE_FLAG_OCCLUDED		= 1 << 1,	// hidden from the occlusion viewpoint, skipped by rendering and updates
+};
+
+// World <-> local for one shape, refreshed whenever its transform is written,
+// so the hot loops never build or invert a Matrix44.
+struct ShapeFrame
+{
+public:
+	Vec2 ToLocalPosition(const Vec2& world_pos) const;
+	Vec2 ToLocalVector(const Vec2& world_vec) const;
+	Vec2 ToWorldPosition(const Vec2& local_pos) const;
+	Vec2 ToWorldVector(const Vec2& local_vec) const;
+
+public:
+	Vec2	m_position = Vec2::ZERO;
+	float	m_cos = 1.0f;
+	float	m_sin = 0.0f;
+	float	m_scale = 1.0f;
+	float	m_invScale = 1.0f;
+};
+
+//--------------------------------------------------------------------
+
+// Structure of arrays for every live ConvexShape2D. Index i in each array belongs to the same shape,
+// and shapes are only ever added to and removed from the back, matching Game::m_convexShapes.
+// Permute reorders every array at once, the caller has to move m_convexShapes the same way.
+struct ShapeComponents
+{
+public:
+	ShapeComponents();
+	~ShapeComponents();
+
+	int			Add(ConvexShape2D* owner);
+	void		RemoveLast();
+	void		Clear();
+	void		Reserve(int num_shapes);
+	int			GetCount() const;
+	uint64_t	GetVersion() const;
+	void		Permute(const std::vector<int>& new_to_old);
+
+	void		SetTransform(int shape_idx, const Vec2& position, float orientation_degrees, float scale);
+	void		RefreshFrame(int shape_idx);
+	Matrix44	GetModelMatrix(int shape_idx) const;
+
+public:
+	TaggedVector<Vec2, MEM_TAG_SHAPES>				m_positions;
+	TaggedVector<float, MEM_TAG_SHAPES>				m_orientationDegrees;
+	TaggedVector<float, MEM_TAG_SHAPES>				m_scales;
+	TaggedVector<int, MEM_TAG_SHAPES>				m_prototypeIds;
+	TaggedVector<uchar, MEM_TAG_SHAPES>				m_flags;
+	TaggedVector<ShapeFrame, MEM_TAG_SHAPES>		m_frames;
+	TaggedVector<ConvexShape2D*, MEM_TAG_SHAPES>	m_owners;
+	uint64_t										m_version = 0;		// bumped by anything that adds, removes, reorders or moves shapes
+};
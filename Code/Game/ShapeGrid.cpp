@@ -0,0 +1,246 @@
+#include "Game/ShapeGrid.hpp"
+#include "Game/ShapeComponents.hpp"
+#include "Game/ShapePrototypes.hpp"
+#include "Game/ShapeSystems.hpp"
+
+#include "Engine/Math/MathUtils.hpp"
+
+
+ShapeGrid::ShapeGrid() = default;
+ShapeGrid::~ShapeGrid() = default;
+
+
+// counting pass then filling pass, the vectors only grow the first time a bigger scene shows up
+void ShapeGrid::Build(const ShapeComponents& shapes, const AABB2& bounds, const float cell_size)
+{
+	m_bounds = bounds;
+	m_cellSize = cell_size;
+	m_invCellSize = 1.0f / cell_size;
+	m_numCellsX = static_cast<int>(ceilf((bounds.maxs.x - bounds.mins.x) * m_invCellSize));
+	m_numCellsY = static_cast<int>(ceilf((bounds.maxs.y - bounds.mins.y) * m_invCellSize));
+
+	const int num_cells = m_numCellsX * m_numCellsY;
+	m_cellStarts.assign(num_cells + 1, 0);
+	m_cellFill.assign(num_cells, 0);
+
+	const int num_shapes = shapes.GetCount();
+	for(int shape_idx = 0; shape_idx < num_shapes; ++shape_idx)
+	{
+		const Vec2& center = shapes.m_positions[shape_idx];
+		const float radius = shapes.m_scales[shape_idx];
+		const int min_x = GetCellX(center.x - radius);
+		const int max_x = GetCellX(center.x + radius);
+		const int min_y = GetCellY(center.y - radius);
+		const int max_y = GetCellY(center.y + radius);
+
+		for(int cell_y = min_y; cell_y <= max_y; ++cell_y)
+		{
+			for(int cell_x = min_x; cell_x <= max_x; ++cell_x)
+			{
+				++m_cellStarts[cell_y * m_numCellsX + cell_x + 1];
+			}
+		}
+	}
+
+	for(int cell_idx = 0; cell_idx < num_cells; ++cell_idx)
+	{
+		m_cellStarts[cell_idx + 1] += m_cellStarts[cell_idx];
+	}
+
+	m_cellShapes.resize(m_cellStarts[num_cells]);
+
+	for(int shape_idx = 0; shape_idx < num_shapes; ++shape_idx)
+	{
+		const Vec2& center = shapes.m_positions[shape_idx];
+		const float radius = shapes.m_scales[shape_idx];
+		const int min_x = GetCellX(center.x - radius);
+		const int max_x = GetCellX(center.x + radius);
+		const int min_y = GetCellY(center.y - radius);
+		const int max_y = GetCellY(center.y + radius);
+
+		for(int cell_y = min_y; cell_y <= max_y; ++cell_y)
+		{
+			for(int cell_x = min_x; cell_x <= max_x; ++cell_x)
+			{
+				const int cell_idx = cell_y * m_numCellsX + cell_x;
+				m_cellShapes[m_cellStarts[cell_idx] + m_cellFill[cell_idx]] = shape_idx;
+				++m_cellFill[cell_idx];
+			}
+		}
+	}
+}
+
+
+// Amanatides & Woo traversal. A hit found in one cell can lie in a later one, so the walk
+// only stops once the best hit so far is before the exit of the current cell.
+bool ShapeGrid::RaycastClosest(const ShapeComponents& shapes, const ShapePrototypeLibrary& prototypes,
+	const Ray2& ray, const float max_t, ShapeRayHit& out_hit) const
+{
+	out_hit = ShapeRayHit();
+	if(m_numCellsX == 0 || m_numCellsY == 0)
+	{
+		return false;
+	}
+
+	// clip the ray to the grid, shapes are clamped into the border cells so nothing is outside it
+	float t_start = 0.0f;
+	float t_end = max_t;
+	const float origin[2] = { ray.m_pos.x, ray.m_pos.y };
+	const float dir[2] = { ray.m_dir.x, ray.m_dir.y };
+	const float mins[2] = { m_bounds.mins.x, m_bounds.mins.y };
+	const float maxs[2] = { m_bounds.maxs.x, m_bounds.maxs.y };
+	for(int axis = 0; axis < 2; ++axis)
+	{
+		if(dir[axis] == 0.0f)
+		{
+			continue;
+		}
+
+		float t_near = (mins[axis] - origin[axis]) / dir[axis];
+		float t_far = (maxs[axis] - origin[axis]) / dir[axis];
+		if(t_near > t_far)
+		{
+			const float swap = t_near;
+			t_near = t_far;
+			t_far = swap;
+		}
+
+		t_start = t_near > t_start ? t_near : t_start;
+		t_end = t_far < t_end ? t_far : t_end;
+	}
+
+	if(t_start > t_end)
+	{
+		t_start = 0.0f;
+		t_end = 0.0f;
+	}
+
+	const Vec2 entry = ray.m_pos + ray.m_dir * t_start;
+	int cell_x = GetCellX(entry.x);
+	int cell_y = GetCellY(entry.y);
+
+	const int step_x = ray.m_dir.x > 0.0f ? 1 : -1;
+	const int step_y = ray.m_dir.y > 0.0f ? 1 : -1;
+	const float delta_x = ray.m_dir.x != 0.0f ? Abs(m_cellSize / ray.m_dir.x) : INFINITY;
+	const float delta_y = ray.m_dir.y != 0.0f ? Abs(m_cellSize / ray.m_dir.y) : INFINITY;
+
+	const float next_edge_x = m_bounds.mins.x + static_cast<float>(cell_x + (step_x > 0 ? 1 : 0)) * m_cellSize;
+	const float next_edge_y = m_bounds.mins.y + static_cast<float>(cell_y + (step_y > 0 ? 1 : 0)) * m_cellSize;
+	float t_max_x = ray.m_dir.x != 0.0f ? (next_edge_x - ray.m_pos.x) / ray.m_dir.x : INFINITY;
+	float t_max_y = ray.m_dir.y != 0.0f ? (next_edge_y - ray.m_pos.y) / ray.m_dir.y : INFINITY;
+
+	// shapes overlap several cells, remember the last few tested so they are not clipped twice
+	constexpr int NUM_RECENT = 32;
+	int recent[NUM_RECENT];
+	int num_recent = 0;
+
+	while(true)
+	{
+		const int cell_idx = cell_y * m_numCellsX + cell_x;
+		for(int entry_idx = m_cellStarts[cell_idx]; entry_idx < m_cellStarts[cell_idx + 1]; ++entry_idx)
+		{
+			const int shape_idx = m_cellShapes[entry_idx];
+
+			bool tested = false;
+			const int num_checked = num_recent < NUM_RECENT ? num_recent : NUM_RECENT;
+			for(int recent_idx = 0; recent_idx < num_checked; ++recent_idx)
+			{
+				if(recent[recent_idx] == shape_idx)
+				{
+					tested = true;
+					break;
+				}
+			}
+
+			if(tested)
+			{
+				continue;
+			}
+
+			recent[num_recent % NUM_RECENT] = shape_idx;
+			++num_recent;
+
+			float t = 0.0f;
+			int plane_idx = -1;
+			if(RaycastShape(shapes, prototypes, shape_idx, ray, t, plane_idx) && t <= max_t && t < out_hit.m_t)
+			{
+				out_hit.m_t = t;
+				out_hit.m_shapeIdx = shape_idx;
+				out_hit.m_planeIdx = plane_idx;
+			}
+		}
+
+		const float t_cell_exit = t_max_x < t_max_y ? t_max_x : t_max_y;
+		if(out_hit.m_t <= t_cell_exit || t_cell_exit > t_end)
+		{
+			break;
+		}
+
+		if(t_max_x < t_max_y)
+		{
+			cell_x += step_x;
+			t_max_x += delta_x;
+		}
+		else
+		{
+			cell_y += step_y;
+			t_max_y += delta_y;
+		}
+
+		if(cell_x < 0 || cell_x >= m_numCellsX || cell_y < 0 || cell_y >= m_numCellsY)
+		{
+			break;
+		}
+	}
+
+	if(out_hit.m_shapeIdx == -1)
+	{
+		return false;
+	}
+
+	if(out_hit.m_planeIdx != -1)
+	{
+		const std::vector<Plane2>& planes = prototypes.GetPrototype(shapes.m_prototypeIds[out_hit.m_shapeIdx]).m_hull.m_planes;
+		out_hit.m_normal = shapes.m_frames[out_hit.m_shapeIdx].ToWorldVector(planes[out_hit.m_planeIdx].m_normal).GetNormalized();
+	}
+
+	return true;
+}
+
+
+int ShapeGrid::GetNumCells() const
+{
+	return m_numCellsX * m_numCellsY;
+}
+
+
+int ShapeGrid::GetNumEntries() const
+{
+	return static_cast<int>(m_cellShapes.size());
+}
+
+
+// positions outside the grid land in the border cells, same as shapes do when building
+int ShapeGrid::GetCellIndex(const Vec2& pos) const
+{
+	return GetCellY(pos.y) * m_numCellsX + GetCellX(pos.x);
+}
+
+
+const int* ShapeGrid::GetCellShapes(const int cell_idx, int& out_num_shapes) const
+{
+	out_num_shapes = m_cellStarts[cell_idx + 1] - m_cellStarts[cell_idx];
+	return m_cellShapes.data() + m_cellStarts[cell_idx];
+}
+
+
+int ShapeGrid::GetCellX(const float x) const
+{
+	return ClampInt(static_cast<int>(floorf((x - m_bounds.mins.x) * m_invCellSize)), 0, m_numCellsX - 1);
+}
+
+
+int ShapeGrid::GetCellY(const float y) const
+{
+	return ClampInt(static_cast<int>(floorf((y - m_bounds.mins.y) * m_invCellSize)), 0, m_numCellsY - 1);
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include "Engine/Math/AABB2.hpp"
+#include "Engine/Math/Ray2.hpp"
+#include "Engine/Math/Vec2.hpp"
+
+#include "Game/MemoryTags.hpp"
+
+#include <cmath>
+#include <vector>
+
+struct ShapeComponents;
+class ShapePrototypeLibrary;
+
+struct ShapeRayHit
+{
+	float	m_t = INFINITY;
+	int		m_shapeIdx = -1;
+	int		m_planeIdx = -1;		// -1 when the ray starts inside the shape
+	Vec2	m_normal = Vec2::ZERO;	// world space, unit length
+};
+
+// Uniform grid over the shapes' bounding discs. Cells are stored back to back (m_cellStarts indexes
+// into m_cellShapes), and rays walk it cell by cell so a closest hit only tests shapes along the way.
+class ShapeGrid
+{
+public:
+	ShapeGrid();
+	~ShapeGrid();
+
+	void	Build(const ShapeComponents& shapes, const AABB2& bounds, float cell_size);
+	bool	RaycastClosest(const ShapeComponents& shapes, const ShapePrototypeLibrary& prototypes,
+				const Ray2& ray, float max_t, ShapeRayHit& out_hit) const;
+
+	int			GetNumCells() const;
+	int			GetNumEntries() const;
+	int			GetCellIndex(const Vec2& pos) const;
+	const int*	GetCellShapes(int cell_idx, int& out_num_shapes) const;
+
+private:
+	int		GetCellX(float x) const;
+	int		GetCellY(float y) const;
+
+private:
+	AABB2	m_bounds;
+	float	m_cellSize = 1.0f;
+	float	m_invCellSize = 1.0f;
+	int		m_numCellsX = 0;
+	int		m_numCellsY = 0;
+
+	TaggedVector<int, MEM_TAG_SHAPES> m_cellStarts;		// one past the last cell as well
+	TaggedVector<int, MEM_TAG_SHAPES> m_cellShapes;
+	TaggedVector<int, MEM_TAG_SCRATCH> m_cellFill;		// scratch while building
+};
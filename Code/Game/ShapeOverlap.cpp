@@ -0,0 +1,439 @@
+#include "Game/ShapeOverlap.hpp"
+#include "Game/ConvexShape.hpp"
+#include "Game/Profiler.hpp"
+#include "Game/ShapeComponents.hpp"
+#include "Game/ShapeGrid.hpp"
+#include "Game/ShapePrototypes.hpp"
+#include "Game/SweepAndPrune.hpp"
+#include "Game/TestScene.hpp"
+
+#include "Engine/Math/MathUtils.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+
+constexpr uint64_t	PAIR_AXIS_EMPTY_KEY = ~0ull;	// shape indices are ints, so no real pair has both halves set
+constexpr uint		PAIR_AXIS_MIN_CAPACITY = 64;
+
+
+// furthest B gets from A along the outward normal of A's edge, positive means a gap
+static float GetEdgeSeparation(const Vec2* points_a, const int num_a, const int edge_idx, const Vec2* points_b, const int num_b, Vec2& out_normal)
+{
+	const Vec2& edge_start = points_a[edge_idx];
+	const Vec2 edge = points_a[(edge_idx + 1) % num_a] - edge_start;
+	out_normal = Vec2(edge.y, -edge.x).GetNormalized();
+
+	float separation = INFINITY;
+	for(int point_idx = 0; point_idx < num_b; ++point_idx)
+	{
+		const float distance = DotProduct(out_normal, points_b[point_idx] - edge_start);
+		separation = distance < separation ? distance : separation;
+	}
+
+	return separation;
+}
+
+
+static float GetAxisSeparation(const Vec2* points_a, const int num_a, const Vec2* points_b, const int num_b, const int axis, Vec2& out_normal)
+{
+	if(axis < num_a)
+	{
+		return GetEdgeSeparation(points_a, num_a, axis, points_b, num_b, out_normal);
+	}
+
+	// B's edges point out of B, flip so the normal still goes from A to B
+	const float separation = GetEdgeSeparation(points_b, num_b, axis - num_a, points_a, num_a, out_normal);
+	out_normal = -out_normal;
+	return separation;
+}
+
+
+bool ConvexPolygonsOverlap(const Vec2* points_a, const int num_a, const Vec2* points_b, const int num_b, int& inout_axis, ShapeContact* out_contact)
+{
+	const int num_axes = num_a + num_b;
+	Vec2 normal;
+
+	if(inout_axis >= 0 && inout_axis < num_axes && GetAxisSeparation(points_a, num_a, points_b, num_b, inout_axis, normal) > 0.0f)
+	{
+		return false;
+	}
+
+	float best_separation = -INFINITY;
+	int best_axis = -1;
+	Vec2 best_normal;
+	for(int axis = 0; axis < num_axes; ++axis)
+	{
+		const float separation = GetAxisSeparation(points_a, num_a, points_b, num_b, axis, normal);
+		if(separation > 0.0f)
+		{
+			inout_axis = axis;
+			return false;
+		}
+
+		if(separation > best_separation)
+		{
+			best_separation = separation;
+			best_axis = axis;
+			best_normal = normal;
+		}
+	}
+
+	inout_axis = best_axis;
+	if(out_contact != nullptr)
+	{
+		out_contact->m_normal = best_normal;
+		out_contact->m_depth = -best_separation;
+	}
+
+	return true;
+}
+
+//--------------------------------------------------------------------
+
+// sized for twice the expected pairs, and only shrunk once it is far too big so clearing stays cheap
+void PairAxisTable::Clear(const int expected_count)
+{
+	uint capacity = PAIR_AXIS_MIN_CAPACITY;
+	while(capacity < 2u * static_cast<uint>(expected_count))
+	{
+		capacity *= 2;
+	}
+
+	m_count = 0;
+	if(capacity > m_keys.size() || capacity * 8 < m_keys.size())
+	{
+		m_keys.assign(capacity, PAIR_AXIS_EMPTY_KEY);
+		m_axes.resize(capacity);
+		m_mask = capacity - 1;
+		return;
+	}
+
+	std::fill(m_keys.begin(), m_keys.end(), PAIR_AXIS_EMPTY_KEY);
+}
+
+
+int PairAxisTable::Find(const uint64_t pair_key) const
+{
+	if(m_keys.empty())
+	{
+		return -1;
+	}
+
+	for(uint slot = GetSlot(pair_key); m_keys[slot] != PAIR_AXIS_EMPTY_KEY; slot = (slot + 1) & m_mask)
+	{
+		if(m_keys[slot] == pair_key)
+		{
+			return m_axes[slot];
+		}
+	}
+
+	return -1;
+}
+
+
+void PairAxisTable::Insert(const uint64_t pair_key, const int axis)
+{
+	if(2u * static_cast<uint>(m_count + 1) > m_keys.size())
+	{
+		Rehash(m_keys.empty() ? PAIR_AXIS_MIN_CAPACITY : static_cast<uint>(m_keys.size()) * 2);
+	}
+
+	uint slot = GetSlot(pair_key);
+	while(m_keys[slot] != PAIR_AXIS_EMPTY_KEY && m_keys[slot] != pair_key)
+	{
+		slot = (slot + 1) & m_mask;
+	}
+
+	if(m_keys[slot] == PAIR_AXIS_EMPTY_KEY)
+	{
+		m_keys[slot] = pair_key;
+		++m_count;
+	}
+	m_axes[slot] = axis;
+}
+
+
+// Fibonacci hashing, the high bits of the product mix both shape indices
+uint PairAxisTable::GetSlot(const uint64_t pair_key) const
+{
+	return static_cast<uint>((pair_key * 0x9E3779B97F4A7C15ull) >> 32) & m_mask;
+}
+
+
+void PairAxisTable::Rehash(const uint capacity)
+{
+	std::vector<uint64_t> old_keys(capacity, PAIR_AXIS_EMPTY_KEY);
+	std::vector<int> old_axes(capacity);
+	old_keys.swap(m_keys);
+	old_axes.swap(m_axes);
+	m_mask = capacity - 1;
+	m_count = 0;
+
+	const size_t old_capacity = old_keys.size();
+	for(size_t slot = 0; slot < old_capacity; ++slot)
+	{
+		if(old_keys[slot] != PAIR_AXIS_EMPTY_KEY)
+		{
+			Insert(old_keys[slot], old_axes[slot]);
+		}
+	}
+}
+
+//--------------------------------------------------------------------
+
+ShapeOverlapQuery::ShapeOverlapQuery() = default;
+ShapeOverlapQuery::~ShapeOverlapQuery() = default;
+
+
+void ShapeOverlapQuery::FindAllOverlaps(const ShapeGrid& grid, const ShapeComponents& shapes, const ShapePrototypeLibrary& prototypes, std::vector<ShapeContact>& out_contacts)
+{
+	PROFILE_SCOPE("ShapeOverlapQuery::FindAllOverlaps(Grid)");
+
+	out_contacts.clear();
+	m_numPairsTested = 0;
+	m_numCacheHits = 0;
+	m_nextAxisCache.Clear(m_axisCache.GetCount());
+
+	BuildWorldPoints(shapes, prototypes);
+
+	const int num_cells = grid.GetNumCells();
+	for(int cell_idx = 0; cell_idx < num_cells; ++cell_idx)
+	{
+		int num_in_cell = 0;
+		const int* cell_shapes = grid.GetCellShapes(cell_idx, num_in_cell);
+
+		for(int first = 0; first < num_in_cell; ++first)
+		{
+			const int shape_a = cell_shapes[first];
+			const Vec2& center_a = shapes.m_positions[shape_a];
+			const float radius_a = shapes.m_scales[shape_a];
+
+			for(int second = first + 1; second < num_in_cell; ++second)
+			{
+				const int shape_b = cell_shapes[second];
+				const Vec2& center_b = shapes.m_positions[shape_b];
+				const float radius_b = shapes.m_scales[shape_b];
+
+				const Vec2 offset = center_b - center_a;
+				const float reach = radius_a + radius_b;
+				if(offset.GetLengthSquared() > reach * reach)
+				{
+					continue;
+				}
+
+				// pairs share several cells, only the one holding the corner of their box overlap reports it
+				const Vec2 overlap_min(
+					std::max(center_a.x - radius_a, center_b.x - radius_b),
+					std::max(center_a.y - radius_a, center_b.y - radius_b));
+				if(grid.GetCellIndex(overlap_min) != cell_idx)
+				{
+					continue;
+				}
+
+				ShapeContact contact;
+				if(TestPair(shape_a, shape_b, &contact))
+				{
+					out_contacts.push_back(contact);
+				}
+			}
+		}
+	}
+
+	std::swap(m_axisCache, m_nextAxisCache);
+}
+
+
+// the broadphase already hands over each box overlap exactly once, no dedup needed
+void ShapeOverlapQuery::FindAllOverlaps(const SweepAndPrune& broadphase, const ShapeComponents& shapes, const ShapePrototypeLibrary& prototypes, std::vector<ShapeContact>& out_contacts)
+{
+	PROFILE_SCOPE("ShapeOverlapQuery::FindAllOverlaps(SAP)");
+
+	out_contacts.clear();
+	m_numPairsTested = 0;
+	m_numCacheHits = 0;
+	m_nextAxisCache.Clear(m_axisCache.GetCount());
+
+	BuildWorldPoints(shapes, prototypes);
+
+	for(const uint64_t pair : broadphase.GetPairs())
+	{
+		const int shape_a = SweepAndPrune::GetPairShapeA(pair);
+		const int shape_b = SweepAndPrune::GetPairShapeB(pair);
+
+		const Vec2 offset = shapes.m_positions[shape_b] - shapes.m_positions[shape_a];
+		const float reach = shapes.m_scales[shape_a] + shapes.m_scales[shape_b];
+		if(offset.GetLengthSquared() > reach * reach)
+		{
+			continue;
+		}
+
+		ShapeContact contact;
+		if(TestPair(shape_a, shape_b, &contact))
+		{
+			out_contacts.push_back(contact);
+		}
+	}
+
+	std::swap(m_axisCache, m_nextAxisCache);
+}
+
+
+// expects BuildWorldPoints to have run for this query
+bool ShapeOverlapQuery::TestPair(int shape_a, int shape_b, ShapeContact* out_contact)
+{
+	if(shape_b < shape_a)
+	{
+		const int swap = shape_a;
+		shape_a = shape_b;
+		shape_b = swap;
+	}
+
+	const uint64_t pair_key = (static_cast<uint64_t>(shape_a) << 32) | static_cast<uint32_t>(shape_b);
+	int axis = m_axisCache.Find(pair_key);
+	if(axis != -1)
+	{
+		++m_numCacheHits;
+	}
+
+	const int start_a = m_pointStarts[shape_a];
+	const int start_b = m_pointStarts[shape_b];
+	const bool overlap = ConvexPolygonsOverlap(
+		&m_worldPoints[start_a], m_pointStarts[shape_a + 1] - start_a,
+		&m_worldPoints[start_b], m_pointStarts[shape_b + 1] - start_b,
+		axis, out_contact);
+
+	m_nextAxisCache.Insert(pair_key, axis);
+	++m_numPairsTested;
+
+	if(overlap && out_contact != nullptr)
+	{
+		out_contact->m_shapeA = shape_a;
+		out_contact->m_shapeB = shape_b;
+	}
+
+	return overlap;
+}
+
+
+// one linear pass so the pair tests never transform a point twice
+void ShapeOverlapQuery::BuildWorldPoints(const ShapeComponents& shapes, const ShapePrototypeLibrary& prototypes)
+{
+	const int num_shapes = shapes.GetCount();
+	m_worldPoints.clear();
+	m_pointStarts.resize(num_shapes + 1);
+
+	for(int shape_idx = 0; shape_idx < num_shapes; ++shape_idx)
+	{
+		m_pointStarts[shape_idx] = static_cast<int>(m_worldPoints.size());
+
+		const ShapeFrame& frame = shapes.m_frames[shape_idx];
+		const std::vector<Vec2>& local_points = prototypes.GetPrototype(shapes.m_prototypeIds[shape_idx]).m_polygon.m_points;
+		const int num_points = static_cast<int>(local_points.size());
+		for(int point_idx = 0; point_idx < num_points; ++point_idx)
+		{
+			m_worldPoints.push_back(frame.ToWorldPosition(local_points[point_idx]));
+		}
+	}
+
+	m_pointStarts[num_shapes] = static_cast<int>(m_worldPoints.size());
+}
+
+//--------------------------------------------------------------------
+
+// every pair of shapes through the brute force separating axis test, sorted by pair
+static void FindOverlapsBruteForce(const ShapeComponents& shapes, const ShapePrototypeLibrary& prototypes, std::vector<uint64_t>& out_pairs)
+{
+	const int num_shapes = shapes.GetCount();
+	std::vector<std::vector<Vec2>> world_points(num_shapes);
+	for(int shape_idx = 0; shape_idx < num_shapes; ++shape_idx)
+	{
+		GetTestWorldPoints(prototypes, shapes, shape_idx, world_points[shape_idx]);
+	}
+
+	out_pairs.clear();
+	for(int shape_a = 0; shape_a < num_shapes; ++shape_a)
+	{
+		for(int shape_b = shape_a + 1; shape_b < num_shapes; ++shape_b)
+		{
+			const std::vector<Vec2>& points_a = world_points[shape_a];
+			const std::vector<Vec2>& points_b = world_points[shape_b];
+			if(TestPolygonsOverlap(points_a.data(), static_cast<int>(points_a.size()), points_b.data(), static_cast<int>(points_b.size())))
+			{
+				out_pairs.push_back(SweepAndPrune::MakePairKey(shape_a, shape_b));
+			}
+		}
+	}
+}
+
+
+// each pair once with the lower index first, and a contact normal that pushes B out of A
+static bool ContactsMatch(const std::vector<ShapeContact>& contacts, const std::vector<uint64_t>& expected_pairs)
+{
+	std::vector<uint64_t> pairs;
+	for(const ShapeContact& contact : contacts)
+	{
+		if(contact.m_shapeA >= contact.m_shapeB || contact.m_depth < 0.0f || fabsf(contact.m_normal.GetLength() - 1.0f) > 0.001f)
+		{
+			return false;
+		}
+		pairs.push_back(SweepAndPrune::MakePairKey(contact.m_shapeA, contact.m_shapeB));
+	}
+
+	std::sort(pairs.begin(), pairs.end());
+	return pairs == expected_pairs;
+}
+
+
+// the second query of each frame runs on the cached axes, then shapes move so some of those go stale
+UNITTEST("ShapeOverlapQuery pairs match brute force", "ShapeOverlap", 0)
+{
+	constexpr int num_shapes = 300;
+	uint random_state = 0xA54FF53Au;
+	ShapePrototypeLibrary prototypes;
+	ShapeComponents shapes;
+	BuildTestScene(prototypes, shapes, random_state, 8, num_shapes, ConvexShape2D::MIN_SIZE * 0.5f, ConvexShape2D::MAX_SIZE * 0.5f);
+
+	// the nudges can carry shapes a little past the world edge
+	const Vec2 padding(2.0f * ConvexShape2D::MAX_SIZE, 2.0f * ConvexShape2D::MAX_SIZE);
+	ShapeGrid grid;
+	SweepAndPrune broadphase;
+	ShapeOverlapQuery query;
+	std::vector<ShapeContact> contacts;
+	std::vector<uint64_t> expected_pairs;
+	for(int frame_idx = 0; frame_idx < 4; ++frame_idx)
+	{
+		FindOverlapsBruteForce(shapes, prototypes, expected_pairs);
+		if(expected_pairs.empty())
+		{
+			return false;
+		}
+
+		grid.Build(shapes, AABB2(WORLD_BL_CORNER - padding, WORLD_TR_CORNER + padding), 10.0f);
+		broadphase.Rebuild(shapes);
+		for(int repeat_idx = 0; repeat_idx < 2; ++repeat_idx)
+		{
+			query.FindAllOverlaps(grid, shapes, prototypes, contacts);
+			if(!ContactsMatch(contacts, expected_pairs))
+			{
+				return false;
+			}
+
+			query.FindAllOverlaps(broadphase, shapes, prototypes, contacts);
+			if(!ContactsMatch(contacts, expected_pairs))
+			{
+				return false;
+			}
+		}
+
+		for(int shape_idx = 0; shape_idx < num_shapes; shape_idx += 3)
+		{
+			const Vec2 nudge(NextTestRandom(random_state) * 4.0f - 2.0f, NextTestRandom(random_state) * 4.0f - 2.0f);
+			shapes.SetTransform(shape_idx, shapes.m_positions[shape_idx] + nudge,
+				shapes.m_orientationDegrees[shape_idx] + NextTestRandom(random_state) * 30.0f, shapes.m_scales[shape_idx]);
+		}
+	}
+
+	return true;
+}
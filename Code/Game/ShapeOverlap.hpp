@@ -0,0 +1,74 @@
+#pragma once
+#include "Engine/Math/Vec2.hpp"
+#include "Game/GameCommon.hpp"
+
+#include <cstdint>
+#include <vector>
+
+struct ShapeComponents;
+class ShapeGrid;
+class ShapePrototypeLibrary;
+class SweepAndPrune;
+
+struct ShapeContact
+{
+	int		m_shapeA = -1;
+	int		m_shapeB = -1;
+	Vec2	m_normal = Vec2::ZERO;		// from A towards B, along the axis of least penetration
+	float	m_depth = 0.0f;
+};
+
+// Separating axis test between two counter clockwise polygons, only edge normals need checking in 2D.
+// inout_axis is the axis that separated them last time (edges of A first, then B), -1 if unknown,
+// it is tried first and updated to whatever decided the answer.
+bool ConvexPolygonsOverlap(const Vec2* points_a, int num_a, const Vec2* points_b, int num_b, int& inout_axis, ShapeContact* out_contact = nullptr);
+
+// Pair key to separating axis, open addressed with linear probing in a power of two table kept at most
+// half full. Clearing refills the keys instead of freeing, so a steady frame never allocates.
+class PairAxisTable
+{
+public:
+	void	Clear(int expected_count);
+	int		Find(uint64_t pair_key) const;			// -1 if the pair is not in the table
+	void	Insert(uint64_t pair_key, int axis);	// overwrites the axis of a pair already there
+	int		GetCount() const		{ return m_count; }
+
+private:
+	uint	GetSlot(uint64_t pair_key) const;
+	void	Rehash(uint capacity);
+
+private:
+	std::vector<uint64_t>	m_keys;
+	std::vector<int>		m_axes;
+	uint					m_mask = 0;
+	int						m_count = 0;
+};
+
+// Every overlapping pair of shapes. Candidates come from the grid or the sweep and prune pairs, disc tests throw most of them away,
+// and the separating axis of every pair tested is remembered for the next query.
+class ShapeOverlapQuery
+{
+public:
+	ShapeOverlapQuery();
+	~ShapeOverlapQuery();
+
+	void	FindAllOverlaps(const ShapeGrid& grid, const ShapeComponents& shapes, const ShapePrototypeLibrary& prototypes, std::vector<ShapeContact>& out_contacts);
+	void	FindAllOverlaps(const SweepAndPrune& broadphase, const ShapeComponents& shapes, const ShapePrototypeLibrary& prototypes, std::vector<ShapeContact>& out_contacts);
+
+	int		GetNumPairsTested() const		{ return m_numPairsTested; }
+	int		GetNumCacheHits() const			{ return m_numCacheHits; }
+
+private:
+	void	BuildWorldPoints(const ShapeComponents& shapes, const ShapePrototypeLibrary& prototypes);
+	bool	TestPair(int shape_a, int shape_b, ShapeContact* out_contact);
+
+private:
+	std::vector<Vec2>	m_worldPoints;		// every shape's polygon in world space, back to back
+	std::vector<int>	m_pointStarts;		// one past the last shape as well
+
+	PairAxisTable	m_axisCache;
+	PairAxisTable	m_nextAxisCache;
+
+	int m_numPairsTested = 0;
+	int m_numCacheHits = 0;
+};
@@ -0,0 +1,130 @@
+#include "Game/ShapePool.hpp"
+#include "Game/ConvexShape.hpp"
+#include "Game/MemoryTags.hpp"
+
+#include <new>
+
+
+ShapePool::ShapePool(Game* the_game): m_game(the_game)
+{
+	m_slabs = std::vector<ConvexShape2D*>();
+	m_freeList = std::vector<ConvexShape2D*>();
+}
+
+
+ShapePool::~ShapePool()
+{
+	Clear();
+}
+
+
+// without a reroll the component slot has to hold the shape's transform already
+ConvexShape2D* ShapePool::Acquire(const int component_idx, const bool reroll)
+{
+	ConvexShape2D* shape = nullptr;
+	if(m_freeList.empty())
+	{
+		shape = ConstructNext();
+	}
+	else
+	{
+		shape = m_freeList.back();
+		m_freeList.pop_back();
+	}
+
+	shape->SetComponentIndex(component_idx);
+	if(reroll)
+	{
+		shape->Revive();
+	}
+	else
+	{
+		shape->ReviveInPlace();
+	}
+
+	return shape;
+}
+
+
+void ShapePool::Release(ConvexShape2D* shape)
+{
+	shape->Die();
+	m_freeList.push_back(shape);
+}
+
+
+// constructs shapes up front so later acquires never touch the allocator
+void ShapePool::Reserve(const int num_shapes)
+{
+	m_freeList.reserve(num_shapes);
+
+	while(GetNumConstructed() < num_shapes)
+	{
+		Release(ConstructNext());
+	}
+}
+
+
+// needs the renderer alive, shapes the mouse has been over own a mesh
+void ShapePool::Clear()
+{
+	const int num_slabs = static_cast<int>(m_slabs.size());
+	for(int slab_idx = 0; slab_idx < num_slabs; ++slab_idx)
+	{
+		const int num_in_slab = slab_idx == num_slabs - 1 ? m_numUsedInLastSlab : SHAPE_POOL_SLAB_SIZE;
+		for(int shape_idx = 0; shape_idx < num_in_slab; ++shape_idx)
+		{
+			m_slabs[slab_idx][shape_idx].~ConvexShape2D();
+		}
+
+		::operator delete(m_slabs[slab_idx], std::align_val_t(alignof(ConvexShape2D)));
+		MemTagFreed(MEM_TAG_SHAPES, sizeof(ConvexShape2D) * SHAPE_POOL_SLAB_SIZE);
+		m_slabs[slab_idx] = nullptr;
+	}
+
+	m_slabs.clear();
+	m_freeList.clear();
+	m_numUsedInLastSlab = SHAPE_POOL_SLAB_SIZE;
+}
+
+
+int ShapePool::GetNumConstructed() const
+{
+	if(m_slabs.empty())
+	{
+		return 0;
+	}
+
+	return (static_cast<int>(m_slabs.size()) - 1) * SHAPE_POOL_SLAB_SIZE + m_numUsedInLastSlab;
+}
+
+
+int ShapePool::GetNumFree() const
+{
+	return static_cast<int>(m_freeList.size());
+}
+
+
+ConvexShape2D* ShapePool::ConstructNext()
+{
+	if(m_numUsedInLastSlab == SHAPE_POOL_SLAB_SIZE)
+	{
+		AddSlab();
+	}
+
+	ConvexShape2D* slot = m_slabs.back() + m_numUsedInLastSlab;
+	ConvexShape2D* shape = new(slot) ConvexShape2D(m_game);
+	++m_numUsedInLastSlab;
+
+	return shape;
+}
+
+
+void ShapePool::AddSlab()
+{
+	// shapes are cache line aligned, so the slab has to be as well
+	void* memory = ::operator new(sizeof(ConvexShape2D) * SHAPE_POOL_SLAB_SIZE, std::align_val_t(alignof(ConvexShape2D)));
+	MemTagAllocated(MEM_TAG_SHAPES, sizeof(ConvexShape2D) * SHAPE_POOL_SLAB_SIZE);
+	m_slabs.push_back(static_cast<ConvexShape2D*>(memory));
+	m_numUsedInLastSlab = 0;
+}
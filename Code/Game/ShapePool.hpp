@@ -0,0 +1,37 @@
+#pragma once
+#include "Game/GameCommon.hpp"
+
+#include <vector>
+
+class Game;
+class ConvexShape2D;
+
+constexpr int SHAPE_POOL_SLAB_SIZE = 256;
+
+// Hands out ConvexShape2Ds from contiguous slabs. Released shapes stay constructed on a free list
+// and are re-rolled in place when acquired again, into whichever ShapeComponents slot the caller gives them.
+class ShapePool
+{
+public:
+	explicit ShapePool(Game* the_game);
+	~ShapePool();
+
+	ConvexShape2D*	Acquire(int component_idx, bool reroll = true);
+	void			Release(ConvexShape2D* shape);
+	void			Reserve(int num_shapes);
+	void			Clear();
+
+	int				GetNumConstructed() const;
+	int				GetNumFree() const;
+
+private:
+	ConvexShape2D*	ConstructNext();
+	void			AddSlab();
+
+private:
+	Game* m_game = nullptr;
+
+	std::vector<ConvexShape2D*>	m_slabs;
+	std::vector<ConvexShape2D*>	m_freeList;
+	int							m_numUsedInLastSlab = SHAPE_POOL_SLAB_SIZE;
+};
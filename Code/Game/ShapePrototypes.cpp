@@ -0,0 +1,164 @@
+#include "Game/ShapePrototypes.hpp"
+#include "Game/MemoryTags.hpp"
+
+#include "Engine/Core/ErrorWarningAssert.hpp"
+#include "Engine/Renderer/GPUMesh.hpp"
+
+
+ShapePrototype::ShapePrototype()
+{
+	m_hull.SetFromPolygon(m_polygon);
+	m_hull.BuildDebugMeshes();
+}
+
+
+// for polygons that were saved rather than rolled
+ShapePrototype::ShapePrototype(const std::vector<Vec2>& ccw_points): m_polygon(ccw_points)
+{
+	m_hull.SetFromCcwPoints(ccw_points);
+	m_hull.BuildDebugMeshes();
+}
+
+
+ShapePrototype::~ShapePrototype()
+{
+	TaggedDelete(MEM_TAG_MESHES, m_mesh);
+}
+
+// prototypes never change once built, so adding and clearing see the same size
+static size_t GetHullBytes(const ShapePrototype& prototype)
+{
+	return sizeof(ShapePrototype)
+		+ prototype.m_polygon.m_points.capacity() * sizeof(Vec2)
+		+ prototype.m_hull.m_planes.capacity() * sizeof(Plane2);
+}
+
+//--------------------------------------------------------------------
+
+ShapePrototypeLibrary::ShapePrototypeLibrary()
+{
+	m_prototypes = std::vector<ShapePrototype*>();
+}
+
+
+ShapePrototypeLibrary::~ShapePrototypeLibrary()
+{
+	Clear();
+}
+
+
+void ShapePrototypeLibrary::Generate(const int num_prototypes)
+{
+	Clear();
+
+	m_prototypes.reserve(num_prototypes);
+	for(int prototype_idx = 0; prototype_idx < num_prototypes; ++prototype_idx)
+	{
+		AddPrototype(new ShapePrototype());
+	}
+
+	BuildDiscMeshes();
+}
+
+
+// point_starts has num_prototypes + 1 entries, prototype i owns points [point_starts[i], point_starts[i + 1])
+void ShapePrototypeLibrary::SetFromPolygons(const float* points_x, const float* points_y, const int* point_starts, const int num_prototypes)
+{
+	Clear();
+
+	m_prototypes.reserve(num_prototypes);
+	std::vector<Vec2> points;
+	for(int prototype_idx = 0; prototype_idx < num_prototypes; ++prototype_idx)
+	{
+		points.clear();
+		for(int point_idx = point_starts[prototype_idx]; point_idx < point_starts[prototype_idx + 1]; ++point_idx)
+		{
+			points.emplace_back(points_x[point_idx], points_y[point_idx]);
+		}
+
+		AddPrototype(new ShapePrototype(points));
+	}
+
+	BuildDiscMeshes();
+}
+
+
+// needs the renderer alive, and no shape may still reference a prototype
+void ShapePrototypeLibrary::Clear()
+{
+	for(int prototype_idx = 0; prototype_idx < static_cast<int>(m_prototypes.size()); ++prototype_idx)
+	{
+		MemTagFreed(MEM_TAG_HULLS, GetHullBytes(*m_prototypes[prototype_idx]));
+		delete m_prototypes[prototype_idx];
+		m_prototypes[prototype_idx] = nullptr;
+	}
+	m_prototypes.clear();
+
+	TaggedDelete(MEM_TAG_MESHES, m_boundsDiscMesh);
+
+	TaggedDelete(MEM_TAG_MESHES, m_collideDiscMesh);
+}
+
+
+int ShapePrototypeLibrary::GetNumPrototypes() const
+{
+	return static_cast<int>(m_prototypes.size());
+}
+
+
+int ShapePrototypeLibrary::GetRandomPrototypeId() const
+{
+	return g_randomNumberGenerator.GetRandomIntInRange(0, GetNumPrototypes() - 1);
+}
+
+
+const ShapePrototype& ShapePrototypeLibrary::GetPrototype(const int prototype_id) const
+{
+	return *m_prototypes[prototype_id];
+}
+
+
+const GPUMesh* ShapePrototypeLibrary::GetBoundsDiscMesh(const bool colliding) const
+{
+	return colliding ? m_collideDiscMesh : m_boundsDiscMesh;
+}
+
+
+void ShapePrototypeLibrary::AddPrototype(ShapePrototype* prototype)
+{
+	const std::vector<Vec2>& points = prototype->m_polygon.m_points;
+	int triangle_set = static_cast<int>(points.size()) - 2;
+
+	CPUMesh convex_mesh;
+	for(int convex_itr = 0; convex_itr < triangle_set; ++convex_itr)
+	{
+		CpuMeshAddTriangle(
+			&convex_mesh,
+			true,
+			points[0],
+			points[convex_itr + 1],
+			points[convex_itr + 2],
+			m_color,
+			convex_itr);
+	}
+
+	prototype->m_mesh = TaggedNew<GPUMesh>(MEM_TAG_MESHES, g_theRenderer);
+	prototype->m_mesh->CreateFromCPUMesh<Vertex_PCU>(convex_mesh); // we won't be updated this;
+
+	MemTagAllocated(MEM_TAG_HULLS, GetHullBytes(*prototype));
+	m_prototypes.push_back(prototype);
+}
+
+
+void ShapePrototypeLibrary::BuildDiscMeshes()
+{
+	CPUMesh disc_mesh;
+	CpuMeshAddDisc(&disc_mesh, m_debugColor, 1.0f);
+	m_boundsDiscMesh = TaggedNew<GPUMesh>(MEM_TAG_MESHES, g_theRenderer);
+	m_boundsDiscMesh->CreateFromCPUMesh<Vertex_PCU>(disc_mesh);
+
+	CPUMesh collide_disc_mesh;
+	CpuMeshAddDisc(&collide_disc_mesh, m_collideColor, 1.0f);
+	m_collideDiscMesh = TaggedNew<GPUMesh>(MEM_TAG_MESHES, g_theRenderer);
+	m_collideDiscMesh->CreateFromCPUMesh<Vertex_PCU>(collide_disc_mesh);
+}
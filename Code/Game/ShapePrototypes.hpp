@@ -0,0 +1,68 @@
+#pragma once
+#include "Game/ConvexShape.hpp"
+
+#include <vector>
+
+class GPUMesh;
+
+// Everything ConvexShape2Ds share. Shapes only differ by the angle sequence RandomCcwPoints rolls,
+// so a small library of these stands in for one polygon, hull and mesh per shape.
+struct ShapePrototype
+{
+public:
+	ShapePrototype();
+	explicit ShapePrototype(const std::vector<Vec2>& ccw_points);
+	~ShapePrototype();
+
+public:
+	ConvexPolygon2D	m_polygon;		// rolled on construction
+	ConvexHull2D	m_hull;
+	GPUMesh*		m_mesh = nullptr;
+};
+
+//--------------------------------------------------------------------
+
+class ShapePrototypeLibrary
+{
+public:
+	ShapePrototypeLibrary();
+	~ShapePrototypeLibrary();
+
+	void Generate(int num_prototypes);
+	void SetFromPolygons(const float* points_x, const float* points_y, const int* point_starts, int num_prototypes);
+	void Clear();
+
+	int						GetNumPrototypes() const;
+	int						GetRandomPrototypeId() const;
+	const ShapePrototype&	GetPrototype(int prototype_id) const;
+	const GPUMesh*			GetBoundsDiscMesh(bool colliding) const;
+
+private:
+	void AddPrototype(ShapePrototype* prototype);
+	void BuildDiscMeshes();
+
+private:
+	std::vector<ShapePrototype*> m_prototypes;
+
+	GPUMesh* m_boundsDiscMesh = nullptr;
+	GPUMesh* m_collideDiscMesh = nullptr;
+
+	Rgba m_color = Rgba(0.0980392156862745f,
+		1.0000000000000000f,
+		0.0980392156862745f,
+		0.3200000000000000f);
+	
+	Rgba m_debugColor = Rgba(
+		0.0784313725490196f,
+		0.7098039215686275f,
+		0.8000000000000000f, 
+		0.2f
+	);
+	
+	Rgba m_collideColor = Rgba(
+		1.0000000000000000f, 
+		0.8980392156862745f,
+		0.0980392156862745f,
+		0.2f
+	);
+};
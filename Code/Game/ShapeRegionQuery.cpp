@@ -0,0 +1,395 @@
+#include "Game/ShapeRegionQuery.hpp"
+#include "Game/DynamicAabbTree.hpp"
+#include "Game/Profiler.hpp"
+#include "Game/ShapeComponents.hpp"
+#include "Game/ShapeOverlap.hpp"
+#include "Game/ShapePrototypes.hpp"
+#include "Game/ShapeSystems.hpp"
+#include "Game/TestScene.hpp"
+
+#include "Engine/Core/ErrorWarningAssert.hpp"
+#include "Engine/Math/MathUtils.hpp"
+
+#include <algorithm>
+
+
+static float GetDistanceSquaredToSegment(const Vec2& point, const Vec2& start, const Vec2& end)
+{
+	const Vec2 edge = end - start;
+	const float length_squared = edge.GetLengthSquared();
+	float fraction = length_squared > 0.0f ? DotProduct(point - start, edge) / length_squared : 0.0f;
+	fraction = fraction < 0.0f ? 0.0f : (fraction > 1.0f ? 1.0f : fraction);
+
+	return (start + edge * fraction - point).GetLengthSquared();
+}
+
+//--------------------------------------------------------------------
+
+ShapeRegionQuery::ShapeRegionQuery() = default;
+ShapeRegionQuery::~ShapeRegionQuery() = default;
+
+
+int ShapeRegionQuery::QueryAabb(const DynamicAabbTree& tree, const ShapeComponents& shapes, const ShapePrototypeLibrary& prototypes,
+	const AABB2& region, int* out_shapes, const int max_shapes)
+{
+	const Vec2 corners[4] = {
+		region.mins,
+		Vec2(region.maxs.x, region.mins.y),
+		region.maxs,
+		Vec2(region.mins.x, region.maxs.y)
+	};
+
+	return QueryPolygon(tree, shapes, prototypes, corners, 4, out_shapes, max_shapes);
+}
+
+
+int ShapeRegionQuery::QueryDisc(const DynamicAabbTree& tree, const ShapeComponents& shapes, const ShapePrototypeLibrary& prototypes,
+	const Vec2& center, const float radius, int* out_shapes, const int max_shapes)
+{
+	PROFILE_SCOPE("ShapeRegionQuery::QueryDisc");
+
+	const Vec2 extents(radius, radius);
+	tree.QueryRegion(AABB2(center - extents, center + extents), m_candidates);
+	m_numCandidates = static_cast<int>(m_candidates.size());
+	m_numExactTests = 0;
+
+	int num_found = 0;
+	for(const int shape_idx : m_candidates)
+	{
+		// every prototype sits on the unit circle, so scale is the bounding radius
+		const float shape_radius = shapes.m_scales[shape_idx];
+		const float distance = (shapes.m_positions[shape_idx] - center).GetLength();
+		if(distance > radius + shape_radius)
+		{
+			continue;
+		}
+
+		if(distance + shape_radius > radius && !DiscOverlapsShape(shapes, prototypes, shape_idx, center, radius))
+		{
+			continue;
+		}
+
+		if(num_found < max_shapes)
+		{
+			out_shapes[num_found] = shape_idx;
+		}
+		++num_found;
+	}
+
+	return num_found;
+}
+
+
+// the polygon has to be convex and counter clockwise
+int ShapeRegionQuery::QueryPolygon(const DynamicAabbTree& tree, const ShapeComponents& shapes, const ShapePrototypeLibrary& prototypes,
+	const Vec2* ccw_points, const int num_points, int* out_shapes, const int max_shapes)
+{
+	PROFILE_SCOPE("ShapeRegionQuery::QueryPolygon");
+	ASSERT_OR_DIE(num_points >= 3, "Region polygons need at least three points");
+
+	AABB2 bounds(ccw_points[0], ccw_points[0]);
+	m_regionPlanes.clear();
+	for(int point_idx = 0; point_idx < num_points; ++point_idx)
+	{
+		const Vec2& start = ccw_points[point_idx];
+		m_regionPlanes.push_back(Plane2(start, ccw_points[(point_idx + 1) % num_points]));
+
+		bounds.mins.x = std::min(bounds.mins.x, start.x);
+		bounds.mins.y = std::min(bounds.mins.y, start.y);
+		bounds.maxs.x = std::max(bounds.maxs.x, start.x);
+		bounds.maxs.y = std::max(bounds.maxs.y, start.y);
+	}
+
+	tree.QueryRegion(bounds, m_candidates);
+	m_numCandidates = static_cast<int>(m_candidates.size());
+	m_numExactTests = 0;
+
+	int num_found = 0;
+	for(const int shape_idx : m_candidates)
+	{
+		const Vec2& position = shapes.m_positions[shape_idx];
+		const float shape_radius = shapes.m_scales[shape_idx];
+
+		// the bounding disc is either outside some edge, inside every edge, or straddling
+		bool outside = false;
+		bool inside = true;
+		for(const Plane2& plane : m_regionPlanes)
+		{
+			const float distance = DotProduct(plane.m_normal, position) - plane.m_signedDistance;
+			if(distance > shape_radius)
+			{
+				outside = true;
+				break;
+			}
+
+			inside = inside && distance <= -shape_radius;
+		}
+
+		if(outside || (!inside && !PolygonOverlapsShape(shapes, prototypes, shape_idx, ccw_points, num_points)))
+		{
+			continue;
+		}
+
+		if(num_found < max_shapes)
+		{
+			out_shapes[num_found] = shape_idx;
+		}
+		++num_found;
+	}
+
+	return num_found;
+}
+
+
+// in the shape's local space the disc stays a disc, so it overlaps when the center is inside or near an edge
+bool ShapeRegionQuery::DiscOverlapsShape(const ShapeComponents& shapes, const ShapePrototypeLibrary& prototypes, const int shape_idx,
+	const Vec2& center, const float radius)
+{
+	++m_numExactTests;
+
+	if(IsPointInsideShape(shapes, prototypes, shape_idx, center))
+	{
+		return true;
+	}
+
+	const ShapeFrame& frame = shapes.m_frames[shape_idx];
+	const Vec2 local_center = frame.ToLocalPosition(center);
+	const float local_radius = radius * frame.m_invScale;
+	const float local_radius_squared = local_radius * local_radius;
+
+	const std::vector<Vec2>& points = prototypes.GetPrototype(shapes.m_prototypeIds[shape_idx]).m_polygon.m_points;
+	const int num_points = static_cast<int>(points.size());
+	for(int point_idx = 0; point_idx < num_points; ++point_idx)
+	{
+		if(GetDistanceSquaredToSegment(local_center, points[point_idx], points[(point_idx + 1) % num_points]) <= local_radius_squared)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+bool ShapeRegionQuery::PolygonOverlapsShape(const ShapeComponents& shapes, const ShapePrototypeLibrary& prototypes, const int shape_idx,
+	const Vec2* ccw_points, const int num_points)
+{
+	++m_numExactTests;
+
+	const ShapeFrame& frame = shapes.m_frames[shape_idx];
+	const std::vector<Vec2>& local_points = prototypes.GetPrototype(shapes.m_prototypeIds[shape_idx]).m_polygon.m_points;
+	m_shapePoints.clear();
+	bool corner_inside = false;
+	for(const Vec2& local_point : local_points)
+	{
+		const Vec2 world_point = frame.ToWorldPosition(local_point);
+		m_shapePoints.push_back(world_point);
+
+		if(!corner_inside)
+		{
+			corner_inside = true;
+			for(const Plane2& plane : m_regionPlanes)
+			{
+				if(DotProduct(plane.m_normal, world_point) > plane.m_signedDistance)
+				{
+					corner_inside = false;
+					break;
+				}
+			}
+		}
+	}
+
+	// a straddling shape usually has a corner inside, only the rest need the full separating axis test
+	if(corner_inside)
+	{
+		return true;
+	}
+
+	int axis = -1;
+	return ConvexPolygonsOverlap(ccw_points, num_points, m_shapePoints.data(), static_cast<int>(m_shapePoints.size()), axis);
+}
+
+//--------------------------------------------------------------------
+
+struct RegionQueryTestScene
+{
+	ShapePrototypeLibrary	m_prototypes;
+	ShapeComponents			m_shapes;
+	DynamicAabbTree			m_tree;
+};
+
+
+// the queries take the scale as the bounding radius, so the tree gets the same boxes the game would
+static void BuildRegionTestScene(RegionQueryTestScene& scene, uint& random_state, const int num_prototypes, const int num_shapes)
+{
+	BuildTestScene(scene.m_prototypes, scene.m_shapes, random_state, num_prototypes, num_shapes, ConvexShape2D::MIN_SIZE, ConvexShape2D::MAX_SIZE);
+
+	for(int shape_idx = 0; shape_idx < num_shapes; ++shape_idx)
+	{
+		const Vec2& position = scene.m_shapes.m_positions[shape_idx];
+		const Vec2 extents(scene.m_shapes.m_scales[shape_idx], scene.m_shapes.m_scales[shape_idx]);
+		scene.m_tree.CreateProxy(AABB2(position - extents, position + extents), shape_idx);
+	}
+}
+
+
+// in world space, the center is inside every edge or some edge is within the radius
+static bool DiscOverlapsPolygonBruteForce(const Vec2& center, const float radius, const std::vector<Vec2>& ccw_points)
+{
+	const int num_points = static_cast<int>(ccw_points.size());
+	bool inside = true;
+	for(int point_idx = 0; point_idx < num_points; ++point_idx)
+	{
+		const Vec2& start = ccw_points[point_idx];
+		const Vec2& end = ccw_points[(point_idx + 1) % num_points];
+		if(GetDistanceSquaredToSegment(center, start, end) <= radius * radius)
+		{
+			return true;
+		}
+
+		const Vec2 edge = end - start;
+		inside = inside && edge.x * (center.y - start.y) - edge.y * (center.x - start.x) >= 0.0f;
+	}
+
+	return inside;
+}
+
+
+// the count has to match even when the buffer is short, and whatever fits has to be overlapping shapes
+static bool MatchesBruteForce(const std::vector<int>& expected, const std::vector<int>& found, const int num_found, const int max_shapes)
+{
+	if(num_found != static_cast<int>(expected.size()))
+	{
+		return false;
+	}
+
+	std::vector<int> sorted_found(found.begin(), found.begin() + std::min(num_found, max_shapes));
+	std::sort(sorted_found.begin(), sorted_found.end());
+	if(std::adjacent_find(sorted_found.begin(), sorted_found.end()) != sorted_found.end())
+	{
+		return false;
+	}
+
+	return num_found <= max_shapes
+		? sorted_found == expected
+		: std::includes(expected.begin(), expected.end(), sorted_found.begin(), sorted_found.end());
+}
+
+
+UNITTEST("ShapeRegionQuery box queries match brute force", "ShapeRegionQuery", 0)
+{
+	constexpr int num_shapes = 400;
+	uint random_state = 0x9E3779B9u;
+	RegionQueryTestScene scene;
+	BuildRegionTestScene(scene, random_state, 8, num_shapes);
+
+	ShapeRegionQuery query;
+	std::vector<int> found(num_shapes);
+	std::vector<int> expected;
+	std::vector<Vec2> shape_points;
+	for(int query_idx = 0; query_idx < 100; ++query_idx)
+	{
+		const Vec2 mins = GetTestWorldPosition(random_state);
+		const AABB2 region(mins, mins + Vec2(1.0f + NextTestRandom(random_state) * 40.0f, 1.0f + NextTestRandom(random_state) * 40.0f));
+		const Vec2 corners[4] = { region.mins, Vec2(region.maxs.x, region.mins.y), region.maxs, Vec2(region.mins.x, region.maxs.y) };
+
+		expected.clear();
+		for(int shape_idx = 0; shape_idx < num_shapes; ++shape_idx)
+		{
+			GetTestWorldPoints(scene.m_prototypes, scene.m_shapes, shape_idx, shape_points);
+			if(TestPolygonsOverlap(corners, 4, shape_points.data(), static_cast<int>(shape_points.size())))
+			{
+				expected.push_back(shape_idx);
+			}
+		}
+
+		const int max_shapes = query_idx % 4 == 0 ? 3 : num_shapes;
+		const int num_found = query.QueryAabb(scene.m_tree, scene.m_shapes, scene.m_prototypes, region, found.data(), max_shapes);
+		if(!MatchesBruteForce(expected, found, num_found, max_shapes))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+UNITTEST("ShapeRegionQuery disc queries match brute force", "ShapeRegionQuery", 0)
+{
+	constexpr int num_shapes = 400;
+	uint random_state = 0x2545F491u;
+	RegionQueryTestScene scene;
+	BuildRegionTestScene(scene, random_state, 8, num_shapes);
+
+	ShapeRegionQuery query;
+	std::vector<int> found(num_shapes);
+	std::vector<int> expected;
+	std::vector<Vec2> shape_points;
+	for(int query_idx = 0; query_idx < 100; ++query_idx)
+	{
+		const Vec2 center = GetTestWorldPosition(random_state);
+		const float radius = 0.5f + NextTestRandom(random_state) * 25.0f;
+
+		expected.clear();
+		for(int shape_idx = 0; shape_idx < num_shapes; ++shape_idx)
+		{
+			GetTestWorldPoints(scene.m_prototypes, scene.m_shapes, shape_idx, shape_points);
+			if(DiscOverlapsPolygonBruteForce(center, radius, shape_points))
+			{
+				expected.push_back(shape_idx);
+			}
+		}
+
+		const int max_shapes = query_idx % 4 == 0 ? 3 : num_shapes;
+		const int num_found = query.QueryDisc(scene.m_tree, scene.m_shapes, scene.m_prototypes, center, radius, found.data(), max_shapes);
+		if(!MatchesBruteForce(expected, found, num_found, max_shapes))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+UNITTEST("ShapeRegionQuery polygon queries match brute force", "ShapeRegionQuery", 0)
+{
+	constexpr int num_shapes = 400;
+	uint random_state = 0x7F4A7C15u;
+	RegionQueryTestScene scene;
+	BuildRegionTestScene(scene, random_state, 8, num_shapes);
+
+	ShapeRegionQuery query;
+	std::vector<int> found(num_shapes);
+	std::vector<int> expected;
+	std::vector<Vec2> region_points;
+	std::vector<Vec2> shape_points;
+	for(int query_idx = 0; query_idx < 100; ++query_idx)
+	{
+		const Vec2 center = GetTestWorldPosition(random_state);
+		region_points.clear();
+		AddTestCirclePoints(random_state, center, 1.0f + NextTestRandom(random_state) * 30.0f, 3 + query_idx % 6, region_points);
+		const int num_region_points = static_cast<int>(region_points.size());
+
+		expected.clear();
+		for(int shape_idx = 0; shape_idx < num_shapes; ++shape_idx)
+		{
+			GetTestWorldPoints(scene.m_prototypes, scene.m_shapes, shape_idx, shape_points);
+			if(TestPolygonsOverlap(region_points.data(), num_region_points, shape_points.data(), static_cast<int>(shape_points.size())))
+			{
+				expected.push_back(shape_idx);
+			}
+		}
+
+		const int max_shapes = query_idx % 4 == 0 ? 3 : num_shapes;
+		const int num_found = query.QueryPolygon(scene.m_tree, scene.m_shapes, scene.m_prototypes,
+			region_points.data(), num_region_points, found.data(), max_shapes);
+		if(!MatchesBruteForce(expected, found, num_found, max_shapes))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include "Engine/Math/AABB2.hpp"
+#include "Engine/Math/Plane2.hpp"
+#include "Engine/Math/Vec2.hpp"
+
+#include "Game/MemoryTags.hpp"
+
+#include <vector>
+
+struct ShapeComponents;
+class DynamicAabbTree;
+class ShapePrototypeLibrary;
+
+// Every shape overlapping a box, disc or convex polygon. The shape tree culls by fat bounds, the
+// shapes' bounding discs cull again, and only shapes straddling the region's edge get an exact test.
+// Shape indices go into the caller's buffer in no particular order. The return value is how many
+// shapes overlap, which is more than max_shapes when the buffer was too small.
+class ShapeRegionQuery
+{
+public:
+	ShapeRegionQuery();
+	~ShapeRegionQuery();
+
+	int		QueryAabb(const DynamicAabbTree& tree, const ShapeComponents& shapes, const ShapePrototypeLibrary& prototypes,
+				const AABB2& region, int* out_shapes, int max_shapes);
+	int		QueryDisc(const DynamicAabbTree& tree, const ShapeComponents& shapes, const ShapePrototypeLibrary& prototypes,
+				const Vec2& center, float radius, int* out_shapes, int max_shapes);
+	int		QueryPolygon(const DynamicAabbTree& tree, const ShapeComponents& shapes, const ShapePrototypeLibrary& prototypes,
+				const Vec2* ccw_points, int num_points, int* out_shapes, int max_shapes);
+
+	int		GetNumCandidates() const		{ return m_numCandidates; }
+	int		GetNumExactTests() const		{ return m_numExactTests; }
+
+private:
+	bool	DiscOverlapsShape(const ShapeComponents& shapes, const ShapePrototypeLibrary& prototypes, int shape_idx, const Vec2& center, float radius);
+	bool	PolygonOverlapsShape(const ShapeComponents& shapes, const ShapePrototypeLibrary& prototypes, int shape_idx, const Vec2* ccw_points, int num_points);
+
+private:
+	TaggedVector<int, MEM_TAG_SCRATCH>		m_candidates;
+	TaggedVector<Plane2, MEM_TAG_SCRATCH>	m_regionPlanes;		// outward edge planes of the query polygon
+	TaggedVector<Vec2, MEM_TAG_SCRATCH>		m_shapePoints;		// one candidate's polygon in world space
+
+	int m_numCandidates = 0;
+	int m_numExactTests = 0;
+};
@@ -0,0 +1,599 @@
+#include "Game/ShapeSnapshotCodec.hpp"
+#include "Game/BitStream.hpp"
+#include "Game/ByteBufferParser.hpp"
+#include "Game/ConvexShape.hpp"
+#include "Game/Profiler.hpp"
+#include "Game/ShapeComponents.hpp"
+#include "Game/TestScene.hpp"
+
+#include <cmath>
+#include <utility>
+
+constexpr int SNAPSHOT_POSITION_SMALL_BITS = 6;
+constexpr int SNAPSHOT_ORIENTATION_SMALL_BITS = 6;
+constexpr int SNAPSHOT_SCALE_SMALL_BITS = 4;
+constexpr size_t SNAPSHOT_HEADER_SIZE = 4 * sizeof(uint);
+
+constexpr uint SNAPSHOT_CHANGED_X = 1 << 0;
+constexpr uint SNAPSHOT_CHANGED_Y = 1 << 1;
+constexpr uint SNAPSHOT_CHANGED_ORIENTATION = 1 << 2;
+constexpr uint SNAPSHOT_CHANGED_SCALE = 1 << 3;
+constexpr int SNAPSHOT_CHANGED_BITS = 4;
+
+
+static uint16_t QuantizeRange(const float value, const float min, const float max, const int num_bits)
+{
+	const float max_steps = static_cast<float>((1 << num_bits) - 1);
+	float steps = floorf((value - min) / (max - min) * max_steps + 0.5f);
+	steps = steps < 0.0f ? 0.0f : (steps > max_steps ? max_steps : steps);
+	return static_cast<uint16_t>(steps);
+}
+
+
+static float DequantizeRange(const uint16_t value, const float min, const float max, const int num_bits)
+{
+	return min + static_cast<float>(value) * (max - min) / static_cast<float>((1 << num_bits) - 1);
+}
+
+
+// deltas wrap at the field's width, so a short step across the orientation seam stays short
+static void WriteField(BitWriter& bits, const uint16_t baseline, const uint16_t value, const int num_bits, const int num_small_bits)
+{
+	const int field_range = 1 << num_bits;
+	int delta = (static_cast<int>(value) - static_cast<int>(baseline)) & (field_range - 1);
+	if(delta >= field_range / 2)
+	{
+		delta -= field_range;
+	}
+
+	const uint zigzag = delta >= 0 ? static_cast<uint>(delta) << 1 : (static_cast<uint>(-delta) << 1) - 1;
+	if(zigzag < (1u << num_small_bits))
+	{
+		bits.WriteBit(false);
+		bits.WriteBits(zigzag, num_small_bits);
+	}
+	else
+	{
+		bits.WriteBit(true);
+		bits.WriteBits(value, num_bits);
+	}
+}
+
+
+static uint16_t ReadField(BitReader& bits, const uint16_t baseline, const int num_bits, const int num_small_bits)
+{
+	if(bits.ReadBit())
+	{
+		return static_cast<uint16_t>(bits.ReadBits(num_bits));
+	}
+
+	const uint zigzag = bits.ReadBits(num_small_bits);
+	const int delta = (zigzag & 1) != 0 ? -static_cast<int>((zigzag + 1) >> 1) : static_cast<int>(zigzag >> 1);
+	return static_cast<uint16_t>((static_cast<int>(baseline) + delta) & ((1 << num_bits) - 1));
+}
+
+
+static double TicksToMs(const uint64_t ticks)
+{
+	return ProfilerTicksToMicroseconds(ticks) * 0.001;
+}
+
+//--------------------------------------------------------------------
+
+void QuantizedShapeTransforms::Quantize(const Vec2* positions, const float* orientations, const float* scales, const int num_shapes)
+{
+	Resize(num_shapes);
+
+	const int orientation_mask = (1 << SNAPSHOT_ORIENTATION_BITS) - 1;
+	const float orientation_steps = static_cast<float>(1 << SNAPSHOT_ORIENTATION_BITS) / 360.0f;
+	for(int shape_idx = 0; shape_idx < num_shapes; ++shape_idx)
+	{
+		m_positionsX[shape_idx] = QuantizeRange(positions[shape_idx].x, WORLD_BL_CORNER.x, WORLD_TR_CORNER.x, SNAPSHOT_POSITION_BITS);
+		m_positionsY[shape_idx] = QuantizeRange(positions[shape_idx].y, WORLD_BL_CORNER.y, WORLD_TR_CORNER.y, SNAPSHOT_POSITION_BITS);
+		m_orientations[shape_idx] = static_cast<uint16_t>(static_cast<int>(floorf(orientations[shape_idx] * orientation_steps + 0.5f)) & orientation_mask);
+		m_scales[shape_idx] = QuantizeRange(scales[shape_idx], ConvexShape2D::MIN_SIZE, ConvexShape2D::MAX_SIZE, SNAPSHOT_SCALE_BITS);
+	}
+}
+
+
+void QuantizedShapeTransforms::Dequantize(std::vector<Vec2>& out_positions, std::vector<float>& out_orientations, std::vector<float>& out_scales) const
+{
+	const int num_shapes = GetCount();
+	out_positions.resize(num_shapes);
+	out_orientations.resize(num_shapes);
+	out_scales.resize(num_shapes);
+
+	const float degrees_per_step = 360.0f / static_cast<float>(1 << SNAPSHOT_ORIENTATION_BITS);
+	for(int shape_idx = 0; shape_idx < num_shapes; ++shape_idx)
+	{
+		out_positions[shape_idx] = Vec2(
+			DequantizeRange(m_positionsX[shape_idx], WORLD_BL_CORNER.x, WORLD_TR_CORNER.x, SNAPSHOT_POSITION_BITS),
+			DequantizeRange(m_positionsY[shape_idx], WORLD_BL_CORNER.y, WORLD_TR_CORNER.y, SNAPSHOT_POSITION_BITS));
+		out_orientations[shape_idx] = static_cast<float>(m_orientations[shape_idx]) * degrees_per_step;
+		out_scales[shape_idx] = DequantizeRange(m_scales[shape_idx], ConvexShape2D::MIN_SIZE, ConvexShape2D::MAX_SIZE, SNAPSHOT_SCALE_BITS);
+	}
+}
+
+
+// shapes past the old count start at zero, the same baseline a new shape is encoded against
+void QuantizedShapeTransforms::Resize(const int num_shapes)
+{
+	m_positionsX.resize(num_shapes, 0);
+	m_positionsY.resize(num_shapes, 0);
+	m_orientations.resize(num_shapes, 0);
+	m_scales.resize(num_shapes, 0);
+}
+
+
+bool QuantizedShapeTransforms::Equals(const QuantizedShapeTransforms& other) const
+{
+	return m_positionsX == other.m_positionsX
+		&& m_positionsY == other.m_positionsY
+		&& m_orientations == other.m_orientations
+		&& m_scales == other.m_scales;
+}
+
+//--------------------------------------------------------------------
+
+ShapeSnapshotEncoder::ShapeSnapshotEncoder() = default;
+ShapeSnapshotEncoder::~ShapeSnapshotEncoder() = default;
+
+
+int ShapeSnapshotEncoder::Encode(const ShapeComponents& shapes, ByteBufferWriter& writer)
+{
+	return Encode(shapes.m_positions.data(), shapes.m_orientationDegrees.data(), shapes.m_scales.data(), shapes.GetCount(), writer);
+}
+
+
+// header is tick, baseline tick, shape count and changed count, then the bit packed changes
+int ShapeSnapshotEncoder::Encode(const Vec2* positions, const float* orientations, const float* scales, const int num_shapes, ByteBufferWriter& writer)
+{
+	PROFILE_SCOPE("ShapeSnapshotEncoder::Encode");
+
+	const int tick = m_nextTick++;
+	m_current.Quantize(positions, orientations, scales, num_shapes);
+	m_current.m_tick = tick;
+
+	const QuantizedShapeTransforms* sent_baseline = GetSent(m_ackedTick);
+	const QuantizedShapeTransforms& baseline = sent_baseline != nullptr ? *sent_baseline : m_emptyBaseline;
+	const int num_baseline = baseline.GetCount();
+
+	writer.WriteUnsignedInt(static_cast<uint>(tick));
+	writer.WriteInt(sent_baseline != nullptr ? baseline.m_tick : SNAPSHOT_NO_BASELINE);
+	writer.WriteInt(num_shapes);
+	const size_t changed_slot = writer.ReserveSlot<uint>();
+
+	BitWriter bits(writer);
+	int num_changed = 0;
+	int last_changed = -1;
+	for(int shape_idx = 0; shape_idx < num_shapes; ++shape_idx)
+	{
+		const bool in_baseline = shape_idx < num_baseline;
+		const uint16_t base_x = in_baseline ? baseline.m_positionsX[shape_idx] : 0;
+		const uint16_t base_y = in_baseline ? baseline.m_positionsY[shape_idx] : 0;
+		const uint16_t base_orientation = in_baseline ? baseline.m_orientations[shape_idx] : 0;
+		const uint16_t base_scale = in_baseline ? baseline.m_scales[shape_idx] : 0;
+
+		uint changed = 0;
+		changed |= m_current.m_positionsX[shape_idx] != base_x ? SNAPSHOT_CHANGED_X : 0;
+		changed |= m_current.m_positionsY[shape_idx] != base_y ? SNAPSHOT_CHANGED_Y : 0;
+		changed |= m_current.m_orientations[shape_idx] != base_orientation ? SNAPSHOT_CHANGED_ORIENTATION : 0;
+		changed |= m_current.m_scales[shape_idx] != base_scale ? SNAPSHOT_CHANGED_SCALE : 0;
+		if(changed == 0)
+		{
+			continue;
+		}
+
+		bits.WriteExpGolomb(static_cast<uint>(shape_idx - last_changed - 1));
+		bits.WriteBits(changed, SNAPSHOT_CHANGED_BITS);
+		if(changed & SNAPSHOT_CHANGED_X)
+		{
+			WriteField(bits, base_x, m_current.m_positionsX[shape_idx], SNAPSHOT_POSITION_BITS, SNAPSHOT_POSITION_SMALL_BITS);
+		}
+		if(changed & SNAPSHOT_CHANGED_Y)
+		{
+			WriteField(bits, base_y, m_current.m_positionsY[shape_idx], SNAPSHOT_POSITION_BITS, SNAPSHOT_POSITION_SMALL_BITS);
+		}
+		if(changed & SNAPSHOT_CHANGED_ORIENTATION)
+		{
+			WriteField(bits, base_orientation, m_current.m_orientations[shape_idx], SNAPSHOT_ORIENTATION_BITS, SNAPSHOT_ORIENTATION_SMALL_BITS);
+		}
+		if(changed & SNAPSHOT_CHANGED_SCALE)
+		{
+			WriteField(bits, base_scale, m_current.m_scales[shape_idx], SNAPSHOT_SCALE_BITS, SNAPSHOT_SCALE_SMALL_BITS);
+		}
+
+		last_changed = shape_idx;
+		++num_changed;
+	}
+
+	bits.Finish();
+	writer.PatchValue<uint>(changed_slot, static_cast<uint>(num_changed));
+	m_numChangedLastTick = num_changed;
+
+	// the slot may still hold the acked baseline, it is only replaced once the packet is written
+	std::swap(m_history[tick % SNAPSHOT_HISTORY], m_current);
+	return tick;
+}
+
+
+void ShapeSnapshotEncoder::Acknowledge(const int tick)
+{
+	if(tick > m_ackedTick && tick < m_nextTick)
+	{
+		m_ackedTick = tick;
+	}
+}
+
+
+void ShapeSnapshotEncoder::Reset()
+{
+	for(int slot_idx = 0; slot_idx < SNAPSHOT_HISTORY; ++slot_idx)
+	{
+		m_history[slot_idx].m_tick = SNAPSHOT_NO_BASELINE;
+	}
+
+	m_nextTick = 0;
+	m_ackedTick = SNAPSHOT_NO_BASELINE;
+	m_numChangedLastTick = 0;
+}
+
+
+const QuantizedShapeTransforms* ShapeSnapshotEncoder::GetSent(const int tick) const
+{
+	if(tick < 0)
+	{
+		return nullptr;
+	}
+
+	const QuantizedShapeTransforms& sent = m_history[tick % SNAPSHOT_HISTORY];
+	return sent.m_tick == tick ? &sent : nullptr;
+}
+
+//--------------------------------------------------------------------
+
+ShapeSnapshotDecoder::ShapeSnapshotDecoder() = default;
+ShapeSnapshotDecoder::~ShapeSnapshotDecoder() = default;
+
+
+bool ShapeSnapshotDecoder::Decode(const uchar* data, const size_t size, int& out_tick)
+{
+	PROFILE_SCOPE("ShapeSnapshotDecoder::Decode");
+
+	ByteBufferParser parser(data, size);
+	if(!parser.HasBytes(SNAPSHOT_HEADER_SIZE))
+	{
+		return false;
+	}
+
+	const int tick = static_cast<int>(parser.ParseUnsignedInt());
+	const int baseline_tick = parser.ParseInt();
+	const int num_shapes = parser.ParseInt();
+	const uint num_changed = parser.ParseUnsignedInt();
+	if(tick < 0 || num_shapes < 0 || num_changed > static_cast<uint>(num_shapes))
+	{
+		return false;
+	}
+
+	const QuantizedShapeTransforms* baseline = &m_emptyBaseline;
+	if(baseline_tick != SNAPSHOT_NO_BASELINE)
+	{
+		baseline = GetReceived(baseline_tick);
+		if(baseline == nullptr)
+		{
+			return false;
+		}
+	}
+
+	m_decoded.m_positionsX.assign(baseline->m_positionsX.begin(), baseline->m_positionsX.end());
+	m_decoded.m_positionsY.assign(baseline->m_positionsY.begin(), baseline->m_positionsY.end());
+	m_decoded.m_orientations.assign(baseline->m_orientations.begin(), baseline->m_orientations.end());
+	m_decoded.m_scales.assign(baseline->m_scales.begin(), baseline->m_scales.end());
+	m_decoded.Resize(num_shapes);
+	m_decoded.m_tick = tick;
+
+	BitReader bits(parser);
+	int shape_idx = -1;
+	for(uint changed_idx = 0; changed_idx < num_changed; ++changed_idx)
+	{
+		shape_idx += static_cast<int>(bits.ReadExpGolomb()) + 1;
+		if(bits.HasOverflowed() || shape_idx >= num_shapes)
+		{
+			return false;
+		}
+
+		const uint changed = bits.ReadBits(SNAPSHOT_CHANGED_BITS);
+		if(changed & SNAPSHOT_CHANGED_X)
+		{
+			m_decoded.m_positionsX[shape_idx] = ReadField(bits, m_decoded.m_positionsX[shape_idx], SNAPSHOT_POSITION_BITS, SNAPSHOT_POSITION_SMALL_BITS);
+		}
+		if(changed & SNAPSHOT_CHANGED_Y)
+		{
+			m_decoded.m_positionsY[shape_idx] = ReadField(bits, m_decoded.m_positionsY[shape_idx], SNAPSHOT_POSITION_BITS, SNAPSHOT_POSITION_SMALL_BITS);
+		}
+		if(changed & SNAPSHOT_CHANGED_ORIENTATION)
+		{
+			m_decoded.m_orientations[shape_idx] = ReadField(bits, m_decoded.m_orientations[shape_idx], SNAPSHOT_ORIENTATION_BITS, SNAPSHOT_ORIENTATION_SMALL_BITS);
+		}
+		if(changed & SNAPSHOT_CHANGED_SCALE)
+		{
+			m_decoded.m_scales[shape_idx] = ReadField(bits, m_decoded.m_scales[shape_idx], SNAPSHOT_SCALE_BITS, SNAPSHOT_SCALE_SMALL_BITS);
+		}
+	}
+
+	if(bits.HasOverflowed())
+	{
+		return false;
+	}
+	bits.Finish();
+
+	std::swap(m_history[tick % SNAPSHOT_HISTORY], m_decoded);
+	if(tick > m_latestTick)
+	{
+		m_latestTick = tick;
+	}
+
+	out_tick = tick;
+	return true;
+}
+
+
+void ShapeSnapshotDecoder::Reset()
+{
+	for(int slot_idx = 0; slot_idx < SNAPSHOT_HISTORY; ++slot_idx)
+	{
+		m_history[slot_idx].m_tick = SNAPSHOT_NO_BASELINE;
+	}
+
+	m_latestTick = SNAPSHOT_NO_BASELINE;
+}
+
+
+const QuantizedShapeTransforms* ShapeSnapshotDecoder::GetReceived(const int tick) const
+{
+	if(tick < 0)
+	{
+		return nullptr;
+	}
+
+	const QuantizedShapeTransforms& received = m_history[tick % SNAPSHOT_HISTORY];
+	return received.m_tick == tick ? &received : nullptr;
+}
+
+
+const QuantizedShapeTransforms* ShapeSnapshotDecoder::GetLatest() const
+{
+	return GetReceived(m_latestTick);
+}
+
+//--------------------------------------------------------------------
+
+ShapeSnapshotLoopback::ShapeSnapshotLoopback() = default;
+ShapeSnapshotLoopback::~ShapeSnapshotLoopback() = default;
+
+
+void ShapeSnapshotLoopback::Tick(const ShapeComponents& shapes)
+{
+	Tick(shapes.m_positions.data(), shapes.m_orientationDegrees.data(), shapes.m_scales.data(), shapes.GetCount());
+}
+
+
+void ShapeSnapshotLoopback::Tick(const Vec2* positions, const float* orientations, const float* scales, const int num_shapes)
+{
+	++m_numTicks;
+
+	m_writer.Clear();
+	const uint64_t encode_start = ProfilerGetTicks();
+	const int tick = m_encoder.Encode(positions, orientations, scales, num_shapes, m_writer);
+	m_encodeMs += TicksToMs(ProfilerGetTicks() - encode_start);
+
+	m_lastPacketBytes = static_cast<int>(m_writer.GetSize());
+	m_totalBytes += m_writer.GetSize();
+
+	if(m_dropEvery > 0 && tick % m_dropEvery == m_dropEvery - 1)
+	{
+		++m_numDropped;
+	}
+	else
+	{
+		m_inFlight.emplace_back();
+		m_inFlight.back().m_deliverTick = m_numTicks + m_latencyTicks;
+		m_inFlight.back().m_bytes.assign(m_writer.GetData(), m_writer.GetData() + m_writer.GetSize());
+	}
+
+	while(!m_inFlight.empty() && m_inFlight.front().m_deliverTick <= m_numTicks)
+	{
+		const std::vector<uchar>& packet = m_inFlight.front().m_bytes;
+		int received_tick = SNAPSHOT_NO_BASELINE;
+
+		const uint64_t decode_start = ProfilerGetTicks();
+		const bool decoded = m_decoder.Decode(packet.data(), packet.size(), received_tick);
+		m_decodeMs += TicksToMs(ProfilerGetTicks() - decode_start);
+
+		if(decoded)
+		{
+			const QuantizedShapeTransforms* sent = m_encoder.GetSent(received_tick);
+			if(sent != nullptr && !sent->Equals(*m_decoder.GetReceived(received_tick)))
+			{
+				++m_numMismatches;
+			}
+
+			SnapshotAck ack;
+			ack.m_deliverTick = m_numTicks + m_latencyTicks;
+			ack.m_ackedTick = received_tick;
+			m_acksInFlight.push_back(ack);
+		}
+		else
+		{
+			++m_numRejected;
+		}
+
+		m_inFlight.pop_front();
+	}
+
+	while(!m_acksInFlight.empty() && m_acksInFlight.front().m_deliverTick <= m_numTicks)
+	{
+		m_encoder.Acknowledge(m_acksInFlight.front().m_ackedTick);
+		m_acksInFlight.pop_front();
+	}
+}
+
+
+void ShapeSnapshotLoopback::Reset()
+{
+	m_encoder.Reset();
+	m_decoder.Reset();
+	m_inFlight.clear();
+	m_acksInFlight.clear();
+
+	m_numTicks = 0;
+	m_lastPacketBytes = 0;
+	m_totalBytes = 0;
+	m_numDropped = 0;
+	m_numRejected = 0;
+	m_numMismatches = 0;
+	m_encodeMs = 0.0;
+	m_decodeMs = 0.0;
+}
+
+//--------------------------------------------------------------------
+
+// own generator so a benchmark in the middle of a recording leaves the game's random stream alone
+SnapshotBenchmarkResult RunSnapshotBenchmark(const ShapeComponents& shapes, const int num_ticks, const float changed_fraction)
+{
+	std::vector<Vec2> positions(shapes.m_positions.begin(), shapes.m_positions.end());
+	std::vector<float> orientations(shapes.m_orientationDegrees.begin(), shapes.m_orientationDegrees.end());
+	std::vector<float> scales(shapes.m_scales.begin(), shapes.m_scales.end());
+	const int num_shapes = shapes.GetCount();
+
+	uint random_state = 0x9E3779B9u;
+
+	ShapeSnapshotLoopback loopback;
+	loopback.SetLatencyTicks(1);
+
+	const int num_changed = static_cast<int>(static_cast<float>(num_shapes) * changed_fraction);
+	for(int tick_idx = 0; tick_idx < num_ticks; ++tick_idx)
+	{
+		for(int changed_idx = 0; changed_idx < num_changed && num_shapes > 0; ++changed_idx)
+		{
+			const int shape_idx = static_cast<int>(NextTestRandom(random_state) * static_cast<float>(num_shapes));
+			positions[shape_idx] += Vec2(NextTestRandom(random_state) - 0.5f, NextTestRandom(random_state) - 0.5f);
+			orientations[shape_idx] = fmodf(orientations[shape_idx] + NextTestRandom(random_state) * 5.0f, 360.0f);
+		}
+
+		loopback.Tick(positions.data(), orientations.data(), scales.data(), num_shapes);
+	}
+
+	SnapshotBenchmarkResult result;
+	result.m_numTicks = num_ticks;
+	result.m_numShapes = num_shapes;
+	result.m_totalBytes = loopback.GetTotalBytes();
+	result.m_encodeMs = loopback.GetEncodeMs();
+	result.m_decodeMs = loopback.GetDecodeMs();
+	result.m_numMismatches = loopback.GetNumMismatches();
+	return result;
+}
+
+//--------------------------------------------------------------------
+
+// acks arrive two ticks late and every fifth packet is lost, so ticks decode against a spread of
+// older baselines; the shape count grows partway so new shapes go out against the zero baseline
+UNITTEST("ShapeSnapshotCodec decodes bit exact transforms against acked baselines", "ShapeSnapshotCodec", 0)
+{
+	constexpr int max_shapes = 200;
+	constexpr int num_ticks = 3 * SNAPSHOT_HISTORY;
+
+	uint random_state = 0x2545F491u;
+
+	std::vector<Vec2> positions(max_shapes);
+	std::vector<float> orientations(max_shapes);
+	std::vector<float> scales(max_shapes);
+	for(int shape_idx = 0; shape_idx < max_shapes; ++shape_idx)
+	{
+		positions[shape_idx] = GetTestWorldPosition(random_state);
+		orientations[shape_idx] = NextTestRandom(random_state) * 360.0f;
+		scales[shape_idx] = ConvexShape2D::MIN_SIZE + NextTestRandom(random_state) * (ConvexShape2D::MAX_SIZE - ConvexShape2D::MIN_SIZE);
+	}
+
+	ShapeSnapshotEncoder encoder;
+	ShapeSnapshotDecoder decoder;
+	ByteBufferWriter writer;
+	std::deque<int> pending_acks;
+	size_t full_packet_bytes = 0;
+	size_t delta_packet_bytes = 0;
+	int num_delta_packets = 0;
+
+	for(int tick_idx = 0; tick_idx < num_ticks; ++tick_idx)
+	{
+		const int num_shapes = tick_idx < num_ticks / 2 ? max_shapes * 3 / 4 : max_shapes;
+
+		// a few small moves, and one shape teleports so some fields go out in full
+		for(int move_idx = 0; move_idx < 10; ++move_idx)
+		{
+			const int shape_idx = static_cast<int>(NextTestRandom(random_state) * static_cast<float>(num_shapes));
+			positions[shape_idx] += Vec2(NextTestRandom(random_state) - 0.5f, NextTestRandom(random_state) - 0.5f);
+			orientations[shape_idx] = fmodf(orientations[shape_idx] + 359.0f + NextTestRandom(random_state) * 2.0f, 360.0f);
+		}
+		const int jump_idx = static_cast<int>(NextTestRandom(random_state) * static_cast<float>(num_shapes));
+		positions[jump_idx] = GetTestWorldPosition(random_state);
+		scales[jump_idx] = ConvexShape2D::MIN_SIZE + NextTestRandom(random_state) * (ConvexShape2D::MAX_SIZE - ConvexShape2D::MIN_SIZE);
+
+		const bool has_baseline = encoder.GetAckedTick() != SNAPSHOT_NO_BASELINE;
+		writer.Clear();
+		const int tick = encoder.Encode(positions.data(), orientations.data(), scales.data(), num_shapes, writer);
+		if(tick_idx == 0)
+		{
+			full_packet_bytes = writer.GetSize();
+		}
+		else if(has_baseline)
+		{
+			delta_packet_bytes += writer.GetSize();
+			++num_delta_packets;
+		}
+
+		if(tick % 5 == 4)
+		{
+			continue;
+		}
+
+		int decoded_tick = SNAPSHOT_NO_BASELINE;
+		if(!decoder.Decode(writer.GetData(), writer.GetSize(), decoded_tick) || decoded_tick != tick)
+		{
+			return false;
+		}
+
+		QuantizedShapeTransforms expected;
+		expected.Quantize(positions.data(), orientations.data(), scales.data(), num_shapes);
+		const QuantizedShapeTransforms* sent = encoder.GetSent(tick);
+		const QuantizedShapeTransforms* received = decoder.GetReceived(tick);
+		if(sent == nullptr || received == nullptr || !received->Equals(*sent) || !received->Equals(expected))
+		{
+			return false;
+		}
+
+		std::vector<Vec2> sent_positions;
+		std::vector<float> sent_orientations;
+		std::vector<float> sent_scales;
+		std::vector<Vec2> received_positions;
+		std::vector<float> received_orientations;
+		std::vector<float> received_scales;
+		sent->Dequantize(sent_positions, sent_orientations, sent_scales);
+		received->Dequantize(received_positions, received_orientations, received_scales);
+		if(memcmp(sent_positions.data(), received_positions.data(), num_shapes * sizeof(Vec2)) != 0
+			|| memcmp(sent_orientations.data(), received_orientations.data(), num_shapes * sizeof(float)) != 0
+			|| memcmp(sent_scales.data(), received_scales.data(), num_shapes * sizeof(float)) != 0)
+		{
+			return false;
+		}
+
+		pending_acks.push_back(tick);
+		if(pending_acks.size() > 2)
+		{
+			encoder.Acknowledge(pending_acks.front());
+			pending_acks.pop_front();
+		}
+	}
+
+	// deltas against a baseline have to average well under a full snapshot, or the history went unused
+	return num_delta_packets > 0 && delta_packet_bytes * 4 < full_packet_bytes * num_delta_packets;
+}
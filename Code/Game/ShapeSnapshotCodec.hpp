@@ -0,0 +1,162 @@
+#pragma once
+#include "Engine/Math/Vec2.hpp"
+
+#include "Game/ByteBufferWriter.hpp"
+#include "Game/GameCommon.hpp"
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+struct ShapeComponents;
+
+constexpr int SNAPSHOT_POSITION_BITS = 16;			// across the world bounds, about 0.003 units
+constexpr int SNAPSHOT_ORIENTATION_BITS = 12;		// about 0.09 degrees
+constexpr int SNAPSHOT_SCALE_BITS = 10;				// across ConvexShape2D's size range
+constexpr int SNAPSHOT_HISTORY = 32;				// ticks either side keeps for baselines, a power of two
+constexpr int SNAPSHOT_NO_BASELINE = -1;
+
+// One tick of shape transforms on the quantization grid, the form both ends keep as baselines
+struct QuantizedShapeTransforms
+{
+public:
+	void	Quantize(const Vec2* positions, const float* orientations, const float* scales, int num_shapes);
+	void	Dequantize(std::vector<Vec2>& out_positions, std::vector<float>& out_orientations, std::vector<float>& out_scales) const;
+	void	Resize(int num_shapes);
+	bool	Equals(const QuantizedShapeTransforms& other) const;
+
+	int		GetCount() const	{ return static_cast<int>(m_positionsX.size()); }
+
+public:
+	int						m_tick = SNAPSHOT_NO_BASELINE;
+	std::vector<uint16_t>	m_positionsX;
+	std::vector<uint16_t>	m_positionsY;
+	std::vector<uint16_t>	m_orientations;
+	std::vector<uint16_t>	m_scales;
+};
+
+//--------------------------------------------------------------------
+
+// Sends each tick as the shapes that differ from the newest tick the receiver acknowledged. Changed
+// shapes are found by index gap, and each field goes as a short delta when it moved a little and
+// in full otherwise. Until something is acknowledged, or once the ack is older than the history,
+// the baseline is an empty scene and every shape goes in full.
+class ShapeSnapshotEncoder
+{
+public:
+	ShapeSnapshotEncoder();
+	~ShapeSnapshotEncoder();
+
+	int		Encode(const ShapeComponents& shapes, ByteBufferWriter& writer);
+	int		Encode(const Vec2* positions, const float* orientations, const float* scales, int num_shapes, ByteBufferWriter& writer);
+	void	Acknowledge(int tick);
+	void	Reset();
+
+	const QuantizedShapeTransforms*	GetSent(int tick) const;
+	int		GetAckedTick() const		{ return m_ackedTick; }
+	int		GetNumChangedLastTick() const	{ return m_numChangedLastTick; }
+
+private:
+	QuantizedShapeTransforms	m_history[SNAPSHOT_HISTORY];
+	QuantizedShapeTransforms	m_current;
+	QuantizedShapeTransforms	m_emptyBaseline;
+	int							m_nextTick = 0;
+	int							m_ackedTick = SNAPSHOT_NO_BASELINE;
+	int							m_numChangedLastTick = 0;
+};
+
+//--------------------------------------------------------------------
+
+// Rebuilds the ticks an encoder sent. A packet whose baseline was never received or has been
+// pushed out of the history is rejected, the sender keeps using an older ack until one lands.
+class ShapeSnapshotDecoder
+{
+public:
+	ShapeSnapshotDecoder();
+	~ShapeSnapshotDecoder();
+
+	bool	Decode(const uchar* data, size_t size, int& out_tick);
+	void	Reset();
+
+	const QuantizedShapeTransforms*	GetReceived(int tick) const;
+	const QuantizedShapeTransforms*	GetLatest() const;
+
+private:
+	QuantizedShapeTransforms	m_history[SNAPSHOT_HISTORY];
+	QuantizedShapeTransforms	m_decoded;
+	QuantizedShapeTransforms	m_emptyBaseline;
+	int							m_latestTick = SNAPSHOT_NO_BASELINE;
+};
+
+//--------------------------------------------------------------------
+
+struct SnapshotPacket
+{
+	int					m_deliverTick = 0;
+	std::vector<uchar>	m_bytes;
+};
+
+struct SnapshotAck
+{
+	int	m_deliverTick = 0;
+	int	m_ackedTick = SNAPSHOT_NO_BASELINE;
+};
+
+// Stand in for the link to a remote viewer. Packets and acks each take a fixed number of ticks and
+// every nth packet can be dropped, every decoded tick is checked against what the encoder sent.
+class ShapeSnapshotLoopback
+{
+public:
+	ShapeSnapshotLoopback();
+	~ShapeSnapshotLoopback();
+
+	void	Tick(const ShapeComponents& shapes);
+	void	Tick(const Vec2* positions, const float* orientations, const float* scales, int num_shapes);
+	void	Reset();
+	void	SetLatencyTicks(int latency_ticks)	{ m_latencyTicks = latency_ticks; }
+	void	SetDropEvery(int drop_every)		{ m_dropEvery = drop_every; }
+
+	const ShapeSnapshotDecoder&	GetDecoder() const	{ return m_decoder; }
+	int			GetNumTicks() const				{ return m_numTicks; }
+	int			GetLastPacketBytes() const		{ return m_lastPacketBytes; }
+	uint64_t	GetTotalBytes() const			{ return m_totalBytes; }
+	int			GetNumDropped() const			{ return m_numDropped; }
+	int			GetNumRejected() const			{ return m_numRejected; }
+	int			GetNumMismatches() const		{ return m_numMismatches; }
+	double		GetEncodeMs() const				{ return m_encodeMs; }
+	double		GetDecodeMs() const				{ return m_decodeMs; }
+
+private:
+	ShapeSnapshotEncoder		m_encoder;
+	ShapeSnapshotDecoder		m_decoder;
+	std::deque<SnapshotPacket>	m_inFlight;
+	std::deque<SnapshotAck>		m_acksInFlight;
+	ByteBufferWriter			m_writer;
+
+	int			m_latencyTicks = 0;
+	int			m_dropEvery = 0;
+
+	int			m_numTicks = 0;
+	int			m_lastPacketBytes = 0;
+	uint64_t	m_totalBytes = 0;
+	int			m_numDropped = 0;
+	int			m_numRejected = 0;
+	int			m_numMismatches = 0;
+	double		m_encodeMs = 0.0;
+	double		m_decodeMs = 0.0;
+};
+
+//--------------------------------------------------------------------
+
+struct SnapshotBenchmarkResult
+{
+	int			m_numTicks = 0;
+	int			m_numShapes = 0;
+	uint64_t	m_totalBytes = 0;
+	double		m_encodeMs = 0.0;
+	double		m_decodeMs = 0.0;
+	int			m_numMismatches = 0;
+};
+
+// moves changed_fraction of the shapes a little every tick and pushes them through a loopback
+SnapshotBenchmarkResult RunSnapshotBenchmark(const ShapeComponents& shapes, int num_ticks, float changed_fraction);
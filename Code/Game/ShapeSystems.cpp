@@ -0,0 +1,272 @@
+#include "Game/ShapeSystems.hpp"
+#include "Game/ShapeComponents.hpp"
+#include "Game/ShapePrototypes.hpp"
+#include "Game/GameCommon.hpp"
+#include "Game/QueryCounters.hpp"
+
+#include "Engine/Math/MathUtils.hpp"
+#include "Engine/Math/Plane2.hpp"
+#include "Engine/Renderer/GPUMesh.hpp"
+#include "Engine/Renderer/Material.hpp"
+#include "Engine/Renderer/RenderContext.hpp"
+
+#include <algorithm>
+
+
+// out_changed gets every shape the point is in now or was in last call, their hover meshes need rebuilding
+void CollideShapesWithPoint(ShapeComponents& shapes, const ShapePrototypeLibrary& prototypes, const Vec2& point,
+	std::vector<int>& out_colliding, std::vector<int>& out_changed)
+{
+	out_colliding.clear();
+	out_changed.clear();
+
+	const int num_shapes = shapes.GetCount();
+	for(int shape_idx = 0; shape_idx < num_shapes; ++shape_idx)
+	{
+		const bool was_colliding = (shapes.m_flags[shape_idx] & SHAPE_FLAG_COLLIDING) != 0;
+
+		// every prototype sits on the unit circle, so scale is the bounding radius
+		const Vec2 offset = point - shapes.m_positions[shape_idx];
+		const float radius = shapes.m_scales[shape_idx];
+		bool colliding = offset.GetLengthSquared() <= radius * radius;
+
+		if(colliding)
+		{
+			colliding = IsPointInsideShape(shapes, prototypes, shape_idx, point);
+		}
+		else
+		{
+			QUERY_COUNT(QUERY_DISC_REJECTIONS);
+		}
+
+		if(colliding)
+		{
+			shapes.m_flags[shape_idx] |= SHAPE_FLAG_COLLIDING;
+			out_colliding.push_back(shape_idx);
+		}
+		else
+		{
+			shapes.m_flags[shape_idx] &= ~SHAPE_FLAG_COLLIDING;
+		}
+
+		if(colliding || was_colliding)
+		{
+			out_changed.push_back(shape_idx);
+		}
+	}
+}
+
+
+// only the candidates get tested, inout_colliding has to hold last call's result so those flags can be cleared
+void CollideShapeCandidatesWithPoint(ShapeComponents& shapes, const ShapePrototypeLibrary& prototypes, const Vec2& point,
+	const std::vector<int>& candidates, std::vector<int>& inout_colliding, std::vector<int>& out_changed)
+{
+	out_changed = inout_colliding;
+
+	const int num_candidates = static_cast<int>(candidates.size());
+	int num_colliding = 0;
+	for(int candidate_idx = 0; candidate_idx < num_candidates; ++candidate_idx)
+	{
+		const int shape_idx = candidates[candidate_idx];
+		const Vec2 offset = point - shapes.m_positions[shape_idx];
+		const float radius = shapes.m_scales[shape_idx];
+		if(offset.GetLengthSquared() > radius * radius)
+		{
+			QUERY_COUNT(QUERY_DISC_REJECTIONS);
+			continue;
+		}
+
+		if(!IsPointInsideShape(shapes, prototypes, shape_idx, point))
+		{
+			continue;
+		}
+
+		if((shapes.m_flags[shape_idx] & SHAPE_FLAG_COLLIDING) == 0)
+		{
+			out_changed.push_back(shape_idx);
+		}
+
+		// the old list is still needed below, the new one is built after it
+		inout_colliding.push_back(shape_idx);
+		++num_colliding;
+	}
+
+	const int num_previous = static_cast<int>(inout_colliding.size()) - num_colliding;
+	for(int previous_idx = 0; previous_idx < num_previous; ++previous_idx)
+	{
+		shapes.m_flags[inout_colliding[previous_idx]] &= ~SHAPE_FLAG_COLLIDING;
+	}
+
+	inout_colliding.erase(inout_colliding.begin(), inout_colliding.begin() + num_previous);
+	std::sort(inout_colliding.begin(), inout_colliding.end());
+	for(int colliding_idx = 0; colliding_idx < num_colliding; ++colliding_idx)
+	{
+		shapes.m_flags[inout_colliding[colliding_idx]] |= SHAPE_FLAG_COLLIDING;
+	}
+}
+
+
+int CountRaysHittingShapes(const ShapeComponents& shapes, const ShapePrototypeLibrary& prototypes, const Ray2* rays, const int num_rays)
+{
+	const int num_shapes = shapes.GetCount();
+	int num_hits = 0;
+
+	for(int ray_idx = 0; ray_idx < num_rays; ++ray_idx)
+	{
+		for(int shape_idx = 0; shape_idx < num_shapes; ++shape_idx)
+		{
+			if(DoesRayHitShape(shapes, prototypes, shape_idx, rays[ray_idx]))
+			{
+				++num_hits;
+				break;
+			}
+		}
+	}
+
+	return num_hits;
+}
+
+
+void RenderShapes(const ShapeComponents& shapes, const ShapePrototypeLibrary& prototypes, const Material& material, const bool dev_mode)
+{
+	g_theRenderer->BindMaterial(material);
+
+	const int num_shapes = shapes.GetCount();
+	for(int shape_idx = 0; shape_idx < num_shapes; ++shape_idx)
+	{
+		if((shapes.m_flags[shape_idx] & SHAPE_FLAG_OCCLUDED) == 0)
+		{
+			RenderShape(shapes, prototypes, shape_idx, dev_mode);
+		}
+	}
+}
+
+//--------------------------------------------------------------------
+
+// inside when n.p <= d for every plane, ignore_plane_idx lets a point sitting on that plane count
+bool IsPointInsideShape(const ShapeComponents& shapes, const ShapePrototypeLibrary& prototypes, const int shape_idx, const Vec2& world_pos, const int ignore_plane_idx)
+{
+	QUERY_COUNT(QUERY_POINT_IN_SHAPE_TESTS);
+
+	const Vec2 local_pos = shapes.m_frames[shape_idx].ToLocalPosition(world_pos);
+	const std::vector<Plane2>& planes = prototypes.GetPrototype(shapes.m_prototypeIds[shape_idx]).m_hull.m_planes;
+
+	const int num_planes = static_cast<int>(planes.size());
+	for(int plane_idx = 0; plane_idx < num_planes; ++plane_idx)
+	{
+		if(plane_idx == ignore_plane_idx)
+		{
+			continue;
+		}
+
+		if(DotProduct(planes[plane_idx].m_normal, local_pos) > planes[plane_idx].m_signedDistance)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+// clips the ray against every plane in local space, it hits if some stretch of it is inside them all
+bool DoesRayHitShape(const ShapeComponents& shapes, const ShapePrototypeLibrary& prototypes, const int shape_idx, const Ray2& ray)
+{
+	float t = 0.0f;
+	int plane_idx = -1;
+	return RaycastShape(shapes, prototypes, shape_idx, ray, t, plane_idx);
+}
+
+
+// out_t is where the ray enters the shape in the ray's own units, the local transform is linear so it
+// carries straight over. Rays starting inside report t = 0 and no plane.
+bool RaycastShape(const ShapeComponents& shapes, const ShapePrototypeLibrary& prototypes, const int shape_idx, const Ray2& ray, float& out_t, int& out_plane_idx)
+{
+	QUERY_COUNT(QUERY_RAY_SHAPE_TESTS);
+
+	// bounding disc first
+	const Vec2 to_center = shapes.m_positions[shape_idx] - ray.m_pos;
+	const float radius = shapes.m_scales[shape_idx];
+	const float dir_length_sqr = ray.m_dir.GetLengthSquared();
+	float closest_t = DotProduct(to_center, ray.m_dir);
+	closest_t = closest_t > 0.0f ? closest_t / dir_length_sqr : 0.0f;
+	const Vec2 closest_offset = to_center - ray.m_dir * closest_t;
+	if(closest_offset.GetLengthSquared() > radius * radius)
+	{
+		QUERY_COUNT(QUERY_DISC_REJECTIONS);
+		return false;
+	}
+
+	const ShapeFrame& frame = shapes.m_frames[shape_idx];
+	const Vec2 local_pos = frame.ToLocalPosition(ray.m_pos);
+	const Vec2 local_dir = frame.ToLocalVector(ray.m_dir);
+	const std::vector<Plane2>& planes = prototypes.GetPrototype(shapes.m_prototypeIds[shape_idx]).m_hull.m_planes;
+
+	float t_enter = 0.0f;
+	float t_exit = INFINITY;
+	int enter_plane_idx = -1;
+
+	const int num_planes = static_cast<int>(planes.size());
+	for(int plane_idx = 0; plane_idx < num_planes; ++plane_idx)
+	{
+		const float towards = DotProduct(planes[plane_idx].m_normal, local_dir);
+		const float room = planes[plane_idx].m_signedDistance - DotProduct(planes[plane_idx].m_normal, local_pos);
+
+		if(towards == 0.0f)
+		{
+			if(room < 0.0f)
+			{
+				QUERY_COUNT_N(QUERY_RAY_PLANES_TESTED, plane_idx + 1);
+				return false;
+			}
+			continue;
+		}
+
+		const float t = room / towards;
+		if(towards < 0.0f)
+		{
+			if(t > t_enter)
+			{
+				t_enter = t;
+				enter_plane_idx = plane_idx;
+			}
+		}
+		else
+		{
+			t_exit = t < t_exit ? t : t_exit;
+		}
+
+		if(t_enter > t_exit)
+		{
+			QUERY_COUNT_N(QUERY_RAY_PLANES_TESTED, plane_idx + 1);
+			return false;
+		}
+	}
+
+	QUERY_COUNT_N(QUERY_RAY_PLANES_TESTED, num_planes);
+	out_t = t_enter;
+	out_plane_idx = enter_plane_idx;
+	return true;
+}
+
+
+// expects the shape material to be bound already
+void RenderShape(const ShapeComponents& shapes, const ShapePrototypeLibrary& prototypes, const int shape_idx, const bool dev_mode)
+{
+	const ShapePrototype& prototype = prototypes.GetPrototype(shapes.m_prototypeIds[shape_idx]);
+	const Matrix44 model_matrix = shapes.GetModelMatrix(shape_idx);
+	const bool colliding = (shapes.m_flags[shape_idx] & SHAPE_FLAG_COLLIDING) != 0;
+
+	g_theRenderer->BindModelMatrix(model_matrix);
+	g_theRenderer->DrawMesh(*prototype.m_mesh);
+
+	if(dev_mode)
+	{
+		g_theRenderer->DrawMesh(*prototypes.GetBoundsDiscMesh(colliding));
+
+		if(colliding)
+		{
+			prototype.m_hull.DebugRender(model_matrix);
+		}
+	}
+}
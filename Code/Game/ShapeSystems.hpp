@@ -0,0 +1,24 @@
+#pragma once
+#include "Engine/Math/Ray2.hpp"
+#include "Engine/Math/Vec2.hpp"
+
+#include <vector>
+
+struct ShapeComponents;
+class ShapePrototypeLibrary;
+class Material;
+
+// Batched passes over ShapeComponents. Each walks the arrays front to back once,
+// so the per-shape work never goes through a virtual call or a Matrix44 inverse.
+
+void	CollideShapesWithPoint(ShapeComponents& shapes, const ShapePrototypeLibrary& prototypes, const Vec2& point,
+			std::vector<int>& out_colliding, std::vector<int>& out_changed);
+void	CollideShapeCandidatesWithPoint(ShapeComponents& shapes, const ShapePrototypeLibrary& prototypes, const Vec2& point,
+			const std::vector<int>& candidates, std::vector<int>& inout_colliding, std::vector<int>& out_changed);
+int		CountRaysHittingShapes(const ShapeComponents& shapes, const ShapePrototypeLibrary& prototypes, const Ray2* rays, int num_rays);
+void	RenderShapes(const ShapeComponents& shapes, const ShapePrototypeLibrary& prototypes, const Material& material, bool dev_mode);
+
+bool	IsPointInsideShape(const ShapeComponents& shapes, const ShapePrototypeLibrary& prototypes, int shape_idx, const Vec2& world_pos, int ignore_plane_idx = -1);
+bool	DoesRayHitShape(const ShapeComponents& shapes, const ShapePrototypeLibrary& prototypes, int shape_idx, const Ray2& ray);
+bool	RaycastShape(const ShapeComponents& shapes, const ShapePrototypeLibrary& prototypes, int shape_idx, const Ray2& ray, float& out_t, int& out_plane_idx);
+void	RenderShape(const ShapeComponents& shapes, const ShapePrototypeLibrary& prototypes, int shape_idx, bool dev_mode);
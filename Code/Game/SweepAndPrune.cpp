@@ -0,0 +1,331 @@
+#include "Game/SweepAndPrune.hpp"
+#include "Game/ConvexShape.hpp"
+#include "Game/Profiler.hpp"
+#include "Game/ShapeComponents.hpp"
+#include "Game/ShapePrototypes.hpp"
+#include "Game/TestScene.hpp"
+
+#include <algorithm>
+
+
+SweepAndPrune::SweepAndPrune() = default;
+SweepAndPrune::~SweepAndPrune() = default;
+
+
+// cheap while the shapes keep their count and only move a little, anything else should Rebuild
+void SweepAndPrune::Update(const ShapeComponents& shapes)
+{
+	PROFILE_SCOPE("SweepAndPrune::Update");
+
+	if(shapes.GetCount() != m_numShapes)
+	{
+		Rebuild(shapes);
+		return;
+	}
+
+	m_events.clear();
+	m_numSwaps = 0;
+
+	ReadBounds(shapes);
+	for(int axis = 0; axis < 2; ++axis)
+	{
+		std::vector<Endpoint>& endpoints = m_endpoints[axis];
+		const int num_endpoints = static_cast<int>(endpoints.size());
+		for(int endpoint_idx = 0; endpoint_idx < num_endpoints; ++endpoint_idx)
+		{
+			endpoints[endpoint_idx].m_value = m_bounds[axis][endpoints[endpoint_idx].m_id];
+		}
+
+		SortAxis(axis);
+	}
+}
+
+
+// full sort plus one sweep, the pairs that changed still come out as events
+void SweepAndPrune::Rebuild(const ShapeComponents& shapes)
+{
+	PROFILE_SCOPE("SweepAndPrune::Rebuild");
+
+	m_events.clear();
+	m_numSwaps = 0;
+	m_numShapes = shapes.GetCount();
+	ReadBounds(shapes);
+
+	for(int axis = 0; axis < 2; ++axis)
+	{
+		std::vector<Endpoint>& endpoints = m_endpoints[axis];
+		endpoints.resize(m_numShapes * 2);
+		for(int id = 0; id < m_numShapes * 2; ++id)
+		{
+			endpoints[id].m_value = m_bounds[axis][id];
+			endpoints[id].m_id = id;
+		}
+
+		std::sort(endpoints.begin(), endpoints.end(), [](const Endpoint& a, const Endpoint& b)
+		{
+			return a.m_value < b.m_value || (a.m_value == b.m_value && (a.m_id & 1) < (b.m_id & 1));
+		});
+
+		m_endpointSlots[axis].resize(m_numShapes * 2);
+		for(int slot = 0; slot < m_numShapes * 2; ++slot)
+		{
+			m_endpointSlots[axis][endpoints[slot].m_id] = slot;
+		}
+	}
+
+	// sweep x keeping the open boxes, anything open when a box starts overlaps it on x
+	std::unordered_set<uint64_t> new_pairs;
+	std::vector<int> open_shapes;
+	std::vector<int> open_slot(m_numShapes, -1);
+	for(const Endpoint& endpoint : m_endpoints[0])
+	{
+		const int shape_idx = endpoint.m_id >> 1;
+		if((endpoint.m_id & 1) == 0)
+		{
+			for(const int open_idx : open_shapes)
+			{
+				if(BoxesOverlap(shape_idx, open_idx))
+				{
+					new_pairs.insert(MakePairKey(shape_idx, open_idx));
+				}
+			}
+
+			open_slot[shape_idx] = static_cast<int>(open_shapes.size());
+			open_shapes.push_back(shape_idx);
+		}
+		else
+		{
+			const int slot = open_slot[shape_idx];
+			open_shapes[slot] = open_shapes.back();
+			open_slot[open_shapes[slot]] = slot;
+			open_shapes.pop_back();
+		}
+	}
+
+	for(const uint64_t pair : m_pairs)
+	{
+		if(new_pairs.find(pair) == new_pairs.end())
+		{
+			m_events.push_back({ GetPairShapeA(pair), GetPairShapeB(pair), false });
+		}
+	}
+
+	for(const uint64_t pair : new_pairs)
+	{
+		if(m_pairs.find(pair) == m_pairs.end())
+		{
+			m_events.push_back({ GetPairShapeA(pair), GetPairShapeB(pair), true });
+		}
+	}
+
+	m_pairs.swap(new_pairs);
+}
+
+
+STATIC uint64_t SweepAndPrune::MakePairKey(const int shape_a, const int shape_b)
+{
+	const int low = shape_a < shape_b ? shape_a : shape_b;
+	const int high = shape_a < shape_b ? shape_b : shape_a;
+	return (static_cast<uint64_t>(low) << 32) | static_cast<uint32_t>(high);
+}
+
+
+STATIC int SweepAndPrune::GetPairShapeA(const uint64_t pair_key)
+{
+	return static_cast<int>(pair_key >> 32);
+}
+
+
+STATIC int SweepAndPrune::GetPairShapeB(const uint64_t pair_key)
+{
+	return static_cast<int>(pair_key & 0xFFFFFFFFu);
+}
+
+
+// the bounding disc's box, prototypes all fit the unit circle
+void SweepAndPrune::ReadBounds(const ShapeComponents& shapes)
+{
+	m_bounds[0].resize(m_numShapes * 2);
+	m_bounds[1].resize(m_numShapes * 2);
+
+	for(int shape_idx = 0; shape_idx < m_numShapes; ++shape_idx)
+	{
+		const Vec2& center = shapes.m_positions[shape_idx];
+		const float radius = shapes.m_scales[shape_idx];
+		m_bounds[0][shape_idx * 2] = center.x - radius;
+		m_bounds[0][shape_idx * 2 + 1] = center.x + radius;
+		m_bounds[1][shape_idx * 2] = center.y - radius;
+		m_bounds[1][shape_idx * 2 + 1] = center.y + radius;
+	}
+}
+
+
+void SweepAndPrune::SortAxis(const int axis)
+{
+	std::vector<Endpoint>& endpoints = m_endpoints[axis];
+	std::vector<int>& slots = m_endpointSlots[axis];
+	const int num_endpoints = static_cast<int>(endpoints.size());
+
+	for(int endpoint_idx = 1; endpoint_idx < num_endpoints; ++endpoint_idx)
+	{
+		const Endpoint moving = endpoints[endpoint_idx];
+		const bool moving_is_max = (moving.m_id & 1) != 0;
+
+		int slot = endpoint_idx;
+		while(slot > 0 && moving.m_value < endpoints[slot - 1].m_value)
+		{
+			const Endpoint& passed = endpoints[slot - 1];
+			const bool passed_is_max = (passed.m_id & 1) != 0;
+
+			if(!moving_is_max && passed_is_max)
+			{
+				// a min slid under someone's max, they may have started overlapping
+				if(BoxesOverlap(moving.m_id >> 1, passed.m_id >> 1))
+				{
+					AddPair(moving.m_id >> 1, passed.m_id >> 1);
+				}
+			}
+			else if(moving_is_max && !passed_is_max)
+			{
+				// a max slid under someone's min, they no longer overlap on this axis
+				RemovePair(moving.m_id >> 1, passed.m_id >> 1);
+			}
+
+			endpoints[slot] = passed;
+			slots[passed.m_id] = slot;
+			--slot;
+			++m_numSwaps;
+		}
+
+		endpoints[slot] = moving;
+		slots[moving.m_id] = slot;
+	}
+}
+
+
+bool SweepAndPrune::BoxesOverlap(const int shape_a, const int shape_b) const
+{
+	for(int axis = 0; axis < 2; ++axis)
+	{
+		const std::vector<float>& bounds = m_bounds[axis];
+		if(bounds[shape_a * 2] > bounds[shape_b * 2 + 1] || bounds[shape_b * 2] > bounds[shape_a * 2 + 1])
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+void SweepAndPrune::AddPair(const int shape_a, const int shape_b)
+{
+	const uint64_t pair = MakePairKey(shape_a, shape_b);
+	if(m_pairs.insert(pair).second)
+	{
+		m_events.push_back({ GetPairShapeA(pair), GetPairShapeB(pair), true });
+	}
+}
+
+
+void SweepAndPrune::RemovePair(const int shape_a, const int shape_b)
+{
+	const uint64_t pair = MakePairKey(shape_a, shape_b);
+	if(m_pairs.erase(pair) > 0)
+	{
+		m_events.push_back({ GetPairShapeA(pair), GetPairShapeB(pair), false });
+	}
+}
+
+//--------------------------------------------------------------------
+
+// bounding disc boxes, touching counts as overlapping like BoxesOverlap
+static void FindBoxPairsBruteForce(const ShapeComponents& shapes, std::unordered_set<uint64_t>& out_pairs)
+{
+	out_pairs.clear();
+	const int num_shapes = shapes.GetCount();
+	for(int shape_a = 0; shape_a < num_shapes; ++shape_a)
+	{
+		for(int shape_b = shape_a + 1; shape_b < num_shapes; ++shape_b)
+		{
+			const Vec2 extents_a(shapes.m_scales[shape_a], shapes.m_scales[shape_a]);
+			const Vec2 extents_b(shapes.m_scales[shape_b], shapes.m_scales[shape_b]);
+			const Vec2 mins_a = shapes.m_positions[shape_a] - extents_a;
+			const Vec2 maxs_a = shapes.m_positions[shape_a] + extents_a;
+			const Vec2 mins_b = shapes.m_positions[shape_b] - extents_b;
+			const Vec2 maxs_b = shapes.m_positions[shape_b] + extents_b;
+			if(mins_a.x <= maxs_b.x && mins_b.x <= maxs_a.x && mins_a.y <= maxs_b.y && mins_b.y <= maxs_a.y)
+			{
+				out_pairs.insert(SweepAndPrune::MakePairKey(shape_a, shape_b));
+			}
+		}
+	}
+}
+
+
+// replaying the events on last frame's pairs has to land on this frame's, and both on brute force
+static bool PairsMatch(const SweepAndPrune& broadphase, const ShapeComponents& shapes, std::unordered_set<uint64_t>& inout_replayed)
+{
+	for(const ShapePairEvent& pair_event : broadphase.GetEvents())
+	{
+		const uint64_t pair = SweepAndPrune::MakePairKey(pair_event.m_shapeA, pair_event.m_shapeB);
+		const bool changed = pair_event.m_added ? inout_replayed.insert(pair).second : inout_replayed.erase(pair) > 0;
+		if(pair_event.m_shapeA >= pair_event.m_shapeB || !changed)
+		{
+			return false;
+		}
+	}
+
+	std::unordered_set<uint64_t> expected;
+	FindBoxPairsBruteForce(shapes, expected);
+	return broadphase.GetPairs() == expected && inout_replayed == expected;
+}
+
+
+// most frames nudge a third of the shapes and go through the insertion sort, every eighth drops a few
+// shapes off the end, which has to come out as removal events for every pair they were in
+UNITTEST("SweepAndPrune pairs match brute force after moves and removals", "SweepAndPrune", 0)
+{
+	constexpr int num_shapes = 400;
+	uint random_state = 0x510E527Fu;
+	ShapePrototypeLibrary prototypes;
+	ShapeComponents shapes;
+	BuildTestScene(prototypes, shapes, random_state, 8, num_shapes, ConvexShape2D::MIN_SIZE * 0.5f, ConvexShape2D::MAX_SIZE * 0.5f);
+
+	SweepAndPrune broadphase;
+	std::unordered_set<uint64_t> replayed;
+	broadphase.Rebuild(shapes);
+	if(!PairsMatch(broadphase, shapes, replayed) || replayed.empty())
+	{
+		return false;
+	}
+
+	int total_swaps = 0;
+	for(int frame_idx = 1; frame_idx < 40; ++frame_idx)
+	{
+		if(frame_idx % 8 == 0)
+		{
+			for(int removed_idx = 0; removed_idx < 5; ++removed_idx)
+			{
+				shapes.RemoveLast();
+			}
+		}
+		else
+		{
+			for(int shape_idx = frame_idx % 3; shape_idx < shapes.GetCount(); shape_idx += 3)
+			{
+				const Vec2 nudge(NextTestRandom(random_state) * 2.0f - 1.0f, NextTestRandom(random_state) * 2.0f - 1.0f);
+				shapes.SetTransform(shape_idx, shapes.m_positions[shape_idx] + nudge, shapes.m_orientationDegrees[shape_idx], shapes.m_scales[shape_idx]);
+			}
+		}
+
+		broadphase.Update(shapes);
+		total_swaps += broadphase.GetNumSwaps();
+		if(broadphase.GetNumShapes() != shapes.GetCount() || !PairsMatch(broadphase, shapes, replayed))
+		{
+			return false;
+		}
+	}
+
+	return total_swaps > 0;
+}
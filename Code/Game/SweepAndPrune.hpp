@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+
+struct ShapeComponents;
+
+struct ShapePairEvent
+{
+	int		m_shapeA = -1;		// always the lower index
+	int		m_shapeB = -1;
+	bool	m_added = false;	// false when the boxes stopped overlapping
+};
+
+// Persistent broadphase over the shapes' bounding boxes. The endpoint lists stay sorted between frames,
+// so when shapes only nudge a little the insertion sort does close to nothing, and every swap of a min
+// past a max is exactly one pair starting or stopping overlap on that axis.
+class SweepAndPrune
+{
+public:
+	SweepAndPrune();
+	~SweepAndPrune();
+
+	void	Update(const ShapeComponents& shapes);
+	void	Rebuild(const ShapeComponents& shapes);
+
+	int								GetNumShapes() const	{ return m_numShapes; }
+	int								GetNumPairs() const		{ return static_cast<int>(m_pairs.size()); }
+	int								GetNumSwaps() const		{ return m_numSwaps; }
+	const std::vector<ShapePairEvent>&	GetEvents() const	{ return m_events; }
+	const std::unordered_set<uint64_t>&	GetPairs() const	{ return m_pairs; }
+
+	static uint64_t	MakePairKey(int shape_a, int shape_b);
+	static int		GetPairShapeA(uint64_t pair_key);
+	static int		GetPairShapeB(uint64_t pair_key);
+
+private:
+	struct Endpoint
+	{
+		float	m_value = 0.0f;
+		int		m_id = 0;		// shape index * 2, plus one for the max end
+	};
+
+	void	ReadBounds(const ShapeComponents& shapes);
+	void	SortAxis(int axis);
+	bool	BoxesOverlap(int shape_a, int shape_b) const;
+	void	AddPair(int shape_a, int shape_b);
+	void	RemovePair(int shape_a, int shape_b);
+
+private:
+	int							m_numShapes = 0;
+	std::vector<float>			m_bounds[2];		// per axis, min and max of each shape side by side
+	std::vector<Endpoint>		m_endpoints[2];
+	std::vector<int>			m_endpointSlots[2];	// where each endpoint currently sits in m_endpoints
+
+	std::unordered_set<uint64_t>	m_pairs;
+	std::vector<ShapePairEvent>		m_events;
+	int								m_numSwaps = 0;
+};
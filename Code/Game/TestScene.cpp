@@ -0,0 +1,115 @@
+#include "Game/TestScene.hpp"
+#include "Game/ShapeComponents.hpp"
+#include "Game/ShapePrototypes.hpp"
+
+#include "Engine/Math/MathUtils.hpp"
+
+#include <algorithm>
+
+
+float NextTestRandom(uint& random_state)
+{
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 17;
+	random_state ^= random_state << 5;
+	return static_cast<float>(random_state & 0xFFFFFF) / static_cast<float>(0x1000000);
+}
+
+
+Vec2 GetTestWorldPosition(uint& random_state)
+{
+	const float x = WORLD_BL_CORNER.x + NextTestRandom(random_state) * WORLD_WIDTH;
+	const float y = WORLD_BL_CORNER.y + NextTestRandom(random_state) * WORLD_HEIGHT;
+	return Vec2(x, y);
+}
+
+
+void AddTestCirclePoints(uint& random_state, const Vec2& center, const float radius, const int num_points, std::vector<Vec2>& out_points)
+{
+	const float slice_degrees = 360.0f / static_cast<float>(num_points);
+	const float start_degrees = NextTestRandom(random_state) * 360.0f;
+	for(int point_idx = 0; point_idx < num_points; ++point_idx)
+	{
+		const float degrees = start_degrees + slice_degrees * (static_cast<float>(point_idx) + 0.8f * NextTestRandom(random_state));
+		out_points.push_back(center + Vec2(CosDegrees(degrees), SinDegrees(degrees)) * radius);
+	}
+}
+
+
+void BuildTestScene(ShapePrototypeLibrary& prototypes, ShapeComponents& shapes, uint& random_state,
+	const int num_prototypes, const int num_shapes, const float min_scale, const float max_scale)
+{
+	std::vector<Vec2> points;
+	std::vector<float> points_x;
+	std::vector<float> points_y;
+	std::vector<int> point_starts(1, 0);
+	for(int prototype_idx = 0; prototype_idx < num_prototypes; ++prototype_idx)
+	{
+		points.clear();
+		AddTestCirclePoints(random_state, Vec2::ZERO, 1.0f, 3 + prototype_idx % 8, points);
+		for(const Vec2& point : points)
+		{
+			points_x.push_back(point.x);
+			points_y.push_back(point.y);
+		}
+		point_starts.push_back(static_cast<int>(points_x.size()));
+	}
+	prototypes.SetFromPolygons(points_x.data(), points_y.data(), point_starts.data(), num_prototypes);
+
+	for(int shape_idx = 0; shape_idx < num_shapes; ++shape_idx)
+	{
+		const int component_idx = shapes.Add(nullptr);
+		shapes.m_prototypeIds[component_idx] = shape_idx % num_prototypes;
+
+		const Vec2 position = GetTestWorldPosition(random_state);
+		const float scale = min_scale + NextTestRandom(random_state) * (max_scale - min_scale);
+		shapes.SetTransform(component_idx, position, NextTestRandom(random_state) * 360.0f, scale);
+	}
+}
+
+
+void GetTestWorldPoints(const ShapePrototypeLibrary& prototypes, const ShapeComponents& shapes, const int shape_idx, std::vector<Vec2>& out_points)
+{
+	out_points.clear();
+	for(const Vec2& local_point : prototypes.GetPrototype(shapes.m_prototypeIds[shape_idx]).m_polygon.m_points)
+	{
+		out_points.push_back(shapes.m_frames[shape_idx].ToWorldPosition(local_point));
+	}
+}
+
+
+bool TestPolygonsOverlap(const Vec2* points_a, const int num_a, const Vec2* points_b, const int num_b)
+{
+	for(int polygon_idx = 0; polygon_idx < 2; ++polygon_idx)
+	{
+		const Vec2* edge_points = polygon_idx == 0 ? points_a : points_b;
+		const int num_edges = polygon_idx == 0 ? num_a : num_b;
+		for(int edge_idx = 0; edge_idx < num_edges; ++edge_idx)
+		{
+			const Vec2 axis = (edge_points[(edge_idx + 1) % num_edges] - edge_points[edge_idx]).GetRotated90Degrees();
+
+			float min_a = DotProduct(axis, points_a[0]);
+			float max_a = min_a;
+			for(int point_idx = 1; point_idx < num_a; ++point_idx)
+			{
+				min_a = std::min(min_a, DotProduct(axis, points_a[point_idx]));
+				max_a = std::max(max_a, DotProduct(axis, points_a[point_idx]));
+			}
+
+			float min_b = DotProduct(axis, points_b[0]);
+			float max_b = min_b;
+			for(int point_idx = 1; point_idx < num_b; ++point_idx)
+			{
+				min_b = std::min(min_b, DotProduct(axis, points_b[point_idx]));
+				max_b = std::max(max_b, DotProduct(axis, points_b[point_idx]));
+			}
+
+			if(max_a < min_b || max_b < min_a)
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include "Game/GameCommon.hpp"
+
+#include "Engine/Math/Vec2.hpp"
+
+#include <vector>
+
+struct ShapeComponents;
+class ShapePrototypeLibrary;
+
+// Fixtures shared by the UNITTESTs and benchmarks. Everything is drawn from one xorshift stream the
+// caller seeds, so a test gets the same scene every run and leaves the game's generator alone.
+
+float	NextTestRandom(uint& random_state);		// in [0, 1)
+Vec2	GetTestWorldPosition(uint& random_state);
+
+// one jittered point per equal slice of the circle, so the points stay distinct, convex and counter clockwise
+void	AddTestCirclePoints(uint& random_state, const Vec2& center, float radius, int num_points, std::vector<Vec2>& out_points);
+
+// prototypes are jittered polygons on the unit circle like the rolled ones, so a shape's scale is its
+// bounding radius. Shapes are scattered over the world and take the prototypes in turn
+void	BuildTestScene(ShapePrototypeLibrary& prototypes, ShapeComponents& shapes, uint& random_state,
+			int num_prototypes, int num_shapes, float min_scale, float max_scale);
+
+void	GetTestWorldPoints(const ShapePrototypeLibrary& prototypes, const ShapeComponents& shapes, int shape_idx, std::vector<Vec2>& out_points);
+
+// separating axis test over every edge normal of both polygons, no early outs or cached axes to trust
+bool	TestPolygonsOverlap(const Vec2* points_a, int num_a, const Vec2* points_b, int num_b);
@@ -0,0 +1,277 @@
+#include "Game/VisibilityPolygon.hpp"
+#include "Game/Profiler.hpp"
+#include "Game/TestScene.hpp"
+
+#include "Engine/Math/MathUtils.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+constexpr float VISIBILITY_PI = 3.14159265358979f;
+constexpr float MIN_SPAN_ANGLE = 0.00001f;
+
+
+void AngularOcclusion::Clear()
+{
+	m_occluded.clear();
+}
+
+
+// reports the parts of [start_angle, end_angle] nothing covered yet, then covers all of it. Intervals
+// less than MIN_SPAN_ANGLE apart merge too, the gap is too thin to report, and leaving it would keep
+// IsFull from ever seeing one interval. Finding the overlap is a binary search, but the vector still
+// shifts its tail on a merge or insert, so the worst case is linear in the disjoint intervals; they
+// are 8 bytes each and merge down as the gaps close, so that shift stays one short memmove
+void AngularOcclusion::Occlude(const float start_angle, const float end_angle, TaggedVector<AngleInterval, MEM_TAG_SCRATCH>& out_newly_visible)
+{
+	out_newly_visible.clear();
+
+	const auto first = std::lower_bound(m_occluded.begin(), m_occluded.end(), start_angle - MIN_SPAN_ANGLE,
+		[](const AngleInterval& interval, const float angle) { return interval.m_end < angle; });
+
+	float cursor = start_angle;
+	auto last = first;
+	for(; last != m_occluded.end() && last->m_start <= end_angle + MIN_SPAN_ANGLE; ++last)
+	{
+		if(last->m_start - cursor > MIN_SPAN_ANGLE)
+		{
+			out_newly_visible.push_back({ cursor, last->m_start });
+		}
+		cursor = last->m_end > cursor ? last->m_end : cursor;
+	}
+
+	if(end_angle - cursor > MIN_SPAN_ANGLE)
+	{
+		out_newly_visible.push_back({ cursor, end_angle });
+	}
+
+	// already inside a single interval, or too thin to keep
+	const int num_touched = static_cast<int>(last - first);
+	if(out_newly_visible.empty() && num_touched <= 1)
+	{
+		return;
+	}
+
+	// everything from first to last merges into one interval
+	AngleInterval merged = { start_angle, end_angle };
+	if(num_touched > 0)
+	{
+		merged.m_start = first->m_start < start_angle ? first->m_start : start_angle;
+		merged.m_end = (last - 1)->m_end > end_angle ? (last - 1)->m_end : end_angle;
+
+		*first = merged;
+		m_occluded.erase(first + 1, last);
+	}
+	else
+	{
+		m_occluded.insert(first, merged);
+	}
+}
+
+
+bool AngularOcclusion::IsFull() const
+{
+	return m_occluded.size() == 1
+		&& m_occluded[0].m_start <= -VISIBILITY_PI + MIN_SPAN_ANGLE
+		&& m_occluded[0].m_end >= VISIBILITY_PI - MIN_SPAN_ANGLE;
+}
+
+//--------------------------------------------------------------------
+
+void VisibilityPolygonQuery::Compute(const BSPTree& tree, const Vec2& viewpoint, const AABB2& clip_bounds, std::vector<Vec2>& out_polygon)
+{
+	PROFILE_SCOPE("VisibilityPolygonQuery::Compute");
+
+	m_viewpoint = viewpoint;
+	m_occlusion.Clear();
+	m_spans.clear();
+	m_numSegmentsTested = 0;
+	out_polygon.clear();
+
+	m_iterator.Reset(tree, viewpoint, BSP_FRONT_TO_BACK);
+	int node_idx = -1;
+	while(!m_occlusion.IsFull() && m_iterator.Next(node_idx))
+	{
+		const BSPNode& node = tree.GetNode(node_idx);
+		if(!node.m_isLeaf)
+		{
+			AddSegment(node.m_segment);
+		}
+	}
+
+	// whatever no wall claimed sees out to the bounds, which are behind everything
+	const Vec2 bottom_right(clip_bounds.maxs.x, clip_bounds.mins.y);
+	const Vec2 top_left(clip_bounds.mins.x, clip_bounds.maxs.y);
+	AddSegment(Segment2(clip_bounds.mins, bottom_right));
+	AddSegment(Segment2(bottom_right, clip_bounds.maxs));
+	AddSegment(Segment2(clip_bounds.maxs, top_left));
+	AddSegment(Segment2(top_left, clip_bounds.mins));
+
+	std::sort(m_spans.begin(), m_spans.end(),
+		[](const VisibleSpan& a, const VisibleSpan& b) { return a.m_startAngle < b.m_startAngle; });
+
+	out_polygon.reserve(m_spans.size() * 2);
+	const int num_spans = static_cast<int>(m_spans.size());
+	for(int span_idx = 0; span_idx < num_spans; ++span_idx)
+	{
+		out_polygon.push_back(m_spans[span_idx].m_start);
+		out_polygon.push_back(m_spans[span_idx].m_end);
+	}
+
+	// shapes hang over the bounds, so their spans can poke out of it
+	ClipToBounds(clip_bounds, out_polygon);
+}
+
+
+void VisibilityPolygonQuery::AddSegment(const Segment2& segment)
+{
+	++m_numSegmentsTested;
+
+	Vec2 to_start = segment.m_start - m_viewpoint;
+	Vec2 to_end = segment.m_end - m_viewpoint;
+
+	// edge on to the viewpoint, it covers no angle
+	const float winding = to_start.x * to_end.y - to_start.y * to_end.x;
+	if(winding == 0.0f)
+	{
+		return;
+	}
+
+	// sweep counter clockwise from start to end
+	Segment2 ccw_segment = segment;
+	if(winding < 0.0f)
+	{
+		ccw_segment = Segment2(segment.m_end, segment.m_start);
+		const Vec2 swap = to_start;
+		to_start = to_end;
+		to_end = swap;
+	}
+
+	const float start_angle = atan2f(to_start.y, to_start.x);
+	const float end_angle = atan2f(to_end.y, to_end.x);
+
+	if(start_angle <= end_angle)
+	{
+		AddVisibleSpan(ccw_segment, start_angle, end_angle);
+	}
+	else
+	{
+		// crosses the -pi / pi seam
+		AddVisibleSpan(ccw_segment, start_angle, VISIBILITY_PI);
+		AddVisibleSpan(ccw_segment, -VISIBILITY_PI, end_angle);
+	}
+}
+
+
+void VisibilityPolygonQuery::AddVisibleSpan(const Segment2& segment, const float start_angle, const float end_angle)
+{
+	m_occlusion.Occlude(start_angle, end_angle, m_newlyVisible);
+
+	const int num_visible = static_cast<int>(m_newlyVisible.size());
+	for(int visible_idx = 0; visible_idx < num_visible; ++visible_idx)
+	{
+		const AngleInterval& interval = m_newlyVisible[visible_idx];
+
+		VisibleSpan span;
+		span.m_startAngle = interval.m_start;
+		span.m_start = PointAtAngle(segment, interval.m_start);
+		span.m_end = PointAtAngle(segment, interval.m_end);
+		m_spans.push_back(span);
+	}
+}
+
+
+// where the ray from the viewpoint at this angle crosses the segment's line
+Vec2 VisibilityPolygonQuery::PointAtAngle(const Segment2& segment, const float angle) const
+{
+	const Vec2 ray_dir(cosf(angle), sinf(angle));
+	const Vec2 seg_dir = segment.m_end - segment.m_start;
+	const Vec2 to_start = segment.m_start - m_viewpoint;
+
+	const float denominator = ray_dir.x * seg_dir.y - ray_dir.y * seg_dir.x;
+	if(denominator == 0.0f)
+	{
+		return segment.m_start;
+	}
+
+	const float fraction = ClampFloat((ray_dir.y * to_start.x - ray_dir.x * to_start.y) / denominator, 0.0f, 1.0f);
+	return segment.m_start + seg_dir * fraction;
+}
+
+
+// Sutherland-Hodgman against the four sides, a star shaped polygon stays star shaped
+void VisibilityPolygonQuery::ClipToBounds(const AABB2& clip_bounds, std::vector<Vec2>& polygon)
+{
+	const Vec2 normals[4] = { Vec2(-1.0f, 0.0f), Vec2(1.0f, 0.0f), Vec2(0.0f, -1.0f), Vec2(0.0f, 1.0f) };
+	const float distances[4] = { -clip_bounds.mins.x, clip_bounds.maxs.x, -clip_bounds.mins.y, clip_bounds.maxs.y };
+
+	for(int side_idx = 0; side_idx < 4; ++side_idx)
+	{
+		m_clipScratch.clear();
+
+		const int num_points = static_cast<int>(polygon.size());
+		for(int point_idx = 0; point_idx < num_points; ++point_idx)
+		{
+			const Vec2& current = polygon[point_idx];
+			const Vec2& next = polygon[(point_idx + 1) % num_points];
+			const float current_room = distances[side_idx] - DotProduct(normals[side_idx], current);
+			const float next_room = distances[side_idx] - DotProduct(normals[side_idx], next);
+
+			if(current_room >= 0.0f)
+			{
+				m_clipScratch.push_back(current);
+			}
+
+			if((current_room >= 0.0f) != (next_room >= 0.0f))
+			{
+				const float fraction = current_room / (current_room - next_room);
+				m_clipScratch.push_back(current + (next - current) * fraction);
+			}
+		}
+
+		polygon.swap(m_clipScratch);
+	}
+}
+
+//--------------------------------------------------------------------
+
+// walls that meet at a vertex leave rounding gaps far thinner than MIN_SPAN_ANGLE between their spans,
+// the circle has to count as full once every wall is in, whatever order they came in
+UNITTEST("AngularOcclusion closes gaps thinner than the minimum span", "VisibilityPolygon", 0)
+{
+	constexpr int num_walls = 97;
+	uint random_state = 0x3C6EF372u;
+
+	int order[num_walls];
+	for(int wall_idx = 0; wall_idx < num_walls; ++wall_idx)
+	{
+		order[wall_idx] = wall_idx;
+	}
+	for(int wall_idx = num_walls - 1; wall_idx > 0; --wall_idx)
+	{
+		std::swap(order[wall_idx], order[static_cast<int>(NextTestRandom(random_state) * static_cast<float>(wall_idx + 1))]);
+	}
+
+	AngularOcclusion occlusion;
+	TaggedVector<AngleInterval, MEM_TAG_SCRATCH> newly_visible;
+	const float wall_angle = 2.0f * VISIBILITY_PI / static_cast<float>(num_walls);
+	float visible_angle = 0.0f;
+	for(int order_idx = 0; order_idx < num_walls; ++order_idx)
+	{
+		const int wall_idx = order[order_idx];
+		const float start_angle = wall_idx == 0 ? -VISIBILITY_PI : -VISIBILITY_PI + wall_angle * static_cast<float>(wall_idx) + MIN_SPAN_ANGLE * 0.4f;
+		const float end_angle = wall_idx == num_walls - 1 ? VISIBILITY_PI : -VISIBILITY_PI + wall_angle * static_cast<float>(wall_idx + 1);
+		if(occlusion.IsFull())
+		{
+			return false;
+		}
+
+		occlusion.Occlude(start_angle, end_angle, newly_visible);
+		for(const AngleInterval& interval : newly_visible)
+		{
+			visible_angle += interval.m_end - interval.m_start;
+		}
+	}
+
+	return occlusion.IsFull() && fabsf(visible_angle - 2.0f * VISIBILITY_PI) < 0.001f;
+}
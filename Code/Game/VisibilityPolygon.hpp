@@ -0,0 +1,63 @@
+#pragma once
+#include "Engine/Math/AABB2.hpp"
+#include "Engine/Math/Segment2.hpp"
+#include "Engine/Math/Vec2.hpp"
+
+#include "Game/BSPTree.hpp"
+#include "Game/MemoryTags.hpp"
+
+#include <vector>
+
+struct AngleInterval
+{
+	float m_start = 0.0f;
+	float m_end = 0.0f;
+};
+
+// Sorted, disjoint angular ranges in [-pi, pi] that are already blocked, at least MIN_SPAN_ANGLE apart.
+class AngularOcclusion
+{
+public:
+	void	Clear();
+	void	Occlude(float start_angle, float end_angle, TaggedVector<AngleInterval, MEM_TAG_SCRATCH>& out_newly_visible);
+	bool	IsFull() const;
+
+private:
+	TaggedVector<AngleInterval, MEM_TAG_SCRATCH>	m_occluded;
+	TaggedVector<AngleInterval, MEM_TAG_SCRATCH>	m_scratch;
+};
+
+//--------------------------------------------------------------------
+
+struct VisibleSpan
+{
+	float	m_startAngle = 0.0f;
+	Vec2	m_start;
+	Vec2	m_end;
+};
+
+// Star shaped region seen from a viewpoint. The BSP hands over walls front to back, so the first
+// wall to claim an angle is the closest one there and everything after only fills the gaps.
+// Keep one of these per caller and reuse it, the buffers stay allocated between queries.
+class VisibilityPolygonQuery
+{
+public:
+	void	Compute(const BSPTree& tree, const Vec2& viewpoint, const AABB2& clip_bounds, std::vector<Vec2>& out_polygon);
+
+	int		GetNumSegmentsTested() const	{ return m_numSegmentsTested; }
+
+private:
+	void	AddSegment(const Segment2& segment);
+	void	AddVisibleSpan(const Segment2& segment, float start_angle, float end_angle);
+	Vec2	PointAtAngle(const Segment2& segment, float angle) const;
+	void	ClipToBounds(const AABB2& clip_bounds, std::vector<Vec2>& polygon);
+
+private:
+	Vec2							m_viewpoint;
+	BSPIterator						m_iterator;
+	AngularOcclusion				m_occlusion;
+	TaggedVector<AngleInterval, MEM_TAG_SCRATCH>	m_newlyVisible;
+	TaggedVector<VisibleSpan, MEM_TAG_SCRATCH>		m_spans;
+	std::vector<Vec2>				m_clipScratch;
+	int								m_numSegmentsTested = 0;
+};
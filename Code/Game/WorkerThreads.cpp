@@ -0,0 +1,54 @@
+#include "Game/WorkerThreads.hpp"
+
+
+WorkerThreads::WorkerThreads(const int num_threads)
+	: m_numThreads(num_threads)
+{
+	m_threads.reserve(num_threads - 1);
+	for(int thread_idx = 1; thread_idx < num_threads; ++thread_idx)
+	{
+		m_threads.emplace_back(&WorkerThreads::WorkerMain, this, thread_idx);
+	}
+}
+
+
+WorkerThreads::~WorkerThreads()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_quit = true;
+	}
+	m_wake.notify_all();
+
+	for(std::thread& thread : m_threads)
+	{
+		thread.join();
+	}
+}
+
+
+// Run waits for every worker, so none can miss a generation
+void WorkerThreads::WorkerMain(const int thread_idx)
+{
+	uint64_t seen_generation = 0;
+	for(;;)
+	{
+		const void* job = nullptr;
+		void (*invoke)(const void*, int) = nullptr;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_wake.wait(lock, [&]() { return m_quit || m_generation != seen_generation; });
+			if(m_quit)
+			{
+				return;
+			}
+
+			seen_generation = m_generation;
+			job = m_job;
+			invoke = m_invoke;
+		}
+
+		invoke(job, thread_idx);
+		m_numBusy.fetch_sub(1, std::memory_order_release);
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Threads kept alive across jobs, the caller always runs as thread 0. Workers sleep on a condition
+// variable between jobs, the caller spins for them to finish since a job is a fraction of a frame.
+class WorkerThreads
+{
+public:
+	explicit WorkerThreads(int num_threads);
+	~WorkerThreads();
+
+	WorkerThreads(const WorkerThreads&) = delete;
+	WorkerThreads& operator=(const WorkerThreads&) = delete;
+
+	int GetNumThreads() const { return m_numThreads; }
+
+	// job(thread_idx) runs once on every thread, Run returns when all of them have
+	template<typename Job>
+	void Run(const Job& job)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_job = &job;
+			m_invoke = [](const void* job_ptr, const int thread_idx) { (*static_cast<const Job*>(job_ptr))(thread_idx); };
+			m_numBusy.store(m_numThreads - 1, std::memory_order_relaxed);
+			++m_generation;
+		}
+		m_wake.notify_all();
+
+		job(0);
+
+		while(m_numBusy.load(std::memory_order_acquire) > 0)
+		{
+			std::this_thread::yield();
+		}
+	}
+
+private:
+	void WorkerMain(int thread_idx);
+
+private:
+	int							m_numThreads = 1;
+	std::vector<std::thread>	m_threads;
+	std::mutex					m_mutex;
+	std::condition_variable		m_wake;
+	const void*					m_job = nullptr;
+	void						(*m_invoke)(const void*, int) = nullptr;
+	uint64_t					m_generation = 0;
+	bool						m_quit = false;
+	std::atomic<int>			m_numBusy { 0 };
+};